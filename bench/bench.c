@@ -0,0 +1,1616 @@
+// Benchmarks of this library, each against the way the same work is done without it.
+//
+// Usage: string_bench [-n MAX] [CASE...]
+//
+// Runs the cases whose names start with one of the arguments, or all of them. Cases
+// that scale with the number of entries go up to MAX (10^6 by default). Each
+// measurement is the fastest of several runs, reported per operation (and in GB/s
+// where bytes are moved), so that builds of this library can be compared on the same machine.
+
+#include "cstring.h"
+#include "string_codec.h"
+#include "string_map.h"
+#include "string_queue.h"
+#include "string_sort.h"
+#include "string_vec.h"
+#include "string_writer.h"
+
+#include <assert.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+
+/// Runs of each measurement, of which the fastest is reported.
+#define RUNS 5
+
+/// Operations per measurement, spread over as many repetitions as the size of a case allows.
+#define OPS ((size_t)1 << 20)
+
+/// Results of measured code, so that it is not optimized away.
+static volatile size_t sink;
+
+/// Largest number of entries of cases that scale (see -n).
+static size_t max_entries = 1000000;
+
+/// @return @c p, hidden from the compiler so that calls of pure C library functions on it are not hoisted.
+static const char *opaque(const char *p)
+{
+    const char *volatile v = p;
+
+    return v;
+}
+
+/// @return Monotonic time in nanoseconds.
+static uint64_t now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/// Print the time @c best of @c ops operations over @c bytes bytes (zero if not meaningful).
+static void report(const char *name, size_t ops, size_t bytes, uint64_t best)
+{
+    if (best == 0) {
+        best = 1;
+    }
+
+    printf("%-48s %12.2f ns/op", name, (double)best / (double)ops);
+    if (bytes > 0) {
+        printf(" %8.2f GB/s", (double)bytes / (double)best);
+    }
+    printf("\n");
+    fflush(stdout);
+}
+
+/// Time @c fn on @c arg, which performs @c ops operations over @c bytes bytes (zero if not meaningful), and print it.
+static void measure(const char *name, size_t ops, size_t bytes, void (*fn)(void *), void *arg)
+{
+    uint64_t best = UINT64_MAX;
+    int i;
+
+    for (i = 0; i < RUNS; ++i) {
+        uint64_t start = now();
+        uint64_t elapsed;
+
+        fn(arg);
+        elapsed = now() - start;
+        if (elapsed < best) {
+            best = elapsed;
+        }
+    }
+
+    report(name, ops, bytes, best);
+}
+
+/// @return Bytes of the heap in use, including the overhead of the allocator, or zero where unknown.
+static size_t heap_in_use(void)
+{
+#ifdef __GLIBC__
+    struct mallinfo2 info = mallinfo2();
+
+    return info.uordblks + info.hblkhd;
+#else
+    return 0;
+#endif
+}
+
+/// Print the heap used by @c n objects, since it was @c before.
+static void footprint(const char *name, size_t n, size_t before)
+{
+    printf("%-48s %12.2f bytes/object\n", name, (double)(heap_in_use() - before) / (double)n);
+}
+
+/// @return Number of repetitions of a case of size @c n that make up about OPS operations.
+static size_t repetitions(size_t n)
+{
+    return (n < OPS) ? OPS / n : 1;
+}
+
+/// @return Next value of a fixed pseudo-random sequence, so that runs are comparable.
+static uint32_t next_random(uint64_t *state)
+{
+    *state = *state * UINT64_C(6364136223846793005) + UINT64_C(1442695040888963407);
+    return (uint32_t)(*state >> 33);
+}
+
+/// Joining of @c n parts.
+struct join {
+    struct string **parts;
+    const char **texts;
+    size_t *lens;
+    struct string *sep;
+    size_t n;
+};
+
+static void join_string_join(void *arg)
+{
+    struct join *j = arg;
+    size_t reps = repetitions(j->n);
+    size_t r;
+
+    for (r = 0; r < reps; ++r) {
+        struct string *s = string_new();
+
+        string_join(s, j->sep, j->parts, j->n);
+        sink += string_size(s);
+        string_delete(s);
+    }
+}
+
+static void join_string_join_buffer(void *arg)
+{
+    struct join *j = arg;
+    size_t reps = repetitions(j->n);
+    size_t r;
+
+    for (r = 0; r < reps; ++r) {
+        struct string *s = string_new();
+
+        string_join_buffer(s, 2, ", ", j->texts, j->lens, j->n);
+        sink += string_size(s);
+        string_delete(s);
+    }
+}
+
+/// Baseline: an append per part and separator, growing as needed.
+static void join_append(void *arg)
+{
+    struct join *j = arg;
+    size_t reps = repetitions(j->n);
+    size_t r;
+    size_t i;
+
+    for (r = 0; r < reps; ++r) {
+        struct string *s = string_new();
+
+        for (i = 0; i < j->n; ++i) {
+            if (i > 0) {
+                string_append_buffer(s, string_size(j->sep), string_c_str(j->sep));
+            }
+            string_append_buffer(s, string_size(j->parts[i]), string_c_str(j->parts[i]));
+        }
+        sink += string_size(s);
+        string_delete(s);
+    }
+}
+
+/// string_join() against appending, for 10 to 10^6 parts of 4 to 19 characters, reported per part.
+static void bench_join(void)
+{
+    struct join j;
+    uint64_t state = 1;
+    char name[64];
+    size_t n;
+    size_t i;
+
+    for (n = 10; n <= 1000000; n *= 10) {
+        j.n = n;
+        j.parts = malloc(n * sizeof(*j.parts));
+        j.texts = malloc(n * sizeof(*j.texts));
+        j.lens = malloc(n * sizeof(*j.lens));
+        j.sep = string_new();
+        assert(j.parts && j.texts && j.lens && j.sep);
+        string_append_c_str(j.sep, ", ");
+
+        for (i = 0; i < n; ++i) {
+            j.parts[i] = string_new();
+            string_append_fill(j.parts[i], 4 + next_random(&state) % 16, (char)('a' + i % 26));
+            j.texts[i] = string_c_str(j.parts[i]);
+            j.lens[i] = string_size(j.parts[i]);
+        }
+
+        snprintf(name, sizeof(name), "join/%zu/string_join", n);
+        measure(name, repetitions(n) * n, 0, join_string_join, &j);
+        snprintf(name, sizeof(name), "join/%zu/string_join_buffer", n);
+        measure(name, repetitions(n) * n, 0, join_string_join_buffer, &j);
+        snprintf(name, sizeof(name), "join/%zu/append", n);
+        measure(name, repetitions(n) * n, 0, join_append, &j);
+
+        for (i = 0; i < n; ++i) {
+            string_delete(j.parts[i]);
+        }
+        string_delete(j.sep);
+        free(j.parts);
+        free(j.texts);
+        free(j.lens);
+    }
+}
+
+/// Case conversion and case-insensitive comparison of strings of @c n characters.
+struct case_text {
+    struct string *a;
+    struct string *b;
+    size_t n;
+};
+
+static void case_to_lower(void *arg)
+{
+    struct case_text *c = arg;
+    size_t reps = repetitions(c->n);
+    size_t r;
+
+    for (r = 0; r < reps; ++r) {
+        string_to_lower(c->a);
+    }
+    sink += string_size(c->a);
+}
+
+/// Baseline: tolower() on each character.
+static void case_tolower(void *arg)
+{
+    struct case_text *c = arg;
+    size_t reps = repetitions(c->n);
+    size_t r;
+    size_t i;
+
+    for (r = 0; r < reps; ++r) {
+        char *p = (char *)string_c_str(c->a);
+
+        for (i = 0; i < c->n; ++i) {
+            p[i] = (char)tolower((unsigned char)p[i]);
+        }
+    }
+    sink += string_size(c->a);
+}
+
+static void case_string_casecmp(void *arg)
+{
+    struct case_text *c = arg;
+    size_t reps = repetitions(c->n);
+    size_t r;
+
+    for (r = 0; r < reps; ++r) {
+        sink += (size_t)string_casecmp(c->a, c->b);
+    }
+}
+
+/// Baseline: strcasecmp() on the C strings.
+static void case_strcasecmp(void *arg)
+{
+    struct case_text *c = arg;
+    size_t reps = repetitions(c->n);
+    size_t r;
+
+    for (r = 0; r < reps; ++r) {
+        sink += (size_t)strcasecmp(opaque(string_c_str(c->a)), string_c_str(c->b));
+    }
+}
+
+static void case_string_case_find(void *arg)
+{
+    struct case_text *c = arg;
+    size_t reps = repetitions(c->n);
+    size_t r;
+
+    for (r = 0; r < reps; ++r) {
+        sink += string_case_find(c->a, 0, string_size(c->b), string_c_str(c->b));
+    }
+}
+
+/// Baseline: strncasecmp() at each position.
+static void case_strncasecmp(void *arg)
+{
+    struct case_text *c = arg;
+    size_t reps = repetitions(c->n);
+    size_t m = string_size(c->b);
+    size_t r;
+    size_t i;
+
+    for (r = 0; r < reps; ++r) {
+        const char *p = opaque(string_c_str(c->a));
+
+        for (i = 0; i + m <= c->n && strncasecmp(&p[i], string_c_str(c->b), m) != 0; ++i) {
+        }
+        sink += i;
+    }
+}
+
+/// Case conversion, comparison of equal strings that differ in case, and search for a word at the end of a
+/// text, on header-sized and page-sized strings of mixed case letters, reported per character.
+static void bench_case(void)
+{
+    static const size_t sizes[] = { 16, 65536 };
+    struct case_text c;
+    uint64_t state = 2;
+    char name[64];
+    size_t k;
+    size_t i;
+
+    for (k = 0; k < sizeof(sizes) / sizeof(sizes[0]); ++k) {
+        c.n = sizes[k];
+        c.a = string_new();
+        c.b = string_new();
+        assert(c.a && c.b);
+
+        for (i = 0; i < c.n; ++i) {
+            uint32_t x = next_random(&state);
+            char ch = (char)('a' + x % 26);
+
+            string_push_back(c.a, (x & 0x100) ? (char)toupper((unsigned char)ch) : ch);
+        }
+
+        snprintf(name, sizeof(name), "case/%zu/string_to_lower", c.n);
+        measure(name, repetitions(c.n) * c.n, repetitions(c.n) * c.n, case_to_lower, &c);
+        snprintf(name, sizeof(name), "case/%zu/tolower", c.n);
+        measure(name, repetitions(c.n) * c.n, repetitions(c.n) * c.n, case_tolower, &c);
+
+        string_assign_buffer(c.b, c.n, string_c_str(c.a));
+        string_to_upper(c.b);
+        snprintf(name, sizeof(name), "case/%zu/string_casecmp", c.n);
+        measure(name, repetitions(c.n) * c.n, repetitions(c.n) * c.n, case_string_casecmp, &c);
+        snprintf(name, sizeof(name), "case/%zu/strcasecmp", c.n);
+        measure(name, repetitions(c.n) * c.n, repetitions(c.n) * c.n, case_strcasecmp, &c);
+
+        string_assign_buffer(c.b, 8, string_c_str(c.a) + c.n - 8);
+        string_to_upper(c.b);
+        snprintf(name, sizeof(name), "case/%zu/string_case_find", c.n);
+        measure(name, repetitions(c.n) * c.n, repetitions(c.n) * c.n, case_string_case_find, &c);
+        snprintf(name, sizeof(name), "case/%zu/strncasecmp", c.n);
+        measure(name, repetitions(c.n) * c.n, repetitions(c.n) * c.n, case_strncasecmp, &c);
+
+        string_delete(c.a);
+        string_delete(c.b);
+    }
+}
+
+/// Comparison of strings of @c n characters.
+struct compare {
+    struct string *a;
+    struct string *b;
+    size_t n;
+};
+
+static void compare_string_equal(void *arg)
+{
+    struct compare *c = arg;
+    size_t reps = repetitions(c->n);
+    size_t r;
+
+    for (r = 0; r < reps; ++r) {
+        sink += string_equal(c->a, c->b);
+    }
+}
+
+static void compare_string_compare(void *arg)
+{
+    struct compare *c = arg;
+    size_t reps = repetitions(c->n);
+    size_t r;
+
+    for (r = 0; r < reps; ++r) {
+        sink += (size_t)string_compare(c->a, c->b);
+    }
+}
+
+static void compare_string_starts_with(void *arg)
+{
+    struct compare *c = arg;
+    size_t reps = repetitions(c->n);
+    size_t r;
+
+    for (r = 0; r < reps; ++r) {
+        sink += string_starts_with(c->a, string_size(c->b), string_c_str(c->b));
+    }
+}
+
+/// Baseline: strcmp() on the C strings.
+static void compare_strcmp(void *arg)
+{
+    struct compare *c = arg;
+    size_t reps = repetitions(c->n);
+    size_t r;
+
+    for (r = 0; r < reps; ++r) {
+        sink += (size_t)strcmp(opaque(string_c_str(c->a)), string_c_str(c->b));
+    }
+}
+
+/// Baseline: strncmp() on the C strings, with the length of the prefix.
+static void compare_strncmp(void *arg)
+{
+    struct compare *c = arg;
+    size_t reps = repetitions(c->n);
+    size_t r;
+
+    for (r = 0; r < reps; ++r) {
+        sink += (size_t)strncmp(opaque(string_c_str(c->a)), string_c_str(c->b), strlen(string_c_str(c->b)));
+    }
+}
+
+/// Comparison of equal strings, which must be read to the end, and of strings of different lengths,
+/// which string_equal() tells apart without reading them, reported per comparison.
+static void bench_compare(void)
+{
+    static const size_t sizes[] = { 16, 4096 };
+    struct compare c;
+    char name[64];
+    size_t k;
+
+    for (k = 0; k < sizeof(sizes) / sizeof(sizes[0]); ++k) {
+        c.n = sizes[k];
+        c.a = string_new();
+        c.b = string_new();
+        assert(c.a && c.b);
+        string_append_fill(c.a, c.n, 'k');
+        string_append_fill(c.b, c.n, 'k');
+
+        snprintf(name, sizeof(name), "compare/%zu/equal/string_equal", c.n);
+        measure(name, repetitions(c.n), 0, compare_string_equal, &c);
+        snprintf(name, sizeof(name), "compare/%zu/equal/string_compare", c.n);
+        measure(name, repetitions(c.n), 0, compare_string_compare, &c);
+        snprintf(name, sizeof(name), "compare/%zu/equal/string_starts_with", c.n);
+        measure(name, repetitions(c.n), 0, compare_string_starts_with, &c);
+        snprintf(name, sizeof(name), "compare/%zu/equal/strcmp", c.n);
+        measure(name, repetitions(c.n), 0, compare_strcmp, &c);
+        snprintf(name, sizeof(name), "compare/%zu/equal/strncmp", c.n);
+        measure(name, repetitions(c.n), 0, compare_strncmp, &c);
+
+        string_push_back(c.b, 'k');
+        snprintf(name, sizeof(name), "compare/%zu/longer/string_equal", c.n);
+        measure(name, repetitions(c.n), 0, compare_string_equal, &c);
+        snprintf(name, sizeof(name), "compare/%zu/longer/strcmp", c.n);
+        measure(name, repetitions(c.n), 0, compare_strcmp, &c);
+
+        string_delete(c.a);
+        string_delete(c.b);
+    }
+}
+
+/// Vectors of @c n strings, of 4 to 19 characters, as a string_vec and as an array of objects.
+struct vec {
+    struct string_vec *vec;
+    struct string **strs;
+    const char *text;
+    size_t n;
+};
+
+static void vec_push_back(void *arg)
+{
+    struct vec *v = arg;
+    uint64_t state = 3;
+    size_t i;
+
+    string_vec_clear(v->vec);
+    for (i = 0; i < v->n; ++i) {
+        string_vec_push_back(v->vec, 4 + next_random(&state) % 16, v->text);
+    }
+    sink += string_vec_size(v->vec);
+}
+
+/// Baseline: an object per string.
+static void vec_string_new(void *arg)
+{
+    struct vec *v = arg;
+    uint64_t state = 3;
+    size_t i;
+
+    for (i = 0; i < v->n; ++i) {
+        string_delete(v->strs[i]);
+        v->strs[i] = string_new();
+        string_append_buffer(v->strs[i], 4 + next_random(&state) % 16, v->text);
+    }
+    sink += string_size(v->strs[v->n - 1]);
+}
+
+static void vec_scan(void *arg)
+{
+    struct vec *v = arg;
+    size_t sum = 0;
+    size_t i;
+
+    for (i = 0; i < v->n; ++i) {
+        struct string_view view = string_vec_at(v->vec, i);
+
+        sum += view.len + (unsigned char)view.buf[view.len - 1];
+    }
+    sink += sum;
+}
+
+/// Baseline: an object per string, and a buffer per string longer than internal storage.
+static void vec_scan_strings(void *arg)
+{
+    struct vec *v = arg;
+    size_t sum = 0;
+    size_t i;
+
+    for (i = 0; i < v->n; ++i) {
+        size_t len = string_size(v->strs[i]);
+
+        sum += len + (unsigned char)string_c_str(v->strs[i])[len - 1];
+    }
+    sink += sum;
+}
+
+/// Building, scanning and memory footprint of 10^6 short strings, reported per string.
+static void bench_vec(void)
+{
+    static const char text[] = "abcdefghijklmnopqrstuvwxyz";
+    struct vec v;
+    char name[64];
+    size_t before;
+    size_t i;
+
+    v.n = 1000000;
+    v.text = text;
+
+    before = heap_in_use();
+    v.vec = string_vec_new();
+    assert(v.vec);
+    vec_push_back(&v);
+    snprintf(name, sizeof(name), "vec/%zu/footprint/string_vec", v.n);
+    footprint(name, v.n, before);
+
+    before = heap_in_use();
+    v.strs = calloc(v.n, sizeof(*v.strs));
+    assert(v.strs);
+    vec_string_new(&v);
+    snprintf(name, sizeof(name), "vec/%zu/footprint/string", v.n);
+    footprint(name, v.n, before);
+
+    snprintf(name, sizeof(name), "vec/%zu/push_back/string_vec", v.n);
+    measure(name, v.n, 0, vec_push_back, &v);
+    snprintf(name, sizeof(name), "vec/%zu/push_back/string", v.n);
+    measure(name, v.n, 0, vec_string_new, &v);
+    snprintf(name, sizeof(name), "vec/%zu/scan/string_vec", v.n);
+    measure(name, v.n, 0, vec_scan, &v);
+    snprintf(name, sizeof(name), "vec/%zu/scan/string", v.n);
+    measure(name, v.n, 0, vec_scan_strings, &v);
+
+    for (i = 0; i < v.n; ++i) {
+        string_delete(v.strs[i]);
+    }
+    free(v.strs);
+    string_vec_delete(v.vec);
+}
+
+/// Sorting of @c n strings, restored from @c keys before each run.
+struct sort {
+    struct string **keys;
+    struct string **arr;
+    size_t n;
+};
+
+static void sort_string_sort(void *arg)
+{
+    struct sort *t = arg;
+
+    memcpy(t->arr, t->keys, t->n * sizeof(*t->arr));
+    string_sort(t->arr, t->n);
+    sink += string_size(t->arr[0]);
+}
+
+static void sort_string_sort_parallel(void *arg)
+{
+    struct sort *t = arg;
+
+    memcpy(t->arr, t->keys, t->n * sizeof(*t->arr));
+    string_sort_parallel(t->arr, t->n, 4);
+    sink += string_size(t->arr[0]);
+}
+
+static int compare_c_str(const void *a, const void *b)
+{
+    return strcmp(string_c_str(*(struct string *const *)a), string_c_str(*(struct string *const *)b));
+}
+
+/// Baseline: qsort() with strcmp() on the C strings.
+static void sort_qsort(void *arg)
+{
+    struct sort *t = arg;
+
+    memcpy(t->arr, t->keys, t->n * sizeof(*t->arr));
+    qsort(t->arr, t->n, sizeof(*t->arr), compare_c_str);
+    sink += string_size(t->arr[0]);
+}
+
+/// Write key @c i of distribution @c kind (URLs, paths or UUIDs) to @c buf of size @c size.
+static void make_key(char *buf, size_t size, int kind, uint64_t *state)
+{
+    static const char *const sections[] = { "news", "products", "support", "users" };
+    static const char *const dirs[] = { "bin", "include/linux", "lib/x86_64-linux-gnu", "share/doc" };
+    uint32_t a = next_random(state);
+    uint32_t b = next_random(state);
+
+    if (kind == 0) {
+        snprintf(buf, size, "https://www.example.com/%s/item/%u?ref=%u", sections[a % 4], a % 100000, b % 100);
+    } else if (kind == 1) {
+        snprintf(buf, size, "/usr/%s/pkg%u/file%u.h", dirs[a % 4], a % 1000, b % 10000);
+    } else {
+        uint32_t c = next_random(state);
+        uint32_t d = next_random(state);
+
+        snprintf(buf, size, "%08x-%04x-4%03x-%04x-%04x%08x", a, b >> 16, b & 0xfff, (c >> 16) | 0x8000, c & 0xffff, d);
+    }
+}
+
+/// string_sort() against qsort(), on 10^6 URLs, paths and UUIDs, reported per string.
+static void bench_sort(void)
+{
+    static const char *const kinds[] = { "url", "path", "uuid" };
+    struct sort t;
+    uint64_t state = 4;
+    char name[64];
+    char key[96];
+    size_t i;
+    int kind;
+
+    t.n = 1000000;
+    t.keys = malloc(t.n * sizeof(*t.keys));
+    t.arr = malloc(t.n * sizeof(*t.arr));
+    assert(t.keys && t.arr);
+
+    for (kind = 0; kind < 3; ++kind) {
+        for (i = 0; i < t.n; ++i) {
+            make_key(key, sizeof(key), kind, &state);
+            t.keys[i] = string_new();
+            string_append_c_str(t.keys[i], key);
+        }
+
+        snprintf(name, sizeof(name), "sort/%zu/%s/string_sort", t.n, kinds[kind]);
+        measure(name, t.n, 0, sort_string_sort, &t);
+        snprintf(name, sizeof(name), "sort/%zu/%s/string_sort_parallel", t.n, kinds[kind]);
+        measure(name, t.n, 0, sort_string_sort_parallel, &t);
+        snprintf(name, sizeof(name), "sort/%zu/%s/qsort", t.n, kinds[kind]);
+        measure(name, t.n, 0, sort_qsort, &t);
+
+        for (i = 0; i < t.n; ++i) {
+            string_delete(t.keys[i]);
+        }
+    }
+
+    free(t.keys);
+    free(t.arr);
+}
+
+/// Baseline for maps: the chained table with FNV-1a hashing of C strings that a user would write, with a node
+/// allocated per key, which is borrowed rather than copied, and as many buckets as keys.
+struct chained {
+    struct chained_node {
+        const char *key;
+        void *value;
+        struct chained_node *next;
+    } **buckets;
+    size_t mask;
+};
+
+/// Map of @c n keys of 13 characters, the same keys in random order to look them up, and as many absent keys.
+struct map {
+    struct string_map *map;
+    struct chained chained;
+    char (*keys)[16];
+    char (*present)[16];
+    char (*absent)[16];
+    size_t n;
+};
+
+static void map_insert(void *arg)
+{
+    struct map *m = arg;
+    size_t reps = repetitions(m->n);
+    size_t r;
+    size_t i;
+
+    for (r = 0; r < reps; ++r) {
+        struct string_map *map = string_map_new();
+
+        for (i = 0; i < m->n; ++i) {
+            string_map_insert(map, 13, m->keys[i], m->keys[i]);
+        }
+        sink += string_map_size(map);
+        string_map_delete(map);
+    }
+}
+
+static void map_insert_reserved(void *arg)
+{
+    struct map *m = arg;
+    size_t reps = repetitions(m->n);
+    size_t r;
+    size_t i;
+
+    for (r = 0; r < reps; ++r) {
+        struct string_map *map = string_map_new();
+
+        string_map_reserve(map, m->n);
+        for (i = 0; i < m->n; ++i) {
+            string_map_insert(map, 13, m->keys[i], m->keys[i]);
+        }
+        sink += string_map_size(map);
+        string_map_delete(map);
+    }
+}
+
+static void map_find(struct map *m, char (*keys)[16])
+{
+    size_t reps = repetitions(m->n);
+    void *value = NULL;
+    size_t r;
+    size_t i;
+
+    for (r = 0; r < reps; ++r) {
+        for (i = 0; i < m->n; ++i) {
+            sink += (size_t)string_map_find(m->map, 13, keys[i], &value);
+        }
+    }
+}
+
+static void map_find_present(void *arg)
+{
+    map_find(arg, ((struct map *)arg)->present);
+}
+
+static void map_find_absent(void *arg)
+{
+    map_find(arg, ((struct map *)arg)->absent);
+}
+
+static uint64_t fnv1a(const char *s)
+{
+    uint64_t h = UINT64_C(14695981039346656037);
+
+    for (; *s; ++s) {
+        h = (h ^ (unsigned char)*s) * UINT64_C(1099511628211);
+    }
+    return h;
+}
+
+/// @return Node of @c key in table @c t, or NULL if absent.
+static struct chained_node *chained_find(const struct chained *t, const char *key)
+{
+    struct chained_node *node = t->buckets[fnv1a(key) & t->mask];
+
+    while (node && strcmp(node->key, key) != 0) {
+        node = node->next;
+    }
+    return node;
+}
+
+/// Fill table @c t with the keys of @c m, each inserted unless already present.
+static void chained_fill(struct chained *t, const struct map *m)
+{
+    size_t i;
+
+    for (t->mask = 1; t->mask < m->n; t->mask <<= 1) {
+    }
+    t->buckets = calloc(t->mask, sizeof(*t->buckets));
+    assert(t->buckets);
+    --t->mask;
+
+    for (i = 0; i < m->n; ++i) {
+        struct chained_node **bucket = &t->buckets[fnv1a(m->keys[i]) & t->mask];
+        struct chained_node *node = chained_find(t, m->keys[i]);
+
+        if (!node) {
+            node = malloc(sizeof(*node));
+            assert(node);
+            node->key = m->keys[i];
+            node->next = *bucket;
+            *bucket = node;
+        }
+        node->value = m->keys[i];
+    }
+}
+
+static void chained_delete(struct chained *t)
+{
+    size_t i;
+
+    for (i = 0; i <= t->mask; ++i) {
+        while (t->buckets[i]) {
+            struct chained_node *node = t->buckets[i];
+
+            t->buckets[i] = node->next;
+            free(node);
+        }
+    }
+    free(t->buckets);
+}
+
+static void map_chained_insert(void *arg)
+{
+    struct map *m = arg;
+    size_t reps = repetitions(m->n);
+    size_t r;
+
+    for (r = 0; r < reps; ++r) {
+        struct chained t;
+
+        chained_fill(&t, m);
+        sink += t.mask;
+        chained_delete(&t);
+    }
+}
+
+static void map_chained_find(struct map *m, char (*keys)[16])
+{
+    size_t reps = repetitions(m->n);
+    size_t r;
+    size_t i;
+
+    for (r = 0; r < reps; ++r) {
+        for (i = 0; i < m->n; ++i) {
+            sink += (chained_find(&m->chained, keys[i]) != NULL);
+        }
+    }
+}
+
+static void map_chained_find_present(void *arg)
+{
+    map_chained_find(arg, ((struct map *)arg)->present);
+}
+
+static void map_chained_find_absent(void *arg)
+{
+    map_chained_find(arg, ((struct map *)arg)->absent);
+}
+
+/// string_map against a chained table, from 10^3 entries to the maximum, reported per key.
+/// Keys are scattered by multiplying their index by an odd constant; absent keys have odd indexes.
+static void bench_map(void)
+{
+    struct map m;
+    uint64_t state = 5;
+    char name[64];
+    size_t i;
+
+    for (m.n = 1000; m.n <= max_entries; m.n *= 10) {
+        m.keys = malloc(m.n * sizeof(*m.keys));
+        m.present = malloc(m.n * sizeof(*m.present));
+        m.absent = malloc(m.n * sizeof(*m.absent));
+        assert(m.keys && m.present && m.absent);
+
+        for (i = 0; i < m.n; ++i) {
+            snprintf(m.keys[i], sizeof(m.keys[i]), "user:%08x", (unsigned)(2 * i * 2654435761u));
+            snprintf(m.absent[i], sizeof(m.absent[i]), "user:%08x", (unsigned)((2 * i + 1) * 2654435761u));
+        }
+
+        // Lookups in insertion order would favour tables that allocate in that order.
+        memcpy(m.present, m.keys, m.n * sizeof(*m.present));
+        for (i = m.n - 1; i > 0; --i) {
+            size_t j = next_random(&state) % (i + 1);
+            char tmp[16];
+
+            memcpy(tmp, m.present[i], sizeof(tmp));
+            memcpy(m.present[i], m.present[j], sizeof(tmp));
+            memcpy(m.present[j], tmp, sizeof(tmp));
+        }
+
+        snprintf(name, sizeof(name), "map/%zu/insert/string_map", m.n);
+        measure(name, repetitions(m.n) * m.n, 0, map_insert, &m);
+        snprintf(name, sizeof(name), "map/%zu/insert_reserved/string_map", m.n);
+        measure(name, repetitions(m.n) * m.n, 0, map_insert_reserved, &m);
+        m.map = string_map_new();
+        assert(m.map);
+        for (i = 0; i < m.n; ++i) {
+            string_map_insert(m.map, 13, m.keys[i], m.keys[i]);
+        }
+        snprintf(name, sizeof(name), "map/%zu/find/string_map", m.n);
+        measure(name, repetitions(m.n) * m.n, 0, map_find_present, &m);
+        snprintf(name, sizeof(name), "map/%zu/miss/string_map", m.n);
+        measure(name, repetitions(m.n) * m.n, 0, map_find_absent, &m);
+        string_map_delete(m.map);
+
+        snprintf(name, sizeof(name), "map/%zu/insert/chained", m.n);
+        measure(name, repetitions(m.n) * m.n, 0, map_chained_insert, &m);
+        chained_fill(&m.chained, &m);
+        snprintf(name, sizeof(name), "map/%zu/find/chained", m.n);
+        measure(name, repetitions(m.n) * m.n, 0, map_chained_find_present, &m);
+        snprintf(name, sizeof(name), "map/%zu/miss/chained", m.n);
+        measure(name, repetitions(m.n) * m.n, 0, map_chained_find_absent, &m);
+        chained_delete(&m.chained);
+
+        free(m.keys);
+        free(m.present);
+        free(m.absent);
+    }
+}
+
+/// Encoding of @c n bytes, and decoding of their encodings.
+struct codec {
+    struct string *out;
+    const char *in;
+    const char *hex;
+    const char *base64;
+    char *tmp;
+    size_t n;
+};
+
+static const char hex_digits[] = "0123456789abcdef";
+static const char base64_digits[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+static void codec_hex(void *arg)
+{
+    struct codec *c = arg;
+    size_t reps = repetitions(c->n);
+    size_t r;
+
+    for (r = 0; r < reps; ++r) {
+        string_clear(c->out);
+        string_append_hex(c->out, c->n, c->in);
+    }
+    sink += string_size(c->out);
+}
+
+/// Baseline: a table lookup per nibble into a separate buffer, then appended.
+static void codec_hex_scalar(void *arg)
+{
+    struct codec *c = arg;
+    size_t reps = repetitions(c->n);
+    size_t r;
+    size_t i;
+
+    for (r = 0; r < reps; ++r) {
+        for (i = 0; i < c->n; ++i) {
+            c->tmp[2 * i] = hex_digits[(unsigned char)c->in[i] >> 4];
+            c->tmp[2 * i + 1] = hex_digits[(unsigned char)c->in[i] & 15];
+        }
+        string_clear(c->out);
+        string_append_buffer(c->out, 2 * c->n, c->tmp);
+    }
+    sink += string_size(c->out);
+}
+
+static void codec_hex_decoded(void *arg)
+{
+    struct codec *c = arg;
+    size_t reps = repetitions(c->n);
+    size_t r;
+
+    for (r = 0; r < reps; ++r) {
+        string_clear(c->out);
+        string_append_hex_decoded(c->out, 2 * c->n, c->hex);
+    }
+    sink += string_size(c->out);
+}
+
+/// @return Value of hex digit @c d, or -1 if invalid.
+static int hex_value(char d)
+{
+    if (d >= '0' && d <= '9') {
+        return d - '0';
+    }
+    if ((d | 0x20) >= 'a' && (d | 0x20) <= 'f') {
+        return (d | 0x20) - 'a' + 10;
+    }
+    return -1;
+}
+
+/// Baseline: a digit at a time into a separate buffer, then appended.
+static void codec_hex_decoded_scalar(void *arg)
+{
+    struct codec *c = arg;
+    size_t reps = repetitions(c->n);
+    size_t r;
+    size_t i;
+
+    for (r = 0; r < reps; ++r) {
+        for (i = 0; i < c->n; ++i) {
+            int hi = hex_value(c->hex[2 * i]);
+            int lo = hex_value(c->hex[2 * i + 1]);
+
+            if (hi < 0 || lo < 0) {
+                break;
+            }
+            c->tmp[i] = (char)(hi << 4 | lo);
+        }
+        string_clear(c->out);
+        string_append_buffer(c->out, i, c->tmp);
+    }
+    sink += string_size(c->out);
+}
+
+static void codec_base64(void *arg)
+{
+    struct codec *c = arg;
+    size_t reps = repetitions(c->n);
+    size_t r;
+
+    for (r = 0; r < reps; ++r) {
+        string_clear(c->out);
+        string_append_base64(c->out, c->n, c->in);
+    }
+    sink += string_size(c->out);
+}
+
+/// Baseline: a table lookup per sextet into a separate buffer, then appended.
+static void codec_base64_scalar(void *arg)
+{
+    struct codec *c = arg;
+    size_t reps = repetitions(c->n);
+    size_t r;
+    size_t i;
+    size_t k;
+
+    for (r = 0; r < reps; ++r) {
+        for (i = 0, k = 0; i + 3 <= c->n; i += 3, k += 4) {
+            uint32_t v = (uint32_t)(unsigned char)c->in[i] << 16 | (uint32_t)(unsigned char)c->in[i + 1] << 8 |
+                         (unsigned char)c->in[i + 2];
+
+            c->tmp[k] = base64_digits[v >> 18];
+            c->tmp[k + 1] = base64_digits[(v >> 12) & 63];
+            c->tmp[k + 2] = base64_digits[(v >> 6) & 63];
+            c->tmp[k + 3] = base64_digits[v & 63];
+        }
+        string_clear(c->out);
+        string_append_buffer(c->out, k, c->tmp);
+    }
+    sink += string_size(c->out);
+}
+
+static void codec_base64_decoded(void *arg)
+{
+    struct codec *c = arg;
+    size_t reps = repetitions(c->n);
+    size_t r;
+
+    for (r = 0; r < reps; ++r) {
+        string_clear(c->out);
+        string_append_base64_decoded(c->out, c->n / 3 * 4, c->base64);
+    }
+    sink += string_size(c->out);
+}
+
+/// Hex and Base64 codecs against scalar code writing to a separate buffer, on 16 bytes (an identifier)
+/// and 64 KiB of random bytes (a payload), reported per input byte of the encoder.
+static void bench_codec(void)
+{
+    static const size_t sizes[] = { 16, 65536 };
+    struct codec c;
+    uint64_t state = 6;
+    char name[64];
+    char *in;
+    struct string *hex;
+    struct string *base64;
+    size_t k;
+    size_t i;
+
+    for (k = 0; k < sizeof(sizes) / sizeof(sizes[0]); ++k) {
+        c.n = sizes[k];
+        in = malloc(c.n);
+        c.tmp = malloc(2 * c.n);
+        c.out = string_new();
+        hex = string_new();
+        base64 = string_new();
+        assert(in && c.tmp && c.out && hex && base64);
+
+        for (i = 0; i < c.n; ++i) {
+            in[i] = (char)next_random(&state);
+        }
+        string_append_hex(hex, c.n, in);
+        string_append_base64(base64, c.n, in);
+        c.in = in;
+        c.hex = string_c_str(hex);
+        c.base64 = string_c_str(base64);
+
+        snprintf(name, sizeof(name), "codec/%zu/hex/string_append_hex", c.n);
+        measure(name, repetitions(c.n) * c.n, repetitions(c.n) * c.n, codec_hex, &c);
+        snprintf(name, sizeof(name), "codec/%zu/hex/scalar", c.n);
+        measure(name, repetitions(c.n) * c.n, repetitions(c.n) * c.n, codec_hex_scalar, &c);
+        snprintf(name, sizeof(name), "codec/%zu/unhex/string_append_hex_decoded", c.n);
+        measure(name, repetitions(c.n) * c.n, repetitions(c.n) * c.n, codec_hex_decoded, &c);
+        snprintf(name, sizeof(name), "codec/%zu/unhex/scalar", c.n);
+        measure(name, repetitions(c.n) * c.n, repetitions(c.n) * c.n, codec_hex_decoded_scalar, &c);
+        snprintf(name, sizeof(name), "codec/%zu/base64/string_append_base64", c.n);
+        measure(name, repetitions(c.n) * c.n, repetitions(c.n) * c.n, codec_base64, &c);
+        snprintf(name, sizeof(name), "codec/%zu/base64/scalar", c.n);
+        measure(name, repetitions(c.n) * c.n, repetitions(c.n) * c.n, codec_base64_scalar, &c);
+        snprintf(name, sizeof(name), "codec/%zu/unbase64/string_append_base64_decoded", c.n);
+        measure(name, repetitions(c.n) * c.n, repetitions(c.n) * c.n, codec_base64_decoded, &c);
+
+        string_delete(c.out);
+        string_delete(hex);
+        string_delete(base64);
+        free(c.tmp);
+        free(in);
+    }
+}
+
+/// Transfer of @c n messages of 64 bytes from a producer thread to a consumer thread, each stamped with
+/// the time it was sent so that the consumer records its latency.
+struct queue {
+    struct string_queue *queue;
+    struct string_channel *channel;
+    struct string **ring;
+    pthread_mutex_t lock;
+    size_t mask;
+    size_t head;
+    size_t tail;
+    uint64_t *latency;
+    size_t n;
+};
+
+/// Baseline: a ring of pointers under a mutex, of the same capacity as the queue.
+static int locked_push(struct queue *q, struct string *str)
+{
+    int ret = -EAGAIN;
+
+    pthread_mutex_lock(&q->lock);
+    if (q->tail - q->head <= q->mask) {
+        q->ring[q->tail++ & q->mask] = str;
+        ret = 0;
+    }
+    pthread_mutex_unlock(&q->lock);
+    return ret;
+}
+
+static struct string *locked_pop(struct queue *q)
+{
+    struct string *str = NULL;
+
+    pthread_mutex_lock(&q->lock);
+    if (q->head != q->tail) {
+        str = q->ring[q->head++ & q->mask];
+    }
+    pthread_mutex_unlock(&q->lock);
+    return str;
+}
+
+static void queue_push_pop(void *arg)
+{
+    struct queue *q = arg;
+    struct string *str = string_new();
+    size_t i;
+
+    assert(str);
+    for (i = 0; i < OPS; ++i) {
+        string_queue_push(q->queue, str);
+        str = string_queue_pop(q->queue);
+    }
+    sink += string_size(str);
+    string_delete(str);
+}
+
+static void queue_locked_push_pop(void *arg)
+{
+    struct queue *q = arg;
+    struct string *str = string_new();
+    size_t i;
+
+    assert(str);
+    for (i = 0; i < OPS; ++i) {
+        locked_push(q, str);
+        str = locked_pop(q);
+    }
+    sink += string_size(str);
+    string_delete(str);
+}
+
+/// Fill @c str with a message stamped with the current time.
+static void stamp(struct string *str)
+{
+    static const char payload[56] = "payload of a message, as long as a short log record";
+    uint64_t t = now();
+
+    string_append_buffer(str, sizeof(t), (const char *)&t);
+    string_append_buffer(str, sizeof(payload), payload);
+}
+
+/// @return Time since @c str was stamped.
+static uint64_t age(struct string *str)
+{
+    uint64_t t;
+
+    memcpy(&t, string_c_str(str), sizeof(t));
+    return now() - t;
+}
+
+static void *channel_producer(void *arg)
+{
+    struct queue *q = arg;
+    size_t i;
+
+    for (i = 0; i < q->n; ++i) {
+        struct string *str = string_channel_acquire(q->channel);
+
+        assert(str);
+        stamp(str);
+        while (string_channel_send(q->channel, str) < 0) {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static void queue_channel(void *arg)
+{
+    struct queue *q = arg;
+    pthread_t producer;
+    size_t i;
+
+    pthread_create(&producer, NULL, channel_producer, q);
+    for (i = 0; i < q->n; ++i) {
+        struct string *str;
+
+        while (!(str = string_channel_receive(q->channel))) {
+            sched_yield();
+        }
+        q->latency[i] = age(str);
+        string_channel_recycle(q->channel, str);
+    }
+    pthread_join(producer, NULL);
+}
+
+/// Baseline: a new string per message, deleted by the consumer.
+static void *locked_producer(void *arg)
+{
+    struct queue *q = arg;
+    size_t i;
+
+    for (i = 0; i < q->n; ++i) {
+        struct string *str = string_new();
+
+        assert(str);
+        stamp(str);
+        while (locked_push(q, str) < 0) {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static void queue_locked(void *arg)
+{
+    struct queue *q = arg;
+    pthread_t producer;
+    size_t i;
+
+    pthread_create(&producer, NULL, locked_producer, q);
+    for (i = 0; i < q->n; ++i) {
+        struct string *str;
+
+        while (!(str = locked_pop(q))) {
+            sched_yield();
+        }
+        q->latency[i] = age(str);
+        string_delete(str);
+    }
+    pthread_join(producer, NULL);
+}
+
+static int compare_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+/// Print the median and tail of the latencies of the last run of a transfer.
+static void percentiles(const char *name, uint64_t *latency, size_t n)
+{
+    qsort(latency, n, sizeof(*latency), compare_u64);
+    printf("%-48s %12" PRIu64 " ns p50 %10" PRIu64 " ns p99 %10" PRIu64 " ns p99.9\n", name, latency[n / 2],
+           latency[n / 100 * 99], latency[n / 1000 * 999]);
+    fflush(stdout);
+}
+
+/// Queue and channel against a ring under a mutex, with a push and pop per operation on one thread,
+/// then as throughput and latency of messages from a producer thread to a consumer thread.
+static void bench_queue(void)
+{
+    struct queue q;
+
+    q.queue = string_queue_new(1024);
+    q.channel = string_channel_new(1024);
+    q.mask = string_queue_capacity(q.queue) - 1;
+    q.ring = malloc((q.mask + 1) * sizeof(*q.ring));
+    q.head = 0;
+    q.tail = 0;
+    q.n = OPS / 4;
+    q.latency = malloc(q.n * sizeof(*q.latency));
+    assert(q.queue && q.channel && q.ring && q.latency);
+    pthread_mutex_init(&q.lock, NULL);
+
+    measure("queue/push_pop/string_queue", OPS, 0, queue_push_pop, &q);
+    measure("queue/push_pop/locked", OPS, 0, queue_locked_push_pop, &q);
+    measure("queue/transfer/string_channel", q.n, 0, queue_channel, &q);
+    percentiles("queue/latency/string_channel", q.latency, q.n);
+    measure("queue/transfer/locked", q.n, 0, queue_locked, &q);
+    percentiles("queue/latency/locked", q.latency, q.n);
+
+    pthread_mutex_destroy(&q.lock);
+    free(q.latency);
+    free(q.ring);
+    string_channel_delete(q.channel);
+    string_queue_delete(q.queue);
+}
+
+/// Writing of @c n strings of @c size bytes to @c fd.
+struct writer {
+    const char *payload;
+    size_t size;
+    size_t n;
+    int fd;
+};
+
+/// Start over at the beginning of the file, so that runs write the same.
+static void rewind_fd(int fd)
+{
+    if (lseek(fd, 0, SEEK_SET) == 0) {
+        sink += (size_t)ftruncate(fd, 0);
+    }
+}
+
+static void writer_string_writer(void *arg)
+{
+    struct writer *w = arg;
+    struct string_writer *writer;
+    size_t i;
+
+    rewind_fd(w->fd);
+    writer = string_writer_new(w->fd, NULL, NULL);
+    assert(writer);
+    for (i = 0; i < w->n; ++i) {
+        struct string *str = string_new();
+
+        assert(str);
+        string_append_buffer(str, w->size, w->payload);
+        string_writer_submit(writer, str);
+    }
+    string_writer_flush(writer);
+    string_writer_delete(writer);
+}
+
+/// Completion callback returning written strings to the channel in @c ctx.
+static void writer_recycle(void *ctx, struct string *str, int err)
+{
+    (void)err;
+    string_channel_recycle(ctx, str);
+}
+
+/// Strings taken from a channel that the completion callback recycles them to, so that storage is reused.
+static void writer_string_writer_recycled(void *arg)
+{
+    struct writer *w = arg;
+    struct string_channel *channel = string_channel_new(1024);
+    struct string_writer *writer;
+    size_t i;
+
+    rewind_fd(w->fd);
+    writer = string_writer_new(w->fd, writer_recycle, channel);
+    assert(channel && writer);
+    for (i = 0; i < w->n; ++i) {
+        struct string *str = string_channel_acquire(channel);
+
+        assert(str);
+        string_append_buffer(str, w->size, w->payload);
+        string_writer_submit(writer, str);
+    }
+    string_writer_flush(writer);
+    string_writer_delete(writer);
+    string_channel_delete(channel);
+}
+
+/// Baseline: a write() per string, on the producing thread.
+static void writer_write(void *arg)
+{
+    struct writer *w = arg;
+    size_t i;
+
+    rewind_fd(w->fd);
+    for (i = 0; i < w->n; ++i) {
+        struct string *str = string_new();
+
+        assert(str);
+        string_append_buffer(str, w->size, w->payload);
+        sink += (size_t)write(w->fd, string_c_str(str), string_size(str));
+        string_delete(str);
+    }
+}
+
+/// Writer against a write() per string, of log lines (64 bytes) and pages (4 KiB), to /dev/null (the
+/// cost of the system calls alone) and to a file, reported per string including the final flush.
+static void bench_writer(void)
+{
+    static const size_t sizes[] = { 64, 4096 };
+    static const char *const targets[] = { "null", "file" };
+    char path[] = "/tmp/string_bench.XXXXXX";
+    struct writer w;
+    char name[64];
+    char *payload;
+    size_t k;
+    size_t t;
+
+    for (t = 0; t < sizeof(targets) / sizeof(targets[0]); ++t) {
+        if (t == 0) {
+            w.fd = open("/dev/null", O_WRONLY);
+        } else {
+            w.fd = mkstemp(path);
+            unlink(path);
+        }
+        assert(w.fd >= 0);
+
+        for (k = 0; k < sizeof(sizes) / sizeof(sizes[0]); ++k) {
+            w.size = sizes[k];
+            w.n = OPS / 4 / (w.size / 64);
+            payload = malloc(w.size);
+            assert(payload);
+            memset(payload, 'x', w.size - 1);
+            payload[w.size - 1] = '\n';
+            w.payload = payload;
+
+            snprintf(name, sizeof(name), "writer/%s/%zu/string_writer", targets[t], w.size);
+            measure(name, w.n, w.n * w.size, writer_string_writer, &w);
+            snprintf(name, sizeof(name), "writer/%s/%zu/string_writer/recycled", targets[t], w.size);
+            measure(name, w.n, w.n * w.size, writer_string_writer_recycled, &w);
+            snprintf(name, sizeof(name), "writer/%s/%zu/write", targets[t], w.size);
+            measure(name, w.n, w.n * w.size, writer_write, &w);
+
+            free(payload);
+        }
+        close(w.fd);
+    }
+}
+
+/// @return Content of @c n bytes of the given @c kind: JSON log records, text of a small vocabulary, or
+///         random bytes.
+static char *make_content(size_t n, int kind, uint64_t *state)
+{
+    static const char *const words[] = { "the",  "string", "of",     "memory", "is",    "a",      "buffer", "to",
+                                         "and",  "when",   "storage", "cold",  "which", "reads",  "large",  "data" };
+    char *p = malloc(n + 128);
+    size_t i = 0;
+
+    assert(p);
+    while (i < n) {
+        if (kind == 0) {
+            i += (size_t)snprintf(p + i, 128,
+                                  "{\"time\":\"2026-10-18T12:%02u:%02u\",\"level\":\"info\",\"path\":\"/items/%u\","
+                                  "\"status\":%u}\n",
+                                  next_random(state) % 60, next_random(state) % 60, next_random(state) % 100000,
+                                  (next_random(state) % 8) ? 200 : 404);
+        } else if (kind == 1) {
+            i += (size_t)snprintf(p + i, 128, "%s ", words[next_random(state) % 16]);
+        } else {
+            p[i++] = (char)next_random(state);
+        }
+    }
+    return p;
+}
+
+/// Compression of strings of @c n bytes, and their decompression on the next access, against copying them.
+/// Reported per string, with the compressed size relative to the original.
+static void bench_compress(void)
+{
+    static const size_t sizes[] = { 4096, 65536 };
+    static const char *const kinds[] = { "log", "text", "random" };
+    struct string **strs;
+    uint64_t state = 7;
+    uint64_t best[3];
+    char name[64];
+    char *content;
+    char *copy;
+    size_t compressed;
+    size_t count;
+    size_t k;
+    size_t t;
+    size_t i;
+    int run;
+
+    for (t = 0; t < sizeof(kinds) / sizeof(kinds[0]); ++t) {
+        for (k = 0; k < sizeof(sizes) / sizeof(sizes[0]); ++k) {
+            size_t n = sizes[k];
+
+            content = make_content(n, (int)t, &state);
+            copy = malloc(n);
+            count = repetitions(n);
+            strs = malloc(count * sizeof(*strs));
+            assert(copy && strs);
+            best[0] = best[1] = best[2] = UINT64_MAX;
+            compressed = 0;
+
+            for (run = 0; run < RUNS; ++run) {
+                uint64_t start;
+                uint64_t elapsed[3];
+
+                for (i = 0; i < count; ++i) {
+                    strs[i] = string_new();
+                    assert(strs[i]);
+                    string_append_buffer(strs[i], n, content);
+                }
+
+                start = now();
+                for (i = 0; i < count; ++i) {
+                    string_compress(strs[i], 0);
+                }
+                elapsed[0] = now() - start;
+                compressed = string_capacity(strs[0]);
+
+                start = now();
+                for (i = 0; i < count; ++i) {
+                    sink += (size_t)string_at(strs[i], n / 2);
+                }
+                elapsed[1] = now() - start;
+
+                start = now();
+                for (i = 0; i < count; ++i) {
+                    memcpy(copy, opaque(string_c_str(strs[i])), n);
+                    sink += (size_t)copy[n / 2];
+                }
+                elapsed[2] = now() - start;
+
+                for (i = 0; i < 3; ++i) {
+                    if (elapsed[i] < best[i]) {
+                        best[i] = elapsed[i];
+                    }
+                }
+                for (i = 0; i < count; ++i) {
+                    string_delete(strs[i]);
+                }
+            }
+
+            printf("%-48s %12.3f ratio\n", (snprintf(name, sizeof(name), "compress/%s/%zu", kinds[t], n), name),
+                   (double)compressed / (double)n);
+            snprintf(name, sizeof(name), "compress/%s/%zu/string_compress", kinds[t], n);
+            report(name, count, count * n, best[0]);
+            snprintf(name, sizeof(name), "compress/%s/%zu/string_at", kinds[t], n);
+            report(name, count, count * n, best[1]);
+            snprintf(name, sizeof(name), "compress/%s/%zu/memcpy", kinds[t], n);
+            report(name, count, count * n, best[2]);
+
+            free(strs);
+            free(copy);
+            free(content);
+        }
+    }
+}
+
+/// Cases, in the order they run.
+static const struct {
+    const char *name;
+    void (*run)(void);
+} cases[] = {
+    { "join", bench_join },
+    { "case", bench_case },
+    { "compare", bench_compare },
+    { "vec", bench_vec },
+    { "sort", bench_sort },
+    { "map", bench_map },
+    { "codec", bench_codec },
+    { "queue", bench_queue },
+    { "writer", bench_writer },
+    { "compress", bench_compress },
+};
+
+int main(int argc, char **argv)
+{
+    int first = 1;
+    size_t i;
+    int a;
+
+    if (argc > 2 && strcmp(argv[1], "-n") == 0) {
+        max_entries = strtoul(argv[2], NULL, 10);
+        first = 3;
+    }
+
+    for (i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+        bool selected = (argc <= first);
+
+        for (a = first; a < argc; ++a) {
+            if (strncmp(cases[i].name, argv[a], strlen(argv[a])) == 0) {
+                selected = true;
+            }
+        }
+
+        if (selected) {
+            cases[i].run();
+        }
+    }
+
+    return 0;
+}
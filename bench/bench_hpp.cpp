@@ -0,0 +1,135 @@
+// Benchmarks of the C++ wrapper of cstring.hpp, against std::string doing the same work.
+//
+// Usage: string_bench_hpp
+//
+// Each measurement is the fastest of several runs, reported per operation.
+
+#include "cstring.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/// Runs of each measurement, of which the fastest is reported.
+static constexpr int RUNS = 5;
+
+/// Operations per measurement.
+static constexpr std::size_t OPS = std::size_t(1) << 20;
+
+/// Results of measured code, so that it is not optimized away.
+static volatile std::size_t sink;
+
+/// Time @c fn, which performs @c ops operations, and print it.
+template <typename F>
+static void measure(const char *name, std::size_t ops, F fn)
+{
+    auto best = std::chrono::nanoseconds::max();
+
+    for (int i = 0; i < RUNS; ++i) {
+        auto start = std::chrono::steady_clock::now();
+
+        fn();
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+        if (elapsed < best) {
+            best = elapsed;
+        }
+    }
+
+    std::printf("%-48s %12.2f ns/op\n", name, double(best.count()) / double(ops));
+    std::fflush(stdout);
+}
+
+/// Construction from a view of @c n characters, and destruction.
+template <typename S>
+static void construct(std::string_view v)
+{
+    for (std::size_t i = 0; i < OPS; ++i) {
+        S s(v);
+
+        sink += s.size();
+    }
+}
+
+/// Growth by push_back() from empty to 1000 characters.
+template <typename S>
+static void push_back()
+{
+    for (std::size_t i = 0; i < OPS / 1000; ++i) {
+        S s;
+
+        for (std::size_t k = 0; k < 1000; ++k) {
+            s.push_back(char('a' + k % 26));
+        }
+        sink += s.size();
+    }
+}
+
+/// Growth by append() of 64 pieces of 16 characters.
+template <typename S>
+static void append()
+{
+    static constexpr std::string_view piece = "0123456789abcdef";
+
+    for (std::size_t i = 0; i < OPS / 64; ++i) {
+        S s;
+
+        for (std::size_t k = 0; k < 64; ++k) {
+            s.append(piece);
+        }
+        sink += s.size();
+    }
+}
+
+/// Moves of strings of 100 characters around a vector, which is how containers shuffle them.
+template <typename S>
+static void move()
+{
+    std::vector<S> v;
+
+    for (std::size_t i = 0; i < 64; ++i) {
+        v.emplace_back(std::string_view("a string long enough to be allocated by any implementation of strings, "
+                                        "whether it has SSO or not"));
+    }
+
+    for (std::size_t i = 0; i < OPS / 64; ++i) {
+        for (std::size_t k = 0; k + 1 < v.size(); ++k) {
+            S tmp(std::move(v[k]));
+
+            v[k] = std::move(v[k + 1]);
+            v[k + 1] = std::move(tmp);
+        }
+    }
+    sink += v[0].size();
+}
+
+/// Equality through std::string_view, of strings of 32 characters.
+template <typename S>
+static void view_equal()
+{
+    S a(std::string_view("abcdefghijklmnopqrstuvwxyz012345"));
+    S b(std::string_view("abcdefghijklmnopqrstuvwxyz012345"));
+
+    for (std::size_t i = 0; i < OPS; ++i) {
+        sink += std::string_view(a) == std::string_view(b);
+    }
+}
+
+int main()
+{
+    measure("construct/7/cstring::string", OPS, [] { construct<cstring::string>("abcdefg"); });
+    measure("construct/7/std::string", OPS, [] { construct<std::string>("abcdefg"); });
+    measure("construct/32/cstring::string", OPS, [] { construct<cstring::string>("abcdefghijklmnopqrstuvwxyz012345"); });
+    measure("construct/32/std::string", OPS, [] { construct<std::string>("abcdefghijklmnopqrstuvwxyz012345"); });
+    measure("push_back/1000/cstring::string", OPS / 1000 * 1000, push_back<cstring::string>);
+    measure("push_back/1000/std::string", OPS / 1000 * 1000, push_back<std::string>);
+    measure("append/64x16/cstring::string", OPS / 64 * 64, append<cstring::string>);
+    measure("append/64x16/std::string", OPS / 64 * 64, append<std::string>);
+    measure("move/cstring::string", OPS / 64 * 63 * 3, move<cstring::string>);
+    measure("move/std::string", OPS / 64 * 63 * 3, move<std::string>);
+    measure("view_equal/32/cstring::string", OPS, view_equal<cstring::string>);
+    measure("view_equal/32/std::string", OPS, view_equal<std::string>);
+    return 0;
+}
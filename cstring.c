@@ -1,38 +1,210 @@
 #include "cstring.h"
+#include "cstring_inline.h"
+#include "string_trace.h"
 
 #include <assert.h>
 #include <errno.h>
 #include <limits.h>
+#include <pthread.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 /// Growth factor for capacity when resizing.
 /// 2.0x balances memory overhead (~50% extra on average after growth) with reallocation frequency.
 /// See Herb Sutter's "Allocators" article for analysis of growth factors.
 #define STRING_GROWTH_FACTOR 2
 
-/// Small string optimization.
-/// Holds up to 7 chars + NUL inline.
-/// Arbitrary choice.
-#define SSO_SIZE 8
+#define SSO_CAPACITY (sizeof(((struct string *)0)->sso) - 1 /* Space for NUL */)
 
-struct string {
-    /// Capacity of buffer (excluding NUL terminator).
-    size_t cap;
-    /// Length of buffer (excluding NUL terminator).
-    size_t len;
-    /// Buffer (always NUL terminated).
-    char *buf;
-    /// Internal storage (small string optimization).
-    char sso[SSO_SIZE];
-};
+/// Process-wide accounting of the bytes held in allocated buffers (capacity + 1 each).
+/// Updated with relaxed atomics once per allocation, rather than per operation.
+static size_t memory_used;
+static size_t memory_peak;
+static size_t memory_budget = SIZE_MAX;
+static size_t memory_allocations;
 
-#define SSO_CAPACITY (sizeof(((struct string *)0)->sso) - 1 /* Space for NUL */)
+/// Account for @c n more bytes held.
+/// @return Zero on success, or -ENOMEM if the budget would be exceeded.
+static int memory_charge(size_t n)
+{
+    size_t used = __atomic_load_n(&memory_used, __ATOMIC_RELAXED);
+    size_t budget = __atomic_load_n(&memory_budget, __ATOMIC_RELAXED);
+    size_t peak;
 
-struct string *string_new(void)
+    do {
+        if (n > 0 && (used > budget || n > budget - used)) {
+            return -ENOMEM;
+        }
+    } while (!__atomic_compare_exchange_n(&memory_used, &used, used + n, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+    peak = __atomic_load_n(&memory_peak, __ATOMIC_RELAXED);
+    while (used + n > peak && !__atomic_compare_exchange_n(&memory_peak, &peak, used + n, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+    return 0;
+}
+
+/// Account for @c n fewer bytes held.
+static void memory_release(size_t n)
+{
+    __atomic_fetch_sub(&memory_used, n, __ATOMIC_RELAXED);
+}
+
+/// Count a request to allocate or reallocate an object or buffer.
+static void memory_count_allocation(void)
+{
+    __atomic_fetch_add(&memory_allocations, 1, __ATOMIC_RELAXED);
+}
+
+/// Recording of traces (see string_trace_start()).
+/// Records are encoded into a static buffer under a mutex, and written out whenever it is full.
+/// Calls made after recording stopped, while already past the unlocked check, are encoded but never written.
+#define TRACE_BUFFER ((size_t)1 << 16)
+
+/// Maximum length of a field of a record.
+#define TRACE_FIELD_MAX ((sizeof(size_t) * CHAR_BIT + 6) / 7)
+
+static pthread_mutex_t trace_mutex = PTHREAD_MUTEX_INITIALIZER;
+static int trace_fd = -1;
+static bool trace_started;
+static bool trace_active;
+const bool *const string_trace_flag = &trace_active;
+static int trace_error;
+static const void *trace_prev;
+static size_t trace_len;
+static char trace_buf[TRACE_BUFFER];
+
+/// True if calls are being recorded; when stopped, recording a call costs no more than this relaxed load.
+#define TRACING() (__atomic_load_n(&trace_fd, __ATOMIC_RELAXED) >= 0)
+
+/// Record a call of operation @c op on object @c str, with @c n arguments that are only evaluated if recording.
+#define TRACE(op, str, n, ...) \
+    do { \
+        if (TRACING()) { \
+            trace_record((op), (str), (n), (const size_t[]){ __VA_ARGS__ }); \
+        } \
+    } while (0)
+
+/// Write out the buffered records, with the mutex held.
+/// On failure, recording stops, and the error is kept for string_trace_stop().
+static void trace_flush(void)
+{
+    int saved = errno;
+    size_t done = 0;
+    ssize_t r;
+
+    while (__atomic_load_n(&trace_fd, __ATOMIC_RELAXED) >= 0 && done < trace_len) {
+        do {
+            r = write(trace_fd, &trace_buf[done], trace_len - done);
+        } while (r < 0 && errno == EINTR);
+
+        if (r < 0) {
+            trace_error = -errno;
+            __atomic_store_n(&trace_fd, -1, __ATOMIC_RELAXED);
+            __atomic_store_n(&trace_active, false, __ATOMIC_RELAXED);
+            break;
+        }
+        done += (size_t)r;
+    }
+
+    trace_len = 0;
+    errno = saved;
+}
+
+/// Append field @c v to the current record, as a varint.
+static void trace_put(size_t v)
+{
+    if (TRACE_BUFFER - trace_len < TRACE_FIELD_MAX) {
+        trace_flush();
+    }
+
+    for (; v >= 0x80; v >>= 7) {
+        trace_buf[trace_len++] = (char)(v | 0x80);
+    }
+    trace_buf[trace_len++] = (char)v;
+}
+
+/// @return Difference between the addresses @c from and @c to, zigzag encoded so that small differences are short.
+static size_t trace_delta(const void *from, const void *to)
+{
+    size_t d = (size_t)(uintptr_t)to - (size_t)(uintptr_t)from;
+
+    return (d << 1) ^ (0 - (d >> (sizeof(size_t) * CHAR_BIT - 1)));
+}
+
+/// Take the mutex, and start a record of operation @c op on object @c str.
+static void trace_begin(unsigned op, const struct string *str)
+{
+    pthread_mutex_lock(&trace_mutex);
+    trace_put(op);
+    trace_put(trace_delta(trace_prev, str));
+    trace_prev = str;
+}
+
+/// End the current record, releasing the mutex.
+static void trace_end(void)
+{
+    pthread_mutex_unlock(&trace_mutex);
+}
+
+/// Record operation @c op on object @c str, with the @c n arguments @c args.
+static void trace_record(unsigned op, const struct string *str, size_t n, const size_t *args)
+{
+    size_t i;
+
+    trace_begin(op, str);
+    for (i = 0; i < n; ++i) {
+        trace_put(args[i]);
+    }
+    trace_end();
+}
+
+int string_trace_start(int fd)
+{
+    int r = 0;
+
+    if (fd < 0) {
+        return -EBADF;
+    }
+
+    pthread_mutex_lock(&trace_mutex);
+    if (trace_started) {
+        r = -EBUSY;
+    } else {
+        trace_started = true;
+        __atomic_store_n(&trace_active, true, __ATOMIC_RELAXED);
+        trace_error = 0;
+        trace_prev = NULL;
+        memcpy(trace_buf, STRING_TRACE_MAGIC, strlen(STRING_TRACE_MAGIC));
+        trace_len = strlen(STRING_TRACE_MAGIC);
+        __atomic_store_n(&trace_fd, fd, __ATOMIC_RELAXED);
+    }
+    pthread_mutex_unlock(&trace_mutex);
+    return r;
+}
+
+int string_trace_stop(void)
+{
+    int r = -EINVAL;
+
+    pthread_mutex_lock(&trace_mutex);
+    if (trace_started) {
+        trace_flush();
+        r = trace_error;
+        trace_started = false;
+        __atomic_store_n(&trace_fd, -1, __ATOMIC_RELAXED);
+        __atomic_store_n(&trace_active, false, __ATOMIC_RELAXED);
+    }
+    pthread_mutex_unlock(&trace_mutex);
+    return r;
+}
+
+/// Create an empty string, without recording the call.
+static struct string *impl_new(void)
 {
     struct string *str = NULL;
 
+    memory_count_allocation();
     str = calloc(1, sizeof(struct string));
     if (!str) {
         errno = ENOMEM;
@@ -44,6 +216,16 @@ struct string *string_new(void)
     return str;
 }
 
+struct string *string_new(void)
+{
+    struct string *str = impl_new();
+
+    if (str) {
+        TRACE(STRING_TRACE_NEW, str, 0, 0);
+    }
+    return str;
+}
+
 static bool internal_storage_used(const struct string *str)
 {
     // Precondition.
@@ -51,148 +233,785 @@ static bool internal_storage_used(const struct string *str)
     return str->buf == str->sso;
 }
 
-void string_delete(struct string *str)
+/// Hash constants (splitmix64 multipliers and golden ratio).
+#define HASH_SEED UINT64_C(0x9e3779b97f4a7c15)
+#define HASH_K1 UINT64_C(0xbf58476d1ce4e5b9)
+#define HASH_K2 UINT64_C(0x94d049bb133111eb)
+
+/// Load up to eight characters as a little-endian word, zero padded, so that hashes do not depend on byte order.
+static uint64_t load_le(const char *s, size_t n)
 {
-    if (!str) {
-        return;
-    }
+    uint64_t w = 0;
 
-    if (!internal_storage_used(str)) {
-        free(str->buf);
+    while (n-- > 0) {
+        w = (w << 8) | (unsigned char)s[n];
     }
-    str->buf = NULL;
-    free(str);
+    return w;
 }
 
-bool string_empty(const struct string *str)
+/// Fold a word of characters into hash state.
+static uint64_t hash_block(uint64_t h, uint64_t w)
 {
-    return string_size(str) == 0;
+    w *= HASH_K1;
+    w ^= w >> 29;
+    h ^= w;
+    return ((h << 27) | (h >> 37)) * HASH_K2 + HASH_SEED;
 }
 
-size_t string_size(const struct string *str)
+/// Fold trailing characters and total length into hash state, and mix.
+static uint64_t hash_final(uint64_t h, uint64_t tail, size_t len)
 {
-    if (!str) {
-        return 0;
-    }
+    h = hash_block(h, tail) ^ (uint64_t)len;
+    h ^= h >> 33;
+    h *= HASH_K1;
+    h ^= h >> 33;
+    h *= HASH_K2;
+    h ^= h >> 33;
+    return h;
+}
 
-    return str->len;
+/// Hash states of the strings that track them (see string_hash_track()), kept out of the objects so that other
+/// strings do not grow. Each record is found by object address in a chained table, whose buckets double as
+/// records are added; the table is shared between threads, while each record is only used by its string.
+struct hash_state {
+    /// String tracked.
+    const struct string *str;
+    /// Next record in the bucket.
+    struct hash_state *next;
+    /// Hash state of the first @c hashed characters, a multiple of the word size, or none if zero.
+    uint64_t hash;
+    size_t hashed;
+};
+
+static pthread_mutex_t hash_states_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct hash_state **hash_states;
+static size_t hash_states_buckets;
+static size_t hash_states_count;
+
+/// @return Bucket of @c str in a table of @c buckets buckets, a power of two.
+static size_t hash_state_bucket(const struct string *str, size_t buckets)
+{
+    return (size_t)(((uint64_t)(uintptr_t)str * HASH_SEED) >> 32) & (buckets - 1);
 }
 
-int string_reserve(struct string *str, size_t cap)
+/// @return Link to the record of @c str, which must exist.
+/// @note Called with hash_states_mutex held.
+static struct hash_state **hash_state_link(const struct string *str)
 {
-    char *buf;
-    bool is_sso;
+    struct hash_state **link = &hash_states[hash_state_bucket(str, hash_states_buckets)];
 
-    if (!str) {
-        return -EFAULT;
+    while ((*link)->str != str) {
+        link = &(*link)->next;
     }
+    return link;
+}
 
-    if (cap == SIZE_MAX) {
-        // Cannot allocate enough memory to hold NUL terminator.
+/// @return Record of @c str, which tracks its hash state.
+static struct hash_state *hash_state_get(const struct string *str)
+{
+    struct hash_state *state;
+
+    // Precondition.
+    assert(str->flags & STRING_FLAG_HASH_TRACK);
+
+    pthread_mutex_lock(&hash_states_mutex);
+    state = *hash_state_link(str);
+    pthread_mutex_unlock(&hash_states_mutex);
+    return state;
+}
+
+/// Create the record of @c str, with no state.
+/// @return Zero on success, negative errno otherwise.
+static int hash_state_add(const struct string *str)
+{
+    struct hash_state *state;
+    int r = 0;
+
+    memory_count_allocation();
+    state = calloc(1, sizeof(*state));
+    if (!state) {
         return -ENOMEM;
     }
+    state->str = str;
+
+    pthread_mutex_lock(&hash_states_mutex);
+    if (hash_states_count == hash_states_buckets) {
+        size_t buckets = hash_states_buckets ? hash_states_buckets * 2 : 16;
+        struct hash_state **table;
+        size_t i;
+
+        memory_count_allocation();
+        table = calloc(buckets, sizeof(*table));
+        if (!table) {
+            r = -ENOMEM;
+            goto out;
+        }
 
-    if (cap < str->len) {
-        return 0;
+        // Relink the records into the larger table.
+        for (i = 0; i < hash_states_buckets; ++i) {
+            while (hash_states[i]) {
+                struct hash_state *moved = hash_states[i];
+                struct hash_state **link = &table[hash_state_bucket(moved->str, buckets)];
+
+                hash_states[i] = moved->next;
+                moved->next = *link;
+                *link = moved;
+            }
+        }
+        free(hash_states);
+        hash_states = table;
+        hash_states_buckets = buckets;
     }
 
-    is_sso = internal_storage_used(str);
-    if (is_sso) {
-        buf = malloc(cap + 1);
-    } else {
-        buf = realloc(str->buf, cap + 1);
+    state->next = hash_states[hash_state_bucket(str, hash_states_buckets)];
+    hash_states[hash_state_bucket(str, hash_states_buckets)] = state;
+    ++hash_states_count;
+
+out:
+    pthread_mutex_unlock(&hash_states_mutex);
+    if (r < 0) {
+        free(state);
     }
+    return r;
+}
 
-    if (!buf) {
-        return -ENOMEM;
+/// Destroy the record of @c str, which tracks its hash state.
+static void hash_state_remove(const struct string *str)
+{
+    struct hash_state **link;
+    struct hash_state *state;
+
+    // Precondition.
+    assert(str->flags & STRING_FLAG_HASH_TRACK);
+
+    pthread_mutex_lock(&hash_states_mutex);
+    link = hash_state_link(str);
+    state = *link;
+    *link = state->next;
+    --hash_states_count;
+    pthread_mutex_unlock(&hash_states_mutex);
+    free(state);
+}
+
+/// Give the record of @c from, which tracks its hash state, to @c to, which does not.
+static void hash_state_rekey(const struct string *from, const struct string *to)
+{
+    struct hash_state **link;
+    struct hash_state *state;
+
+    // Precondition.
+    assert(from->flags & STRING_FLAG_HASH_TRACK);
+
+    pthread_mutex_lock(&hash_states_mutex);
+    link = hash_state_link(from);
+    state = *link;
+    *link = state->next;
+    state->str = to;
+    link = &hash_states[hash_state_bucket(to, hash_states_buckets)];
+    state->next = *link;
+    *link = state;
+    pthread_mutex_unlock(&hash_states_mutex);
+}
+
+/// Fold the words of @c str not yet in @c state, as string_hash_buffer() would.
+/// @return Hash state of the first @c state->hashed characters.
+static uint64_t hash_state_update(struct hash_state *state, const struct string *str)
+{
+    uint64_t h = (state->hashed > 0) ? state->hash : HASH_SEED;
+    size_t i;
+
+    for (i = state->hashed; i + sizeof(uint64_t) <= str->len; i += sizeof(uint64_t)) {
+        h = hash_block(h, load_le(&str->buf[i], sizeof(uint64_t)));
     }
 
-    if (is_sso) {
-        memcpy(buf, str->sso, str->len + 1);
+    state->hash = h;
+    state->hashed = i;
+    return h;
+}
+
+/// Fold the characters appended to @c str into its hash state, if it tracks one.
+static void hash_append(struct string *str)
+{
+    // Precondition.
+    assert(str);
+
+    if (str->flags & STRING_FLAG_HASH_TRACK) {
+        hash_state_update(hash_state_get(str), str);
     }
+}
 
-    str->cap = cap;
-    str->buf = buf;
-    str->buf[str->len] = 0;
-    return 0;
+/// Forget the hash state of @c str, if it tracks one that covers position @c pos; it cannot be rewound, only restarted.
+static void hash_restart(struct string *str, size_t pos)
+{
+    // Precondition.
+    assert(str);
+
+    if (str->flags & STRING_FLAG_HASH_TRACK) {
+        struct hash_state *state = hash_state_get(str);
+
+        if (pos < state->hashed) {
+            state->hashed = 0;
+        }
+    }
 }
 
-size_t string_capacity(const struct string *str)
+/// Forget cached properties; called whenever the content changes, from position @c pos onwards.
+/// A compressed representation is forgotten too, as when the content is replaced without being decompressed.
+static void invalidate(struct string *str, size_t pos)
 {
-    if (!str) {
-        return 0;
+    // Precondition.
+    assert(str);
+    str->flags &= ~(STRING_FLAG_UTF8_VALID | STRING_FLAG_COMPRESSED);
+
+    hash_restart(str, pos);
+}
+
+/// Return to the empty state, using internal storage.
+/// @note Any allocated buffer must have been released or detached by the caller.
+static void reset(struct string *str)
+{
+    // Precondition.
+    assert(str);
+
+    str->buf = str->sso;
+    str->cap = SSO_CAPACITY;
+    str->len = 0;
+    str->buf[0] = 0;
+    invalidate(str, 0);
+}
+
+/// Compression of cold strings, in a byte-oriented LZ77 format in the manner of LZ4.
+/// Each sequence is a token whose high and low nibbles hold a number of literals and a match
+/// length (minus LZ_MIN_MATCH), either extended by bytes of 255 while saturated, then the literals,
+/// then the match offset as two little-endian bytes. The last sequence holds only literals.
+#define LZ_MIN_MATCH 4
+#define LZ_MAX_OFFSET 65535
+#define LZ_HASH_BITS 12
+
+static uint32_t lz_hash(const char *p)
+{
+    uint32_t w;
+    memcpy(&w, p, sizeof(w));
+    return (w * UINT32_C(2654435761)) >> (32 - LZ_HASH_BITS);
+}
+
+/// Write the extension of a nibble length, @c n being the excess over 15.
+static char *lz_put_length(char *op, size_t n)
+{
+    for (; n >= 255; n -= 255) {
+        *op++ = (char)255;
     }
+    *op++ = (char)n;
+    return op;
+}
 
-    return str->cap;
+/// Read the extension of a nibble length.
+static size_t lz_get_length(const unsigned char **ip)
+{
+    size_t n = 0;
+    unsigned char b;
+
+    do {
+        b = *(*ip)++;
+        n += b;
+    } while (b == 255);
+    return n;
 }
 
-char string_at(const struct string *str, size_t pos)
+/// Append a sequence of @c nlit literals from @c lit, then a match of length @c mlen at distance @c off unless @c mlen is zero.
+/// @return False if the sequence might not fit in the @c cap characters of @c dest.
+static bool lz_put_sequence(char *dest, size_t cap, size_t *out, const char *lit, size_t nlit, size_t mlen, size_t off)
 {
-    if (!str) {
-        return 0;
+    // Token, literals, offset, and both length extensions.
+    size_t worst = 1 + nlit + 2 + (nlit / 255 + 1) + (mlen / 255 + 1);
+    char *token;
+    char *op;
+
+    if (worst > cap - *out) {
+        return false;
     }
 
-    if (pos >= str->len) {
-        return 0;
+    token = &dest[*out];
+    op = token + 1;
+    *token = (char)(((nlit < 15) ? nlit : 15) << 4);
+    if (nlit >= 15) {
+        op = lz_put_length(op, nlit - 15);
+    }
+    memcpy(op, lit, nlit);
+    op += nlit;
+
+    if (mlen > 0) {
+        mlen -= LZ_MIN_MATCH;
+        *token |= (char)((mlen < 15) ? mlen : 15);
+        *op++ = (char)(off & 0xff);
+        *op++ = (char)(off >> 8);
+        if (mlen >= 15) {
+            op = lz_put_length(op, mlen - 15);
+        }
     }
 
-    return str->buf[pos];
+    *out = (size_t)(op - dest);
+    return true;
 }
 
-const char *string_c_str(const struct string *str)
+/// Compress @c n characters of @c src into @c dest, of capacity @c cap.
+/// @return Compressed size, or zero if larger than @c cap.
+static size_t lz_compress(const char *src, size_t n, char *dest, size_t cap)
 {
-    if (!str) {
-        errno = EFAULT;
-        return NULL;
+    size_t table[1 << LZ_HASH_BITS] = { 0 };
+    size_t anchor = 0;
+    size_t out = 0;
+    size_t i = 0;
+
+    while (i + LZ_MIN_MATCH <= n) {
+        uint32_t h = lz_hash(&src[i]);
+        size_t cand = table[h];
+        size_t len = LZ_MIN_MATCH;
+
+        table[h] = i;
+        if (cand == i || i - cand > LZ_MAX_OFFSET || memcmp(&src[cand], &src[i], LZ_MIN_MATCH) != 0) {
+            ++i;
+            continue;
+        }
+
+        while (i + len < n && src[cand + len] == src[i + len]) {
+            ++len;
+        }
+
+        if (!lz_put_sequence(dest, cap, &out, &src[anchor], i - anchor, len, i - cand)) {
+            return 0;
+        }
+        i += len;
+        anchor = i;
     }
 
-    return str->buf;
+    if (!lz_put_sequence(dest, cap, &out, &src[anchor], n - anchor, 0, 0)) {
+        return 0;
+    }
+    return out;
 }
 
-char *string_c_str_move(struct string *str)
+/// Decompress @c n characters of @c src, produced by lz_compress(), into @c dest.
+static void lz_decompress(const char *src, size_t n, char *dest)
+{
+    const unsigned char *ip = (const unsigned char *)src;
+    const unsigned char *end = ip + n;
+    char *op = dest;
+
+    for (;;) {
+        unsigned token = *ip++;
+        size_t nlit = token >> 4;
+        size_t mlen = token & 15;
+        size_t off;
+
+        if (nlit == 15) {
+            nlit += lz_get_length(&ip);
+        }
+        memcpy(op, ip, nlit);
+        op += nlit;
+        ip += nlit;
+
+        if (ip == end) {
+            break;
+        }
+
+        off = ip[0] | (size_t)ip[1] << 8;
+        ip += 2;
+        if (mlen == 15) {
+            mlen += lz_get_length(&ip);
+        }
+        mlen += LZ_MIN_MATCH;
+
+        if (off >= mlen) {
+            memcpy(op, op - off, mlen);
+            op += mlen;
+        } else {
+            // Overlapping match repeats the last characters.
+            for (; mlen > 0; --mlen, ++op) {
+                *op = op[-off];
+            }
+        }
+    }
+}
+
+/// Decompress the content if compressed, dropping the compressed representation.
+/// Takes a const pointer as decompressing does not change the observable value of the object.
+/// @return Zero on success, negative errno otherwise.
+static int expand(const struct string *str)
 {
+    struct string *s = (struct string *)str;
     char *buf;
 
-    if (!str) {
-        errno = EFAULT;
-        return NULL;
+    if (!str || !(str->flags & STRING_FLAG_COMPRESSED)) {
+        return 0;
     }
 
-    if (internal_storage_used(str)) {
-        // Duplicate internal storage.
-        buf = strdup(str->sso);
-        if (!buf) {
-            errno = ENOMEM;
-            return NULL;
-        }
+    if (memory_charge(s->len + 1) < 0) {
+        return -ENOMEM;
+    }
 
-    } else {
-        // Detach allocated buffer.
-        buf = str->buf;
+    memory_count_allocation();
+    buf = malloc(s->len + 1);
+    if (!buf) {
+        memory_release(s->len + 1);
+        return -ENOMEM;
     }
 
-    str->buf = str->sso;
-    str->cap = SSO_CAPACITY;
-    str->len = 0;
-    str->buf[0] = 0;
-    return buf;
+    lz_decompress(s->buf, s->cap, buf);
+    buf[s->len] = 0;
+    free(s->buf);
+    memory_release(s->cap + 1);
+    s->buf = buf;
+    s->cap = s->len;
+    s->flags &= ~STRING_FLAG_COMPRESSED;
+    return 0;
 }
 
-void string_clear(struct string *str)
+/// Destroy a string, without recording the call.
+static void impl_delete(struct string *str)
+{
+    // Precondition.
+    assert(str);
+
+    if (!internal_storage_used(str)) {
+        free(str->buf);
+        memory_release(str->cap + 1);
+    }
+    if (str->flags & STRING_FLAG_HASH_TRACK) {
+        hash_state_remove(str);
+    }
+    str->buf = NULL;
+    free(str);
+}
+
+void string_delete(struct string *str)
 {
+    TRACE(STRING_TRACE_DELETE, str, 0, 0);
+
     if (!str) {
         return;
     }
 
-    str->len = 0;
-    str->buf[0] = 0;
+    impl_delete(str);
 }
 
-/// Avoid performance issues with repeated small appends.
-/// @return New capacity to reserve.
-static size_t compute_growth(size_t current, size_t required)
+struct string *string_new_adopt(char *buf, size_t len, size_t cap)
 {
-    size_t doubled;
+    struct string *str = NULL;
+
+    if (!buf) {
+        errno = EFAULT;
+        return NULL;
+    }
+
+    if (len > cap || cap == SIZE_MAX) {
+        errno = ERANGE;
+        return NULL;
+    }
+
+    str = impl_new();
+    if (!str) {
+        return NULL;
+    }
+
+    if (memory_charge(cap + 1) < 0) {
+        free(str);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    str->buf = buf;
+    str->cap = cap;
+    str->len = len;
+    str->buf[len] = 0;
+    TRACE(STRING_TRACE_NEW_ADOPT, str, 2, len, cap);
+    return str;
+}
+
+int string_move(struct string *dst, struct string *src)
+{
+    TRACE(STRING_TRACE_MOVE, dst, 1, trace_delta(dst, src));
+
+    if (!dst) {
+        return -EFAULT;
+    }
+
+    if (!src) {
+        return -EFAULT;
+    }
+
+    if (dst == src) {
+        return 0;
+    }
+
+    if (!internal_storage_used(dst)) {
+        free(dst->buf);
+        memory_release(dst->cap + 1);
+    }
+
+    if (internal_storage_used(src)) {
+        // Small strings are copied.
+        memcpy(dst->sso, src->sso, src->len + 1);
+        dst->buf = dst->sso;
+    } else {
+        // Steal allocated buffer.
+        dst->buf = src->buf;
+    }
+
+    dst->cap = src->cap;
+    dst->len = src->len;
+    if (dst->flags & STRING_FLAG_HASH_TRACK) {
+        hash_state_remove(dst);
+    }
+    if (src->flags & STRING_FLAG_HASH_TRACK) {
+        // The hash state moves with the content, and @c src stops tracking.
+        hash_state_rekey(src, dst);
+    }
+    dst->flags = src->flags;
+    src->flags = 0;
+
+    reset(src);
+    return 0;
+}
+
+void string_swap(struct string *a, struct string *b)
+{
+    struct string tmp;
+
+    TRACE(STRING_TRACE_SWAP, a, 1, trace_delta(a, b));
+
+    if (!a || !b) {
+        return;
+    }
+
+    // Hash states are found by object address, so they are exchanged separately.
+    if (a->flags & b->flags & STRING_FLAG_HASH_TRACK) {
+        struct hash_state *sa = hash_state_get(a);
+        struct hash_state *sb = hash_state_get(b);
+        uint64_t hash = sa->hash;
+        size_t hashed = sa->hashed;
+
+        sa->hash = sb->hash;
+        sa->hashed = sb->hashed;
+        sb->hash = hash;
+        sb->hashed = hashed;
+    } else if (a->flags & STRING_FLAG_HASH_TRACK) {
+        hash_state_rekey(a, b);
+    } else if (b->flags & STRING_FLAG_HASH_TRACK) {
+        hash_state_rekey(b, a);
+    }
+
+    tmp = *a;
+    *a = *b;
+    *b = tmp;
+
+    // Internal storage moved with the copy.
+    if (a->buf == b->sso) {
+        a->buf = a->sso;
+    }
+
+    if (b->buf == a->sso) {
+        b->buf = b->sso;
+    }
+}
+
+bool string_empty(const struct string *str)
+{
+    return string_size(str) == 0;
+}
+
+size_t string_size(const struct string *str)
+{
+    if (!str) {
+        return 0;
+    }
+
+    return str->len;
+}
+
+/// Reserve storage for @c cap characters, without recording the call.
+/// @return Zero on success, negative errno otherwise.
+static int impl_reserve(struct string *str, size_t cap)
+{
+    size_t held;
+    size_t grow;
+    char *buf;
+    bool is_sso;
+    int r;
+
+    // Precondition.
+    assert(str);
+
+    r = expand(str);
+    if (r < 0) {
+        return r;
+    }
+
+    if (cap == SIZE_MAX) {
+        // Cannot allocate enough memory to hold NUL terminator.
+        return -ENOMEM;
+    }
+
+    if (cap < str->len) {
+        return 0;
+    }
+
+    // Growth is charged before allocating, so that the budget is never exceeded.
+    is_sso = internal_storage_used(str);
+    held = is_sso ? 0 : str->cap + 1;
+    grow = (cap + 1 > held) ? cap + 1 - held : 0;
+    r = memory_charge(grow);
+    if (r < 0) {
+        return r;
+    }
+
+    memory_count_allocation();
+    if (is_sso) {
+        buf = malloc(cap + 1);
+    } else {
+        buf = realloc(str->buf, cap + 1);
+    }
+
+    if (!buf) {
+        memory_release(grow);
+        return -ENOMEM;
+    }
+
+    if (is_sso) {
+        memcpy(buf, str->sso, str->len + 1);
+    }
+    memory_release((held > cap + 1) ? held - (cap + 1) : 0);
+
+    str->cap = cap;
+    str->buf = buf;
+    str->buf[str->len] = 0;
+    return 0;
+}
+
+int string_reserve(struct string *str, size_t cap)
+{
+    TRACE(STRING_TRACE_RESERVE, str, 1, cap);
+
+    if (!str) {
+        return -EFAULT;
+    }
+
+    return impl_reserve(str, cap);
+}
+
+size_t string_capacity(const struct string *str)
+{
+    if (!str) {
+        return 0;
+    }
+
+    return str->cap;
+}
+
+char string_at(const struct string *str, size_t pos)
+{
+    TRACE(STRING_TRACE_AT, str, 1, pos);
+
+    if (!str) {
+        return 0;
+    }
+
+    if (pos >= str->len) {
+        return 0;
+    }
+
+    if (expand(str) < 0) {
+        return 0;
+    }
+
+    return str->buf[pos];
+}
+
+const char *string_c_str(const struct string *str)
+{
+    TRACE(STRING_TRACE_C_STR, str, 0, 0);
+
+    if (!str) {
+        errno = EFAULT;
+        return NULL;
+    }
+
+    if (expand(str) < 0) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    return str->buf;
+}
+
+struct string_view string_as_view(const struct string *str)
+{
+    struct string_view view = { NULL, 0 };
+
+    TRACE(STRING_TRACE_AS_VIEW, str, 0, 0);
+
+    if (!str || expand(str) < 0) {
+        return view;
+    }
+
+    view.buf = str->buf;
+    view.len = str->len;
+    return view;
+}
+
+char *string_c_str_move(struct string *str)
+{
+    char *buf;
+
+    TRACE(STRING_TRACE_C_STR_MOVE, str, 0, 0);
+
+    if (!str) {
+        errno = EFAULT;
+        return NULL;
+    }
+
+    if (expand(str) < 0) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    if (internal_storage_used(str)) {
+        // Duplicate internal storage.
+        memory_count_allocation();
+        buf = strdup(str->sso);
+        if (!buf) {
+            errno = ENOMEM;
+            return NULL;
+        }
+
+    } else {
+        // Detach allocated buffer, which the caller now holds.
+        buf = str->buf;
+        memory_release(str->cap + 1);
+    }
+
+    reset(str);
+    return buf;
+}
+
+void string_clear(struct string *str)
+{
+    TRACE(STRING_TRACE_CLEAR, str, 0, 0);
+
+    if (!str) {
+        return;
+    }
+
+    str->len = 0;
+    str->buf[0] = 0;
+    invalidate(str, 0);
+}
+
+/// Avoid performance issues with repeated small appends.
+/// @return New capacity to reserve.
+static size_t compute_growth(size_t current, size_t required)
+{
+    size_t doubled;
 
     // Precondition.
     assert(required > 0);
@@ -201,213 +1020,1441 @@ static size_t compute_growth(size_t current, size_t required)
         return required;
     }
 
-    if (current > SIZE_MAX / STRING_GROWTH_FACTOR) {
-        // Doubling would overflow SIZE_MAX; grow to exact required size instead.
-        return required;
+    if (current > SIZE_MAX / STRING_GROWTH_FACTOR) {
+        // Doubling would overflow SIZE_MAX; grow to exact required size instead.
+        return required;
+    }
+
+    doubled = current * STRING_GROWTH_FACTOR;
+    return (doubled > required) ? doubled : required;
+}
+
+/// Insert @c n characters at position @c pos.
+/// @return Pointer to the start of the inserted area on success, NULL on failure.
+static char *impl_insert(struct string *str, size_t pos, size_t n)
+{
+    size_t required;
+    char *dest;
+
+    // Precondition.
+    assert(str);
+
+    if (n > SIZE_MAX - str->len) {
+        // Check for overflow.
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    // Also true for compressed content, which impl_reserve() decompresses.
+    required = str->len + n;
+    if (required > str->cap) {
+        int r = impl_reserve(str, compute_growth(str->cap, required));
+        if (r < 0) {
+            return NULL;
+        }
+    }
+
+    dest = &str->buf[pos];
+
+    if (pos < str->len) {
+        size_t rhs = str->len - pos;
+
+        memmove(&str->buf[pos + n],
+                &str->buf[pos],
+                rhs + 1);
+    } else {
+        str->buf[pos + n] = 0;
+    }
+
+    str->len += n;
+    invalidate(str, pos);
+    return dest;
+}
+
+/// Insert buffer @c s of length @c n at position @c pos.
+/// @return Zero on success, negative errno otherwise.
+static int impl_insert_buffer(struct string *str, size_t pos, size_t n, const char *s)
+{
+    char *dest;
+
+    // Preconditions.
+    assert(str);
+    assert(s);
+
+    dest = impl_insert(str, pos, n);
+    if (!dest) {
+        return -errno;
+    }
+
+    memmove(dest, s, n);
+
+    // Appends update the hash state as they go; other insertions restarted it, which string_hash() catches up.
+    if (pos + n == str->len) {
+        hash_append(str);
+    }
+    return 0;
+}
+
+/// Insert @c n copies of character @c c at position @c pos.
+/// @return Zero on success, negative errno otherwise.
+static int impl_insert_fill(struct string *str, size_t pos, size_t n, char c)
+{
+    char *dest;
+
+    // Precondition.
+    assert(str);
+
+    dest = impl_insert(str, pos, n);
+    if (!dest) {
+        return -errno;
+    }
+
+    memset(dest, c, n);
+
+    // Appends update the hash state as they go; other insertions restarted it, which string_hash() catches up.
+    if (pos + n == str->len) {
+        hash_append(str);
+    }
+    return 0;
+}
+
+int string_insert_buffer(struct string *str, size_t pos, size_t n, const char *s)
+{
+    TRACE(STRING_TRACE_INSERT_BUFFER, str, 2, pos, n);
+
+    if (!str) {
+        return -EFAULT;
+    }
+
+    if (!s) {
+        return -EFAULT;
+    }
+
+    if (pos > str->len) {
+        return -ERANGE;
+    }
+
+    return impl_insert_buffer(str, pos, n, s);
+}
+
+int string_insert_c_str(struct string *str, size_t pos, const char *s)
+{
+    TRACE(STRING_TRACE_INSERT_C_STR, str, 2, pos, s ? strlen(s) : 0);
+
+    if (!str) {
+        return -EFAULT;
+    }
+
+    if (!s) {
+        return -EFAULT;
+    }
+
+    if (pos > str->len) {
+        return -ERANGE;
+    }
+
+    return impl_insert_buffer(str, pos, strlen(s), s);
+}
+
+int string_insert_fill(struct string *str, size_t pos, size_t n, char c)
+{
+    TRACE(STRING_TRACE_INSERT_FILL, str, 2, pos, n);
+
+    if (!str) {
+        return -EFAULT;
+    }
+
+    if (pos > str->len) {
+        return -ERANGE;
+    }
+
+    return impl_insert_fill(str, pos, n, c);
+}
+
+int string_erase(struct string *str, size_t pos, size_t len)
+{
+    size_t rhs;
+    size_t n;
+    int r;
+
+    TRACE(STRING_TRACE_ERASE, str, 2, pos, len);
+
+    if (!str) {
+        return -EFAULT;
+    }
+
+    if (pos > str->len) {
+        return -ERANGE;
+    }
+
+    // For consistency with string_insert_*().
+    if (pos == str->len) {
+        return 0;
+    }
+
+    if (len == 0) {
+        return 0;
+    }
+
+    r = expand(str);
+    if (r < 0) {
+        return r;
+    }
+
+    //    rhs
+    //   /--------------\
+    //    len   n
+    //   /----\/--------\
+    // --+--+--+--+--+--+
+    //   |  |  |  |  |  |
+    // --+--+--+--+--+--+
+    //    ^              ^
+    //    pos            str->len
+    rhs = str->len - pos;
+    n = 0;
+
+    if (len > rhs) {
+        // Erase as many as possible.
+        len = rhs;
+    }
+
+    n = rhs - len;
+
+    memmove(&str->buf[pos],
+            &str->buf[pos + len],
+            n + 1);
+
+    str->len -= len;
+    invalidate(str, pos);
+    return 0;
+}
+
+int string_apply_edits(struct string *str, const struct string_edit *edits, size_t n)
+{
+    char tmp[sizeof(((struct string *)0)->sso)];
+    size_t size;
+    size_t end = 0;
+    size_t i;
+    char *buf;
+    char *p;
+    int r;
+
+    if (!str) {
+        return -EFAULT;
+    }
+
+    if (!edits && n > 0) {
+        return -EFAULT;
+    }
+
+    if (TRACING()) {
+        trace_begin(STRING_TRACE_APPLY_EDITS, str);
+        trace_put(n);
+        for (i = 0; i < n; ++i) {
+            trace_put(edits[i].pos);
+            trace_put(edits[i].len);
+            trace_put(edits[i].n);
+        }
+        trace_end();
+    }
+
+    // Validate, and compute size of result.
+    size = str->len;
+    for (i = 0; i < n; ++i) {
+        if (!edits[i].s && edits[i].n > 0) {
+            return -EFAULT;
+        }
+
+        if (edits[i].pos > str->len || edits[i].len > str->len - edits[i].pos) {
+            return -ERANGE;
+        }
+
+        if (edits[i].pos < end) {
+            return -EINVAL;
+        }
+
+        if (edits[i].n > SIZE_MAX - 1 - (size - edits[i].len)) {
+            // Check for overflow.
+            return -ENOMEM;
+        }
+
+        size = size - edits[i].len + edits[i].n;
+        end = edits[i].pos + edits[i].len;
+    }
+
+    if (n == 0) {
+        return 0;
+    }
+
+    r = expand(str);
+    if (r < 0) {
+        return r;
+    }
+
+    // Build in new storage, as inserted characters may point into the string.
+    if (size > SSO_CAPACITY) {
+        r = memory_charge(size + 1);
+        if (r < 0) {
+            return r;
+        }
+        memory_count_allocation();
+    }
+
+    buf = (size <= SSO_CAPACITY) ? tmp : malloc(size + 1);
+    if (!buf) {
+        memory_release(size + 1);
+        return -ENOMEM;
+    }
+
+    p = buf;
+    end = 0;
+    for (i = 0; i < n; ++i) {
+        memcpy(p, &str->buf[end], edits[i].pos - end);
+        p += edits[i].pos - end;
+        if (edits[i].n > 0) {
+            memcpy(p, edits[i].s, edits[i].n);
+            p += edits[i].n;
+        }
+        end = edits[i].pos + edits[i].len;
+    }
+    memcpy(p, &str->buf[end], str->len - end);
+    buf[size] = 0;
+
+    if (!internal_storage_used(str)) {
+        free(str->buf);
+        memory_release(str->cap + 1);
+    }
+
+    if (buf == tmp) {
+        reset(str);
+        memcpy(str->buf, tmp, size + 1);
+    } else {
+        str->buf = buf;
+        str->cap = size;
+    }
+    str->len = size;
+    invalidate(str, edits[0].pos);
+    return 0;
+}
+
+int string_push_back(struct string *str, char c)
+{
+    TRACE(STRING_TRACE_PUSH_BACK, str, 0, 0);
+
+    if (!str) {
+        return -EFAULT;
+    }
+
+    return impl_insert_fill(str, str->len, 1, c);
+}
+
+int string_pop_back(struct string *str)
+{
+    int r;
+
+    TRACE(STRING_TRACE_POP_BACK, str, 0, 0);
+
+    if (!str) {
+        return -EFAULT;
+    }
+
+    if (str->len < 1) {
+        return -ERANGE;
+    }
+
+    r = expand(str);
+    if (r < 0) {
+        return r;
+    }
+
+    str->buf[--str->len] = 0;
+    invalidate(str, str->len);
+    return 0;
+}
+
+int string_append_buffer(struct string *str, size_t n, const char *s)
+{
+    TRACE(STRING_TRACE_APPEND_BUFFER, str, 1, n);
+
+    if (!str) {
+        return -EFAULT;
+    }
+
+    if (!s) {
+        return -EFAULT;
+    }
+
+    return impl_insert_buffer(str, str->len, n, s);
+}
+
+int string_append_c_str(struct string *str, const char *s)
+{
+    TRACE(STRING_TRACE_APPEND_C_STR, str, 1, s ? strlen(s) : 0);
+
+    if (!str) {
+        return -EFAULT;
+    }
+
+    if (!s) {
+        return -EFAULT;
+    }
+
+    return impl_insert_buffer(str, str->len, strlen(s), s);
+}
+
+int string_append_fill(struct string *str, size_t n, char c)
+{
+    TRACE(STRING_TRACE_APPEND_FILL, str, 1, n);
+
+    if (!str) {
+        return -EFAULT;
+    }
+
+    return impl_insert_fill(str, str->len, n, c);
+}
+
+/// Word-at-a-time processing.
+/// Eight characters are handled per 64-bit register, which is portable across
+/// instruction sets and leaves the compiler free to vectorize further.
+#define WORD_ONES UINT64_C(0x0101010101010101)
+#define WORD_HIGHS UINT64_C(0x8080808080808080)
+
+static uint64_t load_word(const char *p)
+{
+    uint64_t w;
+    memcpy(&w, p, sizeof(w));
+    return w;
+}
+
+static void store_word(char *p, uint64_t w)
+{
+    memcpy(p, &w, sizeof(w));
+}
+
+/// @return Mask with the high bit set in each byte of @c w that is an ASCII character in [lo, hi].
+static uint64_t word_in_range(uint64_t w, unsigned char lo, unsigned char hi)
+{
+    // Adding to the low seven bits cannot carry into the next byte.
+    uint64_t heptets = w & ~WORD_HIGHS;
+    uint64_t ge_lo = heptets + WORD_ONES * (0x80 - lo);
+    uint64_t gt_hi = heptets + WORD_ONES * (0x7f - hi);
+    return ge_lo & ~gt_hi & ~w & WORD_HIGHS;
+}
+
+static uint64_t word_to_lower(uint64_t w)
+{
+    // 0x80 >> 2 is the ASCII case bit.
+    return w | (word_in_range(w, 'A', 'Z') >> 2);
+}
+
+static uint64_t word_to_upper(uint64_t w)
+{
+    return w & ~(word_in_range(w, 'a', 'z') >> 2);
+}
+
+static char ascii_to_lower(char c)
+{
+    return ((unsigned)((unsigned char)c - 'A') < 26u) ? (char)(c | 0x20) : c;
+}
+
+static char ascii_to_upper(char c)
+{
+    return ((unsigned)((unsigned char)c - 'a') < 26u) ? (char)(c & ~0x20) : c;
+}
+
+/// Convert ASCII letters of buffer @c buf of length @c n, in place.
+static void impl_convert_case(char *buf, size_t n, bool upper)
+{
+    size_t i;
+
+    for (i = 0; i + sizeof(uint64_t) <= n; i += sizeof(uint64_t)) {
+        uint64_t w = load_word(&buf[i]);
+        store_word(&buf[i], upper ? word_to_upper(w) : word_to_lower(w));
+    }
+
+    for (; i < n; ++i) {
+        buf[i] = upper ? ascii_to_upper(buf[i]) : ascii_to_lower(buf[i]);
+    }
+}
+
+/// @return Position of the first character that differs between buffers @c a and @c b (ignoring ASCII case), or @c n if none.
+static size_t impl_case_mismatch(const char *a, const char *b, size_t n)
+{
+    size_t i;
+
+    for (i = 0; i + sizeof(uint64_t) <= n; i += sizeof(uint64_t)) {
+        uint64_t wa = load_word(&a[i]);
+        uint64_t wb = load_word(&b[i]);
+
+        if (wa != wb && word_to_lower(wa) != word_to_lower(wb)) {
+            // Locate the character below.
+            break;
+        }
+    }
+
+    for (; i < n; ++i) {
+        if (ascii_to_lower(a[i]) != ascii_to_lower(b[i])) {
+            return i;
+        }
+    }
+
+    return n;
+}
+
+/// @return Position of the first character that differs between buffers @c a and @c b, or @c n if none.
+static size_t impl_mismatch(const char *a, const char *b, size_t n)
+{
+    size_t i;
+
+    for (i = 0; i + sizeof(uint64_t) <= n; i += sizeof(uint64_t)) {
+        if (load_word(&a[i]) != load_word(&b[i])) {
+            // Locate the character below.
+            break;
+        }
+    }
+
+    for (; i < n; ++i) {
+        if (a[i] != b[i]) {
+            return i;
+        }
+    }
+
+    return n;
+}
+
+int string_to_lower(struct string *str)
+{
+    int r;
+
+    TRACE(STRING_TRACE_TO_LOWER, str, 0, 0);
+
+    if (!str) {
+        return -EFAULT;
+    }
+
+    r = expand(str);
+    if (r < 0) {
+        return r;
+    }
+
+    impl_convert_case(str->buf, str->len, false);
+
+    // Changing the case of ASCII characters preserves UTF-8 validity, so only the hash state is forgotten.
+    hash_restart(str, 0);
+    return 0;
+}
+
+int string_to_upper(struct string *str)
+{
+    int r;
+
+    TRACE(STRING_TRACE_TO_UPPER, str, 0, 0);
+
+    if (!str) {
+        return -EFAULT;
+    }
+
+    r = expand(str);
+    if (r < 0) {
+        return r;
+    }
+
+    impl_convert_case(str->buf, str->len, true);
+
+    // Changing the case of ASCII characters preserves UTF-8 validity, so only the hash state is forgotten.
+    hash_restart(str, 0);
+    return 0;
+}
+
+int string_casecmp(const struct string *a, const struct string *b)
+{
+    const char *pa;
+    const char *pb;
+    size_t la;
+    size_t lb;
+    size_t n;
+    size_t i;
+
+    TRACE(STRING_TRACE_CASECMP, a, 1, trace_delta(a, b));
+
+    if (expand(a) < 0) {
+        a = NULL;
+    }
+
+    if (expand(b) < 0) {
+        b = NULL;
+    }
+
+    pa = a ? a->buf : "";
+    pb = b ? b->buf : "";
+    la = string_size(a);
+    lb = string_size(b);
+    n = (la < lb) ? la : lb;
+
+    i = impl_case_mismatch(pa, pb, n);
+    if (i < n) {
+        return (unsigned char)ascii_to_lower(pa[i]) - (unsigned char)ascii_to_lower(pb[i]);
+    }
+
+    return (la > lb) - (la < lb);
+}
+
+size_t string_case_find(const struct string *str, size_t pos, size_t n, const char *s)
+{
+    const char *p;
+    const char *last;
+    char lower;
+    char upper;
+
+    TRACE(STRING_TRACE_CASE_FIND, str, 2, pos, n);
+
+    if (!str || !s || expand(str) < 0) {
+        return STRING_NPOS;
+    }
+
+    if (pos > str->len || n > str->len - pos) {
+        return STRING_NPOS;
+    }
+
+    if (n == 0) {
+        return pos;
+    }
+
+    lower = ascii_to_lower(s[0]);
+    upper = ascii_to_upper(s[0]);
+    last = &str->buf[str->len - n];
+
+    for (p = &str->buf[pos]; p <= last; ++p) {
+        if (lower == upper) {
+            // Not a letter: skip ahead with the C library.
+            p = memchr(p, lower, (size_t)(last - p) + 1);
+            if (!p) {
+                break;
+            }
+
+        } else if (*p != lower && *p != upper) {
+            continue;
+        }
+
+        if (impl_case_mismatch(p + 1, s + 1, n - 1) == n - 1) {
+            return (size_t)(p - str->buf);
+        }
+    }
+
+    return STRING_NPOS;
+}
+
+bool string_equal(const struct string *a, const struct string *b)
+{
+    size_t la;
+
+    TRACE(STRING_TRACE_EQUAL, a, 1, trace_delta(a, b));
+
+    if (expand(a) < 0) {
+        a = NULL;
+    }
+
+    if (expand(b) < 0) {
+        b = NULL;
+    }
+
+    la = string_size(a);
+
+    if (la != string_size(b)) {
+        return false;
+    }
+
+    return la == 0 || memcmp(a->buf, b->buf, la) == 0;
+}
+
+int string_compare(const struct string *a, const struct string *b)
+{
+    size_t la;
+    size_t lb;
+    size_t n;
+    int r;
+
+    TRACE(STRING_TRACE_COMPARE, a, 1, trace_delta(a, b));
+
+    if (expand(a) < 0) {
+        a = NULL;
+    }
+
+    if (expand(b) < 0) {
+        b = NULL;
+    }
+
+    la = string_size(a);
+    lb = string_size(b);
+    n = (la < lb) ? la : lb;
+
+    if (n > 0) {
+        r = memcmp(a->buf, b->buf, n);
+        if (r != 0) {
+            return r;
+        }
+    }
+
+    return (la > lb) - (la < lb);
+}
+
+bool string_starts_with(const struct string *str, size_t n, const char *s)
+{
+    TRACE(STRING_TRACE_STARTS_WITH, str, 1, n);
+
+    if (!s) {
+        return false;
+    }
+
+    if (expand(str) < 0) {
+        str = NULL;
+    }
+
+    if (n > string_size(str)) {
+        return false;
+    }
+
+    return n == 0 || memcmp(str->buf, s, n) == 0;
+}
+
+bool string_ends_with(const struct string *str, size_t n, const char *s)
+{
+    TRACE(STRING_TRACE_ENDS_WITH, str, 1, n);
+
+    if (!s) {
+        return false;
+    }
+
+    if (expand(str) < 0) {
+        str = NULL;
+    }
+
+    if (n > string_size(str)) {
+        return false;
+    }
+
+    return n == 0 || memcmp(&str->buf[str->len - n], s, n) == 0;
+}
+
+size_t string_common_prefix(const struct string *a, const struct string *b)
+{
+    size_t la;
+    size_t lb;
+
+    TRACE(STRING_TRACE_COMMON_PREFIX, a, 1, trace_delta(a, b));
+
+    if (expand(a) < 0) {
+        a = NULL;
+    }
+
+    if (expand(b) < 0) {
+        b = NULL;
+    }
+
+    la = string_size(a);
+    lb = string_size(b);
+
+    if (la == 0 || lb == 0) {
+        return 0;
+    }
+
+    return impl_mismatch(a->buf, b->buf, (la < lb) ? la : lb);
+}
+
+uint64_t string_hash_buffer(size_t n, const char *s)
+{
+    uint64_t h = HASH_SEED;
+    size_t i;
+
+    if (!s) {
+        n = 0;
+    }
+
+    for (i = 0; i + sizeof(uint64_t) <= n; i += sizeof(uint64_t)) {
+        h = hash_block(h, load_le(&s[i], sizeof(uint64_t)));
+    }
+
+    return hash_final(h, (n > 0) ? load_le(&s[i], n - i) : 0, n);
+}
+
+uint64_t string_hash(const struct string *str)
+{
+    struct hash_state *state;
+    uint64_t h;
+    size_t i;
+
+    TRACE(STRING_TRACE_HASH, str, 0, 0);
+
+    if (!str || expand(str) < 0) {
+        return string_hash_buffer(0, NULL);
+    }
+
+    if (!(str->flags & STRING_FLAG_HASH_TRACK)) {
+        return string_hash_buffer(str->len, str->buf);
+    }
+
+    // Fold in the words appended without updating the state, by the inline functions of cstring_inline.h.
+    // Caching does not change the observable value of the object.
+    state = hash_state_get(str);
+    h = hash_state_update(state, str);
+    i = state->hashed;
+    return hash_final(h, (str->len > 0) ? load_le(&str->buf[i], str->len - i) : 0, str->len);
+}
+
+void string_hash_track(struct string *str, bool enable)
+{
+    TRACE(STRING_TRACE_HASH_TRACK, str, 1, enable);
+
+    if (!str) {
+        return;
+    }
+
+    if (str->flags & STRING_FLAG_HASH_TRACK) {
+        hash_state_remove(str);
+        str->flags &= ~STRING_FLAG_HASH_TRACK;
+    }
+
+    // Tracking stays disabled if the state cannot be allocated, which only costs speed.
+    if (enable && hash_state_add(str) == 0) {
+        str->flags |= STRING_FLAG_HASH_TRACK;
+        hash_append(str);
+    }
+}
+
+int string_assign_buffer(struct string *str, size_t n, const char *s)
+{
+    int r;
+
+    TRACE(STRING_TRACE_ASSIGN_BUFFER, str, 1, n);
+
+    if (!str) {
+        return -EFAULT;
+    }
+
+    if (!s) {
+        return -EFAULT;
+    }
+
+    if (n > str->cap) {
+        // Cannot be within own storage, which is not large enough.
+        r = impl_reserve(str, n);
+        if (r < 0) {
+            return r;
+        }
+    }
+
+    memmove(str->buf, s, n);
+    str->len = n;
+    str->buf[n] = 0;
+    invalidate(str, 0);
+    return 0;
+}
+
+char *string_resize_uninit(struct string *str, size_t n)
+{
+    int r;
+
+    TRACE(STRING_TRACE_RESIZE_UNINIT, str, 1, n);
+
+    if (!str) {
+        errno = EFAULT;
+        return NULL;
+    }
+
+    // Characters up to the new size are kept.
+    r = expand(str);
+    if (r < 0) {
+        errno = -r;
+        return NULL;
+    }
+
+    if (n > str->cap) {
+        r = impl_reserve(str, n);
+        if (r < 0) {
+            errno = -r;
+            return NULL;
+        }
+    }
+
+    // All of the storage is writable.
+    str->len = n;
+    str->buf[n] = 0;
+    invalidate(str, 0);
+    return str->buf;
+}
+
+char *string_reserve_tail(struct string *str, size_t n)
+{
+    int r;
+
+    TRACE(STRING_TRACE_RESERVE_TAIL, str, 1, n);
+
+    if (!str) {
+        errno = EFAULT;
+        return NULL;
+    }
+
+    if (n > SIZE_MAX - str->len) {
+        // Check for overflow.
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    if (str->len + n > str->cap) {
+        r = impl_reserve(str, compute_growth(str->cap, str->len + n));
+        if (r < 0) {
+            errno = -r;
+            return NULL;
+        }
+    }
+
+    return &str->buf[str->len];
+}
+
+int string_commit(struct string *str, size_t n)
+{
+    int r;
+
+    TRACE(STRING_TRACE_COMMIT, str, 1, n);
+
+    if (!str) {
+        return -EFAULT;
+    }
+
+    r = expand(str);
+    if (r < 0) {
+        return r;
+    }
+
+    if (n > str->cap - str->len) {
+        return -ERANGE;
+    }
+
+    str->len += n;
+    str->buf[str->len] = 0;
+    invalidate(str, str->len - n);
+    hash_append(str);
+    return 0;
+}
+
+/// Reserve exactly enough storage to append @c total characters.
+/// @return Pointer to the end of the string on success, NULL on failure.
+static char *impl_reserve_append(struct string *str, size_t total)
+{
+    int r;
+
+    // Precondition.
+    assert(str);
+
+    if (total > SIZE_MAX - str->len) {
+        // Check for overflow.
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    // Also true for compressed content, which impl_reserve() decompresses.
+    if (str->len + total > str->cap) {
+        r = impl_reserve(str, str->len + total);
+        if (r < 0) {
+            errno = -r;
+            return NULL;
+        }
+    }
+
+    return &str->buf[str->len];
+}
+
+int string_join(struct string *str, const struct string *sep, struct string *const *parts, size_t n)
+{
+    size_t total;
+    size_t i;
+    char *dest;
+    int r;
+
+    if (!str) {
+        return -EFAULT;
+    }
+
+    if (!sep) {
+        return -EFAULT;
+    }
+
+    if (!parts && n > 0) {
+        return -EFAULT;
+    }
+
+    if (TRACING()) {
+        trace_begin(STRING_TRACE_JOIN, str);
+        trace_put(trace_delta(str, sep));
+        trace_put(n);
+        for (i = 0; i < n; ++i) {
+            trace_put(trace_delta(str, parts[i]));
+        }
+        trace_end();
+    }
+
+    r = expand(sep);
+    if (r < 0) {
+        return r;
+    }
+
+    total = 0;
+    for (i = 0; i < n; ++i) {
+        if (!parts[i]) {
+            return -EFAULT;
+        }
+
+        r = expand(parts[i]);
+        if (r < 0) {
+            return r;
+        }
+
+        if (parts[i]->len > SIZE_MAX - total) {
+            return -ENOMEM;
+        }
+        total += parts[i]->len;
+
+        if (i > 0) {
+            if (sep->len > SIZE_MAX - total) {
+                return -ENOMEM;
+            }
+            total += sep->len;
+        }
+    }
+
+    dest = impl_reserve_append(str, total);
+    if (!dest) {
+        return -errno;
+    }
+
+    // The length is only updated once all parts are copied, so when the string
+    // appears as a part or as the separator its original content is used.
+    for (i = 0; i < n; ++i) {
+        if (i > 0) {
+            memcpy(dest, sep->buf, sep->len);
+            dest += sep->len;
+        }
+
+        memcpy(dest, parts[i]->buf, parts[i]->len);
+        dest += parts[i]->len;
+    }
+
+    str->len += total;
+    str->buf[str->len] = 0;
+    invalidate(str, str->len - total);
+    return 0;
+}
+
+int string_join_buffer(struct string *str, size_t seplen, const char *sep, const char *const *parts, const size_t *lens, size_t n)
+{
+    size_t total;
+    size_t i;
+    char *dest;
+
+    if (!str) {
+        return -EFAULT;
+    }
+
+    if (!sep && n > 1) {
+        return -EFAULT;
+    }
+
+    if ((!parts || !lens) && n > 0) {
+        return -EFAULT;
+    }
+
+    if (TRACING()) {
+        trace_begin(STRING_TRACE_JOIN_BUFFER, str);
+        trace_put(seplen);
+        trace_put(n);
+        for (i = 0; i < n; ++i) {
+            trace_put(lens[i]);
+        }
+        trace_end();
+    }
+
+    total = 0;
+    for (i = 0; i < n; ++i) {
+        if (!parts[i]) {
+            return -EFAULT;
+        }
+
+        if (lens[i] > SIZE_MAX - total) {
+            return -ENOMEM;
+        }
+        total += lens[i];
+
+        if (i > 0) {
+            if (seplen > SIZE_MAX - total) {
+                return -ENOMEM;
+            }
+            total += seplen;
+        }
+    }
+
+    dest = impl_reserve_append(str, total);
+    if (!dest) {
+        return -errno;
+    }
+
+    for (i = 0; i < n; ++i) {
+        if (i > 0) {
+            memcpy(dest, sep, seplen);
+            dest += seplen;
+        }
+
+        memcpy(dest, parts[i], lens[i]);
+        dest += lens[i];
     }
 
-    doubled = current * STRING_GROWTH_FACTOR;
-    return (doubled > required) ? doubled : required;
+    str->len += total;
+    str->buf[str->len] = 0;
+    invalidate(str, str->len - total);
+    return 0;
 }
 
-/// Insert @c n characters at position @c pos.
-/// @return Pointer to the start of the inserted area on success, NULL on failure.
-static char *impl_insert(struct string *str, size_t pos, size_t n)
+/// Decode one UTF-8 sequence from buffer @c s of length @c n (at least one).
+/// Rejects overlong forms, surrogates and code points above U+10FFFF.
+/// @return Length of the sequence, or zero if invalid.
+static size_t utf8_decode(const char *s, size_t n, uint32_t *cp)
 {
-    size_t required;
-    char *dest;
+    const unsigned char *u = (const unsigned char *)s;
+    unsigned char lo = 0x80;
+    unsigned char hi = 0xbf;
+    uint32_t c;
+    size_t len;
+    size_t i;
 
     // Precondition.
-    assert(str);
+    assert(n > 0);
 
-    if (n > SIZE_MAX - str->len) {
-        // Check for overflow.
-        errno = ENOMEM;
-        return NULL;
-    }
+    if (u[0] < 0x80) {
+        *cp = u[0];
+        return 1;
 
-    required = str->len + n;
-    if (required > str->cap) {
-        int r = string_reserve(str, compute_growth(str->cap, required));
-        if (r < 0) {
-            return NULL;
+    } else if (u[0] < 0xc2) {
+        // Continuation byte, or overlong two byte form.
+        return 0;
+
+    } else if (u[0] < 0xe0) {
+        len = 2;
+        c = u[0] & 0x1f;
+
+    } else if (u[0] < 0xf0) {
+        len = 3;
+        c = u[0] & 0x0f;
+        if (u[0] == 0xe0) {
+            // Overlong.
+            lo = 0xa0;
+        } else if (u[0] == 0xed) {
+            // Surrogate.
+            hi = 0x9f;
+        }
+
+    } else if (u[0] < 0xf5) {
+        len = 4;
+        c = u[0] & 0x07;
+        if (u[0] == 0xf0) {
+            // Overlong.
+            lo = 0x90;
+        } else if (u[0] == 0xf4) {
+            // Above U+10FFFF.
+            hi = 0x8f;
         }
+
+    } else {
+        return 0;
     }
 
-    dest = &str->buf[pos];
+    if (n < len) {
+        return 0;
+    }
 
-    if (pos < str->len) {
-        size_t rhs = str->len - pos;
+    if (u[1] < lo || u[1] > hi) {
+        return 0;
+    }
 
-        memmove(&str->buf[pos + n],
-                &str->buf[pos],
-                rhs + 1);
-    } else {
-        str->buf[pos + n] = 0;
+    c = (c << 6) | (u[1] & 0x3f);
+    for (i = 2; i < len; ++i) {
+        if ((u[i] & 0xc0) != 0x80) {
+            return 0;
+        }
+        c = (c << 6) | (u[i] & 0x3f);
     }
 
-    str->len += n;
-    return dest;
+    *cp = c;
+    return len;
 }
 
-/// Insert buffer @c s of length @c n at position @c pos.
-/// @return Zero on success, negative errno otherwise.
-static int impl_insert_buffer(struct string *str, size_t pos, size_t n, const char *s)
+/// Encode valid code point @c cp as UTF-8 into @c dest (if not NULL).
+/// @return Length of the sequence.
+static size_t utf8_encode(char *dest, uint32_t cp)
 {
-    char *dest;
+    unsigned char u[4];
+    size_t len;
 
-    // Preconditions.
-    assert(str);
-    assert(s);
+    if (cp < 0x80) {
+        u[0] = (unsigned char)cp;
+        len = 1;
+    } else if (cp < 0x800) {
+        u[0] = (unsigned char)(0xc0 | (cp >> 6));
+        u[1] = (unsigned char)(0x80 | (cp & 0x3f));
+        len = 2;
+    } else if (cp < 0x10000) {
+        u[0] = (unsigned char)(0xe0 | (cp >> 12));
+        u[1] = (unsigned char)(0x80 | ((cp >> 6) & 0x3f));
+        u[2] = (unsigned char)(0x80 | (cp & 0x3f));
+        len = 3;
+    } else {
+        u[0] = (unsigned char)(0xf0 | (cp >> 18));
+        u[1] = (unsigned char)(0x80 | ((cp >> 12) & 0x3f));
+        u[2] = (unsigned char)(0x80 | ((cp >> 6) & 0x3f));
+        u[3] = (unsigned char)(0x80 | (cp & 0x3f));
+        len = 4;
+    }
 
-    dest = impl_insert(str, pos, n);
-    if (!dest) {
-        return -errno;
+    if (dest) {
+        memcpy(dest, u, len);
     }
 
-    memmove(dest, s, n);
-    return 0;
+    return len;
 }
 
-/// Insert @c n copies of character @c c at position @c pos.
-/// @return Zero on success, negative errno otherwise.
-static int impl_insert_fill(struct string *str, size_t pos, size_t n, char c)
+/// @return True if @c cp is a Unicode scalar value (a code point that is not a surrogate).
+static bool utf32_valid(uint32_t cp)
 {
-    char *dest;
+    return cp < 0xd800 || (cp > 0xdfff && cp < 0x110000);
+}
+
+/// Walk the UTF-8 content, skipping ASCII a word at a time.
+/// @param utf16 Count UTF-16 code units rather than code points.
+/// @param dest16 If not NULL, receives UTF-16 code units.
+/// @param dest32 If not NULL, receives code points.
+/// @return Number of code points (or code units), or STRING_NPOS if the content is not valid UTF-8.
+static size_t impl_utf8_scan(const struct string *str, bool utf16, uint16_t *dest16, uint32_t *dest32)
+{
+    size_t count = 0;
+    size_t i = 0;
+    size_t j;
+    uint32_t cp;
+    size_t len;
 
     // Precondition.
     assert(str);
 
-    dest = impl_insert(str, pos, n);
-    if (!dest) {
-        return -errno;
+    while (i < str->len) {
+        if (i + sizeof(uint64_t) <= str->len && !(load_word(&str->buf[i]) & WORD_HIGHS)) {
+            // ASCII fast path.
+            for (j = 0; j < sizeof(uint64_t); ++j) {
+                if (dest16) {
+                    dest16[count + j] = (unsigned char)str->buf[i + j];
+                } else if (dest32) {
+                    dest32[count + j] = (unsigned char)str->buf[i + j];
+                }
+            }
+            i += sizeof(uint64_t);
+            count += sizeof(uint64_t);
+            continue;
+        }
+
+        len = utf8_decode(&str->buf[i], str->len - i, &cp);
+        if (len == 0) {
+            return STRING_NPOS;
+        }
+        i += len;
+
+        if (utf16 && cp >= 0x10000) {
+            if (dest16) {
+                dest16[count] = (uint16_t)(0xd800 + ((cp - 0x10000) >> 10));
+                dest16[count + 1] = (uint16_t)(0xdc00 + ((cp - 0x10000) & 0x3ff));
+            }
+            count += 2;
+        } else {
+            if (dest16) {
+                dest16[count] = (uint16_t)cp;
+            } else if (dest32) {
+                dest32[count] = cp;
+            }
+            count += 1;
+        }
     }
 
-    memset(dest, c, n);
-    return 0;
+    return count;
 }
 
-int string_insert_buffer(struct string *str, size_t pos, size_t n, const char *s)
+bool string_utf8_validate(const struct string *str)
 {
+    TRACE(STRING_TRACE_UTF8_VALIDATE, str, 0, 0);
+
     if (!str) {
-        return -EFAULT;
+        return false;
     }
 
-    if (!s) {
-        return -EFAULT;
+    if (str->flags & STRING_FLAG_UTF8_VALID) {
+        return true;
     }
 
-    if (pos > str->len) {
-        return -ERANGE;
+    if (expand(str) < 0) {
+        return false;
     }
 
-    return impl_insert_buffer(str, pos, n, s);
+    if (impl_utf8_scan(str, false, NULL, NULL) == STRING_NPOS) {
+        return false;
+    }
+
+    // Caching does not change the observable value of the object.
+    ((struct string *)str)->flags |= STRING_FLAG_UTF8_VALID;
+    return true;
 }
 
-int string_insert_c_str(struct string *str, size_t pos, const char *s)
+size_t string_utf8_length(const struct string *str)
 {
-    if (!str) {
-        return -EFAULT;
-    }
+    size_t count = 0;
+    size_t i = 0;
 
-    if (!s) {
-        return -EFAULT;
-    }
+    TRACE(STRING_TRACE_UTF8_LENGTH, str, 0, 0);
 
-    if (pos > str->len) {
-        return -ERANGE;
+    if (!str || expand(str) < 0) {
+        return 0;
     }
 
-    return impl_insert_buffer(str, pos, strlen(s), s);
-}
-
-int string_insert_fill(struct string *str, size_t pos, size_t n, char c)
-{
-    if (!str) {
-        return -EFAULT;
+    for (; i + sizeof(uint64_t) <= str->len; i += sizeof(uint64_t)) {
+        uint64_t w = load_word(&str->buf[i]);
+        // High bit set in each continuation byte (10xxxxxx).
+        uint64_t cont = w & ~(w << 1) & WORD_HIGHS;
+        // Horizontal sum of the bytes, each zero or one.
+        count += sizeof(uint64_t) - (size_t)((((cont >> 7) * WORD_ONES) >> 56));
     }
 
-    if (pos > str->len) {
-        return -ERANGE;
+    for (; i < str->len; ++i) {
+        count += ((unsigned char)str->buf[i] & 0xc0) != 0x80;
     }
 
-    return impl_insert_fill(str, pos, n, c);
+    return count;
 }
 
-int string_erase(struct string *str, size_t pos, size_t len)
+/// Transcode to UTF-16 or UTF-32.
+/// @return Zero on success, negative errno otherwise.
+static int impl_utf8_transcode(const struct string *str, bool utf16, void *buf, size_t *n)
 {
-    size_t rhs;
-    size_t n;
+    size_t required;
+    int r;
 
     if (!str) {
         return -EFAULT;
     }
 
-    if (pos > str->len) {
-        return -ERANGE;
+    if (!n) {
+        return -EFAULT;
     }
 
-    // For consistency with string_insert_*().
-    if (pos == str->len) {
-        return 0;
+    r = expand(str);
+    if (r < 0) {
+        return r;
     }
 
-    if (len == 0) {
-        return 0;
+    required = impl_utf8_scan(str, utf16, NULL, NULL);
+    if (required == STRING_NPOS) {
+        return -EILSEQ;
     }
 
-    //    rhs
-    //   /--------------\
-    //    len   n
-    //   /----\/--------\
-    // --+--+--+--+--+--+
-    //   |  |  |  |  |  |
-    // --+--+--+--+--+--+
-    //    ^              ^
-    //    pos            str->len
-    rhs = str->len - pos;
-    n = 0;
+    if (buf) {
+        if (*n < required) {
+            *n = required;
+            return -ERANGE;
+        }
 
-    if (len > rhs) {
-        // Erase as many as possible.
-        len = rhs;
+        impl_utf8_scan(str, utf16, utf16 ? buf : NULL, utf16 ? NULL : buf);
     }
 
-    n = rhs - len;
+    *n = required;
+    return 0;
+}
 
-    memmove(&str->buf[pos],
-            &str->buf[pos + len],
-            n + 1);
+int string_utf8_to_utf16(const struct string *str, uint16_t *buf, size_t *n)
+{
+    TRACE(STRING_TRACE_UTF8_TO_UTF16, str, 1, (buf && n) ? *n : 0);
 
-    str->len -= len;
-    return 0;
+    return impl_utf8_transcode(str, true, buf, n);
 }
 
-int string_push_back(struct string *str, char c)
+int string_utf8_to_utf32(const struct string *str, uint32_t *buf, size_t *n)
 {
-    if (!str) {
-        return -EFAULT;
-    }
+    TRACE(STRING_TRACE_UTF8_TO_UTF32, str, 1, (buf && n) ? *n : 0);
 
-    return impl_insert_fill(str, str->len, 1, c);
+    return impl_utf8_transcode(str, false, buf, n);
 }
 
-int string_pop_back(struct string *str)
+/// Append code points from UTF-16 or UTF-32 buffer @c s of length @c n.
+/// Measures and validates first, so that storage is reserved at most once and nothing is appended on error.
+/// @return Zero on success, negative errno otherwise.
+static int impl_append_utf(struct string *str, size_t n, const uint16_t *s16, const uint32_t *s32)
 {
-    if (!str) {
-        return -EFAULT;
+    size_t total = 0;
+    size_t i;
+    uint32_t cp;
+    unsigned flags;
+    char *dest;
+
+    // Precondition.
+    assert(str);
+
+    for (i = 0; i < n; ++i) {
+        if (s16) {
+            cp = s16[i];
+            if (cp >= 0xd800 && cp <= 0xdbff && i + 1 < n && s16[i + 1] >= 0xdc00 && s16[i + 1] <= 0xdfff) {
+                // Surrogate pair.
+                cp = 0x10000 + ((cp - 0xd800) << 10) + (s16[++i] - 0xdc00u);
+            }
+        } else {
+            cp = s32[i];
+        }
+
+        if (!utf32_valid(cp)) {
+            return -EILSEQ;
+        }
+
+        // Cannot overflow: at most 1.5 bytes are produced per byte of the input array,
+        // which cannot span more than half of the address space.
+        total += utf8_encode(NULL, cp);
     }
 
-    if (str->len < 1) {
-        return -ERANGE;
+    dest = impl_reserve_append(str, total);
+    if (!dest) {
+        return -errno;
     }
 
-    str->buf[--str->len] = 0;
+    for (i = 0; i < n; ++i) {
+        if (s16) {
+            cp = s16[i];
+            if (cp < 0x80) {
+                // ASCII fast path.
+                *dest++ = (char)cp;
+                continue;
+            }
+            if (cp >= 0xd800 && cp <= 0xdbff) {
+                cp = 0x10000 + ((cp - 0xd800) << 10) + (s16[++i] - 0xdc00u);
+            }
+        } else {
+            cp = s32[i];
+        }
+
+        dest += utf8_encode(dest, cp);
+    }
+
+    // Appending valid UTF-8 preserves validity.
+    flags = str->flags;
+    str->len += total;
+    str->buf[str->len] = 0;
+    invalidate(str, str->len - total);
+    str->flags |= flags & STRING_FLAG_UTF8_VALID;
     return 0;
 }
 
-int string_append_buffer(struct string *str, size_t n, const char *s)
+int string_append_utf16(struct string *str, size_t n, const uint16_t *s)
 {
+    TRACE(STRING_TRACE_APPEND_UTF16, str, 1, n);
+
     if (!str) {
         return -EFAULT;
     }
@@ -416,11 +2463,13 @@ int string_append_buffer(struct string *str, size_t n, const char *s)
         return -EFAULT;
     }
 
-    return impl_insert_buffer(str, str->len, n, s);
+    return impl_append_utf(str, n, s, NULL);
 }
 
-int string_append_c_str(struct string *str, const char *s)
+int string_append_utf32(struct string *str, size_t n, const uint32_t *s)
 {
+    TRACE(STRING_TRACE_APPEND_UTF32, str, 1, n);
+
     if (!str) {
         return -EFAULT;
     }
@@ -429,16 +2478,7 @@ int string_append_c_str(struct string *str, const char *s)
         return -EFAULT;
     }
 
-    return impl_insert_buffer(str, str->len, strlen(s), s);
-}
-
-int string_append_fill(struct string *str, size_t n, char c)
-{
-    if (!str) {
-        return -EFAULT;
-    }
-
-    return impl_insert_fill(str, str->len, n, c);
+    return impl_append_utf(str, n, NULL, s);
 }
 
 struct string *string_substr(const struct string *str, size_t pos, size_t len)
@@ -456,6 +2496,12 @@ struct string *string_substr(const struct string *str, size_t pos, size_t len)
         return NULL;
     }
 
+    r = expand(str);
+    if (r < 0) {
+        errno = -r;
+        return NULL;
+    }
+
     if (len > SIZE_MAX - pos) {
         // Cap in case of numerical overflow.
         len = str->len - pos;
@@ -465,17 +2511,127 @@ struct string *string_substr(const struct string *str, size_t pos, size_t len)
         len = str->len - pos;
     }
 
-    sub = string_new();
+    sub = impl_new();
     if (!sub) {
         return NULL;
     }
 
-    r = string_append_buffer(sub, len, &str->buf[pos]);
+    r = impl_insert_buffer(sub, 0, len, &str->buf[pos]);
     if (r < 0) {
-        string_delete(sub);
+        impl_delete(sub);
         errno = -r;
         return NULL;
     }
 
+    TRACE(STRING_TRACE_SUBSTR, str, 3, trace_delta(str, sub), pos, len);
     return sub;
 }
+
+int string_compress(struct string *str, size_t min_size)
+{
+    size_t clen;
+    char *buf;
+    char *shrunk;
+    int r;
+
+    TRACE(STRING_TRACE_COMPRESS, str, 1, min_size);
+
+    if (!str) {
+        return -EFAULT;
+    }
+
+    if (str->len < min_size || str->len <= SSO_CAPACITY || internal_storage_used(str) || (str->flags & STRING_FLAG_COMPRESSED)) {
+        return 0;
+    }
+
+    // Compression must save at least one character.
+    r = memory_charge(str->len);
+    if (r < 0) {
+        return r;
+    }
+
+    memory_count_allocation();
+    buf = malloc(str->len);
+    if (!buf) {
+        memory_release(str->len);
+        return -ENOMEM;
+    }
+
+    clen = lz_compress(str->buf, str->len, buf, str->len - 1);
+    if (clen == 0) {
+        free(buf);
+        memory_release(str->len);
+        return 0;
+    }
+
+    // Give back the unused part, if any. Should that fail, the string is left unchanged, since the
+    // buffer would then hold more than the compressed size recorded for it.
+    if (clen + 1 < str->len) {
+        memory_count_allocation();
+        shrunk = realloc(buf, clen + 1);
+        if (!shrunk) {
+            free(buf);
+            memory_release(str->len);
+            return -ENOMEM;
+        }
+        buf = shrunk;
+    }
+
+    buf[clen] = 0;
+    free(str->buf);
+    memory_release(str->cap + 1 + str->len - (clen + 1));
+    str->buf = buf;
+    str->cap = clen;
+    str->flags |= STRING_FLAG_COMPRESSED;
+    return 0;
+}
+
+bool string_compressed(const struct string *str)
+{
+    if (!str) {
+        return false;
+    }
+
+    return (str->flags & STRING_FLAG_COMPRESSED) != 0;
+}
+
+struct string_memory string_memory_usage(const struct string *str)
+{
+    struct string_memory usage = { 0, 0 };
+
+    if (!str) {
+        return usage;
+    }
+
+    usage.object = sizeof(struct string);
+    if (str->flags & STRING_FLAG_HASH_TRACK) {
+        usage.object += sizeof(struct hash_state);
+    }
+    usage.heap = internal_storage_used(str) ? 0 : str->cap + 1;
+    return usage;
+}
+
+size_t string_memory_total(void)
+{
+    return __atomic_load_n(&memory_used, __ATOMIC_RELAXED);
+}
+
+size_t string_memory_peak(void)
+{
+    return __atomic_load_n(&memory_peak, __ATOMIC_RELAXED);
+}
+
+void string_memory_peak_reset(void)
+{
+    __atomic_store_n(&memory_peak, __atomic_load_n(&memory_used, __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+}
+
+void string_memory_set_budget(size_t bytes)
+{
+    __atomic_store_n(&memory_budget, bytes, __ATOMIC_RELAXED);
+}
+
+size_t string_memory_allocations(void)
+{
+    return __atomic_load_n(&memory_allocations, __ATOMIC_RELAXED);
+}
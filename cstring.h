@@ -17,6 +17,7 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 #ifdef __has_attribute
 # define PUBLIC __attribute__ ((visibility("default")))
@@ -24,15 +25,31 @@
 # define PUBLIC /*NOTHING*/
 #endif
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Position returned by search functions when there is no match.
+#define STRING_NPOS ((size_t)-1)
+
 /// String object.
 ///
 /// Strings are objects that represent sequences of characters.
 ///
 /// This library is **not** thread-safe.
 /// Caller must synchronize access to string objects.
-/// Multiple readers are safe if no writers are active.
+/// Multiple readers are safe if no writers are active, and the string is not compressed (see string_compress()).
 struct string;
 
+/// String view.
+/// Non-owning reference to a sequence of characters.
+struct string_view {
+    /// Characters (not necessarily NUL terminated).
+    const char *buf;
+    /// Number of characters.
+    size_t len;
+};
+
 /// Constructor.
 /// Create a new empty string.
 /// @return Pointer to string on success.
@@ -45,6 +62,28 @@ struct string *string_new(void) PUBLIC;
 /// @note Memory ownership: Object takes ownership of the pointer.
 void string_delete(struct string *) PUBLIC;
 
+/// Constructor.
+/// Create a new string that takes ownership of an allocated buffer, without copying.
+/// @param buf Buffer allocated by malloc() or realloc(), of at least @c cap + 1 bytes.
+/// @param len Number of characters in @c buf; a NUL terminator is written at @c buf[len].
+/// @param cap Capacity of @c buf (excluding space for the NUL terminator).
+/// @return Pointer to string on success.
+/// @return NULL on failure, and errno is set to:
+///   - EFAULT: NULL pointer argument.
+///   - ENOMEM: Insufficient memory.
+///   - ERANGE: @c len exceeds @c cap.
+/// @note Memory ownership: Object takes ownership of @c buf on success only. Caller must string_delete() the returned pointer.
+struct string *string_new_adopt(char *buf, size_t len, size_t cap) PUBLIC;
+
+/// Move content of @c src into @c dst, without copying allocated storage.
+/// The previous content of @c dst is released, and @c src is left valid but empty.
+/// @return Zero on success, negative errno otherwise.
+///   - EFAULT: NULL pointer argument.
+int string_move(struct string *dst, struct string *src) PUBLIC;
+
+/// Exchange content of two strings, without copying allocated storage.
+void string_swap(struct string *, struct string *) PUBLIC;
+
 /// Test if string is empty.
 /// @return True if string is empty or NULL, false otherwise.
 bool string_empty(const struct string *) PUBLIC;
@@ -66,8 +105,8 @@ int string_reserve(struct string *, size_t cap) PUBLIC;
 
 /// Get capacity.
 /// The capacity represents the size of the allocated internal storage.
-/// @return size_t Number of characters that there is currently room for.
-/// @see string_reserve.
+/// @return size_t Number of characters that there is currently room for, or the compressed size if compressed.
+/// @see string_reserve, string_compress.
 size_t string_capacity(const struct string *) PUBLIC;
 
 /// Get character at position.
@@ -80,10 +119,16 @@ char string_at(const struct string *, size_t pos) PUBLIC;
 /// @return Pointer to string on success.
 /// @return NULL on failure, and errno is set to:
 ///   - EFAULT: NULL pointer argument.
+///   - ENOMEM: Insufficient memory to decompress (see string_compress()).
 /// @note Memory ownership: Owned by the object; valid until object modified or deleted.
 /// @warning Recommend that this internal pointer is not stored by the caller; call this API every time the information is needed.
 const char *string_c_str(const struct string *) PUBLIC;
 
+/// Get view of string content.
+/// @return View of the characters in the string, or an empty view with NULL @c buf if NULL.
+/// @note Memory ownership: Owned by the object; valid until object modified or deleted.
+struct string_view string_as_view(const struct string *) PUBLIC;
+
 /// Move C string.
 /// Detaches C string from this object, leaving a valid but empty string object.
 /// @return Pointer to string on success.
@@ -117,6 +162,31 @@ int string_insert_fill(struct string *, size_t pos, size_t n, char c) PUBLIC;
 ///   - ERANGE: Position invalid.
 int string_erase(struct string *, size_t pos, size_t len) PUBLIC;
 
+/// Edit applied by string_apply_edits(): replace @c len characters at @c pos by the @c n characters in buffer @c s.
+/// An insertion has zero @c len, and an erasure has zero @c n.
+struct string_edit {
+    /// Position in the original string.
+    size_t pos;
+    /// Number of characters to remove.
+    size_t len;
+    /// Number of characters to insert.
+    size_t n;
+    /// Characters to insert; may be NULL if @c n is zero, and may point into the string.
+    const char *s;
+};
+
+/// Apply @c n edits, whose positions are in the original string, in one pass.
+/// Edits must be sorted by position and must not overlap; insertions at the same position are applied in order.
+/// The string is not modified if any edit is invalid.
+/// @note The result is built with at most one allocation, instead of moving the tail of the string for each edit.
+/// @return Zero on success, negative errno otherwise.
+///   - EFAULT: NULL pointer argument.
+///   - EINVAL: Edits not sorted, or overlapping.
+///   - ENOMEM: Insufficient memory.
+///   - ERANGE: Position or length invalid.
+/// @note Memory ownership: Caller retains ownership of @c edits and the buffers they point to.
+int string_apply_edits(struct string *, const struct string_edit *edits, size_t n) PUBLIC;
+
 /// Append character.
 /// @return Zero on success, negative errno otherwise.
 ///   - EFAULT: NULL pointer argument.
@@ -145,6 +215,155 @@ int string_append_c_str(struct string *, const char *s) PUBLIC;
 /// @see string_append_buffer.
 int string_append_fill(struct string *, size_t n, char c) PUBLIC;
 
+/// Replace content with @c n characters from buffer @c s, reusing existing capacity.
+/// @c s may point into the string's own storage.
+/// @return Zero on success, negative errno otherwise.
+///   - EFAULT: NULL pointer argument.
+///   - ENOMEM: Insufficient memory.
+/// @note Memory ownership: Caller retains ownership of @c s.
+int string_assign_buffer(struct string *, size_t n, const char *s) PUBLIC;
+
+/// Resize string to @c n characters without initializing them.
+/// Characters beyond the old size are indeterminate until written by the caller; the string is NUL terminated at @c n.
+/// @return Pointer to the writable storage on success.
+/// @return NULL on failure, and errno is set to:
+///   - EFAULT: NULL pointer argument.
+///   - ENOMEM: Insufficient memory.
+/// @note Memory ownership: Owned by the object; valid until object modified or deleted.
+char *string_resize_uninit(struct string *, size_t n) PUBLIC;
+
+/// Reserve room for at least @c n characters after the end of the string, for direct writes.
+/// The size is unchanged; call string_commit() to append the characters written.
+/// Until then, written characters replace the NUL terminator as seen through string_c_str().
+/// Storage grows geometrically, as for the append functions.
+/// @return Pointer to the spare capacity (at string_size()) on success.
+/// @return NULL on failure, and errno is set to:
+///   - EFAULT: NULL pointer argument.
+///   - ENOMEM: Insufficient memory.
+/// @note Memory ownership: Owned by the object; valid until object modified or deleted.
+char *string_reserve_tail(struct string *, size_t n) PUBLIC;
+
+/// Append @c n characters previously written into the spare capacity.
+/// @see string_reserve_tail.
+/// @return Zero on success, negative errno otherwise.
+///   - EFAULT: NULL pointer argument.
+///   - ERANGE: @c n exceeds the spare capacity.
+int string_commit(struct string *, size_t n) PUBLIC;
+
+/// Append the @c n strings in @c parts, separated by @c sep, at end of string.
+/// The final size is computed up front so that storage is reserved at most once.
+/// @note The string itself may appear as @c sep or in @c parts; its original content is used.
+/// @return Zero on success, negative errno otherwise.
+///   - EFAULT: NULL pointer argument.
+///   - ENOMEM: Insufficient memory.
+int string_join(struct string *, const struct string *sep, struct string *const *parts, size_t n) PUBLIC;
+
+/// Append the @c n buffers in @c parts (with lengths @c lens), separated by buffer @c sep of length @c seplen, at end of string.
+/// @see string_join.
+/// @note Memory ownership: Caller retains ownership of @c sep and @c parts, which must not point into the string's own storage.
+int string_join_buffer(struct string *, size_t seplen, const char *sep, const char *const *parts, const size_t *lens, size_t n) PUBLIC;
+
+/// Test if strings are equal.
+/// Sizes are compared first, and embedded NUL characters are compared like any other character.
+/// @note A NULL string compares as an empty string.
+/// @return True if both strings have the same size and content, false otherwise.
+bool string_equal(const struct string *, const struct string *) PUBLIC;
+
+/// Compare strings lexicographically, as unsigned characters.
+/// A string that is a prefix of another orders first.
+/// @note A NULL string compares as an empty string.
+/// @return Negative, zero or positive if the first string is less than, equal to, or greater than the second.
+int string_compare(const struct string *, const struct string *) PUBLIC;
+
+/// Test if string begins with the @c n characters in buffer @c s.
+/// @note A NULL string is treated as an empty string.
+/// @return True if string begins with the buffer, false otherwise or if @c s is NULL.
+bool string_starts_with(const struct string *, size_t n, const char *s) PUBLIC;
+
+/// Test if string ends with the @c n characters in buffer @c s.
+/// @see string_starts_with.
+bool string_ends_with(const struct string *, size_t n, const char *s) PUBLIC;
+
+/// Get length of common prefix.
+/// @return The number of leading characters that are the same in both strings, or zero if either is NULL.
+size_t string_common_prefix(const struct string *, const struct string *) PUBLIC;
+
+/// Compute 64-bit hash of string content.
+/// Equal strings have equal hashes; the value is the same on all platforms, but may change between library versions.
+/// @note A NULL string hashes as an empty string.
+/// @return Hash value.
+uint64_t string_hash(const struct string *) PUBLIC;
+
+/// Enable or disable incremental hashing.
+/// When enabled, the string keeps the hash state of its content in a separately allocated record, which appends
+/// and push_back update as they go, so that string_hash() only folds in the last characters, and those appended by
+/// the inline functions of cstring_inline.h. Other modifications restart the state from the beginning.
+/// The state moves with the content by string_move() and string_swap(), and is freed by string_delete().
+/// @note If the record cannot be allocated, the string is not tracked; string_hash() returns the same values.
+void string_hash_track(struct string *, bool enable) PUBLIC;
+
+/// Compute 64-bit hash of the @c n characters in buffer @c s.
+/// @see string_hash.
+/// @return Hash value, equal to string_hash() of a string with the same content (NULL @c s hashes as empty).
+uint64_t string_hash_buffer(size_t n, const char *s) PUBLIC;
+
+/// Convert ASCII letters to lower case, in place.
+/// Locale independent; bytes outside the ASCII range (such as UTF-8 sequences) are unchanged.
+/// @return Zero on success, negative errno otherwise.
+///   - EFAULT: NULL pointer argument.
+int string_to_lower(struct string *) PUBLIC;
+
+/// Convert ASCII letters to upper case, in place.
+/// @see string_to_lower.
+int string_to_upper(struct string *) PUBLIC;
+
+/// Compare strings, ignoring the case of ASCII letters.
+/// Embedded NUL characters are compared like any other character.
+/// @note A NULL string compares as an empty string.
+/// @return Negative, zero or positive if the first string is less than, equal to, or greater than the second.
+int string_casecmp(const struct string *, const struct string *) PUBLIC;
+
+/// Find the first occurrence of the @c n characters in buffer @c s at or after @c pos, ignoring the case of ASCII letters.
+/// @return Position of the match, or STRING_NPOS if not found or arguments invalid.
+size_t string_case_find(const struct string *, size_t pos, size_t n, const char *s) PUBLIC;
+
+/// Test if string is valid UTF-8.
+/// Overlong forms, surrogates and code points above U+10FFFF are rejected.
+/// @note The result is cached in the object until the string is next modified.
+/// @return True if string is valid UTF-8, false otherwise or if NULL.
+bool string_utf8_validate(const struct string *) PUBLIC;
+
+/// Get number of UTF-8 code points in string.
+/// @return The number of characters that are not UTF-8 continuation bytes, or zero if NULL.
+/// @note Only meaningful if string_utf8_validate() is true.
+size_t string_utf8_length(const struct string *) PUBLIC;
+
+/// Transcode UTF-8 content to UTF-16.
+/// @param buf Destination, or NULL to query the required size.
+/// @param n On entry, the capacity of @c buf in code units; on exit, the number of code units required.
+/// @return Zero on success, negative errno otherwise.
+///   - EFAULT: NULL pointer argument.
+///   - EILSEQ: String is not valid UTF-8.
+///   - ERANGE: Buffer too small (nothing is written).
+int string_utf8_to_utf16(const struct string *, uint16_t *buf, size_t *n) PUBLIC;
+
+/// Transcode UTF-8 content to UTF-32.
+/// @see string_utf8_to_utf16.
+int string_utf8_to_utf32(const struct string *, uint32_t *buf, size_t *n) PUBLIC;
+
+/// Append @c n UTF-16 code units from buffer @c s, encoded as UTF-8.
+/// @return Zero on success, negative errno otherwise.
+///   - EFAULT: NULL pointer argument.
+///   - EILSEQ: Unpaired surrogate (nothing is appended).
+///   - ENOMEM: Insufficient memory.
+/// @note Memory ownership: Caller retains ownership of @c s.
+int string_append_utf16(struct string *, size_t n, const uint16_t *s) PUBLIC;
+
+/// Append @c n UTF-32 code points from buffer @c s, encoded as UTF-8.
+/// @see string_append_utf16.
+/// @return -EILSEQ if a code point is a surrogate or above U+10FFFF.
+int string_append_utf32(struct string *, size_t n, const uint32_t *s) PUBLIC;
+
 /// Generate substring.
 /// Get substring [pos, pos + len) or [pos, size()) if @c len is too big.
 /// @param pos Start position in the range 0..size().
@@ -157,4 +376,76 @@ int string_append_fill(struct string *, size_t n, char c) PUBLIC;
 /// @note Memory ownership: Caller must string_delete() the returned pointer.
 struct string *string_substr(const struct string *, size_t pos, size_t len) PUBLIC;
 
+/// Compress a large string that is rarely accessed, to reduce its memory use.
+/// The storage is replaced by a compressed representation (LZ77, in the manner of LZ4), while the size
+/// is kept. The next function of this library to access the content, such as string_c_str(), string_at()
+/// or any modification, decompresses it first and releases the compressed representation.
+/// Strings shorter than @c min_size, in internal storage, or that do not compress are left unchanged.
+/// @return Zero on success, negative errno otherwise.
+///   - EFAULT: NULL pointer argument.
+///   - ENOMEM: Insufficient memory.
+/// @note Decompression allocates memory; if it fails, functions that cannot report errors behave as for
+///       a NULL argument. Reading a compressed string modifies it, so that readers must also be synchronized.
+int string_compress(struct string *, size_t min_size) PUBLIC;
+
+/// Check whether the content is compressed.
+/// @return True if compressed by string_compress() and not accessed since, false otherwise or if NULL.
+bool string_compressed(const struct string *) PUBLIC;
+
+/// Memory used by a string object.
+struct string_memory {
+    /// Bytes of the object itself, which holds the characters of short strings, and of its hash state if tracked.
+    size_t object;
+    /// Bytes of the allocated buffer, or zero if the characters are held in the object.
+    size_t heap;
+};
+
+/// Get memory used by a string object.
+/// @return Memory used, or zero sizes if NULL.
+struct string_memory string_memory_usage(const struct string *) PUBLIC;
+
+/// Get number of bytes held in the allocated buffers of all strings in the process.
+/// Buffers adopted by string_new_adopt() are included, and buffers detached by string_c_str_move() are not.
+/// Unlike other functions of this library, the accounting functions may be called from any thread.
+size_t string_memory_total(void) PUBLIC;
+
+/// Get highest value of string_memory_total() since the start of the process, or the last call to string_memory_peak_reset().
+size_t string_memory_peak(void) PUBLIC;
+
+/// Restart tracking of string_memory_peak() from the current total.
+void string_memory_peak_reset(void) PUBLIC;
+
+/// Set a process-wide limit on string_memory_total().
+/// Functions that would allocate or adopt a buffer beyond the limit fail with ENOMEM instead,
+/// before allocating. Strings already allocated are not affected by lowering the limit.
+/// @param bytes Limit, or SIZE_MAX (the default) for none.
+void string_memory_set_budget(size_t bytes) PUBLIC;
+
+/// Get number of allocations (including reallocations) of string objects and buffers requested since the start of the process.
+size_t string_memory_allocations(void) PUBLIC;
+
+/// Start recording calls to this library in a trace written to @c fd.
+/// Each call of a function that takes a string object is recorded as its operation, object identity and size
+/// arguments, but never the characters, in the compact binary format described in string_trace.h, whose
+/// string_trace_replay() re-executes the calls. Field accessors (string_size(), string_empty(), string_capacity(),
+/// string_compressed() and string_memory_usage()) are not recorded; while recording, the inline functions of
+/// cstring_inline.h call the recorded functions, except the @c _unchecked variants, which are never recorded.
+/// Records are buffered, and written in order from any thread; recording a call only adds a relaxed load when stopped.
+/// @return Zero on success, negative errno otherwise.
+///   - EBADF: @c fd is negative.
+///   - EBUSY: Already recording.
+/// @note @c fd is not closed by string_trace_stop().
+int string_trace_start(int fd) PUBLIC;
+
+/// Stop recording, writing out buffered records.
+/// Recording stops by itself if writing fails, and the error is then reported here.
+/// @return Zero on success, negative errno otherwise.
+///   - EINVAL: Not recording.
+///   - Any error of write().
+int string_trace_stop(void) PUBLIC;
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif // LIBCSTRING_CSTRING_H_
@@ -0,0 +1,334 @@
+#ifndef LIBCSTRING_CSTRING_HPP_
+#define LIBCSTRING_CSTRING_HPP_
+
+/// C++ wrapper.
+///
+/// Header-only RAII class that owns a struct string and forwards to the C API,
+/// adding no state and no allocations of its own.
+///
+/// Errors returned by the C API are thrown:
+///   - ENOMEM: std::bad_alloc.
+///   - ERANGE: std::out_of_range.
+///   - Other errors: std::system_error, with the errno value as code.
+///
+/// Like struct string, objects are **not** thread-safe.
+
+#include "cstring.h"
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <new>
+#include <stdexcept>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+namespace cstring {
+
+namespace detail {
+
+/// Throw the exception for negative errno @c r, if any.
+inline void check(int r)
+{
+    if (r == -ENOMEM) {
+        throw std::bad_alloc();
+    }
+    if (r == -ERANGE) {
+        throw std::out_of_range("cstring: position invalid");
+    }
+    if (r < 0) {
+        throw std::system_error(-r, std::generic_category());
+    }
+}
+
+/// @return Characters of @c v, never NULL, as the C API rejects NULL buffers even when empty.
+inline const char *data_of(std::string_view v) noexcept
+{
+    return v.data() ? v.data() : "";
+}
+
+} // namespace detail
+
+/// String object.
+/// A moved-from object holds no struct string: it is empty, and may be assigned to or destroyed.
+class string {
+public:
+    /// Position returned by search functions when there is no match.
+    static constexpr std::size_t npos = STRING_NPOS;
+
+    /// Create an empty string.
+    string() : str_(::string_new())
+    {
+        if (!str_) {
+            throw std::bad_alloc();
+        }
+    }
+
+    /// Create a string holding a copy of @c v.
+    explicit string(std::string_view v) : string()
+    {
+        append(v);
+    }
+
+    /// Take ownership of @c str, which may be NULL.
+    explicit string(struct ::string *str) noexcept : str_(str)
+    {
+    }
+
+    string(const string &other) : string(std::string_view(other))
+    {
+    }
+
+    /// Steal the struct string of @c other, without allocating.
+    string(string &&other) noexcept : str_(std::exchange(other.str_, nullptr))
+    {
+    }
+
+    ~string()
+    {
+        ::string_delete(str_);
+    }
+
+    string &operator=(const string &other)
+    {
+        if (this != &other) {
+            assign(other);
+        }
+        return *this;
+    }
+
+    /// Exchange struct strings with @c other, without allocating; the previous content is released with @c other.
+    string &operator=(string &&other) noexcept
+    {
+        swap(other);
+        return *this;
+    }
+
+    string &operator=(std::string_view v)
+    {
+        assign(v);
+        return *this;
+    }
+
+    /// @return The owned struct string, for use with the C API.
+    struct ::string *get() const noexcept
+    {
+        return str_;
+    }
+
+    /// Give up ownership of the struct string, leaving this object moved-from.
+    /// @note Memory ownership: Caller must string_delete() the returned pointer.
+    struct ::string *release() noexcept
+    {
+        return std::exchange(str_, nullptr);
+    }
+
+    void swap(string &other) noexcept
+    {
+        std::swap(str_, other.str_);
+    }
+
+    bool empty() const noexcept
+    {
+        return ::string_empty(str_);
+    }
+
+    std::size_t size() const noexcept
+    {
+        return ::string_size(str_);
+    }
+
+    std::size_t capacity() const noexcept
+    {
+        return ::string_capacity(str_);
+    }
+
+    /// @return NUL terminated characters, or NULL if moved-from.
+    const char *c_str() const noexcept
+    {
+        return ::string_c_str(str_);
+    }
+
+    /// @see c_str.
+    const char *data() const noexcept
+    {
+        return ::string_c_str(str_);
+    }
+
+    /// @return Character at @c pos, or zero if @c pos is invalid.
+    char operator[](std::size_t pos) const noexcept
+    {
+        return ::string_at(str_, pos);
+    }
+
+    /// View of the characters, without copying; valid until the string is modified or destroyed.
+    operator std::string_view() const noexcept
+    {
+        struct ::string_view v = ::string_as_view(str_);
+
+        return std::string_view(v.buf, v.len);
+    }
+
+    void clear() noexcept
+    {
+        ::string_clear(str_);
+    }
+
+    void reserve(std::size_t cap)
+    {
+        detail::check(::string_reserve(str_, cap));
+    }
+
+    /// Replace content with @c v, which may view this string.
+    string &assign(std::string_view v)
+    {
+        if (!str_) {
+            *this = string();
+        }
+        detail::check(::string_assign_buffer(str_, v.size(), detail::data_of(v)));
+        return *this;
+    }
+
+    void push_back(char c)
+    {
+        detail::check(::string_push_back(str_, c));
+    }
+
+    void pop_back()
+    {
+        detail::check(::string_pop_back(str_));
+    }
+
+    /// Append @c v, which must not view this string.
+    string &append(std::string_view v)
+    {
+        detail::check(::string_append_buffer(str_, v.size(), detail::data_of(v)));
+        return *this;
+    }
+
+    string &append(std::size_t n, char c)
+    {
+        detail::check(::string_append_fill(str_, n, c));
+        return *this;
+    }
+
+    string &operator+=(std::string_view v)
+    {
+        return append(v);
+    }
+
+    string &operator+=(char c)
+    {
+        push_back(c);
+        return *this;
+    }
+
+    /// Insert @c v, which must not view this string, at @c pos.
+    string &insert(std::size_t pos, std::string_view v)
+    {
+        detail::check(::string_insert_buffer(str_, pos, v.size(), detail::data_of(v)));
+        return *this;
+    }
+
+    string &insert(std::size_t pos, std::size_t n, char c)
+    {
+        detail::check(::string_insert_fill(str_, pos, n, c));
+        return *this;
+    }
+
+    /// Erase up to @c len characters from @c pos.
+    string &erase(std::size_t pos = 0, std::size_t len = npos)
+    {
+        detail::check(::string_erase(str_, pos, len));
+        return *this;
+    }
+
+    /// @return Copy of up to @c len characters from @c pos.
+    string substr(std::size_t pos = 0, std::size_t len = npos) const
+    {
+        struct ::string *str = ::string_substr(str_, pos, len);
+
+        if (!str) {
+            detail::check(-errno);
+        }
+        return string(str);
+    }
+
+    bool starts_with(std::string_view v) const noexcept
+    {
+        return ::string_starts_with(str_, v.size(), detail::data_of(v));
+    }
+
+    bool ends_with(std::string_view v) const noexcept
+    {
+        return ::string_ends_with(str_, v.size(), detail::data_of(v));
+    }
+
+    /// @return Negative, zero or positive as this string orders before, equal to or after @c other.
+    int compare(const string &other) const noexcept
+    {
+        return ::string_compare(str_, other.str_);
+    }
+
+    std::uint64_t hash() const noexcept
+    {
+        return ::string_hash(str_);
+    }
+
+    friend bool operator==(const string &a, const string &b) noexcept
+    {
+        return ::string_equal(a.str_, b.str_);
+    }
+
+    friend bool operator==(const string &a, std::string_view b) noexcept
+    {
+        return std::string_view(a) == b;
+    }
+
+    friend bool operator==(std::string_view a, const string &b) noexcept
+    {
+        return a == std::string_view(b);
+    }
+
+    friend bool operator!=(const string &a, const string &b) noexcept
+    {
+        return !(a == b);
+    }
+
+    friend bool operator!=(const string &a, std::string_view b) noexcept
+    {
+        return !(a == b);
+    }
+
+    friend bool operator!=(std::string_view a, const string &b) noexcept
+    {
+        return !(a == b);
+    }
+
+    friend bool operator<(const string &a, const string &b) noexcept
+    {
+        return a.compare(b) < 0;
+    }
+
+private:
+    struct ::string *str_;
+};
+
+inline void swap(string &a, string &b) noexcept
+{
+    a.swap(b);
+}
+
+} // namespace cstring
+
+template <>
+struct std::hash<cstring::string> {
+    std::size_t operator()(const cstring::string &s) const noexcept
+    {
+        return static_cast<std::size_t>(s.hash());
+    }
+};
+
+#endif // LIBCSTRING_CSTRING_HPP_
@@ -0,0 +1,132 @@
+#ifndef LIBCSTRING_CSTRING_INLINE_H_
+#define LIBCSTRING_CSTRING_INLINE_H_
+
+/// String library inline fast paths.
+///
+/// Optional header that exposes the layout of the string object, so that the common
+/// cases of size, character access and appending within capacity are inlined into
+/// the caller. Growth and error handling are delegated to the functions in cstring.h, as are
+/// all calls while recording (see string_trace_start()), so that traces replay faithfully;
+/// the @c _unchecked variants bypass the library, and are never recorded.
+///
+/// @warning The layout is not a stable interface: code that includes this header must be rebuilt when the library changes.
+
+#include "cstring.h"
+
+#include <string.h>
+
+/// Small string optimization.
+/// Holds up to 7 chars + NUL inline.
+/// Arbitrary choice.
+#define STRING_SSO_SIZE 8
+
+/// Content is known to be valid UTF-8.
+#define STRING_FLAG_UTF8_VALID 1u
+
+/// Content is compressed (see string_compress()): @c buf holds the compressed representation, and
+/// @c cap its size, which is less than @c len so that capacity checks fall back to the library.
+#define STRING_FLAG_COMPRESSED 2u
+
+/// Hash state is kept, in a record allocated apart from the object (see string_hash_track()).
+#define STRING_FLAG_HASH_TRACK 4u
+
+/// Internal: flag that is true while calls are recorded by string_trace_start(), only read by string_tracing().
+extern const bool *const string_trace_flag PUBLIC;
+
+/// @return True if calls must go through the functions in cstring.h to be recorded.
+static inline bool string_tracing(void)
+{
+    return __atomic_load_n(string_trace_flag, __ATOMIC_RELAXED);
+}
+
+struct string {
+    /// Capacity of buffer (excluding NUL terminator).
+    size_t cap;
+    /// Length of buffer (excluding NUL terminator).
+    size_t len;
+    /// Buffer (always NUL terminated).
+    char *buf;
+    /// Internal storage (small string optimization).
+    char sso[STRING_SSO_SIZE];
+    /// Cached properties of the content (STRING_FLAG_*).
+    unsigned flags;
+};
+
+/// Get number of characters in string, without checking arguments.
+static inline size_t string_size_unchecked(const struct string *str)
+{
+    return str->len;
+}
+
+/// Get character at position, without checking arguments.
+/// @pre @c pos is less than string_size(), and the string is not compressed.
+static inline char string_at_unchecked(const struct string *str, size_t pos)
+{
+    return str->buf[pos];
+}
+
+/// Append character, without checking arguments or capacity.
+/// @pre string_size() is less than string_capacity(), for example after string_reserve().
+static inline void string_push_back_unchecked(struct string *str, char c)
+{
+    str->buf[str->len++] = c;
+    str->buf[str->len] = 0;
+    str->flags &= ~STRING_FLAG_UTF8_VALID;
+}
+
+/// Append @c n characters from buffer @c s, without checking arguments or capacity.
+/// @pre @c n does not exceed string_capacity() - string_size(), and the string is not compressed.
+static inline void string_append_buffer_unchecked(struct string *str, size_t n, const char *s)
+{
+    memcpy(&str->buf[str->len], s, n);
+    str->len += n;
+    str->buf[str->len] = 0;
+    str->flags &= ~STRING_FLAG_UTF8_VALID;
+}
+
+/// Get number of characters in string.
+/// @see string_size.
+static inline size_t string_size_inline(const struct string *str)
+{
+    return str ? string_size_unchecked(str) : 0;
+}
+
+/// Get character at position.
+/// @see string_at.
+static inline char string_at_inline(const struct string *str, size_t pos)
+{
+    if (!string_tracing() && str && pos < str->len && !(str->flags & STRING_FLAG_COMPRESSED)) {
+        return string_at_unchecked(str, pos);
+    }
+
+    // Recording, decompression and errors.
+    return string_at(str, pos);
+}
+
+/// Append character.
+/// @see string_push_back.
+static inline int string_push_back_inline(struct string *str, char c)
+{
+    if (!string_tracing() && str && str->len < str->cap) {
+        string_push_back_unchecked(str, c);
+        return 0;
+    }
+
+    // Recording, growth and errors.
+    return string_push_back(str, c);
+}
+
+/// Append @c n characters from buffer @c s at end of string.
+/// @see string_append_buffer.
+static inline int string_append_buffer_inline(struct string *str, size_t n, const char *s)
+{
+    if (!string_tracing() && str && s && str->len <= str->cap && n <= str->cap - str->len) {
+        string_append_buffer_unchecked(str, n, s);
+        return 0;
+    }
+
+    // Recording, growth and errors.
+    return string_append_buffer(str, n, s);
+}
+
+#endif // LIBCSTRING_CSTRING_INLINE_H_
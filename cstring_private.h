@@ -0,0 +1,80 @@
+#ifndef LIBCSTRING_CSTRING_PRIVATE_H_
+#define LIBCSTRING_CSTRING_PRIVATE_H_
+
+// Private API.
+// Helpers shared by the modules of this library; this header is not installed.
+
+#include "cstring.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <poll.h>
+#include <sys/uio.h>
+
+/// Decode an unsigned LEB128 varint from the @c n characters of @c p into @c v.
+/// @return Length of the varint, zero if truncated, or STRING_NPOS if it does not fit in a size_t or is overlong
+///         (ends with a zero group, which encoders never produce).
+static inline size_t get_varint(const char *p, size_t n, size_t *v)
+{
+    unsigned shift = 0;
+    size_t value = 0;
+    size_t i;
+
+    for (i = 0; i < n; ++i, shift += 7) {
+        size_t bits = (unsigned char)p[i] & 0x7f;
+
+        // Reject bits beyond the width of size_t.
+        if (shift >= sizeof(size_t) * CHAR_BIT || (bits << shift) >> shift != bits) {
+            return STRING_NPOS;
+        }
+        value |= bits << shift;
+
+        if (!((unsigned char)p[i] & 0x80)) {
+            if (i > 0 && bits == 0) {
+                return STRING_NPOS;
+            }
+
+            *v = value;
+            return i + 1;
+        }
+    }
+
+    return 0;
+}
+
+/// Write all of @c n buffers in @c iov to @c fd, resuming after partial writes and interruptions,
+/// and waiting with poll() while a non-blocking @c fd is full.
+/// @return Zero on success, negative errno otherwise (part of the buffers may have been written).
+static inline int write_all(int fd, struct iovec *iov, int n)
+{
+    while (n > 0) {
+        ssize_t r = writev(fd, iov, n);
+
+        if (r < 0) {
+            struct pollfd pfd = { .fd = fd, .events = POLLOUT };
+
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN || poll(&pfd, 1, -1) < 0) {
+                return -errno;
+            }
+            continue;
+        }
+
+        // Skip buffers written completely, and advance into a buffer written partially.
+        while (n > 0 && (size_t)r >= iov->iov_len) {
+            r -= (ssize_t)iov->iov_len;
+            ++iov;
+            --n;
+        }
+        if (n > 0) {
+            iov->iov_base = (char *)iov->iov_base + r;
+            iov->iov_len -= (size_t)r;
+        }
+    }
+
+    return 0;
+}
+
+#endif // LIBCSTRING_CSTRING_PRIVATE_H_
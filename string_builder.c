@@ -0,0 +1,324 @@
+#include "string_builder.h"
+
+#include "cstring_private.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/// Capacity of the first chunk.
+#define FIRST_CHUNK 256
+
+/// Capacity beyond which chunks stop growing, so that little memory is left unused in the last chunk.
+#define MAX_CHUNK ((size_t)1 << 20)
+
+/// Number of chunks written by one writev() call (not more than IOV_MAX).
+#define IOV_BATCH 64
+
+struct chunk {
+    /// Buffer, with room for a NUL terminator so that it can be adopted by a string.
+    char *buf;
+    /// Number of characters written.
+    size_t len;
+    /// Capacity of buffer (excluding NUL terminator).
+    size_t cap;
+};
+
+struct string_builder {
+    struct chunk *chunks;
+    size_t nchunks;
+    size_t chunks_cap;
+    /// Total number of characters.
+    size_t size;
+    /// Capacity of the next chunk.
+    size_t next;
+};
+
+/// @return Last chunk of builder @c b, which must have one.
+static struct chunk *last_chunk(struct string_builder *b)
+{
+    return &b->chunks[b->nchunks - 1];
+}
+
+/// @return Room left in the last chunk of builder @c b.
+static size_t spare(const struct string_builder *b)
+{
+    return b->nchunks ? b->chunks[b->nchunks - 1].cap - b->chunks[b->nchunks - 1].len : 0;
+}
+
+/// Start a new chunk with room for at least @c n characters.
+/// @return Zero on success, negative errno otherwise.
+static int add_chunk(struct string_builder *b, size_t n)
+{
+    size_t cap = (n > b->next) ? n : b->next;
+    struct chunk *c;
+
+    if (cap == SIZE_MAX) {
+        // Check for overflow.
+        return -ENOMEM;
+    }
+
+    if (b->nchunks == b->chunks_cap) {
+        size_t chunks_cap = b->chunks_cap ? 2 * b->chunks_cap : 8;
+        struct chunk *chunks = realloc(b->chunks, chunks_cap * sizeof(struct chunk));
+
+        if (!chunks) {
+            return -ENOMEM;
+        }
+        b->chunks = chunks;
+        b->chunks_cap = chunks_cap;
+    }
+
+    c = &b->chunks[b->nchunks];
+    c->buf = malloc(cap + 1);
+    if (!c->buf) {
+        return -ENOMEM;
+    }
+    c->len = 0;
+    c->cap = cap;
+    ++b->nchunks;
+
+    if (b->next < MAX_CHUNK) {
+        b->next *= 2;
+    }
+    return 0;
+}
+
+struct string_builder *string_builder_new(void)
+{
+    struct string_builder *b = NULL;
+
+    b = calloc(1, sizeof(struct string_builder));
+    if (!b) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    b->next = FIRST_CHUNK;
+    return b;
+}
+
+void string_builder_delete(struct string_builder *b)
+{
+    if (!b) {
+        return;
+    }
+
+    string_builder_clear(b);
+    free(b->chunks);
+    free(b);
+}
+
+size_t string_builder_size(const struct string_builder *b)
+{
+    if (!b) {
+        return 0;
+    }
+
+    return b->size;
+}
+
+void string_builder_clear(struct string_builder *b)
+{
+    size_t i;
+
+    if (!b) {
+        return;
+    }
+
+    for (i = 0; i < b->nchunks; ++i) {
+        free(b->chunks[i].buf);
+    }
+    b->nchunks = 0;
+    b->size = 0;
+    b->next = FIRST_CHUNK;
+}
+
+int string_builder_append_buffer(struct string_builder *b, size_t n, const char *s)
+{
+    size_t last;
+    size_t k;
+
+    if (!b || !s) {
+        return -EFAULT;
+    }
+
+    if (n > SIZE_MAX - b->size) {
+        // Check for overflow.
+        return -ENOMEM;
+    }
+
+    // Fill the last chunk, and put the rest in one new chunk, added first so that nothing changes on failure.
+    last = b->nchunks;
+    k = (n < spare(b)) ? n : spare(b);
+    if (k < n) {
+        int r = add_chunk(b, n - k);
+
+        if (r != 0) {
+            return r;
+        }
+    }
+
+    if (k > 0) {
+        struct chunk *c = &b->chunks[last - 1];
+
+        memcpy(&c->buf[c->len], s, k);
+        c->len += k;
+    }
+
+    if (k < n) {
+        struct chunk *c = last_chunk(b);
+
+        memcpy(c->buf, &s[k], n - k);
+        c->len = n - k;
+    }
+
+    b->size += n;
+    return 0;
+}
+
+int string_builder_append_c_str(struct string_builder *b, const char *s)
+{
+    if (!s) {
+        return -EFAULT;
+    }
+
+    return string_builder_append_buffer(b, strlen(s), s);
+}
+
+int string_builder_push_back(struct string_builder *b, char c)
+{
+    return string_builder_append_buffer(b, 1, &c);
+}
+
+char *string_builder_reserve_tail(struct string_builder *b, size_t n)
+{
+    int r;
+
+    if (!b) {
+        errno = EFAULT;
+        return NULL;
+    }
+
+    if (spare(b) < n || b->nchunks == 0) {
+        r = add_chunk(b, n);
+        if (r != 0) {
+            errno = -r;
+            return NULL;
+        }
+    }
+
+    return &last_chunk(b)->buf[last_chunk(b)->len];
+}
+
+int string_builder_commit(struct string_builder *b, size_t n)
+{
+    if (!b) {
+        return -EFAULT;
+    }
+
+    if (n > spare(b)) {
+        return -ERANGE;
+    }
+
+    if (n > 0) {
+        last_chunk(b)->len += n;
+        b->size += n;
+    }
+    return 0;
+}
+
+size_t string_builder_chunks(const struct string_builder *b)
+{
+    if (!b) {
+        return 0;
+    }
+
+    return b->nchunks;
+}
+
+struct string_view string_builder_chunk(const struct string_builder *b, size_t i)
+{
+    struct string_view view = { NULL, 0 };
+
+    if (!b || i >= b->nchunks) {
+        return view;
+    }
+
+    view.buf = b->chunks[i].buf;
+    view.len = b->chunks[i].len;
+    return view;
+}
+
+int string_builder_write(const struct string_builder *b, int fd)
+{
+    size_t i;
+
+    if (!b) {
+        return -EFAULT;
+    }
+
+    for (i = 0; i < b->nchunks; i += IOV_BATCH) {
+        struct iovec iov[IOV_BATCH];
+        int n = 0;
+        int r;
+        size_t k;
+
+        for (k = i; k < b->nchunks && n < IOV_BATCH; ++k, ++n) {
+            iov[n].iov_base = b->chunks[k].buf;
+            iov[n].iov_len = b->chunks[k].len;
+        }
+
+        r = write_all(fd, iov, n);
+        if (r < 0) {
+            return r;
+        }
+    }
+
+    return 0;
+}
+
+struct string *string_builder_finish(struct string_builder *b)
+{
+    struct string *str = NULL;
+    char *buf;
+    size_t i;
+
+    if (!b) {
+        errno = EFAULT;
+        return NULL;
+    }
+
+    if (b->nchunks == 1) {
+        str = string_new_adopt(b->chunks[0].buf, b->chunks[0].len, b->chunks[0].cap);
+        if (!str) {
+            return NULL;
+        }
+
+        // The chunk now belongs to the string.
+        b->nchunks = 0;
+        string_builder_clear(b);
+        return str;
+    }
+
+    str = string_new();
+    if (!str) {
+        return NULL;
+    }
+
+    buf = string_resize_uninit(str, b->size);
+    if (!buf) {
+        string_delete(str);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    for (i = 0; i < b->nchunks; ++i) {
+        memcpy(buf, b->chunks[i].buf, b->chunks[i].len);
+        buf += b->chunks[i].len;
+    }
+
+    string_builder_clear(b);
+    return str;
+}
@@ -0,0 +1,99 @@
+#ifndef LIBCSTRING_STRING_BUILDER_H_
+#define LIBCSTRING_STRING_BUILDER_H_
+
+/// String builder.
+///
+/// Builds large strings of unknown size in a list of chunks, so that characters
+/// once written are never moved: growing a string by reallocation copies its
+/// content at every doubling, and briefly holds the old and new storage.
+///
+/// Chunks grow geometrically up to a fixed size. The content can be written
+/// out directly from the chunks with writev(), or turned into a string with a
+/// single copy, or none if it fits in one chunk.
+///
+/// Functions follow the return type conventions described in cstring.h.
+
+#include "cstring.h"
+
+/// String builder object.
+///
+/// This library is **not** thread-safe.
+/// Caller must synchronize access to builder objects.
+struct string_builder;
+
+/// Constructor.
+/// Create a new empty builder.
+/// @return Pointer to builder on success.
+/// @return NULL on failure, and errno is set to:
+///   - ENOMEM: Insufficient memory.
+/// @note Memory ownership: Caller must string_builder_delete() the returned pointer.
+struct string_builder *string_builder_new(void) PUBLIC;
+
+/// Destructor.
+/// @note Memory ownership: Object takes ownership of the pointer.
+void string_builder_delete(struct string_builder *) PUBLIC;
+
+/// Get number of characters.
+/// @return The number of characters in the builder, or zero if empty or NULL.
+size_t string_builder_size(const struct string_builder *) PUBLIC;
+
+/// Erases all characters, and releases the chunks.
+void string_builder_clear(struct string_builder *) PUBLIC;
+
+/// Append @c n characters from buffer @c s.
+/// @return Zero on success, negative errno otherwise.
+///   - EFAULT: NULL pointer argument.
+///   - ENOMEM: Insufficient memory.
+/// @note Memory ownership: Caller retains ownership of @c s.
+int string_builder_append_buffer(struct string_builder *, size_t n, const char *s) PUBLIC;
+
+/// Append string.
+/// @see string_builder_append_buffer.
+int string_builder_append_c_str(struct string_builder *, const char *s) PUBLIC;
+
+/// Append character.
+/// @see string_builder_append_buffer.
+int string_builder_push_back(struct string_builder *, char c) PUBLIC;
+
+/// Reserve room for at least @c n contiguous characters at the end, for direct writes.
+/// If the last chunk has less room, a new chunk is started; call string_builder_commit() to append the characters written.
+/// @return Pointer to the spare capacity on success.
+/// @return NULL on failure, and errno is set to:
+///   - EFAULT: NULL pointer argument.
+///   - ENOMEM: Insufficient memory.
+/// @note Memory ownership: Owned by the object; valid until object modified or deleted.
+char *string_builder_reserve_tail(struct string_builder *, size_t n) PUBLIC;
+
+/// Append @c n characters previously written into the spare capacity.
+/// @see string_builder_reserve_tail.
+/// @return Zero on success, negative errno otherwise.
+///   - EFAULT: NULL pointer argument.
+///   - ERANGE: @c n exceeds the spare capacity.
+int string_builder_commit(struct string_builder *, size_t n) PUBLIC;
+
+/// Get number of chunks.
+/// @return The number of chunks, or zero if NULL.
+size_t string_builder_chunks(const struct string_builder *) PUBLIC;
+
+/// Get view of chunk @c i; the content of the builder is the chunks in order.
+/// @return View of the characters in the chunk, or an empty view with NULL @c buf if NULL or @c i invalid.
+/// @note Memory ownership: Owned by the object; valid until object modified or deleted.
+struct string_view string_builder_chunk(const struct string_builder *, size_t i) PUBLIC;
+
+/// Write the content to @c fd with writev(), directly from the chunks, resuming after partial writes.
+/// Non-blocking descriptors are waited on with poll(), so that the content is written completely.
+/// @return Zero on success, negative errno otherwise.
+///   - EFAULT: NULL pointer argument.
+///   - Any error of writev() or poll().
+int string_builder_write(const struct string_builder *, int fd) PUBLIC;
+
+/// Move the content into a new string, leaving the builder empty.
+/// The chunks are copied once into storage of the exact size, or a single chunk is adopted without copying.
+/// @return Pointer to string on success.
+/// @return NULL on failure (the builder is unchanged), and errno is set to:
+///   - EFAULT: NULL pointer argument.
+///   - ENOMEM: Insufficient memory.
+/// @note Memory ownership: Caller must string_delete() the returned pointer.
+struct string *string_builder_finish(struct string_builder *) PUBLIC;
+
+#endif // LIBCSTRING_STRING_BUILDER_H_
@@ -0,0 +1,112 @@
+#include "string_chunk.h"
+
+#include <stdint.h>
+
+/// Number of characters that the Gear hash depends on: each step shifts the
+/// state left by one bit, so characters older than this have been shifted out.
+#define GEAR_WINDOW 64
+
+/// Random values for each character, generated with splitmix64.
+static const uint64_t gear[256] = {
+    UINT64_C(0xc0e16b163a85a4dc), UINT64_C(0x890acd8dd443c47c), UINT64_C(0xb3889d8a6dc47761), UINT64_C(0x6a0398e528f0ae6a),
+    UINT64_C(0x048344ece48a855e), UINT64_C(0xf175cfea21871330), UINT64_C(0x391ceef02702c2fd), UINT64_C(0x4baf8cac4784cb12),
+    UINT64_C(0x3547744583a3f88e), UINT64_C(0xd9cf2b15c6b6c90e), UINT64_C(0x961facc76d5fe21c), UINT64_C(0x0094ab49d50f11f9),
+    UINT64_C(0xe3211e37bdbeb6dc), UINT64_C(0x62fe6c274ff3511a), UINT64_C(0x5ac30b329fdf0574), UINT64_C(0x1450582c6b65b406),
+    UINT64_C(0x7a30fcc7888eb791), UINT64_C(0x5540f5ba6a15576e), UINT64_C(0x16cef0559096d3e9), UINT64_C(0x2cf8f14b06874899),
+    UINT64_C(0xc9c9263b6e2ce103), UINT64_C(0xd6ff920b0a9faa6d), UINT64_C(0x53192697db998dc1), UINT64_C(0x73ea9b9bc7cd18d7),
+    UINT64_C(0x102713f872c33fce), UINT64_C(0xf4183a0e5d2a033e), UINT64_C(0x71b63e307eebb517), UINT64_C(0xda61f5713d036000),
+    UINT64_C(0x46eb7409ae691b21), UINT64_C(0xb23ad691d6707698), UINT64_C(0x67c8fe11d22fc4b9), UINT64_C(0x7eb4661419481338),
+    UINT64_C(0x98077547fb070efc), UINT64_C(0x1ee63336c2e3a9a8), UINT64_C(0xbc353656348c36f6), UINT64_C(0xce3898cbf1bb1bd8),
+    UINT64_C(0x265b1c23c82915cb), UINT64_C(0xfd1948c91687e355), UINT64_C(0xd976893961980ffa), UINT64_C(0x336e77a6288e4c34),
+    UINT64_C(0x16f8956d7b76d269), UINT64_C(0xda7cd844690d4669), UINT64_C(0x1e8cf85f253a581e), UINT64_C(0x3ea68129e923e53a),
+    UINT64_C(0xa080a077c9e9fd79), UINT64_C(0x4469a19c673c14cf), UINT64_C(0xbd5b9351b2d0963c), UINT64_C(0xb46a749cad9df6b7),
+    UINT64_C(0x07da714e59c7d362), UINT64_C(0x393a84bb5af17618), UINT64_C(0xb3ae08f3c86dfc0c), UINT64_C(0x642a350ed7c82c93),
+    UINT64_C(0x547bdec029cd3fa3), UINT64_C(0x778debb21b67fc3d), UINT64_C(0xb1e26d886eaed22b), UINT64_C(0x49fb5996898a7303),
+    UINT64_C(0x5e245bcec3e007b3), UINT64_C(0x1f6818e4a739f61b), UINT64_C(0xad694562d6313aff), UINT64_C(0xded7c324e96e3a09),
+    UINT64_C(0x0e181ef86a661cf8), UINT64_C(0x675448d833ac146b), UINT64_C(0xf047e1b493d6b255), UINT64_C(0xe3d9f8b33d92678c),
+    UINT64_C(0x62648db4d3b1b3ac), UINT64_C(0x5e772e6b32ded778), UINT64_C(0x6bc2ea32285bad33), UINT64_C(0x298b58c7b2262c2d),
+    UINT64_C(0x89a142e7a847c68f), UINT64_C(0x07b170d776f29a64), UINT64_C(0x754b9d28182fd07f), UINT64_C(0x934990332438604c),
+    UINT64_C(0xa1ab48a85cc22bbb), UINT64_C(0xff5aa2d675545595), UINT64_C(0x32a5a207c5c3eed3), UINT64_C(0xd9970e23aebb3d51),
+    UINT64_C(0xd9d01979fc161649), UINT64_C(0x437a2ed7a4fca264), UINT64_C(0x30fa485d263c4dd1), UINT64_C(0xaab6790590cb5b06),
+    UINT64_C(0x65091913e11e2cfa), UINT64_C(0x51b90f06b259b46b), UINT64_C(0x8289d10138b1d6b4), UINT64_C(0x88ae7e8730e361fb),
+    UINT64_C(0x0833a622304c447b), UINT64_C(0xe2e55431bf4b1b54), UINT64_C(0xdde9371fc120d32f), UINT64_C(0x5751a8d978ce73dd),
+    UINT64_C(0xbf1f19e0e1fbd33d), UINT64_C(0x75374f1247e3cdaa), UINT64_C(0x9f1ca64eb4d3ce97), UINT64_C(0x38136f3a3d5ace59),
+    UINT64_C(0xd47963dbf7f8dc43), UINT64_C(0xd87428ff43dd9d86), UINT64_C(0x2607e8bece834053), UINT64_C(0x3c7a84fa12044c87),
+    UINT64_C(0x8c7f4bfac5f7e4bb), UINT64_C(0xed4a244966996f87), UINT64_C(0x36c97138af16e719), UINT64_C(0x08d81534dedb7662),
+    UINT64_C(0xac7c55978241afc4), UINT64_C(0xdf1b8863c9332ce7), UINT64_C(0x620ee7f218ea0997), UINT64_C(0x38d1df383ce89b65),
+    UINT64_C(0xe719097929758713), UINT64_C(0x9ec6cd248c58ad3c), UINT64_C(0xf54bd98a78d9f340), UINT64_C(0x6498bc6124519df3),
+    UINT64_C(0x198e656271e64fa2), UINT64_C(0xa43fd5dd0d813097), UINT64_C(0x35ad65fea929819a), UINT64_C(0x2f00139d2a8cd90c),
+    UINT64_C(0x155f41d97478845c), UINT64_C(0x3f2b6a8cfea779b9), UINT64_C(0x4b7264199d7c962a), UINT64_C(0xa26165f55b57273f),
+    UINT64_C(0xb7a6f3f0ecf5b89f), UINT64_C(0x8e0692470e1ee509), UINT64_C(0x23234da5964b213a), UINT64_C(0x6461d9c18fb4c2b9),
+    UINT64_C(0x9c44cac712b73113), UINT64_C(0x93de0e8d937a2da0), UINT64_C(0x88c84529e3843d70), UINT64_C(0x70daad40227330ce),
+    UINT64_C(0x7ab855c449ec8aca), UINT64_C(0xc8de7a81906c8be8), UINT64_C(0x5f5627df47641dda), UINT64_C(0xdd60bf81e2586cbc),
+    UINT64_C(0x3cfc1ba44eaf2468), UINT64_C(0x405a9309613ad882), UINT64_C(0x4de7eb21b0277f28), UINT64_C(0x86e512678e4dd45a),
+    UINT64_C(0x0f1286efd6bdd066), UINT64_C(0x1c8aca34c2fa6773), UINT64_C(0x1da8e48b2342e347), UINT64_C(0x1890dcd0a94893e7),
+    UINT64_C(0x2b1aaf97ef6b4dff), UINT64_C(0xb32b16249647a7ec), UINT64_C(0x9fb5f0bced31ea58), UINT64_C(0x3d78f7907627c61f),
+    UINT64_C(0x1841958c7d191f94), UINT64_C(0xa18a85a96a78b19e), UINT64_C(0x631e9abbb0213210), UINT64_C(0x3dab614952cc05a9),
+    UINT64_C(0x017020b874beabd6), UINT64_C(0xfa59da85e751094c), UINT64_C(0x29cd811450b5412e), UINT64_C(0x8d15c850af2489a8),
+    UINT64_C(0x950b3bdd58d563a0), UINT64_C(0x836cb8f306d51f7e), UINT64_C(0x4065efde02b744e8), UINT64_C(0xb9baecb669369d99),
+    UINT64_C(0x7b378c9248d47dc4), UINT64_C(0x4ddd25d48cdc6168), UINT64_C(0xa732d6380105f470), UINT64_C(0x75c8d0927bb9c613),
+    UINT64_C(0x6785a012497a2d75), UINT64_C(0xffca85e4ac7617e9), UINT64_C(0xc6f2129203f39492), UINT64_C(0x3ed2bc376029332e),
+    UINT64_C(0xd0dc8d146f7e2680), UINT64_C(0x513f8ed97341b4a1), UINT64_C(0x4324394cfa366d32), UINT64_C(0x7cbea6ee7da29a4a),
+    UINT64_C(0x69707125ac82ecfa), UINT64_C(0xdd4ba7a8ed6c0ef7), UINT64_C(0x100210a42564a9ef), UINT64_C(0xaf1101e77e76c1c2),
+    UINT64_C(0x140a33b32394451b), UINT64_C(0xce3748ebe86fd0f9), UINT64_C(0x763b94236a3c95dc), UINT64_C(0x0e82087dbe388ce4),
+    UINT64_C(0x8a3f991981c24d6e), UINT64_C(0x31b399f558c60586), UINT64_C(0xf50ea2c64afdfe9b), UINT64_C(0x6c02449c992ff889),
+    UINT64_C(0x7914a6531aeeb744), UINT64_C(0xb75f86f73f2f4ec2), UINT64_C(0x1bdb24c7bd571df8), UINT64_C(0x06e4e518ae8f033e),
+    UINT64_C(0xffe622dab44f3689), UINT64_C(0xf2792f1385db0e95), UINT64_C(0x2aad6ff4838907b8), UINT64_C(0x0d649d2b9341acca),
+    UINT64_C(0x2aef8ac693c156cd), UINT64_C(0xb86c9e57fa18942e), UINT64_C(0xe85e3cf930ed3877), UINT64_C(0xb3fb466dd31f94a2),
+    UINT64_C(0xac8d03c007f25604), UINT64_C(0xa9eec498626ff508), UINT64_C(0xf47be033dda3f9b0), UINT64_C(0xa4f748b538e6f27d),
+    UINT64_C(0xc01bb10959d5e985), UINT64_C(0x89079de7dda37d8f), UINT64_C(0xd7007ba815cc0658), UINT64_C(0xc4da1bb45a7b871a),
+    UINT64_C(0x98185ba52f9d9cd4), UINT64_C(0x4242c91a500844e5), UINT64_C(0x07965f1aa6863c5d), UINT64_C(0x0359ccaad9aea599),
+    UINT64_C(0xe7a54bf05004eddb), UINT64_C(0x333aa1cd725ff5e8), UINT64_C(0x94c18d8184570964), UINT64_C(0xee0303af7e757a57),
+    UINT64_C(0xbbc38705003c82ec), UINT64_C(0xc57a6bbdbb7edfbd), UINT64_C(0xbaea4e697c235ee2), UINT64_C(0x9f1ed9c9b4707ea2),
+    UINT64_C(0x3845a969b77941f0), UINT64_C(0x1f02624c80d73ce6), UINT64_C(0x4820b4e1649d1ddc), UINT64_C(0x77d1259b2f0be5fb),
+    UINT64_C(0xa495f4fdba5cccdd), UINT64_C(0x5ce421e295346c68), UINT64_C(0x0dfd63adc1c5bc74), UINT64_C(0x570045b98cbc93e3),
+    UINT64_C(0x5b7317cd17a15f04), UINT64_C(0x6defb13e4a48fa9c), UINT64_C(0x9d2540358539f109), UINT64_C(0xdff1d3db7af0541b),
+    UINT64_C(0xa786c0d906df090e), UINT64_C(0x9c8aa8553f5db609), UINT64_C(0x2d5d59b48454ab11), UINT64_C(0x73fbfbfd57360323),
+    UINT64_C(0xe045969a1fe274d6), UINT64_C(0xb374b31ccc1c9668), UINT64_C(0xee53c1d82d9ced9c), UINT64_C(0x02ee16f7445f3d27),
+    UINT64_C(0x43d17009acf06ed8), UINT64_C(0xd17f5baf03dd6e26), UINT64_C(0xbddf2289ed7719ff), UINT64_C(0xf9b980d54f117273),
+    UINT64_C(0xcdd05dc90b2c3b5b), UINT64_C(0xae6df7dd9d557455), UINT64_C(0xa6a0e6779f5dfb3f), UINT64_C(0xd85269b48de6f619),
+    UINT64_C(0x43b0855155163e1c), UINT64_C(0x716aa342eaa75e67), UINT64_C(0xf601d8d15e1709ae), UINT64_C(0x9ce1c4f19d6c405b),
+    UINT64_C(0x8e5d480bf2121c70), UINT64_C(0x5cd643cb24cbaa78), UINT64_C(0x44ecfa2a75ca3a34), UINT64_C(0x390f2eddea3099a2),
+    UINT64_C(0xdfea67149da0609f), UINT64_C(0xb734297101779a59), UINT64_C(0xc3f3700cbb0afe9f), UINT64_C(0x403cae0119d1bb35),
+    UINT64_C(0x23853b00d0e1076b), UINT64_C(0x63dc284ae4cf5983), UINT64_C(0x252721131cfe91ae), UINT64_C(0xdbe6d98b3113e9d6),
+    UINT64_C(0xf3f923744c247687), UINT64_C(0x01ef9061730e4ab6), UINT64_C(0x7f2a753307b3391c), UINT64_C(0xfd4cbb1b3007d376),
+};
+
+size_t string_chunk_boundary(size_t n, const char *s, size_t min_size, size_t max_size, unsigned bits)
+{
+    const unsigned char *u = (const unsigned char *)s;
+    uint64_t mask;
+    uint64_t h = 0;
+    size_t end;
+    size_t i;
+
+    if (!s) {
+        return 0;
+    }
+
+    end = (n < max_size) ? n : max_size;
+    if (end <= min_size) {
+        return end;
+    }
+
+    // The boundary condition tests the top bits, which depend on the whole window.
+    bits = (bits < 63) ? bits : 63;
+    mask = ~(UINT64_MAX >> bits);
+
+    // Characters before the window of the first candidate position cannot affect the state there.
+    i = (min_size > GEAR_WINDOW) ? min_size - GEAR_WINDOW : 0;
+    for (; i < min_size; ++i) {
+        h = (h << 1) + gear[u[i]];
+    }
+
+    for (; i < end; ++i) {
+        h = (h << 1) + gear[u[i]];
+        if (!(h & mask)) {
+            return i + 1;
+        }
+    }
+
+    return end;
+}
@@ -0,0 +1,29 @@
+#ifndef LIBCSTRING_STRING_CHUNK_H_
+#define LIBCSTRING_STRING_CHUNK_H_
+
+/// Content-defined chunking.
+///
+/// Splits data into chunks whose boundaries depend on the content around them,
+/// rather than on their offsets, so that an insertion or deletion only changes
+/// the chunks near it; identical runs of data in different places are cut into
+/// identical chunks, for deduplication.
+///
+/// Boundaries are found with a Gear rolling hash, which takes a shift, an add
+/// and a table lookup per character over a window of the last 64 characters.
+///
+/// Functions follow the return type conventions described in cstring.h.
+
+#include "cstring.h"
+
+/// Find the end of the chunk that starts at @c s.
+/// A boundary follows a character where the top @c bits bits of the rolling hash are zero, so
+/// that chunks average about 2^bits characters beyond @c min_size; boundaries closer than
+/// @c min_size to the start are skipped without hashing most of those characters.
+/// Call again from the returned position until the data is consumed; when streaming, the
+/// chunk ending at @c n is only complete at the end of the data, or if @c n reaches @c max_size.
+/// @param bits Number of bits tested, clamped to 63.
+/// @return Length of the chunk: at most @c n and @c max_size, and at least @c min_size unless
+///         limited by them; or zero if @c s is NULL.
+size_t string_chunk_boundary(size_t n, const char *s, size_t min_size, size_t max_size, unsigned bits) PUBLIC;
+
+#endif // LIBCSTRING_STRING_CHUNK_H_
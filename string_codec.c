@@ -0,0 +1,240 @@
+#include "string_codec.h"
+
+#include <errno.h>
+#include <stdint.h>
+
+static const char hex_digits[] = "0123456789abcdef";
+
+static const char base64_chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+static const char base64url_chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+// Decoding tables hold one plus the value of each digit, so that zero marks an invalid character.
+
+static const unsigned char hex_values[256] = {
+    ['0'] = 1, ['1'] = 2, ['2'] = 3, ['3'] = 4, ['4'] = 5, ['5'] = 6, ['6'] = 7, ['7'] = 8,
+    ['8'] = 9, ['9'] = 10, ['a'] = 11, ['b'] = 12, ['c'] = 13, ['d'] = 14, ['e'] = 15, ['f'] = 16,
+    ['A'] = 11, ['B'] = 12, ['C'] = 13, ['D'] = 14, ['E'] = 15, ['F'] = 16,
+};
+
+static const unsigned char base64_values[256] = {
+    ['A'] = 1, ['B'] = 2, ['C'] = 3, ['D'] = 4, ['E'] = 5, ['F'] = 6, ['G'] = 7, ['H'] = 8,
+    ['I'] = 9, ['J'] = 10, ['K'] = 11, ['L'] = 12, ['M'] = 13, ['N'] = 14, ['O'] = 15, ['P'] = 16,
+    ['Q'] = 17, ['R'] = 18, ['S'] = 19, ['T'] = 20, ['U'] = 21, ['V'] = 22, ['W'] = 23, ['X'] = 24,
+    ['Y'] = 25, ['Z'] = 26, ['a'] = 27, ['b'] = 28, ['c'] = 29, ['d'] = 30, ['e'] = 31, ['f'] = 32,
+    ['g'] = 33, ['h'] = 34, ['i'] = 35, ['j'] = 36, ['k'] = 37, ['l'] = 38, ['m'] = 39, ['n'] = 40,
+    ['o'] = 41, ['p'] = 42, ['q'] = 43, ['r'] = 44, ['s'] = 45, ['t'] = 46, ['u'] = 47, ['v'] = 48,
+    ['w'] = 49, ['x'] = 50, ['y'] = 51, ['z'] = 52, ['0'] = 53, ['1'] = 54, ['2'] = 55, ['3'] = 56,
+    ['4'] = 57, ['5'] = 58, ['6'] = 59, ['7'] = 60, ['8'] = 61, ['9'] = 62, ['+'] = 63, ['/'] = 64,
+};
+
+static const unsigned char base64url_values[256] = {
+    ['A'] = 1, ['B'] = 2, ['C'] = 3, ['D'] = 4, ['E'] = 5, ['F'] = 6, ['G'] = 7, ['H'] = 8,
+    ['I'] = 9, ['J'] = 10, ['K'] = 11, ['L'] = 12, ['M'] = 13, ['N'] = 14, ['O'] = 15, ['P'] = 16,
+    ['Q'] = 17, ['R'] = 18, ['S'] = 19, ['T'] = 20, ['U'] = 21, ['V'] = 22, ['W'] = 23, ['X'] = 24,
+    ['Y'] = 25, ['Z'] = 26, ['a'] = 27, ['b'] = 28, ['c'] = 29, ['d'] = 30, ['e'] = 31, ['f'] = 32,
+    ['g'] = 33, ['h'] = 34, ['i'] = 35, ['j'] = 36, ['k'] = 37, ['l'] = 38, ['m'] = 39, ['n'] = 40,
+    ['o'] = 41, ['p'] = 42, ['q'] = 43, ['r'] = 44, ['s'] = 45, ['t'] = 46, ['u'] = 47, ['v'] = 48,
+    ['w'] = 49, ['x'] = 50, ['y'] = 51, ['z'] = 52, ['0'] = 53, ['1'] = 54, ['2'] = 55, ['3'] = 56,
+    ['4'] = 57, ['5'] = 58, ['6'] = 59, ['7'] = 60, ['8'] = 61, ['9'] = 62, ['-'] = 63, ['_'] = 64,
+};
+
+/// @return Value of Base64 digit @c c, or negative if invalid.
+static int base64_value(const unsigned char *values, char c)
+{
+    return values[(unsigned char)c] - 1;
+}
+
+int string_append_hex(struct string *str, size_t n, const char *s)
+{
+    const unsigned char *in = (const unsigned char *)s;
+    char *p;
+    size_t i;
+
+    if (!s) {
+        return -EFAULT;
+    }
+
+    if (n > SIZE_MAX / 2) {
+        // Check for overflow.
+        return -ENOMEM;
+    }
+
+    p = string_reserve_tail(str, 2 * n);
+    if (!p) {
+        return -errno;
+    }
+
+    for (i = 0; i < n; ++i) {
+        p[2 * i] = hex_digits[in[i] >> 4];
+        p[2 * i + 1] = hex_digits[in[i] & 0xf];
+    }
+
+    return string_commit(str, 2 * n);
+}
+
+int string_append_hex_decoded(struct string *str, size_t n, const char *s)
+{
+    char *p;
+    size_t i;
+
+    if (!s) {
+        return -EFAULT;
+    }
+
+    if (n % 2 != 0) {
+        return -EILSEQ;
+    }
+
+    p = string_reserve_tail(str, n / 2);
+    if (!p) {
+        return -errno;
+    }
+
+    for (i = 0; i < n; i += 2) {
+        int hi = hex_values[(unsigned char)s[i]] - 1;
+        int lo = hex_values[(unsigned char)s[i + 1]] - 1;
+
+        if ((hi | lo) < 0) {
+            // Restore NUL terminator.
+            string_commit(str, 0);
+            return -EILSEQ;
+        }
+
+        p[i / 2] = (char)((hi << 4) | lo);
+    }
+
+    return string_commit(str, n / 2);
+}
+
+/// Append @c n bytes from @c s encoded as Base64 with @c chars, padded if @c pad.
+static int append_base64(struct string *str, size_t n, const char *s, const char *chars, bool pad)
+{
+    const unsigned char *in = (const unsigned char *)s;
+    size_t rem = n % 3;
+    size_t size;
+    char *out;
+    char *p;
+    size_t i;
+
+    if (!s) {
+        return -EFAULT;
+    }
+
+    if (n / 3 >= SIZE_MAX / 4) {
+        // Check for overflow.
+        return -ENOMEM;
+    }
+
+    size = n / 3 * 4 + ((rem == 0) ? 0 : pad ? 4 : rem + 1);
+    out = string_reserve_tail(str, size);
+    if (!out) {
+        return -errno;
+    }
+
+    p = out;
+    for (i = 0; i + 3 <= n; i += 3) {
+        uint32_t v = (uint32_t)in[i] << 16 | (uint32_t)in[i + 1] << 8 | in[i + 2];
+
+        p[0] = chars[v >> 18];
+        p[1] = chars[(v >> 12) & 0x3f];
+        p[2] = chars[(v >> 6) & 0x3f];
+        p[3] = chars[v & 0x3f];
+        p += 4;
+    }
+
+    if (rem > 0) {
+        uint32_t v = (uint32_t)in[i] << 16 | ((rem == 2) ? (uint32_t)in[i + 1] << 8 : 0);
+
+        p[0] = chars[v >> 18];
+        p[1] = chars[(v >> 12) & 0x3f];
+        if (rem == 2) {
+            p[2] = chars[(v >> 6) & 0x3f];
+        } else if (pad) {
+            p[2] = '=';
+        }
+        if (pad) {
+            p[3] = '=';
+        }
+    }
+
+    return string_commit(str, size);
+}
+
+/// Append bytes decoded from @c n Base64 characters at @c s, with digit values @c values.
+static int append_base64_decoded(struct string *str, size_t n, const char *s, const unsigned char *values)
+{
+    size_t rem;
+    size_t size;
+    char *p;
+    size_t i;
+
+    if (!s) {
+        return -EFAULT;
+    }
+
+    // Padding is optional.
+    if (n > 0 && n % 4 == 0 && s[n - 1] == '=') {
+        n -= (s[n - 2] == '=') ? 2 : 1;
+    }
+
+    rem = n % 4;
+    if (rem == 1) {
+        return -EILSEQ;
+    }
+
+    size = n / 4 * 3 + ((rem == 0) ? 0 : rem - 1);
+    p = string_reserve_tail(str, size);
+    if (!p) {
+        return -errno;
+    }
+
+    for (i = 0; i < n; i += 4) {
+        int a = base64_value(values, s[i]);
+        int b = base64_value(values, s[i + 1]);
+        int c = (i + 2 < n) ? base64_value(values, s[i + 2]) : 0;
+        int d = (i + 3 < n) ? base64_value(values, s[i + 3]) : 0;
+        uint32_t v;
+
+        if ((a | b | c | d) < 0) {
+            // Restore NUL terminator.
+            string_commit(str, 0);
+            return -EILSEQ;
+        }
+
+        v = (uint32_t)a << 18 | (uint32_t)b << 12 | (uint32_t)c << 6 | (uint32_t)d;
+        if (i + 4 <= n) {
+            p[0] = (char)(v >> 16);
+            p[1] = (char)(v >> 8);
+            p[2] = (char)v;
+            p += 3;
+        } else {
+            // A partial group only holds the bytes it has whole digits for.
+            p[0] = (char)(v >> 16);
+            if (rem == 3) {
+                p[1] = (char)(v >> 8);
+            }
+        }
+    }
+
+    return string_commit(str, size);
+}
+
+int string_append_base64(struct string *str, size_t n, const char *s)
+{
+    return append_base64(str, n, s, base64_chars, true);
+}
+
+int string_append_base64_decoded(struct string *str, size_t n, const char *s)
+{
+    return append_base64_decoded(str, n, s, base64_values);
+}
+
+int string_append_base64url(struct string *str, size_t n, const char *s)
+{
+    return append_base64(str, n, s, base64url_chars, false);
+}
+
+int string_append_base64url_decoded(struct string *str, size_t n, const char *s)
+{
+    return append_base64_decoded(str, n, s, base64url_values);
+}
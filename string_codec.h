@@ -0,0 +1,49 @@
+#ifndef LIBCSTRING_STRING_CODEC_H_
+#define LIBCSTRING_STRING_CODEC_H_
+
+/// Binary to text encodings.
+///
+/// Appends buffers encoded as, or decoded from, hexadecimal and Base64
+/// (RFC 4648), writing directly into the spare capacity of the string.
+///
+/// Buffers must not point into the string being appended to, as reserving space
+/// may move its storage.
+///
+/// Functions follow the return type conventions described in cstring.h.
+
+#include "cstring.h"
+
+/// Append @c n bytes from buffer @c s, encoded as lower case hexadecimal.
+/// @return Zero on success, negative errno otherwise.
+///   - EFAULT: NULL pointer argument.
+///   - ENOMEM: Insufficient memory.
+/// @note Memory ownership: Caller retains ownership of @c s.
+int string_append_hex(struct string *, size_t n, const char *s) PUBLIC;
+
+/// Append the bytes encoded as hexadecimal by the @c n characters in buffer @c s.
+/// Both upper and lower case digits are accepted.
+/// @return Zero on success, negative errno otherwise.
+///   - EFAULT: NULL pointer argument.
+///   - EILSEQ: Invalid character, or odd number of characters (nothing is appended).
+///   - ENOMEM: Insufficient memory.
+/// @note Memory ownership: Caller retains ownership of @c s.
+int string_append_hex_decoded(struct string *, size_t n, const char *s) PUBLIC;
+
+/// Append @c n bytes from buffer @c s, encoded as Base64 with padding.
+/// @see string_append_hex.
+int string_append_base64(struct string *, size_t n, const char *s) PUBLIC;
+
+/// Append the bytes encoded as Base64 by the @c n characters in buffer @c s.
+/// Padding is optional; whitespace is not accepted.
+/// @see string_append_hex_decoded.
+int string_append_base64_decoded(struct string *, size_t n, const char *s) PUBLIC;
+
+/// Append @c n bytes from buffer @c s, encoded as Base64 with the URL and filename safe alphabet, without padding.
+/// @see string_append_hex.
+int string_append_base64url(struct string *, size_t n, const char *s) PUBLIC;
+
+/// Append the bytes encoded as Base64 with the URL and filename safe alphabet by the @c n characters in buffer @c s.
+/// @see string_append_base64_decoded.
+int string_append_base64url_decoded(struct string *, size_t n, const char *s) PUBLIC;
+
+#endif // LIBCSTRING_STRING_CODEC_H_
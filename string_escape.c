@@ -0,0 +1,512 @@
+#include "string_escape.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define WORD_ONES UINT64_C(0x0101010101010101)
+#define WORD_HIGHS UINT64_C(0x8080808080808080)
+
+/// Characters with named escapes, each followed by the letter of its escape.
+#define JSON_ESCAPES "\"\"\\\\\bb\ff\nn\rr\tt"
+#define C_ESCAPES "\"\"\\\\''\aa\bb\ff\nn\rr\tt\vv"
+
+/// Maximum length of a character reference, from '&' to ';' inclusive.
+#define HTML_REF_MAX 12
+
+static const char hex_digits[] = "0123456789ABCDEF";
+
+/// Named character references, and the characters they stand for.
+static const struct {
+    const char *name;
+    char c;
+} html_names[] = {
+    { "amp", '&' },
+    { "lt", '<' },
+    { "gt", '>' },
+    { "quot", '"' },
+    { "apos", '\'' },
+};
+
+static uint64_t load_word(const char *s)
+{
+    uint64_t w;
+
+    memcpy(&w, s, sizeof(w));
+    return w;
+}
+
+/// @return Non-zero if any byte of @c w is less than @c c, which must be at most 0x80.
+static uint64_t word_has_less(uint64_t w, unsigned char c)
+{
+    return (w - WORD_ONES * c) & ~w & WORD_HIGHS;
+}
+
+/// @return Non-zero if any byte of @c w equals @c c.
+static uint64_t word_has(uint64_t w, unsigned char c)
+{
+    return word_has_less(w ^ (WORD_ONES * c), 1);
+}
+
+/// @return Pair in @c pairs whose character at @c i (0 for the character, 1 for its escape letter) is @c c, or NULL.
+static const char *find_pair(const char *pairs, size_t i, char c)
+{
+    for (; *pairs; pairs += 2) {
+        if (pairs[i] == c) {
+            return pairs;
+        }
+    }
+    return NULL;
+}
+
+/// @return Value of hexadecimal digit @c c, or -1 if not a digit.
+static int hex_value(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+
+    c |= 0x20;
+    return (c >= 'a' && c <= 'f') ? c - 'a' + 10 : -1;
+}
+
+/// @return Value of the @c n digits in @c base at @c s, or -1 if there are none or any is invalid.
+/// @pre @c n is at most 15 hexadecimal or 18 decimal digits, so that the value fits in int64_t (callers pass at most 8).
+static int64_t parse_number(const char *s, size_t n, int base)
+{
+    int64_t v = 0;
+
+    if (n == 0) {
+        return -1;
+    }
+
+    while (n-- > 0) {
+        int d = hex_value(*s++);
+
+        if (d < 0 || d >= base) {
+            return -1;
+        }
+        v = v * base + d;
+    }
+    return v;
+}
+
+/// Encode code point @c cp as UTF-8.
+/// @return Number of characters written.
+static size_t encode_utf8(char *p, uint32_t cp)
+{
+    if (cp < 0x80) {
+        p[0] = (char)cp;
+        return 1;
+    }
+
+    if (cp < 0x800) {
+        p[0] = (char)(0xc0 | (cp >> 6));
+        p[1] = (char)(0x80 | (cp & 0x3f));
+        return 2;
+    }
+
+    if (cp < 0x10000) {
+        p[0] = (char)(0xe0 | (cp >> 12));
+        p[1] = (char)(0x80 | ((cp >> 6) & 0x3f));
+        p[2] = (char)(0x80 | (cp & 0x3f));
+        return 3;
+    }
+
+    p[0] = (char)(0xf0 | (cp >> 18));
+    p[1] = (char)(0x80 | ((cp >> 12) & 0x3f));
+    p[2] = (char)(0x80 | ((cp >> 6) & 0x3f));
+    p[3] = (char)(0x80 | (cp & 0x3f));
+    return 4;
+}
+
+/// Append @c n characters from @c s, escaping each character for which @c special is true.
+/// @param worst Maximum number of characters written by @c escape.
+/// @param special_word Optional test for any special character in a word, to skip clean words quickly.
+/// @param escape Write escape of character, and return pointer past it.
+static int append_escaped(struct string *str, size_t n, const char *s, size_t worst,
+                          bool (*special)(unsigned char), uint64_t (*special_word)(uint64_t),
+                          char *(*escape)(char *, unsigned char))
+{
+    char *out;
+    char *p;
+    size_t i = 0;
+
+    if (!s) {
+        return -EFAULT;
+    }
+
+    if (n > SIZE_MAX / worst) {
+        // Check for overflow.
+        return -ENOMEM;
+    }
+
+    out = string_reserve_tail(str, n * worst);
+    if (!out) {
+        return -errno;
+    }
+
+    p = out;
+    while (i < n) {
+        size_t j = i;
+
+        // Find the end of the clean run, a word at a time and then a character at a time.
+        while (special_word && j + sizeof(uint64_t) <= n && special_word(load_word(&s[j])) == 0) {
+            j += sizeof(uint64_t);
+        }
+        while (j < n && !special((unsigned char)s[j])) {
+            j++;
+        }
+
+        memcpy(p, &s[i], j - i);
+        p += j - i;
+
+        if (j < n) {
+            p = escape(p, (unsigned char)s[j++]);
+        }
+        i = j;
+    }
+
+    return string_commit(str, (size_t)(p - out));
+}
+
+/// Append @c n characters from @c s, decoding escapes introduced by @c c.
+/// @param unescape Decode escape at @c s, of at most @c n characters, to @c out, and set @c used to its length.
+///   Return the number of characters written (at most @c used), or zero if the escape is invalid.
+static int append_unescaped(struct string *str, size_t n, const char *s, char c,
+                            size_t (*unescape)(const char *s, size_t n, char *out, size_t *used))
+{
+    const char *end;
+    const char *q;
+    char *out;
+    char *p;
+
+    if (!s) {
+        return -EFAULT;
+    }
+
+    // Unescaping never lengthens.
+    out = string_reserve_tail(str, n);
+    if (!out) {
+        return -errno;
+    }
+
+    p = out;
+    end = s + n;
+    while ((q = memchr(s, c, (size_t)(end - s))) != NULL) {
+        size_t used = 0;
+        size_t written;
+
+        memcpy(p, s, (size_t)(q - s));
+        p += q - s;
+
+        written = unescape(q, (size_t)(end - q), p, &used);
+        if (written == 0) {
+            // Restore NUL terminator.
+            string_commit(str, 0);
+            return -EILSEQ;
+        }
+
+        p += written;
+        s = q + used;
+    }
+
+    memcpy(p, s, (size_t)(end - s));
+    p += end - s;
+    return string_commit(str, (size_t)(p - out));
+}
+
+static bool json_special(unsigned char c)
+{
+    return c < 0x20 || c == '"' || c == '\\';
+}
+
+static uint64_t json_special_word(uint64_t w)
+{
+    return word_has_less(w, 0x20) | word_has(w, '"') | word_has(w, '\\');
+}
+
+static char *json_escape(char *p, unsigned char c)
+{
+    const char *pair = find_pair(JSON_ESCAPES, 0, (char)c);
+
+    if (pair) {
+        p[0] = '\\';
+        p[1] = pair[1];
+        return p + 2;
+    }
+
+    memcpy(p, "\\u00", 4);
+    p[4] = hex_digits[c >> 4];
+    p[5] = hex_digits[c & 0xf];
+    return p + 6;
+}
+
+static size_t json_unescape(const char *s, size_t n, char *out, size_t *used)
+{
+    const char *pair;
+    int64_t cp;
+    int64_t lo;
+
+    if (n < 2) {
+        return 0;
+    }
+
+    pair = find_pair(JSON_ESCAPES "//", 1, s[1]);
+    if (pair) {
+        *out = pair[0];
+        *used = 2;
+        return 1;
+    }
+
+    cp = (s[1] == 'u' && n >= 6) ? parse_number(&s[2], 4, 16) : -1;
+    if (cp < 0 || (cp >= 0xdc00 && cp <= 0xdfff)) {
+        return 0;
+    }
+
+    *used = 6;
+    if (cp >= 0xd800 && cp <= 0xdbff) {
+        // High surrogate must be followed by an escaped low surrogate.
+        lo = (n >= 12 && s[6] == '\\' && s[7] == 'u') ? parse_number(&s[8], 4, 16) : -1;
+        if (lo < 0xdc00 || lo > 0xdfff) {
+            return 0;
+        }
+
+        cp = 0x10000 + ((cp - 0xd800) << 10) + (lo - 0xdc00);
+        *used = 12;
+    }
+
+    return encode_utf8(out, (uint32_t)cp);
+}
+
+int string_append_json_escaped(struct string *str, size_t n, const char *s)
+{
+    return append_escaped(str, n, s, 6, json_special, json_special_word, json_escape);
+}
+
+int string_append_json_unescaped(struct string *str, size_t n, const char *s)
+{
+    return append_unescaped(str, n, s, '\\', json_unescape);
+}
+
+static bool url_special(unsigned char c)
+{
+    unsigned char lower = c | 0x20;
+
+    return !(lower >= 'a' && lower <= 'z') && !(c >= '0' && c <= '9') && c != '-' && c != '.' && c != '_' && c != '~';
+}
+
+static char *url_escape(char *p, unsigned char c)
+{
+    p[0] = '%';
+    p[1] = hex_digits[c >> 4];
+    p[2] = hex_digits[c & 0xf];
+    return p + 3;
+}
+
+static size_t url_unescape(const char *s, size_t n, char *out, size_t *used)
+{
+    int64_t v = (n >= 3) ? parse_number(&s[1], 2, 16) : -1;
+
+    if (v < 0) {
+        return 0;
+    }
+
+    *out = (char)v;
+    *used = 3;
+    return 1;
+}
+
+int string_append_url_encoded(struct string *str, size_t n, const char *s)
+{
+    // Most characters are special, so clean runs are short; no word test.
+    return append_escaped(str, n, s, 3, url_special, NULL, url_escape);
+}
+
+int string_append_url_decoded(struct string *str, size_t n, const char *s)
+{
+    return append_unescaped(str, n, s, '%', url_unescape);
+}
+
+static bool html_special(unsigned char c)
+{
+    return c == '&' || c == '<' || c == '>' || c == '"' || c == '\'';
+}
+
+static uint64_t html_special_word(uint64_t w)
+{
+    return word_has(w, '&') | word_has(w, '<') | word_has(w, '>') | word_has(w, '"') | word_has(w, '\'');
+}
+
+static char *html_escape(char *p, unsigned char c)
+{
+    const char *ref;
+    size_t n;
+
+    switch (c) {
+    case '&':
+        ref = "&amp;";
+        break;
+    case '<':
+        ref = "&lt;";
+        break;
+    case '>':
+        ref = "&gt;";
+        break;
+    case '"':
+        ref = "&quot;";
+        break;
+    default:
+        // "&apos;" is not defined by HTML 4.
+        ref = "&#39;";
+        break;
+    }
+
+    n = strlen(ref);
+    memcpy(p, ref, n);
+    return p + n;
+}
+
+/// Decode character reference at @c s, of at most @c n characters, to @c out, and set @c used to its length.
+/// @return Number of characters written, or zero if it is not a reference that is recognized.
+static size_t html_reference(const char *s, size_t n, char *out, size_t *used)
+{
+    const char *semi = memchr(s, ';', (n < HTML_REF_MAX) ? n : HTML_REF_MAX);
+    const char *name = s + 1;
+    size_t len;
+    int64_t cp;
+    size_t i;
+
+    if (!semi) {
+        return 0;
+    }
+
+    len = (size_t)(semi - name);
+    *used = len + 2;
+
+    for (i = 0; i < sizeof(html_names) / sizeof(html_names[0]); ++i) {
+        if (strlen(html_names[i].name) == len && memcmp(html_names[i].name, name, len) == 0) {
+            *out = html_names[i].c;
+            return 1;
+        }
+    }
+
+    if (len < 2 || name[0] != '#') {
+        return 0;
+    }
+
+    if (name[1] == 'x' || name[1] == 'X') {
+        cp = parse_number(&name[2], len - 2, 16);
+    } else {
+        cp = parse_number(&name[1], len - 1, 10);
+    }
+
+    if (cp <= 0 || cp > 0x10ffff || (cp >= 0xd800 && cp <= 0xdfff)) {
+        return 0;
+    }
+
+    return encode_utf8(out, (uint32_t)cp);
+}
+
+static size_t html_unescape(const char *s, size_t n, char *out, size_t *used)
+{
+    size_t written = html_reference(s, n, out, used);
+
+    if (written == 0) {
+        // Keep a '&' that begins no reference, as HTML parsers do.
+        *out = '&';
+        *used = 1;
+        return 1;
+    }
+
+    return written;
+}
+
+int string_append_html_escaped(struct string *str, size_t n, const char *s)
+{
+    return append_escaped(str, n, s, 6, html_special, html_special_word, html_escape);
+}
+
+int string_append_html_unescaped(struct string *str, size_t n, const char *s)
+{
+    return append_unescaped(str, n, s, '&', html_unescape);
+}
+
+static bool c_special(unsigned char c)
+{
+    return c < 0x20 || c >= 0x7f || c == '"' || c == '\\' || c == '\'';
+}
+
+static uint64_t c_special_word(uint64_t w)
+{
+    return word_has_less(w, 0x20) | (w & WORD_HIGHS) | word_has(w, 0x7f) | word_has(w, '"') | word_has(w, '\\') | word_has(w, '\'');
+}
+
+static char *c_escape(char *p, unsigned char c)
+{
+    const char *pair = find_pair(C_ESCAPES, 0, (char)c);
+
+    if (pair) {
+        p[0] = '\\';
+        p[1] = pair[1];
+        return p + 2;
+    }
+
+    // Three octal digits, so that a following digit is not taken as part of the escape.
+    p[0] = '\\';
+    p[1] = (char)('0' + (c >> 6));
+    p[2] = (char)('0' + ((c >> 3) & 7));
+    p[3] = (char)('0' + (c & 7));
+    return p + 4;
+}
+
+static size_t c_unescape(const char *s, size_t n, char *out, size_t *used)
+{
+    const char *pair;
+    int64_t v;
+    size_t i;
+
+    if (n < 2) {
+        return 0;
+    }
+
+    pair = find_pair(C_ESCAPES "??", 1, s[1]);
+    if (pair) {
+        *out = pair[0];
+        *used = 2;
+        return 1;
+    }
+
+    if (s[1] == 'x') {
+        i = 2;
+        while (i < n && i < 4 && hex_value(s[i]) >= 0) {
+            i++;
+        }
+        v = parse_number(&s[2], i - 2, 16);
+    } else {
+        i = 1;
+        while (i < n && i < 4 && s[i] >= '0' && s[i] <= '7') {
+            i++;
+        }
+        v = parse_number(&s[1], i - 1, 8);
+    }
+
+    if (v < 0 || v > 0xff) {
+        return 0;
+    }
+
+    *out = (char)v;
+    *used = i;
+    return 1;
+}
+
+int string_append_c_escaped(struct string *str, size_t n, const char *s)
+{
+    return append_escaped(str, n, s, 4, c_special, c_special_word, c_escape);
+}
+
+int string_append_c_unescaped(struct string *str, size_t n, const char *s)
+{
+    return append_unescaped(str, n, s, '\\', c_unescape);
+}
@@ -0,0 +1,70 @@
+#ifndef LIBCSTRING_STRING_ESCAPE_H_
+#define LIBCSTRING_STRING_ESCAPE_H_
+
+/// String escaping.
+///
+/// Appends buffers escaped or unescaped for JSON, URL, HTML and C.
+///
+/// Each function reserves the worst-case space once with string_reserve_tail(),
+/// writes directly into it, and commits the result with string_commit().
+/// Runs of characters that need no escaping are found a word (or, through
+/// memchr(), a vector) at a time and copied in bulk.
+///
+/// Buffers must not point into the string being appended to, as reserving space
+/// may move its storage.
+///
+/// Functions follow the return type conventions described in cstring.h.
+
+#include "cstring.h"
+
+/// Append @c n characters from buffer @c s, escaped as the content of a JSON string.
+/// Quotation mark, reverse solidus and control characters are escaped; other characters, including UTF-8
+/// sequences, are copied.
+/// @return Zero on success, negative errno otherwise.
+///   - EFAULT: NULL pointer argument.
+///   - ENOMEM: Insufficient memory.
+/// @note Memory ownership: Caller retains ownership of @c s.
+int string_append_json_escaped(struct string *, size_t n, const char *s) PUBLIC;
+
+/// Append @c n characters from buffer @c s, unescaped from the content of a JSON string.
+/// Escaped code points are encoded as UTF-8.
+/// @return Zero on success, negative errno otherwise.
+///   - EFAULT: NULL pointer argument.
+///   - EILSEQ: Invalid escape sequence, or unpaired surrogate (nothing is appended).
+///   - ENOMEM: Insufficient memory.
+/// @note Memory ownership: Caller retains ownership of @c s.
+int string_append_json_unescaped(struct string *, size_t n, const char *s) PUBLIC;
+
+/// Append @c n characters from buffer @c s, percent-encoded as a URL component.
+/// All characters except the unreserved characters of RFC 3986 (letters, digits, '-', '.', '_' and '~') are encoded.
+/// @see string_append_json_escaped.
+int string_append_url_encoded(struct string *, size_t n, const char *s) PUBLIC;
+
+/// Append @c n characters from buffer @c s, with percent-encoding decoded.
+/// A '+' is not decoded, as it only means space in form data.
+/// @see string_append_json_unescaped.
+int string_append_url_decoded(struct string *, size_t n, const char *s) PUBLIC;
+
+/// Append @c n characters from buffer @c s, escaped for HTML text or attribute values.
+/// The characters '&', '<', '>', '"' and '\'' are replaced by character references.
+/// @see string_append_json_escaped.
+int string_append_html_escaped(struct string *, size_t n, const char *s) PUBLIC;
+
+/// Append @c n characters from buffer @c s, with character references decoded.
+/// The named references produced by string_append_html_escaped(), "&apos;", and numeric references are decoded;
+/// code points are encoded as UTF-8. A '&' that does not begin such a reference (as in "AT&T", "&nbsp;" or "&#0;")
+/// is kept, as HTML parsers do, so that decoding never fails with EILSEQ.
+/// @see string_append_json_unescaped.
+int string_append_html_unescaped(struct string *, size_t n, const char *s) PUBLIC;
+
+/// Append @c n characters from buffer @c s, escaped as the content of a C string literal.
+/// Characters other than printable ASCII are escaped, using octal escapes where there is no named escape.
+/// @see string_append_json_escaped.
+int string_append_c_escaped(struct string *, size_t n, const char *s) PUBLIC;
+
+/// Append @c n characters from buffer @c s, unescaped from the content of a C string literal.
+/// Octal escapes have one to three digits, and hexadecimal escapes one or two digits.
+/// @see string_append_json_unescaped.
+int string_append_c_unescaped(struct string *, size_t n, const char *s) PUBLIC;
+
+#endif // LIBCSTRING_STRING_ESCAPE_H_
@@ -0,0 +1,170 @@
+#include "string_frozen.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+/// Strings shorter than this are copied into the frozen object.
+/// Longer strings necessarily use allocated storage, whose buffer is taken over.
+#define INLINE_SIZE 64
+
+struct string_frozen {
+    /// Number of references.
+    size_t refs;
+    /// Number of characters (excluding NUL terminator).
+    size_t len;
+    /// Characters (NUL terminated): either taken over from a string, or @c chars.
+    char *buf;
+    /// Storage for short strings.
+    char chars[];
+};
+
+/// @return True if frozen string @c f holds a buffer taken over from a string.
+static bool owns_buffer(const struct string_frozen *f)
+{
+    return f->buf != f->chars;
+}
+
+/// Delete frozen string @c f, and the buffer it owns.
+static void destroy(struct string_frozen *f)
+{
+    if (owns_buffer(f)) {
+        free(f->buf);
+    }
+    free(f);
+}
+
+struct string_frozen *string_freeze(struct string *str)
+{
+    struct string_frozen *f = NULL;
+    size_t len;
+
+    if (!str) {
+        errno = EFAULT;
+        return NULL;
+    }
+
+    len = string_size(str);
+    f = malloc(sizeof(struct string_frozen) + ((len < INLINE_SIZE) ? len + 1 : 0));
+    if (!f) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    f->refs = 1;
+    f->len = len;
+    if (len < INLINE_SIZE) {
+        // Fails only if compressed content cannot be expanded.
+        const char *chars = string_c_str(str);
+
+        if (!chars) {
+            free(f);
+            errno = ENOMEM;
+            return NULL;
+        }
+
+        memcpy(f->chars, chars, len + 1);
+        f->buf = f->chars;
+        string_clear(str);
+    } else {
+        // Fails only if compressed content cannot be expanded, leaving str unchanged.
+        f->buf = string_c_str_move(str);
+        if (!f->buf) {
+            free(f);
+            errno = ENOMEM;
+            return NULL;
+        }
+    }
+
+    return f;
+}
+
+struct string_frozen *string_frozen_retain(struct string_frozen *f)
+{
+    if (!f) {
+        errno = EFAULT;
+        return NULL;
+    }
+
+    __atomic_fetch_add(&f->refs, 1, __ATOMIC_RELAXED);
+    return f;
+}
+
+void string_frozen_release(struct string_frozen *f)
+{
+    if (!f) {
+        return;
+    }
+
+    // Acquire the other threads' reads of the content before deleting it.
+    if (__atomic_fetch_sub(&f->refs, 1, __ATOMIC_ACQ_REL) == 1) {
+        destroy(f);
+    }
+}
+
+size_t string_frozen_size(const struct string_frozen *f)
+{
+    if (!f) {
+        return 0;
+    }
+
+    return f->len;
+}
+
+const char *string_frozen_c_str(const struct string_frozen *f)
+{
+    if (!f) {
+        errno = EFAULT;
+        return NULL;
+    }
+
+    return f->buf;
+}
+
+struct string_view string_frozen_view(const struct string_frozen *f)
+{
+    struct string_view view = { NULL, 0 };
+
+    if (!f) {
+        return view;
+    }
+
+    view.buf = f->buf;
+    view.len = f->len;
+    return view;
+}
+
+struct string *string_thaw(struct string_frozen *f)
+{
+    struct string *str = NULL;
+
+    if (!f) {
+        errno = EFAULT;
+        return NULL;
+    }
+
+    // With the last reference, no other thread can retain the object, so its buffer may be taken over.
+    if (owns_buffer(f) && __atomic_load_n(&f->refs, __ATOMIC_ACQUIRE) == 1) {
+        str = string_new_adopt(f->buf, f->len, f->len);
+        if (!str) {
+            return NULL;
+        }
+
+        free(f);
+        return str;
+    }
+
+    str = string_new();
+    if (!str) {
+        return NULL;
+    }
+
+    if (string_append_buffer(str, f->len, f->buf) != 0) {
+        string_delete(str);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    string_frozen_release(f);
+    return str;
+}
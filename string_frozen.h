@@ -0,0 +1,69 @@
+#ifndef LIBCSTRING_STRING_FROZEN_H_
+#define LIBCSTRING_STRING_FROZEN_H_
+
+/// Frozen strings.
+///
+/// Immutable, reference counted snapshots of string content, that any number of
+/// threads may read, retain and release concurrently without locks.
+///
+/// Freezing moves the content out of a string: long strings hand over their
+/// buffer without copying, and short strings are copied into the frozen object
+/// so that it takes a single allocation. Thawing the last reference moves the
+/// buffer back into a new string; otherwise the content is copied.
+///
+/// Functions follow the return type conventions described in cstring.h.
+
+#include "cstring.h"
+
+/// Frozen string object.
+///
+/// Unlike other objects in this library, frozen strings are thread-safe: their content never changes, and the
+/// reference count is updated atomically.
+struct string_frozen;
+
+/// Constructor.
+/// Move the content of @c str into a new frozen string holding one reference, leaving @c str valid but empty.
+/// @return Pointer to frozen string on success.
+/// @return NULL on failure (@c str is unchanged), and errno is set to:
+///   - EFAULT: NULL pointer argument.
+///   - ENOMEM: Insufficient memory.
+/// @note Memory ownership: Caller must string_frozen_release() or string_thaw() the returned pointer.
+struct string_frozen *string_freeze(struct string *str) PUBLIC;
+
+/// Add a reference.
+/// @return The frozen string on success.
+/// @return NULL on failure, and errno is set to:
+///   - EFAULT: NULL pointer argument.
+/// @note Memory ownership: Caller must string_frozen_release() or string_thaw() the returned pointer.
+struct string_frozen *string_frozen_retain(struct string_frozen *) PUBLIC;
+
+/// Drop a reference; the frozen string is deleted with its last reference.
+void string_frozen_release(struct string_frozen *) PUBLIC;
+
+/// Get number of characters.
+/// @return The number of characters, or zero if NULL.
+size_t string_frozen_size(const struct string_frozen *) PUBLIC;
+
+/// Get C string.
+/// @return Pointer to string on success.
+/// @return NULL on failure, and errno is set to:
+///   - EFAULT: NULL pointer argument.
+/// @note Memory ownership: Owned by the object; valid while a reference is held.
+const char *string_frozen_c_str(const struct string_frozen *) PUBLIC;
+
+/// Get view of content.
+/// @return View of the characters, or an empty view with NULL @c buf if NULL.
+/// @note Memory ownership: Owned by the object; valid while a reference is held.
+struct string_view string_frozen_view(const struct string_frozen *) PUBLIC;
+
+/// Destructor.
+/// Drop a reference, and create a new mutable string with the content.
+/// The buffer is moved into the string, without copying, if this was the last reference to a long string.
+/// @return Pointer to string on success.
+/// @return NULL on failure (the reference is kept), and errno is set to:
+///   - EFAULT: NULL pointer argument.
+///   - ENOMEM: Insufficient memory.
+/// @note Memory ownership: Caller must string_delete() the returned pointer.
+struct string *string_thaw(struct string_frozen *) PUBLIC;
+
+#endif // LIBCSTRING_STRING_FROZEN_H_
@@ -0,0 +1,431 @@
+#include "string_map.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/// Number of slots in a probe group, matched a word at a time.
+#define GROUP_SIZE 8
+
+/// Keys up to this length are stored inline in the slot.
+#define INLINE_KEY_SIZE 16
+
+/// Control byte of an empty slot; full slots hold seven bits of the key's hash, so the high bit is clear.
+#define CTRL_EMPTY 0x80
+/// Control byte of an erased slot, which must not stop a probe sequence.
+#define CTRL_DELETED 0xfe
+
+#define GROUP_LSBS UINT64_C(0x0101010101010101)
+#define GROUP_MSBS UINT64_C(0x8080808080808080)
+
+/// Slot index returned when a key is not found.
+#define NOT_FOUND SIZE_MAX
+
+struct slot {
+    /// Hash of key, kept to avoid rehashing keys on resize.
+    uint64_t hash;
+    /// Number of characters in key.
+    size_t len;
+    /// Characters of key: inline if at most INLINE_KEY_SIZE, allocated otherwise.
+    union {
+        char buf[INLINE_KEY_SIZE];
+        char *ptr;
+    } key;
+    /// Value.
+    void *value;
+};
+
+struct string_map {
+    /// Control bytes, one per slot.
+    unsigned char *ctrl;
+    /// Slots.
+    struct slot *slots;
+    /// Number of slots: zero, or a power of two that is at least GROUP_SIZE.
+    size_t cap;
+    /// Number of entries.
+    size_t size;
+    /// Number of empty slots that may be filled before rehashing.
+    size_t growth_left;
+};
+
+/// @return Maximum number of entries for @c cap slots (load factor 7/8).
+static size_t max_load(size_t cap)
+{
+    return cap - cap / 8;
+}
+
+/// @return Control bytes of group at @c ctrl, as a little-endian word.
+static uint64_t load_group(const unsigned char *ctrl)
+{
+    uint64_t w = 0;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    memcpy(&w, ctrl, sizeof(w));
+#else
+    size_t i;
+
+    for (i = GROUP_SIZE; i-- > 0;) {
+        w = (w << 8) | ctrl[i];
+    }
+#endif
+    return w;
+}
+
+/// @return Mask with the high bit set in each byte of @c group that may equal @c h2.
+/// @note False positives are possible, and are rejected by comparing keys.
+static uint64_t match_hash(uint64_t group, unsigned char h2)
+{
+    uint64_t x = group ^ (GROUP_LSBS * h2);
+
+    return (x - GROUP_LSBS) & ~x & GROUP_MSBS;
+}
+
+/// @return Mask with the high bit set in each empty byte of @c group.
+static uint64_t match_empty(uint64_t group)
+{
+    return group & (~group << 1) & GROUP_MSBS;
+}
+
+/// @return Mask with the high bit set in each empty or deleted byte of @c group.
+static uint64_t match_free(uint64_t group)
+{
+    return group & GROUP_MSBS;
+}
+
+/// @return Index of lowest byte set in non-zero @c mask.
+static size_t lowest_byte(uint64_t mask)
+{
+#if defined(__GNUC__)
+    return (size_t)__builtin_ctzll(mask) / 8;
+#else
+    size_t i = 0;
+
+    while (!(mask & 0x80)) {
+        mask >>= 8;
+        i++;
+    }
+    return i;
+#endif
+}
+
+static const char *slot_key(const struct slot *slot)
+{
+    return (slot->len <= INLINE_KEY_SIZE) ? slot->key.buf : slot->key.ptr;
+}
+
+static void free_slot(struct slot *slot)
+{
+    if (slot->len > INLINE_KEY_SIZE) {
+        free(slot->key.ptr);
+    }
+}
+
+/// Find slot of key.
+/// @return Index of slot, or NOT_FOUND.
+static size_t find_slot(const struct string_map *map, uint64_t hash, size_t n, const char *key)
+{
+    size_t mask;
+    size_t group;
+    size_t step;
+
+    // Precondition.
+    assert(map);
+
+    if (map->cap == 0) {
+        return NOT_FOUND;
+    }
+
+    mask = map->cap / GROUP_SIZE - 1;
+    group = (size_t)(hash >> 7) & mask;
+    for (step = 1;; ++step) {
+        uint64_t ctrl = load_group(&map->ctrl[group * GROUP_SIZE]);
+        uint64_t m;
+
+        for (m = match_hash(ctrl, hash & 0x7f); m != 0; m &= m - 1) {
+            size_t i = group * GROUP_SIZE + lowest_byte(m);
+            const struct slot *slot = &map->slots[i];
+
+            if (slot->hash == hash && slot->len == n && memcmp(slot_key(slot), key, n) == 0) {
+                return i;
+            }
+        }
+
+        if (match_empty(ctrl) != 0) {
+            return NOT_FOUND;
+        }
+
+        // Triangular probing visits every group, as the number of groups is a power of two.
+        group = (group + step) & mask;
+    }
+}
+
+/// Find slot to insert key with @c hash.
+/// @pre At least one slot is free.
+/// @return Index of first empty or deleted slot in probe sequence.
+static size_t find_free(const unsigned char *ctrl, size_t cap, uint64_t hash)
+{
+    size_t mask = cap / GROUP_SIZE - 1;
+    size_t group = (size_t)(hash >> 7) & mask;
+    size_t step;
+    uint64_t m;
+
+    for (step = 1; (m = match_free(load_group(&ctrl[group * GROUP_SIZE]))) == 0; ++step) {
+        group = (group + step) & mask;
+    }
+
+    return group * GROUP_SIZE + lowest_byte(m);
+}
+
+/// Move entries to new storage of @c cap slots, dropping deleted slots.
+/// @return Zero on success, negative errno otherwise.
+static int resize(struct string_map *map, size_t cap)
+{
+    unsigned char *ctrl;
+    struct slot *slots;
+    size_t i;
+
+    // Precondition.
+    assert(map);
+    assert(cap >= GROUP_SIZE);
+    assert(max_load(cap) >= map->size);
+
+    slots = calloc(cap, sizeof(struct slot));
+    if (!slots) {
+        return -ENOMEM;
+    }
+
+    ctrl = malloc(cap);
+    if (!ctrl) {
+        free(slots);
+        return -ENOMEM;
+    }
+    memset(ctrl, CTRL_EMPTY, cap);
+
+    for (i = 0; i < map->cap; ++i) {
+        if (!(map->ctrl[i] & 0x80)) {
+            size_t j = find_free(ctrl, cap, map->slots[i].hash);
+
+            ctrl[j] = map->ctrl[i];
+            slots[j] = map->slots[i];
+        }
+    }
+
+    free(map->ctrl);
+    free(map->slots);
+    map->ctrl = ctrl;
+    map->slots = slots;
+    map->cap = cap;
+    map->growth_left = max_load(cap) - map->size;
+    return 0;
+}
+
+struct string_map *string_map_new(void)
+{
+    struct string_map *map = NULL;
+
+    map = calloc(1, sizeof(struct string_map));
+    if (!map) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    return map;
+}
+
+void string_map_delete(struct string_map *map)
+{
+    if (!map) {
+        return;
+    }
+
+    string_map_clear(map);
+    free(map->ctrl);
+    free(map->slots);
+    free(map);
+}
+
+size_t string_map_size(const struct string_map *map)
+{
+    if (!map) {
+        return 0;
+    }
+
+    return map->size;
+}
+
+void string_map_clear(struct string_map *map)
+{
+    size_t i;
+
+    if (!map) {
+        return;
+    }
+
+    for (i = 0; i < map->cap; ++i) {
+        if (!(map->ctrl[i] & 0x80)) {
+            free_slot(&map->slots[i]);
+        }
+    }
+
+    if (map->cap > 0) {
+        memset(map->ctrl, CTRL_EMPTY, map->cap);
+    }
+    map->size = 0;
+    map->growth_left = max_load(map->cap);
+}
+
+int string_map_reserve(struct string_map *map, size_t n)
+{
+    size_t cap = GROUP_SIZE;
+
+    if (!map) {
+        return -EFAULT;
+    }
+
+    if (n > SIZE_MAX / 2 / sizeof(struct slot)) {
+        return -ENOMEM;
+    }
+
+    while (max_load(cap) < n) {
+        cap *= 2;
+    }
+
+    if (cap <= map->cap) {
+        return 0;
+    }
+
+    return resize(map, cap);
+}
+
+int string_map_insert(struct string_map *map, size_t n, const char *key, void *value)
+{
+    struct slot *slot;
+    uint64_t hash;
+    char *dst;
+    size_t i;
+    int r;
+
+    if (!map) {
+        return -EFAULT;
+    }
+
+    if (!key) {
+        return -EFAULT;
+    }
+
+    hash = string_hash_buffer(n, key);
+    i = find_slot(map, hash, n, key);
+    if (i != NOT_FOUND) {
+        map->slots[i].value = value;
+        return 0;
+    }
+
+    if (map->growth_left == 0) {
+        // Grow, unless most of the used slots are deleted and rehashing in place reclaims them.
+        r = resize(map, (map->cap == 0) ? GROUP_SIZE : (map->size >= max_load(map->cap) / 2) ? map->cap * 2 : map->cap);
+        if (r < 0) {
+            return r;
+        }
+    }
+
+    i = find_free(map->ctrl, map->cap, hash);
+    slot = &map->slots[i];
+    dst = slot->key.buf;
+    if (n > INLINE_KEY_SIZE) {
+        dst = malloc(n);
+        if (!dst) {
+            return -ENOMEM;
+        }
+        slot->key.ptr = dst;
+    }
+
+    memcpy(dst, key, n);
+    slot->hash = hash;
+    slot->len = n;
+    slot->value = value;
+
+    if (map->ctrl[i] == CTRL_EMPTY) {
+        map->growth_left--;
+    }
+    map->ctrl[i] = (unsigned char)(hash & 0x7f);
+    map->size++;
+    return 0;
+}
+
+int string_map_find(const struct string_map *map, size_t n, const char *key, void **value)
+{
+    size_t i;
+
+    if (!map) {
+        return -EFAULT;
+    }
+
+    if (!key) {
+        return -EFAULT;
+    }
+
+    i = find_slot(map, string_hash_buffer(n, key), n, key);
+    if (i == NOT_FOUND) {
+        return -ENOENT;
+    }
+
+    if (value) {
+        *value = map->slots[i].value;
+    }
+    return 0;
+}
+
+int string_map_erase(struct string_map *map, size_t n, const char *key)
+{
+    size_t i;
+
+    if (!map) {
+        return -EFAULT;
+    }
+
+    if (!key) {
+        return -EFAULT;
+    }
+
+    i = find_slot(map, string_hash_buffer(n, key), n, key);
+    if (i == NOT_FOUND) {
+        return -ENOENT;
+    }
+
+    free_slot(&map->slots[i]);
+    map->size--;
+
+    // A probe sequence ends at a group with an empty slot, so the slot may be emptied if its group already has one.
+    if (match_empty(load_group(&map->ctrl[i - i % GROUP_SIZE])) != 0) {
+        map->ctrl[i] = CTRL_EMPTY;
+        map->growth_left++;
+    } else {
+        map->ctrl[i] = CTRL_DELETED;
+    }
+    return 0;
+}
+
+int string_map_foreach(const struct string_map *map, void (*fn)(void *ctx, struct string_view key, void *value), void *ctx)
+{
+    size_t i;
+
+    if (!map) {
+        return -EFAULT;
+    }
+
+    if (!fn) {
+        return -EFAULT;
+    }
+
+    for (i = 0; i < map->cap; ++i) {
+        if (!(map->ctrl[i] & 0x80)) {
+            struct string_view key;
+
+            key.buf = slot_key(&map->slots[i]);
+            key.len = map->slots[i].len;
+            fn(ctx, key, map->slots[i].value);
+        }
+    }
+    return 0;
+}
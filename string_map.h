@@ -0,0 +1,83 @@
+#ifndef LIBCSTRING_STRING_MAP_H_
+#define LIBCSTRING_STRING_MAP_H_
+
+/// String map.
+///
+/// Hash map from string keys to pointer values, using open addressing.
+///
+/// Slots are probed in groups of eight, with one control byte per slot holding
+/// seven bits of the key's hash, so that a whole group is matched a word at a
+/// time and keys are only compared when their hash bits match.
+/// Short keys are stored inline in the slot, avoiding a pointer dereference.
+///
+/// Keys are looked up by buffer and length, so no string object needs to be
+/// constructed; use string_as_view() to look up by the content of a string.
+///
+/// Functions follow the return type conventions described in cstring.h.
+
+#include "cstring.h"
+
+/// String map object.
+///
+/// Keys may contain any characters, including NUL.
+///
+/// This library is **not** thread-safe.
+/// Caller must synchronize access to map objects.
+/// Multiple readers are safe if no writers are active.
+struct string_map;
+
+/// Constructor.
+/// Create a new empty map.
+/// @return Pointer to map on success.
+/// @return NULL on failure, and errno is set to:
+///   - ENOMEM: Insufficient memory.
+/// @note Memory ownership: Caller must string_map_delete() the returned pointer.
+struct string_map *string_map_new(void) PUBLIC;
+
+/// Destructor.
+/// @note Memory ownership: Object takes ownership of the pointer, but not of the values.
+void string_map_delete(struct string_map *) PUBLIC;
+
+/// Get number of entries.
+/// @return The number of entries in the map, or zero if empty or NULL.
+size_t string_map_size(const struct string_map *) PUBLIC;
+
+/// Erases all entries from the map.
+/// Storage is kept for reuse.
+void string_map_clear(struct string_map *) PUBLIC;
+
+/// Reserves storage for @c n entries, so that inserting them does not rehash.
+/// @note Silently ignores reserving less storage than currently used.
+/// @return Zero on success, negative errno otherwise.
+///   - EFAULT: NULL pointer argument.
+///   - ENOMEM: Insufficient memory.
+int string_map_reserve(struct string_map *, size_t n) PUBLIC;
+
+/// Insert entry with the key of @c n characters from buffer @c key, or replace the value of an existing entry.
+/// @return Zero on success, negative errno otherwise.
+///   - EFAULT: NULL pointer argument.
+///   - ENOMEM: Insufficient memory.
+/// @note Memory ownership: The key is copied; caller retains ownership of @c key and @c value.
+int string_map_insert(struct string_map *, size_t n, const char *key, void *value) PUBLIC;
+
+/// Find entry with the key of @c n characters from buffer @c key.
+/// @param value Set to the value of the entry, if found and not NULL.
+/// @return Zero on success, negative errno otherwise.
+///   - EFAULT: NULL pointer argument.
+///   - ENOENT: No such entry.
+int string_map_find(const struct string_map *, size_t n, const char *key, void **value) PUBLIC;
+
+/// Erase entry with the key of @c n characters from buffer @c key.
+/// @return Zero on success, negative errno otherwise.
+///   - EFAULT: NULL pointer argument.
+///   - ENOENT: No such entry.
+int string_map_erase(struct string_map *, size_t n, const char *key) PUBLIC;
+
+/// Call @c fn for each entry, in unspecified order.
+/// The map must not be modified by @c fn.
+/// @return Zero on success, negative errno otherwise.
+///   - EFAULT: NULL pointer argument.
+/// @note Memory ownership: The key view is owned by the object; valid until object modified or deleted.
+int string_map_foreach(const struct string_map *, void (*fn)(void *ctx, struct string_view key, void *value), void *ctx) PUBLIC;
+
+#endif // LIBCSTRING_STRING_MAP_H_
@@ -0,0 +1,312 @@
+#include "string_matcher.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/// Compiled pattern.
+struct pattern {
+    /// Number of characters.
+    size_t len;
+    /// One plus id of next identical pattern, or zero.
+    uint32_t next;
+};
+
+struct string_matcher {
+    /// Class of each character; class zero holds the characters that occur in no pattern.
+    uint16_t classes[256];
+    /// Number of classes.
+    size_t nclasses;
+    /// Only character that begins a pattern, or -1 if there are several.
+    int start;
+    /// Set of characters that begin a pattern, one bit per character.
+    uint64_t starts[4];
+    /// Transitions, indexed by state * nclasses + class; state zero is the root.
+    uint32_t *next;
+    /// One plus id of first pattern ending at state, or zero.
+    uint32_t *match;
+    /// State itself if it ends a pattern, otherwise the longest proper suffix state that does, or zero if none does.
+    uint32_t *out;
+    /// Value of @c out for the longest proper suffix state of state.
+    uint32_t *dict;
+    struct pattern *patterns;
+};
+
+/// @return Character @c c, with ASCII letters folded to lower case if @c icase.
+static unsigned char fold(unsigned char c, bool icase)
+{
+    return (icase && c >= 'A' && c <= 'Z') ? (unsigned char)(c - 'A' + 'a') : c;
+}
+
+/// Assign a class to each character that occurs in a pattern.
+static void build_classes(struct string_matcher *m, const struct string_view *patterns, size_t n, bool icase)
+{
+    size_t i;
+    size_t j;
+
+    for (i = 0; i < n; ++i) {
+        for (j = 0; j < patterns[i].len; ++j) {
+            m->classes[fold((unsigned char)patterns[i].buf[j], icase)] = 1;
+        }
+    }
+
+    m->nclasses = 1;
+    for (i = 0; i < 256; ++i) {
+        if (m->classes[i]) {
+            m->classes[i] = (uint16_t)m->nclasses++;
+        }
+    }
+
+    if (icase) {
+        for (i = 'A'; i <= 'Z'; ++i) {
+            m->classes[i] = m->classes[i - 'A' + 'a'];
+        }
+    }
+}
+
+/// Build trie of patterns.
+static void build_trie(struct string_matcher *m, const struct string_view *patterns, size_t n)
+{
+    uint32_t count = 1;
+    size_t i;
+    size_t j;
+
+    // In reverse, so that identical patterns are chained in order of id.
+    for (i = n; i-- > 0;) {
+        uint32_t s = 0;
+
+        for (j = 0; j < patterns[i].len; ++j) {
+            uint32_t *t = &m->next[s * m->nclasses + m->classes[(unsigned char)patterns[i].buf[j]]];
+
+            if (*t == 0) {
+                *t = count++;
+            }
+            s = *t;
+        }
+
+        m->patterns[i].len = patterns[i].len;
+        m->patterns[i].next = m->match[s];
+        m->match[s] = (uint32_t)i + 1;
+    }
+}
+
+/// Compute failure links breadth first, and replace missing transitions by those of the failure state.
+/// @param fail Temporary space for a failure link per state.
+/// @param queue Temporary space for a queue of states.
+static void build_automaton(struct string_matcher *m, uint32_t *fail, uint32_t *queue)
+{
+    size_t head = 0;
+    size_t tail = 0;
+    size_t c;
+
+    // Children of the root fail to the root, and its missing transitions already lead to it.
+    for (c = 0; c < m->nclasses; ++c) {
+        uint32_t t = m->next[c];
+
+        if (t != 0) {
+            m->out[t] = m->match[t] ? t : 0;
+            queue[tail++] = t;
+        }
+    }
+
+    while (head < tail) {
+        uint32_t s = queue[head++];
+
+        for (c = 0; c < m->nclasses; ++c) {
+            uint32_t *t = &m->next[s * m->nclasses + c];
+            uint32_t f = m->next[fail[s] * m->nclasses + c];
+
+            if (*t == 0) {
+                *t = f;
+            } else {
+                fail[*t] = f;
+                m->dict[*t] = m->out[f];
+                m->out[*t] = m->match[*t] ? *t : m->dict[*t];
+                queue[tail++] = *t;
+            }
+        }
+    }
+}
+
+/// Find the only character that begins a pattern.
+static void build_start(struct string_matcher *m)
+{
+    size_t count = 0;
+    size_t i;
+
+    m->start = -1;
+    for (i = 0; i < 256; ++i) {
+        if (m->next[m->classes[i]] != 0) {
+            m->start = (count++ == 0) ? (int)i : -1;
+            m->starts[i >> 6] |= UINT64_C(1) << (i & 63);
+        }
+    }
+}
+
+/// @return True if character @c c begins a pattern.
+static bool is_start(const struct string_matcher *m, unsigned char c)
+{
+    return (m->starts[c >> 6] >> (c & 63)) & 1;
+}
+
+/// @return First character in [p, end) that begins a pattern, or @c end if none does.
+static const char *skip_to_start(const struct string_matcher *m, const char *p, const char *end)
+{
+    // Test the characters of a word together, so that runs of other characters cost one branch per word.
+    while (end - p >= (ptrdiff_t)sizeof(uint64_t)) {
+        uint64_t w;
+        bool hit = false;
+        size_t i;
+
+        memcpy(&w, p, sizeof(w));
+        for (i = 0; i < sizeof(w); ++i) {
+            hit |= is_start(m, (unsigned char)(w >> (8 * i)));
+        }
+        if (hit) {
+            break;
+        }
+        p += sizeof(w);
+    }
+
+    while (p < end && !is_start(m, (unsigned char)*p)) {
+        ++p;
+    }
+    return p;
+}
+
+struct string_matcher *string_matcher_new(const struct string_view *patterns, size_t n, unsigned flags)
+{
+    struct string_matcher *m = NULL;
+    uint32_t *fail = NULL;
+    size_t total = 0;
+    size_t nstates;
+    size_t i;
+
+    if (!patterns && n > 0) {
+        errno = EFAULT;
+        return NULL;
+    }
+
+    if (flags & ~STRING_MATCHER_ICASE) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    for (i = 0; i < n; ++i) {
+        if (!patterns[i].buf) {
+            errno = EFAULT;
+            return NULL;
+        }
+
+        if (patterns[i].len == 0) {
+            errno = EINVAL;
+            return NULL;
+        }
+
+        // States and pattern ids must fit in 32 bits.
+        if (patterns[i].len > UINT32_MAX - 2 - total || n > UINT32_MAX - 2) {
+            errno = ENOMEM;
+            return NULL;
+        }
+        total += patterns[i].len;
+    }
+
+    m = calloc(1, sizeof(struct string_matcher));
+    if (!m) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    build_classes(m, patterns, n, flags & STRING_MATCHER_ICASE);
+
+    // At most one state per pattern character, plus the root.
+    nstates = total + 1;
+    m->next = calloc(nstates, m->nclasses * sizeof(uint32_t));
+    m->match = calloc(nstates, sizeof(uint32_t));
+    m->out = calloc(nstates, sizeof(uint32_t));
+    m->dict = calloc(nstates, sizeof(uint32_t));
+    m->patterns = calloc(n, sizeof(struct pattern));
+    fail = calloc(nstates, 2 * sizeof(uint32_t));
+    if (!m->next || !m->match || !m->out || !m->dict || (n > 0 && !m->patterns) || !fail) {
+        free(fail);
+        string_matcher_delete(m);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    build_trie(m, patterns, n);
+    build_automaton(m, fail, &fail[nstates]);
+    build_start(m);
+
+    free(fail);
+    return m;
+}
+
+void string_matcher_delete(struct string_matcher *m)
+{
+    if (!m) {
+        return;
+    }
+
+    free(m->next);
+    free(m->match);
+    free(m->out);
+    free(m->dict);
+    free(m->patterns);
+    free(m);
+}
+
+int string_matcher_scan(const struct string_matcher *m, size_t n, const char *s, bool (*fn)(void *ctx, size_t id, size_t pos), void *ctx)
+{
+    const char *end;
+    const char *p;
+    uint32_t state = 0;
+
+    if (!m || !s || !fn) {
+        return -EFAULT;
+    }
+
+    end = s + n;
+    for (p = s; p < end; ++p) {
+        uint32_t o;
+
+        if (state == 0 && m->start >= 0) {
+            // Nothing partly matched: skip to the next possible start with the C library.
+            p = memchr(p, m->start, (size_t)(end - p));
+            if (!p) {
+                break;
+            }
+        } else if (state == 0) {
+            // Nothing partly matched: skip to the next character that begins any pattern.
+            p = skip_to_start(m, p, end);
+            if (p == end) {
+                break;
+            }
+        }
+
+        state = m->next[state * m->nclasses + m->classes[(unsigned char)*p]];
+        for (o = m->out[state]; o != 0; o = m->dict[o]) {
+            uint32_t id;
+
+            for (id = m->match[o]; id != 0; id = m->patterns[id - 1].next) {
+                if (!fn(ctx, id - 1, (size_t)(p - s) + 1 - m->patterns[id - 1].len)) {
+                    return 0;
+                }
+            }
+        }
+    }
+
+    return 0;
+}
+
+int string_matcher_scan_string(const struct string_matcher *m, const struct string *s, bool (*fn)(void *ctx, size_t id, size_t pos), void *ctx)
+{
+    struct string_view view = string_as_view(s);
+
+    if (!view.buf) {
+        return -EFAULT;
+    }
+
+    return string_matcher_scan(m, view.len, view.buf, fn, ctx);
+}
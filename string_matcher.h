@@ -0,0 +1,55 @@
+#ifndef LIBCSTRING_STRING_MATCHER_H_
+#define LIBCSTRING_STRING_MATCHER_H_
+
+/// Multi-pattern matcher.
+///
+/// Finds all occurrences of any of a set of patterns in one linear pass, using
+/// the Aho-Corasick algorithm compiled to a deterministic automaton.
+///
+/// Characters are mapped to classes of characters that patterns do not tell
+/// apart, which keeps the transition table small, and provides case folding at
+/// no cost during a scan. While no pattern is partly matched, the scan skips
+/// ahead to the next character that begins a pattern: with memchr() if all
+/// patterns begin with the same character, otherwise a word at a time through
+/// the set of first characters.
+///
+/// Functions follow the return type conventions described in cstring.h.
+
+#include "cstring.h"
+
+/// Flag: ignore the case of ASCII letters.
+#define STRING_MATCHER_ICASE 0x1u
+
+/// Matcher object.
+///
+/// A matcher is not modified by a scan, so may be shared by concurrent scans.
+struct string_matcher;
+
+/// Constructor.
+/// Compile @c n patterns; the id of a pattern is its index in the array.
+/// @param flags Zero, or STRING_MATCHER_ICASE.
+/// @return Pointer to matcher on success.
+/// @return NULL on failure, and errno is set to:
+///   - EFAULT: NULL pointer argument (including the buffer of a pattern).
+///   - EINVAL: Empty pattern, or unknown flag.
+///   - ENOMEM: Insufficient memory.
+/// @note Memory ownership: Caller retains ownership of patterns, and must string_matcher_delete() the returned pointer.
+struct string_matcher *string_matcher_new(const struct string_view *patterns, size_t n, unsigned flags) PUBLIC;
+
+/// Destructor.
+/// @note Memory ownership: Object takes ownership of the pointer.
+void string_matcher_delete(struct string_matcher *) PUBLIC;
+
+/// Scan the @c n characters in buffer @c s, calling @c fn for each occurrence of pattern @c id starting at position @c pos.
+/// The scan stops early if @c fn returns false.
+/// Occurrences are reported in order of their end position; occurrences that end at the same position are reported
+/// longest first, and identical patterns in order of id.
+/// @return Zero on success, negative errno otherwise.
+///   - EFAULT: NULL pointer argument.
+int string_matcher_scan(const struct string_matcher *, size_t n, const char *s, bool (*fn)(void *ctx, size_t id, size_t pos), void *ctx) PUBLIC;
+
+/// Scan the content of string @c s.
+/// @see string_matcher_scan.
+int string_matcher_scan_string(const struct string_matcher *, const struct string *s, bool (*fn)(void *ctx, size_t id, size_t pos), void *ctx) PUBLIC;
+
+#endif // LIBCSTRING_STRING_MATCHER_H_
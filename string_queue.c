@@ -0,0 +1,238 @@
+#include "string_queue.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/// Size of a cache line, to keep the positions written by producers and consumers apart.
+#define CACHE_LINE 64
+
+/// Queue slot.
+/// Its sequence number equals the position of the push that may fill it, or that position plus one once filled.
+/// Popping advances it to the position of the push one lap later.
+struct cell {
+    size_t seq;
+    struct string *str;
+};
+
+struct string_queue {
+    struct cell *cells;
+    /// Capacity minus one, to map positions to slots.
+    size_t mask;
+    char pad0[CACHE_LINE - sizeof(struct cell *) - sizeof(size_t)];
+    /// Position of the next push.
+    size_t head;
+    char pad1[CACHE_LINE - sizeof(size_t)];
+    /// Position of the next pop.
+    size_t tail;
+    char pad2[CACHE_LINE - sizeof(size_t)];
+};
+
+struct string_channel {
+    /// Strings sent to consumers.
+    struct string_queue *sent;
+    /// Empty strings returned to producers.
+    struct string_queue *recycled;
+};
+
+struct string_queue *string_queue_new(size_t capacity)
+{
+    struct string_queue *q = NULL;
+    size_t cap = 2;
+    size_t i;
+
+    if (capacity == 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    while (cap < capacity) {
+        if (cap > SIZE_MAX / 2 / sizeof(struct cell)) {
+            // Check for overflow.
+            errno = ENOMEM;
+            return NULL;
+        }
+        cap *= 2;
+    }
+
+    q = calloc(1, sizeof(struct string_queue));
+    if (!q) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    q->cells = malloc(cap * sizeof(struct cell));
+    if (!q->cells) {
+        free(q);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    for (i = 0; i < cap; ++i) {
+        q->cells[i].seq = i;
+        q->cells[i].str = NULL;
+    }
+    q->mask = cap - 1;
+
+    return q;
+}
+
+void string_queue_delete(struct string_queue *q)
+{
+    struct string *str;
+
+    if (!q) {
+        return;
+    }
+
+    while ((str = string_queue_pop(q)) != NULL) {
+        string_delete(str);
+    }
+    free(q->cells);
+    free(q);
+}
+
+size_t string_queue_capacity(const struct string_queue *q)
+{
+    if (!q) {
+        return 0;
+    }
+
+    return q->mask + 1;
+}
+
+int string_queue_push(struct string_queue *q, struct string *str)
+{
+    size_t pos;
+
+    if (!q || !str) {
+        return -EFAULT;
+    }
+
+    for (pos = __atomic_load_n(&q->head, __ATOMIC_RELAXED);; pos = __atomic_load_n(&q->head, __ATOMIC_RELAXED)) {
+        struct cell *cell = &q->cells[pos & q->mask];
+        intptr_t diff = (intptr_t)(__atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE) - pos);
+
+        if (diff < 0) {
+            // The slot still holds the string pushed one lap earlier.
+            return -EAGAIN;
+        }
+
+        if (diff == 0 && __atomic_compare_exchange_n(&q->head, &pos, pos + 1, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            cell->str = str;
+            __atomic_store_n(&cell->seq, pos + 1, __ATOMIC_RELEASE);
+            return 0;
+        }
+
+        // Another producer claimed the slot first.
+    }
+}
+
+struct string *string_queue_pop(struct string_queue *q)
+{
+    size_t pos;
+
+    if (!q) {
+        errno = EFAULT;
+        return NULL;
+    }
+
+    for (pos = __atomic_load_n(&q->tail, __ATOMIC_RELAXED);; pos = __atomic_load_n(&q->tail, __ATOMIC_RELAXED)) {
+        struct cell *cell = &q->cells[pos & q->mask];
+        intptr_t diff = (intptr_t)(__atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE) - (pos + 1));
+
+        if (diff < 0) {
+            // The slot has not been filled yet.
+            errno = EAGAIN;
+            return NULL;
+        }
+
+        if (diff == 0 && __atomic_compare_exchange_n(&q->tail, &pos, pos + 1, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            struct string *str = cell->str;
+
+            __atomic_store_n(&cell->seq, pos + q->mask + 1, __ATOMIC_RELEASE);
+            return str;
+        }
+
+        // Another consumer claimed the slot first.
+    }
+}
+
+struct string_channel *string_channel_new(size_t capacity)
+{
+    struct string_channel *ch = NULL;
+
+    ch = calloc(1, sizeof(struct string_channel));
+    if (!ch) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    ch->sent = string_queue_new(capacity);
+    ch->recycled = ch->sent ? string_queue_new(capacity) : NULL;
+    if (!ch->recycled) {
+        int err = errno;
+
+        string_channel_delete(ch);
+        errno = err;
+        return NULL;
+    }
+
+    return ch;
+}
+
+void string_channel_delete(struct string_channel *ch)
+{
+    if (!ch) {
+        return;
+    }
+
+    string_queue_delete(ch->sent);
+    string_queue_delete(ch->recycled);
+    free(ch);
+}
+
+struct string *string_channel_acquire(struct string_channel *ch)
+{
+    struct string *str;
+
+    if (!ch) {
+        errno = EFAULT;
+        return NULL;
+    }
+
+    str = string_queue_pop(ch->recycled);
+    if (!str) {
+        str = string_new();
+    }
+
+    return str;
+}
+
+int string_channel_send(struct string_channel *ch, struct string *str)
+{
+    if (!ch) {
+        return -EFAULT;
+    }
+
+    return string_queue_push(ch->sent, str);
+}
+
+struct string *string_channel_receive(struct string_channel *ch)
+{
+    if (!ch) {
+        errno = EFAULT;
+        return NULL;
+    }
+
+    return string_queue_pop(ch->sent);
+}
+
+void string_channel_recycle(struct string_channel *ch, struct string *str)
+{
+    string_clear(str);
+
+    if (!ch || string_queue_push(ch->recycled, str) != 0) {
+        string_delete(str);
+    }
+}
@@ -0,0 +1,99 @@
+#ifndef LIBCSTRING_STRING_QUEUE_H_
+#define LIBCSTRING_STRING_QUEUE_H_
+
+/// String queue.
+///
+/// Bounded lock-free queue that hands ownership of string objects from
+/// producer threads to consumer threads, without copying their content.
+///
+/// Each slot holds a sequence number that tells producers and consumers whose
+/// turn it is, so that a push or pop claims its slot with a single
+/// compare-and-swap on the head or tail position, and no thread ever waits on
+/// a lock. Any number of producers and consumers may use a queue concurrently.
+///
+/// A channel pairs a queue of strings sent to consumers with a queue of emptied
+/// strings returned to producers, so that strings and their storage are
+/// recycled instead of being allocated for every message.
+///
+/// A detached buffer from string_c_str_move() can be sent by wrapping it with
+/// string_new_adopt().
+///
+/// Functions follow the return type conventions described in cstring.h.
+
+#include "cstring.h"
+
+/// String queue object.
+///
+/// Unlike other objects in this library, queues are thread-safe: push and pop may be called concurrently from
+/// any number of threads. Creating and deleting a queue must not race with other calls.
+struct string_queue;
+
+/// Constructor.
+/// Create a new empty queue with room for at least @c capacity strings.
+/// @return Pointer to queue on success.
+/// @return NULL on failure, and errno is set to:
+///   - EINVAL: Zero capacity.
+///   - ENOMEM: Insufficient memory.
+/// @note Memory ownership: Caller must string_queue_delete() the returned pointer.
+struct string_queue *string_queue_new(size_t capacity) PUBLIC;
+
+/// Destructor.
+/// @note Memory ownership: Object takes ownership of the pointer, and deletes any strings still queued.
+void string_queue_delete(struct string_queue *) PUBLIC;
+
+/// Get capacity.
+/// @return Number of strings that there is room for (@c capacity rounded up to a power of two), or zero if NULL.
+size_t string_queue_capacity(const struct string_queue *) PUBLIC;
+
+/// Append @c str at the back of the queue.
+/// @return Zero on success, negative errno otherwise.
+///   - EAGAIN: Queue full.
+///   - EFAULT: NULL pointer argument.
+/// @note Memory ownership: Queue takes ownership of @c str on success only.
+int string_queue_push(struct string_queue *, struct string *str) PUBLIC;
+
+/// Remove the string at the front of the queue.
+/// @return Pointer to string on success.
+/// @return NULL on failure, and errno is set to:
+///   - EAGAIN: Queue empty.
+///   - EFAULT: NULL pointer argument.
+/// @note Memory ownership: Caller must string_delete() the returned pointer.
+struct string *string_queue_pop(struct string_queue *) PUBLIC;
+
+/// String channel object.
+/// @see string_queue.
+struct string_channel;
+
+/// Constructor.
+/// Create a new channel, where at least @c capacity strings may be in flight and as many kept for recycling.
+/// @see string_queue_new.
+/// @note Memory ownership: Caller must string_channel_delete() the returned pointer.
+struct string_channel *string_channel_new(size_t capacity) PUBLIC;
+
+/// Destructor.
+/// @note Memory ownership: Object takes ownership of the pointer, and deletes any strings still sent or recycled.
+void string_channel_delete(struct string_channel *) PUBLIC;
+
+/// Get an empty string for a producer to fill: a recycled one if available, otherwise a new one.
+/// @return Pointer to string on success.
+/// @return NULL on failure, and errno is set to:
+///   - EFAULT: NULL pointer argument.
+///   - ENOMEM: Insufficient memory.
+/// @note Memory ownership: Caller must string_channel_send(), string_channel_recycle() or string_delete() the
+///       returned pointer.
+struct string *string_channel_acquire(struct string_channel *) PUBLIC;
+
+/// Send @c str to consumers.
+/// @see string_queue_push.
+int string_channel_send(struct string_channel *, struct string *str) PUBLIC;
+
+/// Receive a string sent by a producer.
+/// @see string_queue_pop.
+/// @note Memory ownership: Caller must string_channel_recycle() or string_delete() the returned pointer.
+struct string *string_channel_receive(struct string_channel *) PUBLIC;
+
+/// Clear @c str and return it to producers, keeping its storage; it is deleted if there is no room for it.
+/// @note Memory ownership: Object takes ownership of @c str.
+void string_channel_recycle(struct string_channel *, struct string *str) PUBLIC;
+
+#endif // LIBCSTRING_STRING_QUEUE_H_
@@ -0,0 +1,247 @@
+#include "string_search.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/// Number of start positions searched as one unit of work.
+#define CHUNK_SIZE ((size_t)1 << 20)
+
+/// Initial capacity of the offsets of a chunk.
+#define OFFSETS_INITIAL 16
+
+/// Part of the string, searched by one thread.
+struct chunk {
+    /// First start position.
+    size_t begin;
+    /// One past the last start position.
+    size_t end;
+    /// Positions of occurrences, if collected.
+    size_t *offsets;
+    /// Capacity of @c offsets.
+    size_t cap;
+    /// Number of occurrences.
+    size_t count;
+    /// Zero, or negative errno if the chunk failed.
+    int error;
+};
+
+/// Search shared by all threads.
+struct job {
+    const char *buf;
+    /// Pattern.
+    const char *s;
+    /// Length of pattern.
+    size_t n;
+    /// Collect positions, as well as counting.
+    bool collect;
+    struct chunk *chunks;
+    size_t nchunks;
+    /// Index of next chunk to search, taken atomically.
+    size_t next;
+};
+
+/// Grow offsets of @c chunk.
+/// @return Zero on success, negative errno otherwise.
+static int grow_offsets(struct chunk *chunk)
+{
+    size_t cap = (chunk->cap == 0) ? OFFSETS_INITIAL : chunk->cap * 2;
+    size_t *offsets;
+
+    offsets = realloc(chunk->offsets, cap * sizeof(size_t));
+    if (!offsets) {
+        return -ENOMEM;
+    }
+
+    chunk->offsets = offsets;
+    chunk->cap = cap;
+    return 0;
+}
+
+static void search_chunk(const struct job *job, struct chunk *chunk)
+{
+    const char *p = &job->buf[chunk->begin];
+    const char *end = &job->buf[chunk->end];
+
+    // Skip to candidates with the C library, which scans a word or vector at a time.
+    while (p < end && (p = memchr(p, job->s[0], (size_t)(end - p))) != NULL) {
+        if (memcmp(p + 1, job->s + 1, job->n - 1) == 0) {
+            if (job->collect && chunk->count == chunk->cap && grow_offsets(chunk) < 0) {
+                chunk->error = -ENOMEM;
+                return;
+            }
+
+            if (job->collect) {
+                chunk->offsets[chunk->count] = (size_t)(p - job->buf);
+            }
+            chunk->count++;
+        }
+        p++;
+    }
+}
+
+/// Search chunks until none are left.
+static void *search_task(void *arg)
+{
+    struct job *job = arg;
+    size_t k;
+
+    while ((k = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED)) < job->nchunks) {
+        search_chunk(job, &job->chunks[k]);
+    }
+    return NULL;
+}
+
+/// Run @c job with up to @c threads threads, including the caller.
+static void run_job(struct job *job, unsigned threads)
+{
+    pthread_t *ids;
+    size_t spawned = 0;
+    size_t k;
+
+    if (threads > job->nchunks) {
+        threads = (unsigned)job->nchunks;
+    }
+
+    // Without memory for thread handles, the caller searches alone.
+    ids = (threads > 1) ? calloc(threads - 1, sizeof(pthread_t)) : NULL;
+
+    // The caller takes any chunks left by threads that could not be created.
+    while (ids && spawned + 1 < threads && pthread_create(&ids[spawned], NULL, search_task, job) == 0) {
+        spawned++;
+    }
+
+    search_task(job);
+
+    for (k = 0; k < spawned; ++k) {
+        pthread_join(ids[k], NULL);
+    }
+    free(ids);
+}
+
+/// Gather offsets of all chunks in order.
+/// @return Zero on success, negative errno otherwise.
+static int gather_offsets(struct job *job, size_t total, size_t **offsets)
+{
+    size_t *out;
+    size_t k;
+
+    if (job->nchunks == 1) {
+        // Hand over the only array.
+        *offsets = job->chunks[0].offsets;
+        job->chunks[0].offsets = NULL;
+        return 0;
+    }
+
+    out = calloc(total, sizeof(size_t));
+    if (!out) {
+        return -ENOMEM;
+    }
+
+    *offsets = out;
+    for (k = 0; k < job->nchunks; ++k) {
+        memcpy(out, job->chunks[k].offsets, job->chunks[k].count * sizeof(size_t));
+        out += job->chunks[k].count;
+    }
+    return 0;
+}
+
+/// Find or count occurrences.
+/// @see string_find_all_parallel.
+static int impl_search(const struct string *str, size_t n, const char *s, size_t **offsets, size_t *count, unsigned threads)
+{
+    struct string_view view = string_as_view(str);
+    struct job job;
+    size_t candidates;
+    size_t total = 0;
+    size_t k;
+    int r = 0;
+
+    if (!str || !s || !count) {
+        return -EFAULT;
+    }
+
+    if (!view.buf) {
+        // Compressed content could not be expanded.
+        return -ENOMEM;
+    }
+
+    if (n == 0) {
+        return -EINVAL;
+    }
+
+    *count = 0;
+    if (offsets) {
+        *offsets = NULL;
+    }
+
+    if (n > view.len) {
+        return 0;
+    }
+
+    candidates = view.len - n + 1;
+    job.buf = view.buf;
+    job.s = s;
+    job.n = n;
+    job.collect = offsets != NULL;
+    job.nchunks = candidates / CHUNK_SIZE + (candidates % CHUNK_SIZE != 0);
+    job.next = 0;
+    job.chunks = calloc(job.nchunks, sizeof(struct chunk));
+    if (!job.chunks) {
+        return -ENOMEM;
+    }
+
+    for (k = 0; k < job.nchunks; ++k) {
+        job.chunks[k].begin = k * CHUNK_SIZE;
+        job.chunks[k].end = (candidates - job.chunks[k].begin > CHUNK_SIZE) ? job.chunks[k].begin + CHUNK_SIZE : candidates;
+    }
+
+    run_job(&job, threads);
+
+    for (k = 0; k < job.nchunks; ++k) {
+        total += job.chunks[k].count;
+        if (job.chunks[k].error < 0) {
+            r = job.chunks[k].error;
+        }
+    }
+
+    if (r == 0 && offsets && total > 0) {
+        r = gather_offsets(&job, total, offsets);
+    }
+
+    if (r == 0) {
+        *count = total;
+    }
+
+    for (k = 0; k < job.nchunks; ++k) {
+        free(job.chunks[k].offsets);
+    }
+    free(job.chunks);
+    return r;
+}
+
+int string_find_all_parallel(const struct string *str, size_t n, const char *s, size_t **offsets, size_t *count, unsigned threads)
+{
+    if (!offsets) {
+        return -EFAULT;
+    }
+
+    return impl_search(str, n, s, offsets, count, threads);
+}
+
+int string_find_all(const struct string *str, size_t n, const char *s, size_t **offsets, size_t *count)
+{
+    return string_find_all_parallel(str, n, s, offsets, count, 1);
+}
+
+int string_count_parallel(const struct string *str, size_t n, const char *s, size_t *count, unsigned threads)
+{
+    return impl_search(str, n, s, NULL, count, threads);
+}
+
+int string_count(const struct string *str, size_t n, const char *s, size_t *count)
+{
+    return string_count_parallel(str, n, s, count, 1);
+}
@@ -0,0 +1,49 @@
+#ifndef LIBCSTRING_STRING_SEARCH_H_
+#define LIBCSTRING_STRING_SEARCH_H_
+
+/// String search.
+///
+/// Finds or counts every occurrence of a pattern in a string, optionally
+/// splitting large strings into chunks searched by several threads.
+///
+/// Occurrences may overlap: every position at which the pattern starts is
+/// reported, so that the result does not depend on how the string is split.
+/// Each chunk owns the start positions within it, and reads past its end by up
+/// to the pattern length, so that occurrences straddling a chunk boundary are
+/// found exactly once.
+///
+/// A compressed string (see string_compress()) is expanded in place before it is searched,
+/// which allocates, and writes to the string: searching a string shared with concurrent
+/// readers requires it to be uncompressed.
+///
+/// Functions follow the return type conventions described in cstring.h.
+
+#include "cstring.h"
+
+/// Find all occurrences of the @c n characters in buffer @c s.
+/// @param offsets Set to an array of the positions of occurrences in increasing order, or NULL if there are none.
+/// @param count Set to the number of occurrences.
+/// @return Zero on success, negative errno otherwise.
+///   - EFAULT: NULL pointer argument.
+///   - EINVAL: Empty pattern.
+///   - ENOMEM: Insufficient memory, including to expand a compressed string.
+/// @note Memory ownership: Caller must free() @c offsets.
+int string_find_all(const struct string *, size_t n, const char *s, size_t **offsets, size_t *count) PUBLIC;
+
+/// Find all occurrences, using up to @c threads threads for large strings.
+/// @see string_find_all.
+int string_find_all_parallel(const struct string *, size_t n, const char *s, size_t **offsets, size_t *count, unsigned threads) PUBLIC;
+
+/// Count occurrences of the @c n characters in buffer @c s.
+/// @param count Set to the number of occurrences.
+/// @return Zero on success, negative errno otherwise.
+///   - EFAULT: NULL pointer argument.
+///   - EINVAL: Empty pattern.
+///   - ENOMEM: Insufficient memory, including to expand a compressed string.
+int string_count(const struct string *, size_t n, const char *s, size_t *count) PUBLIC;
+
+/// Count occurrences, using up to @c threads threads for large strings.
+/// @see string_count.
+int string_count_parallel(const struct string *, size_t n, const char *s, size_t *count, unsigned threads) PUBLIC;
+
+#endif // LIBCSTRING_STRING_SEARCH_H_
@@ -0,0 +1,361 @@
+#include "string_serial.h"
+
+#include "cstring_private.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/// Maximum length of a varint holding a size_t.
+#define VARINT_MAX ((sizeof(size_t) * CHAR_BIT + 6) / 7)
+
+/// Size of the buffer of a reader; the remainder of longer strings bypasses it.
+#define READ_BUFFER ((size_t)1 << 16)
+
+struct string_reader {
+    int fd;
+    /// Characters read but not yet decoded are at [begin, end).
+    size_t begin;
+    size_t end;
+    char buf[READ_BUFFER];
+};
+
+/// Encode @c v as a varint at @c p, which has room for VARINT_MAX characters.
+/// @return Length of the varint.
+static size_t put_varint(char *p, size_t v)
+{
+    size_t k = 0;
+
+    for (; v >= 0x80; v >>= 7) {
+        p[k++] = (char)(v | 0x80);
+    }
+    p[k++] = (char)v;
+    return k;
+}
+
+
+/// Append the encoding of @c n characters from buffer @c s, which must not point into @c dest.
+/// @return Zero on success, negative errno otherwise.
+static int append_encoded(struct string *dest, size_t n, const char *s)
+{
+    char *p;
+    size_t k;
+
+    p = string_reserve_tail(dest, VARINT_MAX + n);
+    if (!p) {
+        return -errno;
+    }
+
+    k = put_varint(p, n);
+    memcpy(&p[k], s, n);
+    return string_commit(dest, k + n);
+}
+
+int string_serialize(struct string *dest, const struct string *src)
+{
+    struct string_view v;
+    char *p;
+    size_t k;
+
+    if (!dest || !src) {
+        return -EFAULT;
+    }
+
+    v = string_as_view(src);
+    if (!v.buf) {
+        return -ENOMEM;
+    }
+
+    p = string_reserve_tail(dest, VARINT_MAX + v.len);
+    if (!p) {
+        return -errno;
+    }
+
+    // Storage may have moved, if src is dest.
+    v = string_as_view(src);
+    k = put_varint(p, v.len);
+    memcpy(&p[k], v.buf, v.len);
+    return string_commit(dest, k + v.len);
+}
+
+int string_serialize_vec(struct string *dest, const struct string_vec *src)
+{
+    char count[VARINT_MAX];
+    size_t start;
+    size_t i;
+    int r;
+
+    if (!dest || !src) {
+        return -EFAULT;
+    }
+
+    start = string_size(dest);
+    r = string_append_buffer(dest, put_varint(count, string_vec_size(src)), count);
+
+    for (i = 0; i < string_vec_size(src) && r == 0; ++i) {
+        struct string_view v = string_vec_at(src, i);
+
+        r = append_encoded(dest, v.len, v.buf);
+    }
+
+    if (r < 0) {
+        // Shrinking cannot fail.
+        string_resize_uninit(dest, start);
+    }
+    return r;
+}
+
+/// Decode a string from the @c n characters of @c buf at @c pos, as a view.
+/// @param next Receives the position after the encoding.
+/// @return Zero on success, negative errno otherwise.
+static int decode_view(size_t n, const char *buf, size_t pos, struct string_view *view, size_t *next)
+{
+    size_t len;
+    size_t k;
+
+    if (pos > n) {
+        return -EILSEQ;
+    }
+
+    k = get_varint(&buf[pos], n - pos, &len);
+    if (k == 0 || k == STRING_NPOS || len > n - pos - k) {
+        return -EILSEQ;
+    }
+
+    view->buf = &buf[pos + k];
+    view->len = len;
+    *next = pos + k + len;
+    return 0;
+}
+
+int string_deserialize(struct string *dest, size_t n, const char *buf, size_t *pos)
+{
+    struct string_view v;
+    size_t next;
+    int r;
+
+    if (!dest || !buf || !pos) {
+        return -EFAULT;
+    }
+
+    r = decode_view(n, buf, *pos, &v, &next);
+    if (r < 0) {
+        return r;
+    }
+
+    r = string_assign_buffer(dest, v.len, v.buf);
+    if (r < 0) {
+        return r;
+    }
+
+    *pos = next;
+    return 0;
+}
+
+int string_deserialize_vec(struct string_vec *dest, size_t n, const char *buf, size_t *pos)
+{
+    struct string_view v;
+    size_t count;
+    size_t chars = 0;
+    size_t next;
+    size_t k;
+    size_t i;
+    int r;
+
+    if (!dest || !buf || !pos) {
+        return -EFAULT;
+    }
+
+    // Validate, and measure; each element takes at least one character.
+    k = (*pos <= n) ? get_varint(&buf[*pos], n - *pos, &count) : 0;
+    if (k == 0 || k == STRING_NPOS || count > n - *pos - k) {
+        return -EILSEQ;
+    }
+
+    next = *pos + k;
+    for (i = 0; i < count; ++i) {
+        r = decode_view(n, buf, next, &v, &next);
+        if (r < 0) {
+            return r;
+        }
+        chars += v.len;
+    }
+
+    // Capacities are totals, including the existing elements.
+    for (i = 0; i < string_vec_size(dest); ++i) {
+        chars += string_vec_at(dest, i).len;
+    }
+
+    r = string_vec_reserve(dest, string_vec_size(dest) + count, chars);
+    if (r < 0) {
+        return r;
+    }
+
+    // Cannot fail, as storage is reserved.
+    next = *pos + k;
+    for (i = 0; i < count; ++i) {
+        decode_view(n, buf, next, &v, &next);
+        string_vec_push_back(dest, v.len, v.buf);
+    }
+
+    *pos = next;
+    return 0;
+}
+
+int string_deserialize_view(struct string_view *dest, size_t n, const char *buf, size_t *pos)
+{
+    size_t next;
+    int r;
+
+    if (!dest || !buf || !pos) {
+        return -EFAULT;
+    }
+
+    r = decode_view(n, buf, *pos, dest, &next);
+    if (r < 0) {
+        return r;
+    }
+
+    *pos = next;
+    return 0;
+}
+
+struct string_reader *string_reader_new(int fd)
+{
+    struct string_reader *reader = NULL;
+
+    reader = malloc(sizeof(struct string_reader));
+    if (!reader) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    reader->fd = fd;
+    reader->begin = 0;
+    reader->end = 0;
+    return reader;
+}
+
+void string_reader_delete(struct string_reader *reader)
+{
+    if (!reader) {
+        return;
+    }
+
+    free(reader);
+}
+
+/// Read up to @c n characters from @c fd into @c p, retrying if interrupted.
+/// @return Number of characters read, zero at end of file, or negative errno.
+static ssize_t read_some(int fd, char *p, size_t n)
+{
+    ssize_t r;
+
+    do {
+        r = read(fd, p, n);
+    } while (r < 0 && errno == EINTR);
+
+    return (r < 0) ? -errno : r;
+}
+
+/// Read more characters into the buffer of @c reader, after those not yet decoded.
+/// @return Number of characters read, zero at end of file, or negative errno.
+static ssize_t fill(struct string_reader *reader)
+{
+    ssize_t r;
+
+    memmove(reader->buf, &reader->buf[reader->begin], reader->end - reader->begin);
+    reader->end -= reader->begin;
+    reader->begin = 0;
+
+    r = read_some(reader->fd, &reader->buf[reader->end], READ_BUFFER - reader->end);
+    if (r > 0) {
+        reader->end += (size_t)r;
+    }
+    return r;
+}
+
+/// Read the next string into @c dest.
+/// @return Zero on success, negative errno otherwise.
+static int read_next(struct string_reader *reader, struct string *dest)
+{
+    size_t len;
+    size_t got = 0;
+    ssize_t r;
+    size_t k;
+    char *p;
+
+    // Length, which fits in the buffer.
+    for (;;) {
+        k = get_varint(&reader->buf[reader->begin], reader->end - reader->begin, &len);
+        if (k == STRING_NPOS) {
+            return -EILSEQ;
+        }
+
+        if (k > 0) {
+            break;
+        }
+
+        r = fill(reader);
+        if (r < 0) {
+            return (int)r;
+        }
+
+        if (r == 0) {
+            return (reader->begin == reader->end) ? -ENODATA : -EILSEQ;
+        }
+    }
+    reader->begin += k;
+
+    p = string_resize_uninit(dest, len);
+    if (!p) {
+        return -errno;
+    }
+
+    while (got < len) {
+        if (reader->begin == reader->end) {
+            // Long remainders bypass the buffer.
+            bool direct = (len - got >= READ_BUFFER);
+
+            r = direct ? read_some(reader->fd, &p[got], len - got) : fill(reader);
+            if (r < 0) {
+                return (int)r;
+            }
+
+            if (r == 0) {
+                return -EILSEQ;
+            }
+
+            if (direct) {
+                got += (size_t)r;
+                continue;
+            }
+        }
+
+        k = reader->end - reader->begin;
+        k = (k < len - got) ? k : len - got;
+        memcpy(&p[got], &reader->buf[reader->begin], k);
+        reader->begin += k;
+        got += k;
+    }
+
+    return 0;
+}
+
+int string_reader_next(struct string_reader *reader, struct string *dest)
+{
+    int r;
+
+    if (!reader || !dest) {
+        return -EFAULT;
+    }
+
+    r = read_next(reader, dest);
+    if (r < 0) {
+        string_clear(dest);
+    }
+    return r;
+}
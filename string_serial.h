@@ -0,0 +1,78 @@
+#ifndef LIBCSTRING_STRING_SERIAL_H_
+#define LIBCSTRING_STRING_SERIAL_H_
+
+/// Binary serialization of strings.
+///
+/// A string is encoded as its length, as an unsigned LEB128 varint, followed by
+/// its characters; an array is encoded as the number of elements, followed by the
+/// elements. Decoding needs no terminator scan, and the characters may contain NUL.
+///
+/// Encodings are decoded from a buffer into strings or vectors, or into views of the
+/// buffer without copying (for example of a file mapped with mmap()), or read from a
+/// file descriptor directly into the storage of a string.
+///
+/// Functions follow the return type conventions described in cstring.h.
+
+#include "cstring.h"
+#include "string_vec.h"
+
+/// Append the encoding of string @c src.
+/// @return Zero on success, negative errno otherwise.
+///   - EFAULT: NULL pointer argument.
+///   - ENOMEM: Insufficient memory.
+int string_serialize(struct string *dest, const struct string *src) PUBLIC;
+
+/// Append the encoding of the elements of vector @c src, as an array.
+/// @return Zero on success (nothing is appended on failure), negative errno otherwise.
+///   - EFAULT: NULL pointer argument.
+///   - ENOMEM: Insufficient memory.
+int string_serialize_vec(struct string *dest, const struct string_vec *src) PUBLIC;
+
+/// Decode a string from the @c n characters of @c buf, starting at @c *pos, into @c dest.
+/// @param pos Position in @c buf, advanced past the encoding on success.
+/// @return Zero on success, negative errno otherwise.
+///   - EFAULT: NULL pointer argument.
+///   - EILSEQ: Encoding invalid, or truncated at @c n (@c dest and @c pos are unchanged).
+///   - ENOMEM: Insufficient memory.
+int string_deserialize(struct string *dest, size_t n, const char *buf, size_t *pos) PUBLIC;
+
+/// Decode an array from the @c n characters of @c buf, starting at @c *pos, appending its elements to @c dest.
+/// The whole encoding is validated, and storage reserved, before any element is appended.
+/// @see string_deserialize.
+int string_deserialize_vec(struct string_vec *dest, size_t n, const char *buf, size_t *pos) PUBLIC;
+
+/// Decode a string from the @c n characters of @c buf, starting at @c *pos, as a view of @c buf without copying.
+/// @see string_deserialize.
+/// @note Memory ownership: The view points into @c buf, and is valid as long as @c buf is.
+int string_deserialize_view(struct string_view *dest, size_t n, const char *buf, size_t *pos) PUBLIC;
+
+/// Streaming decoder of strings from a file descriptor.
+///
+/// This library is **not** thread-safe.
+/// Caller must synchronize access to reader objects.
+struct string_reader;
+
+/// Constructor.
+/// Create a new reader of the encodings of strings from @c fd, in sequence.
+/// @return Pointer to reader on success.
+/// @return NULL on failure, and errno is set to:
+///   - ENOMEM: Insufficient memory.
+/// @note Memory ownership: Caller must string_reader_delete() the returned pointer; @c fd is not closed.
+struct string_reader *string_reader_new(int fd) PUBLIC;
+
+/// Destructor.
+/// @note Memory ownership: Object takes ownership of the pointer.
+void string_reader_delete(struct string_reader *) PUBLIC;
+
+/// Read the next string into @c dest.
+/// Short strings are decoded from an internal buffer; the remainder of long strings is
+/// read directly into the storage of @c dest, which is reserved once at its final size.
+/// @return Zero on success, negative errno otherwise (@c dest is then empty).
+///   - EFAULT: NULL pointer argument.
+///   - EILSEQ: Encoding invalid, or truncated by the end of the file.
+///   - ENODATA: End of the file, after the last string.
+///   - ENOMEM: Insufficient memory.
+///   - Any error of read().
+int string_reader_next(struct string_reader *, struct string *dest) PUBLIC;
+
+#endif // LIBCSTRING_STRING_SERIAL_H_
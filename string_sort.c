@@ -0,0 +1,335 @@
+#include "string_sort.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/// Ranges at most this size are finished by insertion sort.
+#define INSERTION_SORT_MAX 16
+
+/// Ranges smaller than this are not worth handing to another thread.
+#define PARALLEL_MIN 16384
+
+/// Number of characters in a prefix key.
+#define KEY_SIZE sizeof(uint64_t)
+
+/// String being sorted.
+struct item {
+    /// Characters at [depth, depth + KEY_SIZE), big-endian and zero padded, so that keys order as the characters do.
+    uint64_t key;
+    /// Characters.
+    const char *buf;
+    /// Number of characters.
+    size_t len;
+    /// Original string, if any.
+    struct string *ref;
+    /// Number of characters in key (at most KEY_SIZE), which orders strings that are a prefix of others first.
+    unsigned char rem;
+};
+
+/// Load prefix key of @c item at @c depth.
+/// @pre @c depth does not exceed length of item.
+static void load_key(struct item *item, size_t depth)
+{
+    unsigned char b[KEY_SIZE] = { 0 };
+    size_t n = item->len - depth;
+    size_t i;
+
+    if (n > KEY_SIZE) {
+        n = KEY_SIZE;
+    }
+
+    memcpy(b, &item->buf[depth], n);
+
+    item->key = 0;
+    for (i = 0; i < KEY_SIZE; ++i) {
+        item->key = (item->key << 8) | b[i];
+    }
+    item->rem = (unsigned char)n;
+}
+
+/// Compare prefix keys.
+static int compare_keys(const struct item *a, const struct item *b)
+{
+    if (a->key != b->key) {
+        return (a->key < b->key) ? -1 : 1;
+    }
+
+    return (a->rem > b->rem) - (a->rem < b->rem);
+}
+
+/// Compare strings that are equal up to @c depth.
+static int compare_items(const struct item *a, const struct item *b, size_t depth)
+{
+    size_t la;
+    size_t lb;
+    int r;
+
+    r = compare_keys(a, b);
+    if (r != 0 || a->rem < KEY_SIZE) {
+        return r;
+    }
+
+    // Keys are full and equal: compare remainder.
+    depth += KEY_SIZE;
+    la = a->len - depth;
+    lb = b->len - depth;
+
+    r = memcmp(&a->buf[depth], &b->buf[depth], (la < lb) ? la : lb);
+    if (r != 0) {
+        return r;
+    }
+
+    return (la > lb) - (la < lb);
+}
+
+static void swap_items(struct item *a, struct item *b)
+{
+    struct item tmp = *a;
+    *a = *b;
+    *b = tmp;
+}
+
+static void insertion_sort(struct item *a, size_t n, size_t depth)
+{
+    size_t i;
+    size_t j;
+
+    for (i = 1; i < n; ++i) {
+        for (j = i; j > 0 && compare_items(&a[j - 1], &a[j], depth) > 0; --j) {
+            swap_items(&a[j - 1], &a[j]);
+        }
+    }
+}
+
+/// @return Index of median of three items, by key.
+static size_t median_of_three(const struct item *a, size_t i, size_t j, size_t k)
+{
+    if (compare_keys(&a[i], &a[j]) < 0) {
+        if (compare_keys(&a[j], &a[k]) < 0) {
+            return j;
+        }
+        return (compare_keys(&a[i], &a[k]) < 0) ? k : i;
+    }
+
+    if (compare_keys(&a[k], &a[j]) < 0) {
+        return j;
+    }
+    return (compare_keys(&a[k], &a[i]) < 0) ? k : i;
+}
+
+static void sort_range(struct item *a, size_t n, size_t depth, unsigned threads);
+
+/// Work for another thread.
+struct task {
+    struct item *a;
+    size_t n;
+    size_t depth;
+    unsigned threads;
+};
+
+static void *sort_task(void *arg)
+{
+    struct task *task = arg;
+
+    sort_range(task->a, task->n, task->depth, task->threads);
+    return NULL;
+}
+
+/// Multikey quicksort of @c n items whose strings are equal up to @c depth, and whose keys are loaded at @c depth.
+static void sort_range(struct item *a, size_t n, size_t depth, unsigned threads)
+{
+    struct task parts[3];
+    struct item pivot;
+    struct task task;
+    pthread_t thread;
+    bool spawned = false;
+    bool handed;
+    size_t largest;
+    size_t lt;
+    size_t gt;
+    size_t i;
+
+    while (n > INSERTION_SORT_MAX) {
+        // Three-way partition by key: [0, lt) < pivot, [lt, gt) == pivot, [gt, n) > pivot.
+        pivot = a[median_of_three(a, 0, n / 2, n - 1)];
+        lt = 0;
+        gt = n;
+        i = 0;
+        while (i < gt) {
+            int r = compare_keys(&a[i], &pivot);
+            if (r < 0) {
+                swap_items(&a[lt++], &a[i++]);
+            } else if (r > 0) {
+                swap_items(&a[i], &a[--gt]);
+            } else {
+                i++;
+            }
+        }
+
+        // Hand the lower range to another thread, if worthwhile, once the previous one has finished.
+        handed = false;
+        if (threads > 1 && lt >= PARALLEL_MIN) {
+            if (spawned) {
+                pthread_join(thread, NULL);
+                threads += task.threads;
+            }
+            task.a = a;
+            task.n = lt;
+            task.depth = depth;
+            task.threads = threads / 2;
+            spawned = pthread_create(&thread, NULL, sort_task, &task) == 0;
+            if (spawned) {
+                threads -= task.threads;
+                handed = true;
+            }
+        }
+
+        // Ranges left: lower and upper on the same key, and equal on the next key, unless it holds identical strings.
+        parts[0] = (struct task){ a, handed ? 0 : lt, depth, threads };
+        parts[1] = (struct task){ &a[gt], n - gt, depth, threads };
+        parts[2] = (struct task){ &a[lt], pivot.rem < KEY_SIZE ? 0 : gt - lt, depth + KEY_SIZE, threads };
+        for (i = 0; i < parts[2].n; ++i) {
+            load_key(&parts[2].a[i], parts[2].depth);
+        }
+
+        // Recurse into the smaller ranges, each at most half of this one, and continue with the largest,
+        // so that the depth of recursion is logarithmic.
+        largest = 0;
+        for (i = 1; i < 3; ++i) {
+            if (parts[i].n > parts[largest].n) {
+                largest = i;
+            }
+        }
+        for (i = 0; i < 3; ++i) {
+            if (i != largest) {
+                sort_range(parts[i].a, parts[i].n, parts[i].depth, parts[i].threads);
+            }
+        }
+
+        a = parts[largest].a;
+        n = parts[largest].n;
+        depth = parts[largest].depth;
+    }
+
+    insertion_sort(a, n, depth);
+
+    if (spawned) {
+        pthread_join(thread, NULL);
+    }
+}
+
+/// Allocate items for @c n strings.
+/// @return Pointer to items on success, NULL on failure.
+static struct item *new_items(size_t n)
+{
+    struct item *items;
+
+    if (n > SIZE_MAX / sizeof(struct item)) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    items = malloc(n * sizeof(struct item));
+    if (!items) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    return items;
+}
+
+int string_sort_parallel(struct string **arr, size_t n, unsigned threads)
+{
+    struct item *items;
+    size_t i;
+
+    if (!arr) {
+        return -EFAULT;
+    }
+
+    if (n == 0) {
+        return 0;
+    }
+
+    items = new_items(n);
+    if (!items) {
+        return -errno;
+    }
+
+    for (i = 0; i < n; ++i) {
+        struct string_view view = string_as_view(arr[i]);
+
+        if (!view.buf) {
+            free(items);
+            return arr[i] ? -ENOMEM : -EFAULT;
+        }
+
+        items[i].buf = view.buf;
+        items[i].len = view.len;
+        items[i].ref = arr[i];
+        load_key(&items[i], 0);
+    }
+
+    sort_range(items, n, 0, threads);
+
+    for (i = 0; i < n; ++i) {
+        arr[i] = items[i].ref;
+    }
+
+    free(items);
+    return 0;
+}
+
+int string_sort(struct string **arr, size_t n)
+{
+    return string_sort_parallel(arr, n, 1);
+}
+
+int string_view_sort_parallel(struct string_view *views, size_t n, unsigned threads)
+{
+    struct item *items;
+    size_t i;
+
+    if (!views) {
+        return -EFAULT;
+    }
+
+    if (n == 0) {
+        return 0;
+    }
+
+    items = new_items(n);
+    if (!items) {
+        return -errno;
+    }
+
+    for (i = 0; i < n; ++i) {
+        if (!views[i].buf) {
+            free(items);
+            return -EFAULT;
+        }
+
+        items[i].buf = views[i].buf;
+        items[i].len = views[i].len;
+        items[i].ref = NULL;
+        load_key(&items[i], 0);
+    }
+
+    sort_range(items, n, 0, threads);
+
+    for (i = 0; i < n; ++i) {
+        views[i].buf = items[i].buf;
+        views[i].len = items[i].len;
+    }
+
+    free(items);
+    return 0;
+}
+
+int string_view_sort(struct string_view *views, size_t n)
+{
+    return string_view_sort_parallel(views, n, 1);
+}
@@ -0,0 +1,38 @@
+#ifndef LIBCSTRING_STRING_SORT_H_
+#define LIBCSTRING_STRING_SORT_H_
+
+/// String sorting.
+///
+/// Sorts arrays of strings in lexicographic order, as unsigned characters.
+/// A string that is a prefix of another orders first.
+///
+/// Multikey quicksort partitions on cached 8-character prefix keys, so that
+/// characters are compared a word at a time, and prefixes shared by many strings
+/// are not compared again once the strings have been grouped by them.
+/// The sort is not stable.
+///
+/// Functions follow the return type conventions described in cstring.h.
+
+#include "cstring.h"
+
+/// Sort array of @c n strings.
+/// @return Zero on success, negative errno otherwise.
+///   - EFAULT: NULL pointer argument (including an element of the array).
+///   - ENOMEM: Insufficient memory, including to expand compressed strings (see string_compress()).
+/// @note Compressed strings are expanded, which writes to them: strings shared with concurrent readers
+///       must not be compressed, or must be expanded (for example by string_as_view()) beforehand.
+int string_sort(struct string **, size_t n) PUBLIC;
+
+/// Sort array of @c n strings, using up to @c threads threads for large arrays.
+/// @see string_sort.
+int string_sort_parallel(struct string **, size_t n, unsigned threads) PUBLIC;
+
+/// Sort array of @c n views.
+/// @see string_sort.
+int string_view_sort(struct string_view *, size_t n) PUBLIC;
+
+/// Sort array of @c n views, using up to @c threads threads for large arrays.
+/// @see string_sort.
+int string_view_sort_parallel(struct string_view *, size_t n, unsigned threads) PUBLIC;
+
+#endif // LIBCSTRING_STRING_SORT_H_
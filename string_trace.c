@@ -0,0 +1,805 @@
+#include "string_trace.h"
+
+#include "cstring_private.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/// Size of the buffer of the trace being decoded.
+#define READ_BUFFER ((size_t)1 << 16)
+
+/// Initial number of slots of the table of objects, a power of two.
+#define TABLE_MIN 64
+
+/// Object of a trace, by the address it was recorded with.
+struct slot {
+    uintptr_t id;
+    /// NULL if the slot is free, or the object was deleted.
+    struct string *str;
+};
+
+struct replay {
+    int fd;
+    /// Characters read but not yet decoded are at [begin, end).
+    size_t begin;
+    size_t end;
+    bool eof;
+    /// Object of the previous record.
+    uintptr_t prev;
+    /// Open addressing table, with linear probing; slots are never freed, as addresses are reused.
+    struct slot *slots;
+    size_t nslots;
+    size_t used;
+    size_t live;
+    size_t live_max;
+    /// Content used in place of recorded characters, of @c scratch elements each.
+    char *text;
+    uint16_t *text16;
+    uint32_t *text32;
+    size_t scratch;
+    char buf[READ_BUFFER];
+};
+
+/// @return Slot of the object recorded as @c id, which is either free or holds it.
+static struct slot *slot_find(const struct replay *rp, uintptr_t id)
+{
+    size_t mask = rp->nslots - 1;
+    size_t i = (size_t)((id * UINT64_C(0x9e3779b97f4a7c15)) >> 32) & mask;
+
+    while (rp->slots[i].id != id && rp->slots[i].id != 0) {
+        i = (i + 1) & mask;
+    }
+    return &rp->slots[i];
+}
+
+/// Double the number of slots of the table.
+/// @return Zero on success, negative errno otherwise.
+static int table_grow(struct replay *rp)
+{
+    struct slot *old = rp->slots;
+    size_t n = rp->nslots;
+    size_t i;
+
+    rp->slots = calloc(2 * n, sizeof(struct slot));
+    if (!rp->slots) {
+        rp->slots = old;
+        return -ENOMEM;
+    }
+
+    rp->nslots = 2 * n;
+    for (i = 0; i < n; ++i) {
+        if (old[i].id != 0) {
+            *slot_find(rp, old[i].id) = old[i];
+        }
+    }
+    free(old);
+    return 0;
+}
+
+/// Get the slot of the object recorded as @c id, adding it if missing.
+/// @return Slot on success, NULL on failure.
+static struct slot *slot_get(struct replay *rp, uintptr_t id)
+{
+    struct slot *slot = slot_find(rp, id);
+
+    if (slot->id == 0) {
+        // At most half full.
+        if (2 * (rp->used + 1) > rp->nslots) {
+            if (table_grow(rp) < 0) {
+                return NULL;
+            }
+            slot = slot_find(rp, id);
+        }
+        slot->id = id;
+        ++rp->used;
+    }
+    return slot;
+}
+
+/// Store @c str in @c slot, deleting any previous object at that address.
+static void slot_store(struct replay *rp, struct slot *slot, struct string *str)
+{
+    if (slot->str) {
+        string_delete(slot->str);
+        --rp->live;
+    }
+
+    slot->str = str;
+    if (str && ++rp->live > rp->live_max) {
+        rp->live_max = rp->live;
+    }
+}
+
+/// Store @c str as the object recorded as @c id.
+/// @return Zero on success, negative errno otherwise (@c str is then deleted).
+static int object_set(struct replay *rp, uintptr_t id, struct string *str)
+{
+    struct slot *slot = slot_get(rp, id);
+
+    if (!slot) {
+        string_delete(str);
+        return -ENOMEM;
+    }
+
+    slot_store(rp, slot, str);
+    return 0;
+}
+
+/// Get the object recorded as @c id, creating it empty if it existed before recording started.
+/// @return Zero on success (with a NULL object for a NULL address), negative errno otherwise.
+static int object_get(struct replay *rp, uintptr_t id, struct string **str)
+{
+    struct slot *slot;
+
+    *str = NULL;
+    if (id == 0) {
+        return 0;
+    }
+
+    slot = slot_get(rp, id);
+    if (!slot) {
+        return -ENOMEM;
+    }
+
+    if (!slot->str) {
+        struct string *created = string_new();
+
+        if (!created) {
+            return -ENOMEM;
+        }
+        slot_store(rp, slot, created);
+    }
+
+    *str = slot->str;
+    return 0;
+}
+
+/// Forget the object recorded as @c id, which the replayed call deleted or is about to.
+static void object_forget(struct replay *rp, uintptr_t id)
+{
+    struct slot *slot = slot_find(rp, id);
+
+    if (slot->str) {
+        slot->str = NULL;
+        --rp->live;
+    }
+}
+
+/// Read more characters, after those not yet decoded.
+/// @return Zero on success, negative errno otherwise.
+static int fill(struct replay *rp)
+{
+    ssize_t r;
+
+    memmove(rp->buf, &rp->buf[rp->begin], rp->end - rp->begin);
+    rp->end -= rp->begin;
+    rp->begin = 0;
+
+    do {
+        r = read(rp->fd, &rp->buf[rp->end], READ_BUFFER - rp->end);
+    } while (r < 0 && errno == EINTR);
+
+    if (r < 0) {
+        return -errno;
+    }
+
+    rp->end += (size_t)r;
+    rp->eof = (r == 0);
+    return 0;
+}
+
+/// Decode the next field.
+/// @return Zero on success, negative errno otherwise (-ENODATA at the end of the trace, between records).
+static int next(struct replay *rp, size_t *v)
+{
+    size_t k;
+    int r;
+
+    for (;;) {
+        k = get_varint(&rp->buf[rp->begin], rp->end - rp->begin, v);
+        if (k == STRING_NPOS) {
+            return -EILSEQ;
+        }
+
+        if (k > 0) {
+            rp->begin += k;
+            return 0;
+        }
+
+        if (rp->eof) {
+            return (rp->begin == rp->end) ? -ENODATA : -EILSEQ;
+        }
+
+        r = fill(rp);
+        if (r < 0) {
+            return r;
+        }
+    }
+}
+
+/// Decode the next field, which must be present.
+/// @return Zero on success, negative errno otherwise.
+static int field(struct replay *rp, size_t *v)
+{
+    int r = next(rp, v);
+
+    return (r == -ENODATA) ? -EILSEQ : r;
+}
+
+/// Decode @c n fields into @c v.
+/// @return Zero on success, negative errno otherwise.
+static int fields(struct replay *rp, size_t n, size_t *v)
+{
+    size_t i;
+    int r;
+
+    for (i = 0; i < n; ++i) {
+        r = field(rp, &v[i]);
+        if (r < 0) {
+            return r;
+        }
+    }
+    return 0;
+}
+
+/// @return Address @c base plus the zigzag-encoded difference @c v.
+static uintptr_t undelta(uintptr_t base, size_t v)
+{
+    return base + (uintptr_t)((v >> 1) ^ (0 - (v & 1)));
+}
+
+/// Decode an object given as an argument of the record of @c id.
+/// @return Zero on success, negative errno otherwise.
+static int field_object(struct replay *rp, uintptr_t id, struct string **str)
+{
+    size_t v;
+    int r;
+
+    r = field(rp, &v);
+    if (r < 0) {
+        return r;
+    }
+
+    return object_get(rp, undelta(id, v), str);
+}
+
+/// Make the content used in place of recorded characters hold at least @c n elements, and a terminator.
+/// @return Zero on success, negative errno otherwise.
+static int scratch_reserve(struct replay *rp, size_t n)
+{
+    size_t cap = rp->scratch ? rp->scratch : TABLE_MIN;
+    size_t i;
+
+    if (n <= rp->scratch) {
+        return 0;
+    }
+
+    while (cap < n) {
+        cap = (cap > SIZE_MAX / 8) ? n : 2 * cap;
+    }
+
+    if (cap >= SIZE_MAX / sizeof(uint32_t)) {
+        return -ENOMEM;
+    }
+
+    free(rp->text);
+    free(rp->text16);
+    free(rp->text32);
+    rp->text = malloc(cap + 1);
+    rp->text16 = malloc(cap * sizeof(uint16_t));
+    rp->text32 = malloc(cap * sizeof(uint32_t));
+    rp->scratch = 0;
+    if (!rp->text || !rp->text16 || !rp->text32) {
+        return -ENOMEM;
+    }
+
+    memset(rp->text, 'x', cap);
+    rp->text[cap] = 0;
+    for (i = 0; i < cap; ++i) {
+        rp->text16[i] = 'x';
+        rp->text32[i] = 'x';
+    }
+    rp->scratch = cap;
+    return 0;
+}
+
+/// Replay a call of string_apply_edits().
+/// @return Zero on success, negative errno otherwise.
+static int replay_edits(struct replay *rp, struct string *str)
+{
+    struct string_edit *edits;
+    size_t n;
+    size_t i;
+    int r;
+
+    r = field(rp, &n);
+    if (r < 0) {
+        return r;
+    }
+
+    edits = (n <= SIZE_MAX / sizeof(struct string_edit)) ? malloc(n * sizeof(struct string_edit) + 1) : NULL;
+    if (!edits) {
+        return -ENOMEM;
+    }
+
+    for (i = 0; i < n && r == 0; ++i) {
+        size_t v[3];
+
+        r = fields(rp, 3, v);
+        if (r == 0) {
+            edits[i].pos = v[0];
+            edits[i].len = v[1];
+            edits[i].n = v[2];
+            r = scratch_reserve(rp, v[2]);
+        }
+    }
+
+    // Content pointers are only taken once the scratch content is final.
+    for (i = 0; i < n && r == 0; ++i) {
+        edits[i].s = rp->text;
+    }
+
+    if (r == 0) {
+        string_apply_edits(str, edits, n);
+    }
+    free(edits);
+    return r;
+}
+
+/// Replay a call of string_join().
+/// @return Zero on success, negative errno otherwise.
+static int replay_join(struct replay *rp, uintptr_t id, struct string *str)
+{
+    struct string **parts;
+    struct string *sep;
+    size_t n;
+    size_t i;
+    int r;
+
+    r = field_object(rp, id, &sep);
+    if (r == 0) {
+        r = field(rp, &n);
+    }
+
+    if (r < 0) {
+        return r;
+    }
+
+    parts = (n <= SIZE_MAX / sizeof(struct string *)) ? malloc(n * sizeof(struct string *) + 1) : NULL;
+    if (!parts) {
+        return -ENOMEM;
+    }
+
+    for (i = 0; i < n && r == 0; ++i) {
+        r = field_object(rp, id, &parts[i]);
+    }
+
+    if (r == 0) {
+        string_join(str, sep, parts, n);
+    }
+    free(parts);
+    return r;
+}
+
+/// Replay a call of string_join_buffer().
+/// @return Zero on success, negative errno otherwise.
+static int replay_join_buffer(struct replay *rp, struct string *str)
+{
+    const char **parts;
+    size_t *lens;
+    size_t seplen;
+    size_t n;
+    size_t i;
+    int r;
+
+    r = field(rp, &seplen);
+    if (r == 0) {
+        r = field(rp, &n);
+    }
+
+    if (r == 0) {
+        r = scratch_reserve(rp, seplen);
+    }
+
+    if (r < 0) {
+        return r;
+    }
+
+    parts = (n <= SIZE_MAX / sizeof(size_t)) ? malloc(n * sizeof(const char *) + 1) : NULL;
+    lens = parts ? malloc(n * sizeof(size_t) + 1) : NULL;
+    if (!lens) {
+        free(parts);
+        return -ENOMEM;
+    }
+
+    for (i = 0; i < n && r == 0; ++i) {
+        r = field(rp, &lens[i]);
+        if (r == 0) {
+            r = scratch_reserve(rp, lens[i]);
+        }
+    }
+
+    for (i = 0; i < n && r == 0; ++i) {
+        parts[i] = rp->text;
+    }
+
+    if (r == 0) {
+        string_join_buffer(str, seplen, rp->text, parts, lens, n);
+    }
+    free(parts);
+    free(lens);
+    return r;
+}
+
+/// @return Number of characters (or code units) passed to operation @c op, with arguments @c v.
+static size_t characters(size_t op, const size_t *v)
+{
+    switch (op) {
+    case STRING_TRACE_INSERT_BUFFER:
+    case STRING_TRACE_INSERT_C_STR:
+    case STRING_TRACE_CASE_FIND:
+        return v[1];
+    case STRING_TRACE_APPEND_BUFFER:
+    case STRING_TRACE_APPEND_C_STR:
+    case STRING_TRACE_STARTS_WITH:
+    case STRING_TRACE_ENDS_WITH:
+    case STRING_TRACE_ASSIGN_BUFFER:
+    case STRING_TRACE_UTF8_TO_UTF16:
+    case STRING_TRACE_UTF8_TO_UTF32:
+    case STRING_TRACE_APPEND_UTF16:
+    case STRING_TRACE_APPEND_UTF32:
+        return v[0];
+    default:
+        return 0;
+    }
+}
+
+/// Replay an operation that takes arguments of sizes, into @c v.
+/// @return Zero on success, negative errno otherwise.
+static int replay_sized(struct replay *rp, size_t op, struct string *str, const size_t *v)
+{
+    size_t k;
+    char *p;
+    int r;
+
+    r = scratch_reserve(rp, characters(op, v));
+    if (r < 0) {
+        return r;
+    }
+
+    switch (op) {
+    case STRING_TRACE_RESERVE:
+        string_reserve(str, v[0]);
+        break;
+    case STRING_TRACE_AT:
+        string_at(str, v[0]);
+        break;
+    case STRING_TRACE_INSERT_BUFFER:
+        string_insert_buffer(str, v[0], v[1], rp->text);
+        break;
+    case STRING_TRACE_INSERT_C_STR:
+        rp->text[v[1]] = 0;
+        string_insert_c_str(str, v[0], rp->text);
+        rp->text[v[1]] = (v[1] < rp->scratch) ? 'x' : 0;
+        break;
+    case STRING_TRACE_INSERT_FILL:
+        string_insert_fill(str, v[0], v[1], 'x');
+        break;
+    case STRING_TRACE_ERASE:
+        string_erase(str, v[0], v[1]);
+        break;
+    case STRING_TRACE_APPEND_BUFFER:
+        string_append_buffer(str, v[0], rp->text);
+        break;
+    case STRING_TRACE_APPEND_C_STR:
+        rp->text[v[0]] = 0;
+        string_append_c_str(str, rp->text);
+        rp->text[v[0]] = (v[0] < rp->scratch) ? 'x' : 0;
+        break;
+    case STRING_TRACE_APPEND_FILL:
+        string_append_fill(str, v[0], 'x');
+        break;
+    case STRING_TRACE_CASE_FIND:
+        string_case_find(str, v[0], v[1], rp->text);
+        break;
+    case STRING_TRACE_STARTS_WITH:
+        string_starts_with(str, v[0], rp->text);
+        break;
+    case STRING_TRACE_ENDS_WITH:
+        string_ends_with(str, v[0], rp->text);
+        break;
+    case STRING_TRACE_HASH_TRACK:
+        string_hash_track(str, v[0] != 0);
+        break;
+    case STRING_TRACE_ASSIGN_BUFFER:
+        string_assign_buffer(str, v[0], rp->text);
+        break;
+    case STRING_TRACE_RESIZE_UNINIT:
+        // Written, as by the caller.
+        p = string_resize_uninit(str, v[0]);
+        if (p) {
+            memset(p, 'x', v[0]);
+        }
+        break;
+    case STRING_TRACE_RESERVE_TAIL:
+        p = string_reserve_tail(str, v[0]);
+        if (p) {
+            memset(p, 'x', v[0]);
+        }
+        break;
+    case STRING_TRACE_COMMIT:
+        string_commit(str, v[0]);
+        break;
+    case STRING_TRACE_UTF8_TO_UTF16:
+        k = v[0];
+        string_utf8_to_utf16(str, k ? rp->text16 : NULL, &k);
+        break;
+    case STRING_TRACE_UTF8_TO_UTF32:
+        k = v[0];
+        string_utf8_to_utf32(str, k ? rp->text32 : NULL, &k);
+        break;
+    case STRING_TRACE_APPEND_UTF16:
+        string_append_utf16(str, v[0], rp->text16);
+        break;
+    case STRING_TRACE_APPEND_UTF32:
+        string_append_utf32(str, v[0], rp->text32);
+        break;
+    default:
+        string_compress(str, v[0]);
+        break;
+    }
+    return 0;
+}
+
+/// Replay the record of operation @c op on the object recorded as @c id.
+/// @return Zero on success, negative errno otherwise.
+static int replay_record(struct replay *rp, size_t op, uintptr_t id)
+{
+    struct string *str = NULL;
+    struct string *other;
+    size_t v[3];
+    char *buf;
+    int r;
+
+    // Constructors record the new object.
+    if (op != STRING_TRACE_NEW && op != STRING_TRACE_NEW_ADOPT) {
+        r = object_get(rp, id, &str);
+        if (r < 0) {
+            return r;
+        }
+    }
+
+    switch (op) {
+    case STRING_TRACE_NEW:
+        return object_set(rp, id, string_new());
+    case STRING_TRACE_NEW_ADOPT:
+        r = fields(rp, 2, v);
+        if (r < 0) {
+            return r;
+        }
+
+        // Invalid arguments fail, as they did when recorded.
+        buf = (v[0] <= v[1] && v[1] < SIZE_MAX) ? malloc(v[1] + 1) : NULL;
+        str = buf ? string_new_adopt(memset(buf, 'x', v[0]), v[0], v[1]) : NULL;
+        if (!str) {
+            free(buf);
+            return 0;
+        }
+        return object_set(rp, id, str);
+    case STRING_TRACE_DELETE:
+        object_forget(rp, id);
+        string_delete(str);
+        return 0;
+    case STRING_TRACE_MOVE:
+    case STRING_TRACE_SWAP:
+    case STRING_TRACE_CASECMP:
+    case STRING_TRACE_EQUAL:
+    case STRING_TRACE_COMPARE:
+    case STRING_TRACE_COMMON_PREFIX:
+        r = field_object(rp, id, &other);
+        if (r < 0) {
+            return r;
+        }
+
+        if (op == STRING_TRACE_MOVE) {
+            string_move(str, other);
+        } else if (op == STRING_TRACE_SWAP) {
+            string_swap(str, other);
+        } else if (op == STRING_TRACE_CASECMP) {
+            string_casecmp(str, other);
+        } else if (op == STRING_TRACE_EQUAL) {
+            string_equal(str, other);
+        } else if (op == STRING_TRACE_COMPARE) {
+            string_compare(str, other);
+        } else {
+            string_common_prefix(str, other);
+        }
+        return 0;
+    case STRING_TRACE_C_STR:
+        string_c_str(str);
+        return 0;
+    case STRING_TRACE_AS_VIEW:
+        string_as_view(str);
+        return 0;
+    case STRING_TRACE_C_STR_MOVE:
+        free(string_c_str_move(str));
+        return 0;
+    case STRING_TRACE_CLEAR:
+        string_clear(str);
+        return 0;
+    case STRING_TRACE_APPLY_EDITS:
+        return replay_edits(rp, str);
+    case STRING_TRACE_PUSH_BACK:
+        string_push_back(str, 'x');
+        return 0;
+    case STRING_TRACE_POP_BACK:
+        string_pop_back(str);
+        return 0;
+    case STRING_TRACE_TO_LOWER:
+        string_to_lower(str);
+        return 0;
+    case STRING_TRACE_TO_UPPER:
+        string_to_upper(str);
+        return 0;
+    case STRING_TRACE_HASH:
+        string_hash(str);
+        return 0;
+    case STRING_TRACE_JOIN:
+        return replay_join(rp, id, str);
+    case STRING_TRACE_JOIN_BUFFER:
+        return replay_join_buffer(rp, str);
+    case STRING_TRACE_UTF8_VALIDATE:
+        string_utf8_validate(str);
+        return 0;
+    case STRING_TRACE_UTF8_LENGTH:
+        string_utf8_length(str);
+        return 0;
+    case STRING_TRACE_SUBSTR:
+        r = field(rp, &v[0]);
+        if (r == 0) {
+            r = fields(rp, 2, &v[1]);
+        }
+
+        if (r < 0) {
+            return r;
+        }
+
+        other = string_substr(str, v[1], v[2]);
+        return other ? object_set(rp, undelta(id, v[0]), other) : 0;
+    case STRING_TRACE_INSERT_BUFFER:
+    case STRING_TRACE_INSERT_C_STR:
+    case STRING_TRACE_INSERT_FILL:
+    case STRING_TRACE_ERASE:
+    case STRING_TRACE_CASE_FIND:
+        r = fields(rp, 2, v);
+        return (r < 0) ? r : replay_sized(rp, op, str, v);
+    case STRING_TRACE_RESERVE:
+    case STRING_TRACE_AT:
+    case STRING_TRACE_APPEND_BUFFER:
+    case STRING_TRACE_APPEND_C_STR:
+    case STRING_TRACE_APPEND_FILL:
+    case STRING_TRACE_STARTS_WITH:
+    case STRING_TRACE_ENDS_WITH:
+    case STRING_TRACE_HASH_TRACK:
+    case STRING_TRACE_ASSIGN_BUFFER:
+    case STRING_TRACE_RESIZE_UNINIT:
+    case STRING_TRACE_RESERVE_TAIL:
+    case STRING_TRACE_COMMIT:
+    case STRING_TRACE_UTF8_TO_UTF16:
+    case STRING_TRACE_UTF8_TO_UTF32:
+    case STRING_TRACE_APPEND_UTF16:
+    case STRING_TRACE_APPEND_UTF32:
+    case STRING_TRACE_COMPRESS:
+        r = field(rp, v);
+        return (r < 0) ? r : replay_sized(rp, op, str, v);
+    default:
+        return -EILSEQ;
+    }
+}
+
+/// Replay all records, counting them.
+/// @return Zero on success, negative errno otherwise.
+static int replay_all(struct replay *rp, size_t *calls)
+{
+    size_t op;
+    size_t v;
+    int r;
+
+    for (;;) {
+        r = next(rp, &op);
+        if (r == -ENODATA) {
+            return 0;
+        }
+
+        if (r == 0) {
+            r = field(rp, &v);
+        }
+
+        if (r < 0) {
+            return r;
+        }
+
+        rp->prev = undelta(rp->prev, v);
+        r = replay_record(rp, op, rp->prev);
+        if (r < 0) {
+            return r;
+        }
+        ++*calls;
+    }
+}
+
+/// @return Monotonic time, in nanoseconds.
+static uint64_t now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+int string_trace_replay(int fd, struct string_trace_stats *stats)
+{
+    struct string_trace_stats result = { 0, 0, 0, 0, 0 };
+    struct replay *rp = NULL;
+    size_t magic = strlen(STRING_TRACE_MAGIC);
+    size_t allocations;
+    size_t used;
+    size_t i;
+    int r;
+
+    if (!stats) {
+        return -EFAULT;
+    }
+
+    rp = calloc(1, sizeof(struct replay));
+    if (!rp) {
+        return -ENOMEM;
+    }
+
+    rp->fd = fd;
+    rp->nslots = TABLE_MIN;
+    rp->slots = calloc(rp->nslots, sizeof(struct slot));
+    r = rp->slots ? 0 : -ENOMEM;
+
+    // The header fits in the buffer.
+    while (r == 0 && !rp->eof && rp->end < magic) {
+        r = fill(rp);
+    }
+
+    if (r == 0 && (rp->end < magic || memcmp(rp->buf, STRING_TRACE_MAGIC, magic) != 0)) {
+        r = -EILSEQ;
+    }
+
+    if (r == 0) {
+        rp->begin = magic;
+        allocations = string_memory_allocations();
+        used = string_memory_total();
+        string_memory_peak_reset();
+        result.nanoseconds = now();
+
+        r = replay_all(rp, &result.calls);
+
+        result.nanoseconds = now() - result.nanoseconds;
+        result.peak = string_memory_peak() - used;
+        result.allocations = string_memory_allocations() - allocations;
+        result.objects = rp->live_max;
+    }
+
+    for (i = 0; i < rp->nslots && rp->slots; ++i) {
+        string_delete(rp->slots[i].str);
+    }
+    free(rp->slots);
+    free(rp->text);
+    free(rp->text16);
+    free(rp->text32);
+    free(rp);
+
+    if (r == 0) {
+        *stats = result;
+    }
+    return r;
+}
@@ -0,0 +1,134 @@
+#ifndef LIBCSTRING_STRING_TRACE_H_
+#define LIBCSTRING_STRING_TRACE_H_
+
+/// Replay of traces of calls to this library.
+///
+/// A trace, recorded with string_trace_start(), holds the sequence of calls made by an
+/// application, so that changes to this library (such as its growth policy or the size of
+/// internal storage) can be measured against real traffic rather than synthetic benchmarks.
+///
+/// The trace starts with the 8 characters of STRING_TRACE_MAGIC, followed by one record per
+/// call. Every field of a record is an unsigned LEB128 varint: the operation, the object as
+/// the zigzag-encoded difference between its address and that of the previous record, then
+/// the arguments listed for the operation. Objects given as arguments are encoded as the
+/// zigzag-encoded difference from the object of the record. Characters are never recorded.
+///
+/// Functions follow the return type conventions described in cstring.h.
+
+#include "cstring.h"
+
+/// First characters of a trace, identifying the format and its version.
+#define STRING_TRACE_MAGIC "CSTRACE1"
+
+/// Operations of records, and their arguments.
+/// Constructors are recorded once they succeed, with the new object; other calls before executing.
+enum string_trace_op {
+    STRING_TRACE_NEW = 1,
+    /// len, cap.
+    STRING_TRACE_NEW_ADOPT = 2,
+    STRING_TRACE_DELETE = 3,
+    /// src object.
+    STRING_TRACE_MOVE = 4,
+    /// b object.
+    STRING_TRACE_SWAP = 5,
+    /// cap.
+    STRING_TRACE_RESERVE = 6,
+    /// pos.
+    STRING_TRACE_AT = 7,
+    STRING_TRACE_C_STR = 8,
+    STRING_TRACE_AS_VIEW = 9,
+    STRING_TRACE_C_STR_MOVE = 10,
+    STRING_TRACE_CLEAR = 11,
+    /// pos, n.
+    STRING_TRACE_INSERT_BUFFER = 12,
+    /// pos, n (the length of the C string).
+    STRING_TRACE_INSERT_C_STR = 13,
+    /// pos, n.
+    STRING_TRACE_INSERT_FILL = 14,
+    /// pos, len.
+    STRING_TRACE_ERASE = 15,
+    /// n, then pos, len and n of each edit.
+    STRING_TRACE_APPLY_EDITS = 16,
+    STRING_TRACE_PUSH_BACK = 17,
+    STRING_TRACE_POP_BACK = 18,
+    /// n.
+    STRING_TRACE_APPEND_BUFFER = 19,
+    /// n (the length of the C string).
+    STRING_TRACE_APPEND_C_STR = 20,
+    /// n.
+    STRING_TRACE_APPEND_FILL = 21,
+    STRING_TRACE_TO_LOWER = 22,
+    STRING_TRACE_TO_UPPER = 23,
+    /// b object.
+    STRING_TRACE_CASECMP = 24,
+    /// pos, n.
+    STRING_TRACE_CASE_FIND = 25,
+    /// b object.
+    STRING_TRACE_EQUAL = 26,
+    /// b object.
+    STRING_TRACE_COMPARE = 27,
+    /// n.
+    STRING_TRACE_STARTS_WITH = 28,
+    /// n.
+    STRING_TRACE_ENDS_WITH = 29,
+    /// b object.
+    STRING_TRACE_COMMON_PREFIX = 30,
+    STRING_TRACE_HASH = 31,
+    /// enable.
+    STRING_TRACE_HASH_TRACK = 32,
+    /// n.
+    STRING_TRACE_ASSIGN_BUFFER = 33,
+    /// n.
+    STRING_TRACE_RESIZE_UNINIT = 34,
+    /// n.
+    STRING_TRACE_RESERVE_TAIL = 35,
+    /// n.
+    STRING_TRACE_COMMIT = 36,
+    /// sep object, n, then the n part objects.
+    STRING_TRACE_JOIN = 37,
+    /// seplen, n, then the n part lengths.
+    STRING_TRACE_JOIN_BUFFER = 38,
+    STRING_TRACE_UTF8_VALIDATE = 39,
+    STRING_TRACE_UTF8_LENGTH = 40,
+    /// n (capacity of the buffer, or zero to measure only).
+    STRING_TRACE_UTF8_TO_UTF16 = 41,
+    /// n (capacity of the buffer, or zero to measure only).
+    STRING_TRACE_UTF8_TO_UTF32 = 42,
+    /// n.
+    STRING_TRACE_APPEND_UTF16 = 43,
+    /// n.
+    STRING_TRACE_APPEND_UTF32 = 44,
+    /// Recorded with the source string: substring object, pos, len.
+    STRING_TRACE_SUBSTR = 45,
+    /// min_size.
+    STRING_TRACE_COMPRESS = 46,
+};
+
+/// Measurements of a replay.
+struct string_trace_stats {
+    /// Number of calls replayed.
+    size_t calls;
+    /// Highest number of string objects alive at once.
+    size_t objects;
+    /// Allocations requested by this library (see string_memory_allocations()).
+    size_t allocations;
+    /// Highest number of bytes held in string buffers, above those held before the replay.
+    size_t peak;
+    /// Elapsed time, including decoding the trace.
+    uint64_t nanoseconds;
+};
+
+/// Replay the trace read from @c fd, and measure it.
+/// Each recorded call is executed again, with characters of its own in place of the recorded
+/// content; results, including errors, are ignored. Objects that the trace uses without creating
+/// them (as they existed before recording started) are created empty, and objects still alive at
+/// the end of the trace are deleted. String objects must not be used by other threads meanwhile.
+/// @param stats Receives the measurements, on success.
+/// @return Zero on success, negative errno otherwise.
+///   - EFAULT: NULL pointer argument.
+///   - EILSEQ: Trace invalid, or truncated.
+///   - ENOMEM: Insufficient memory.
+///   - Any error of read().
+int string_trace_replay(int fd, struct string_trace_stats *stats) PUBLIC;
+
+#endif // LIBCSTRING_STRING_TRACE_H_
@@ -0,0 +1,264 @@
+#include "string_vec.h"
+
+#include "string_sort.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/// Growth factor for capacity when resizing.
+/// @see STRING_GROWTH_FACTOR.
+#define VEC_GROWTH_FACTOR 2
+
+/// Location of an element in the block of characters.
+struct entry {
+    /// Offset of first character.
+    size_t off;
+    /// Number of characters (excluding NUL terminator).
+    size_t len;
+};
+
+struct string_vec {
+    /// Characters of all elements, each NUL terminated.
+    char *chars;
+    /// Number of characters used, including NUL terminators.
+    size_t chars_len;
+    /// Capacity of @c chars.
+    size_t chars_cap;
+    /// Elements.
+    struct entry *entries;
+    /// Number of elements.
+    size_t count;
+    /// Capacity of @c entries.
+    size_t entries_cap;
+};
+
+struct string_vec *string_vec_new(void)
+{
+    struct string_vec *vec = NULL;
+
+    vec = calloc(1, sizeof(struct string_vec));
+    if (!vec) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    return vec;
+}
+
+void string_vec_delete(struct string_vec *vec)
+{
+    if (!vec) {
+        return;
+    }
+
+    free(vec->chars);
+    free(vec->entries);
+    free(vec);
+}
+
+size_t string_vec_size(const struct string_vec *vec)
+{
+    if (!vec) {
+        return 0;
+    }
+
+    return vec->count;
+}
+
+void string_vec_clear(struct string_vec *vec)
+{
+    if (!vec) {
+        return;
+    }
+
+    vec->chars_len = 0;
+    vec->count = 0;
+}
+
+/// Resize character storage to @c cap.
+/// @return Zero on success, negative errno otherwise.
+static int reserve_chars(struct string_vec *vec, size_t cap)
+{
+    char *chars;
+
+    // Precondition.
+    assert(vec);
+
+    if (cap <= vec->chars_cap) {
+        return 0;
+    }
+
+    chars = realloc(vec->chars, cap);
+    if (!chars) {
+        return -ENOMEM;
+    }
+
+    vec->chars = chars;
+    vec->chars_cap = cap;
+    return 0;
+}
+
+/// Resize element storage to @c cap.
+/// @return Zero on success, negative errno otherwise.
+static int reserve_entries(struct string_vec *vec, size_t cap)
+{
+    struct entry *entries;
+
+    // Precondition.
+    assert(vec);
+
+    if (cap <= vec->entries_cap) {
+        return 0;
+    }
+
+    if (cap > SIZE_MAX / sizeof(struct entry)) {
+        return -ENOMEM;
+    }
+
+    entries = realloc(vec->entries, cap * sizeof(struct entry));
+    if (!entries) {
+        return -ENOMEM;
+    }
+
+    vec->entries = entries;
+    vec->entries_cap = cap;
+    return 0;
+}
+
+/// Avoid performance issues with repeated small appends.
+/// @return New capacity to reserve.
+static size_t compute_growth(size_t current, size_t required)
+{
+    // If doubling would overflow SIZE_MAX, grow to exact required size instead.
+    return (current > SIZE_MAX / VEC_GROWTH_FACTOR || current * VEC_GROWTH_FACTOR < required) ? required : current * VEC_GROWTH_FACTOR;
+}
+
+int string_vec_reserve(struct string_vec *vec, size_t count, size_t chars)
+{
+    int r;
+
+    if (!vec) {
+        return -EFAULT;
+    }
+
+    if (count > SIZE_MAX - chars) {
+        // Check for overflow of space for NUL terminators.
+        return -ENOMEM;
+    }
+
+    r = reserve_entries(vec, count);
+    if (r < 0) {
+        return r;
+    }
+
+    return reserve_chars(vec, chars + count);
+}
+
+int string_vec_push_back(struct string_vec *vec, size_t n, const char *s)
+{
+    size_t required;
+    int r;
+
+    if (!vec) {
+        return -EFAULT;
+    }
+
+    if (!s) {
+        return -EFAULT;
+    }
+
+    if (n > SIZE_MAX - 1 - vec->chars_len) {
+        // Check for overflow.
+        return -ENOMEM;
+    }
+
+    required = vec->chars_len + n + 1;
+    if (required > vec->chars_cap) {
+        r = reserve_chars(vec, compute_growth(vec->chars_cap, required));
+        if (r < 0) {
+            return r;
+        }
+    }
+
+    if (vec->count == vec->entries_cap) {
+        r = reserve_entries(vec, compute_growth(vec->entries_cap, vec->count + 1));
+        if (r < 0) {
+            return r;
+        }
+    }
+
+    memcpy(&vec->chars[vec->chars_len], s, n);
+    vec->chars[vec->chars_len + n] = 0;
+
+    vec->entries[vec->count].off = vec->chars_len;
+    vec->entries[vec->count].len = n;
+    vec->count++;
+    vec->chars_len = required;
+    return 0;
+}
+
+int string_vec_push_back_string(struct string_vec *vec, const struct string *s)
+{
+    struct string_view view = string_as_view(s);
+
+    if (!view.buf) {
+        return -EFAULT;
+    }
+
+    return string_vec_push_back(vec, view.len, view.buf);
+}
+
+struct string_view string_vec_at(const struct string_vec *vec, size_t i)
+{
+    struct string_view view = { NULL, 0 };
+
+    if (!vec) {
+        return view;
+    }
+
+    if (i >= vec->count) {
+        return view;
+    }
+
+    view.buf = &vec->chars[vec->entries[i].off];
+    view.len = vec->entries[i].len;
+    return view;
+}
+
+int string_vec_sort(struct string_vec *vec)
+{
+    struct string_view *views;
+    size_t i;
+    int r;
+
+    if (!vec) {
+        return -EFAULT;
+    }
+
+    if (vec->count < 2) {
+        return 0;
+    }
+
+    views = calloc(vec->count, sizeof(struct string_view));
+    if (!views) {
+        return -ENOMEM;
+    }
+
+    for (i = 0; i < vec->count; ++i) {
+        views[i] = string_vec_at(vec, i);
+    }
+
+    r = string_view_sort(views, vec->count);
+    if (r == 0) {
+        for (i = 0; i < vec->count; ++i) {
+            vec->entries[i].off = (size_t)(views[i].buf - vec->chars);
+            vec->entries[i].len = views[i].len;
+        }
+    }
+
+    free(views);
+    return r;
+}
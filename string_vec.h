@@ -0,0 +1,76 @@
+#ifndef LIBCSTRING_STRING_VEC_H_
+#define LIBCSTRING_STRING_VEC_H_
+
+/// String vector.
+///
+/// Stores many strings in one contiguous block of characters, with an array of
+/// offsets, instead of one object and one allocation per string.
+///
+/// Functions follow the return type conventions described in cstring.h.
+
+#include "cstring.h"
+
+/// String vector object.
+///
+/// Elements are NUL terminated, so that the view of an element may also be used as a C string.
+///
+/// This library is **not** thread-safe.
+/// Caller must synchronize access to vector objects.
+/// Multiple readers are safe if no writers are active.
+struct string_vec;
+
+/// Constructor.
+/// Create a new empty vector.
+/// @return Pointer to vector on success.
+/// @return NULL on failure, and errno is set to:
+///   - ENOMEM: Insufficient memory.
+/// @note Memory ownership: Caller must string_vec_delete() the returned pointer.
+struct string_vec *string_vec_new(void) PUBLIC;
+
+/// Destructor.
+/// @note Memory ownership: Object takes ownership of the pointer.
+void string_vec_delete(struct string_vec *) PUBLIC;
+
+/// Get number of elements.
+/// @return The number of elements in the vector, or zero if empty or NULL.
+size_t string_vec_size(const struct string_vec *) PUBLIC;
+
+/// Erases all elements from the vector.
+/// Storage is kept for reuse.
+void string_vec_clear(struct string_vec *) PUBLIC;
+
+/// Reserves storage.
+/// @param count Number of elements.
+/// @param chars Total number of characters in all elements (excluding NUL terminators).
+/// @note Silently ignores reserving less storage than currently used.
+/// @return Zero on success, negative errno otherwise.
+///   - EFAULT: NULL pointer argument.
+///   - ENOMEM: Insufficient memory.
+int string_vec_reserve(struct string_vec *, size_t count, size_t chars) PUBLIC;
+
+/// Append element with @c n characters from buffer @c s.
+/// @return Zero on success, negative errno otherwise.
+///   - EFAULT: NULL pointer argument.
+///   - ENOMEM: Insufficient memory.
+/// @note Memory ownership: Caller retains ownership of @c s, which must not point into the vector's own storage.
+int string_vec_push_back(struct string_vec *, size_t n, const char *s) PUBLIC;
+
+/// Append element with the content of string @c s.
+/// @see string_vec_push_back.
+int string_vec_push_back_string(struct string_vec *, const struct string *s) PUBLIC;
+
+/// Get element at index.
+/// Iterate by calling this function for each index below string_vec_size().
+/// @return View of element, or an empty view with NULL @c buf if index invalid or vector invalid.
+/// @note Memory ownership: Owned by the object; valid until object modified or deleted.
+struct string_view string_vec_at(const struct string_vec *, size_t i) PUBLIC;
+
+/// Sort elements in lexicographic order, as unsigned characters.
+/// Only the offsets are permuted; characters are not moved.
+/// @see string_view_sort.
+/// @return Zero on success, negative errno otherwise.
+///   - EFAULT: NULL pointer argument.
+///   - ENOMEM: Insufficient memory.
+int string_vec_sort(struct string_vec *) PUBLIC;
+
+#endif // LIBCSTRING_STRING_VEC_H_
@@ -0,0 +1,237 @@
+#include "string_writer.h"
+
+#include "cstring_private.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+
+/// Number of strings written by one writev() call (not more than IOV_MAX).
+#define IOV_BATCH 64
+
+struct string_writer {
+    int fd;
+    void (*done)(void *ctx, struct string *str, int err);
+    void *ctx;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    /// Signalled when strings are submitted, or the writer is stopping.
+    pthread_cond_t work;
+    /// Signalled when all submitted strings have completed.
+    pthread_cond_t idle;
+    /// Strings submitted, waiting for the writer thread.
+    struct string **queue;
+    size_t queued;
+    size_t queue_cap;
+    /// Strings taken by the writer thread; swapped with @c queue to reuse both arrays.
+    struct string **batch;
+    size_t batch_cap;
+    /// Number of strings submitted but not completed.
+    size_t pending;
+    /// First error since the last flush, as negative errno.
+    int error;
+    bool stopping;
+};
+
+/// Write @c n strings in @c strs in order, and complete them.
+/// Writing stops at the first error, which may be @c first, reported before this batch: the remaining strings are
+/// completed with that error rather than written after a gap. A string whose compressed content cannot be expanded
+/// fails with -ENOMEM.
+/// @return Zero on success, or the first error as negative errno.
+static int write_batch(struct string_writer *w, struct string **strs, size_t n, int first)
+{
+    struct iovec iov[IOV_BATCH];
+    size_t i;
+
+    for (i = 0; i < n; i += IOV_BATCH) {
+        size_t count = (n - i < IOV_BATCH) ? n - i : IOV_BATCH;
+        size_t written = 0;
+        size_t k;
+
+        if (first == 0) {
+            for (k = 0; k < count; ++k) {
+                struct string_view v = string_as_view(strs[i + k]);
+
+                if (!v.buf) {
+                    break;
+                }
+                iov[k].iov_base = (void *)v.buf;
+                iov[k].iov_len = v.len;
+            }
+
+            // A failed write may have written part of the strings: none of them is reported as written.
+            first = write_all(w->fd, iov, (int)k);
+            if (first == 0) {
+                written = k;
+                first = (k < count) ? -ENOMEM : 0;
+            }
+        }
+
+        for (k = 0; k < count; ++k) {
+            int err = (k < written) ? 0 : first;
+
+            if (w->done) {
+                w->done(w->ctx, strs[i + k], err);
+            } else {
+                string_delete(strs[i + k]);
+            }
+        }
+    }
+
+    return first;
+}
+
+static void *writer_task(void *arg)
+{
+    struct string_writer *w = arg;
+
+    pthread_mutex_lock(&w->lock);
+    for (;;) {
+        struct string **strs;
+        size_t cap;
+        size_t n;
+        int error;
+        int r;
+
+        while (w->queued == 0 && !w->stopping) {
+            pthread_cond_wait(&w->work, &w->lock);
+        }
+        if (w->queued == 0) {
+            break;
+        }
+
+        // Take the queued strings, leaving the spare array for producers.
+        strs = w->queue;
+        cap = w->queue_cap;
+        n = w->queued;
+        w->queue = w->batch;
+        w->queue_cap = w->batch_cap;
+        w->queued = 0;
+        w->batch = strs;
+        w->batch_cap = cap;
+        error = w->error;
+        pthread_mutex_unlock(&w->lock);
+
+        r = write_batch(w, strs, n, error);
+
+        pthread_mutex_lock(&w->lock);
+        if (w->error == 0) {
+            w->error = r;
+        }
+        __atomic_store_n(&w->pending, w->pending - n, __ATOMIC_RELAXED);
+        if (w->pending == 0) {
+            pthread_cond_broadcast(&w->idle);
+        }
+    }
+    pthread_mutex_unlock(&w->lock);
+
+    return NULL;
+}
+
+struct string_writer *string_writer_new(int fd, void (*done)(void *ctx, struct string *str, int err), void *ctx)
+{
+    struct string_writer *w = NULL;
+    int r;
+
+    w = calloc(1, sizeof(struct string_writer));
+    if (!w) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    w->fd = fd;
+    w->done = done;
+    w->ctx = ctx;
+    pthread_mutex_init(&w->lock, NULL);
+    pthread_cond_init(&w->work, NULL);
+    pthread_cond_init(&w->idle, NULL);
+
+    r = pthread_create(&w->thread, NULL, writer_task, w);
+    if (r != 0) {
+        pthread_cond_destroy(&w->idle);
+        pthread_cond_destroy(&w->work);
+        pthread_mutex_destroy(&w->lock);
+        free(w);
+        errno = r;
+        return NULL;
+    }
+
+    return w;
+}
+
+void string_writer_delete(struct string_writer *w)
+{
+    if (!w) {
+        return;
+    }
+
+    pthread_mutex_lock(&w->lock);
+    w->stopping = true;
+    pthread_cond_signal(&w->work);
+    pthread_mutex_unlock(&w->lock);
+
+    pthread_join(w->thread, NULL);
+
+    pthread_cond_destroy(&w->idle);
+    pthread_cond_destroy(&w->work);
+    pthread_mutex_destroy(&w->lock);
+    free(w->queue);
+    free(w->batch);
+    free(w);
+}
+
+int string_writer_submit(struct string_writer *w, struct string *str)
+{
+    if (!w || !str) {
+        return -EFAULT;
+    }
+
+    pthread_mutex_lock(&w->lock);
+
+    if (w->queued == w->queue_cap) {
+        size_t cap = w->queue_cap ? 2 * w->queue_cap : IOV_BATCH;
+        struct string **queue = realloc(w->queue, cap * sizeof(struct string *));
+
+        if (!queue) {
+            pthread_mutex_unlock(&w->lock);
+            return -ENOMEM;
+        }
+        w->queue = queue;
+        w->queue_cap = cap;
+    }
+
+    w->queue[w->queued++] = str;
+    __atomic_store_n(&w->pending, w->pending + 1, __ATOMIC_RELAXED);
+    pthread_cond_signal(&w->work);
+
+    pthread_mutex_unlock(&w->lock);
+    return 0;
+}
+
+size_t string_writer_pending(const struct string_writer *w)
+{
+    if (!w) {
+        return 0;
+    }
+
+    return __atomic_load_n(&w->pending, __ATOMIC_RELAXED);
+}
+
+int string_writer_flush(struct string_writer *w)
+{
+    int r;
+
+    if (!w) {
+        return -EFAULT;
+    }
+
+    pthread_mutex_lock(&w->lock);
+    while (w->pending > 0) {
+        pthread_cond_wait(&w->idle, &w->lock);
+    }
+    r = w->error;
+    w->error = 0;
+    pthread_mutex_unlock(&w->lock);
+
+    return r;
+}
@@ -0,0 +1,64 @@
+#ifndef LIBCSTRING_STRING_WRITER_H_
+#define LIBCSTRING_STRING_WRITER_H_
+
+/// String writer.
+///
+/// Writes strings to a file descriptor from a background thread, so that
+/// producers hand over strings without waiting for I/O.
+///
+/// Strings submitted while a write is in progress are queued, and written
+/// together by the next batch of writev() calls, so that the number of system
+/// calls falls as the load rises. Each string is owned by the writer until it
+/// has been written, and is then handed to a completion callback, which may
+/// recycle it.
+///
+/// Functions follow the return type conventions described in cstring.h.
+
+#include "cstring.h"
+
+/// String writer object.
+///
+/// Unlike other objects in this library, writers are thread-safe: strings may be submitted concurrently from
+/// any number of threads. Creating and deleting a writer must not race with other calls.
+struct string_writer;
+
+/// Constructor.
+/// Create a new writer to @c fd, and start its thread.
+/// @param fd File descriptor, which is not closed by the writer; non-blocking descriptors are waited on with poll().
+/// @param done Called from the writer thread, in submission order, for each string once written, with zero or the
+///             negative errno of the failed write; -ENOMEM if its compressed content could not be expanded, and was
+///             not written. Called with @c ctx, and passed ownership of the string.
+///             If NULL, written strings are deleted.
+///             After an error, so that the output has no gaps, no string is written until string_writer_flush() has
+///             reported it: strings are completed with the same error instead.
+/// @return Pointer to writer on success.
+/// @return NULL on failure, and errno is set to:
+///   - EAGAIN: Insufficient resources to create a thread.
+///   - ENOMEM: Insufficient memory.
+/// @note Memory ownership: Caller must string_writer_delete() the returned pointer.
+struct string_writer *string_writer_new(int fd, void (*done)(void *ctx, struct string *str, int err), void *ctx) PUBLIC;
+
+/// Destructor.
+/// Waits for all submitted strings to be written, and stops the thread.
+/// @note Memory ownership: Object takes ownership of the pointer.
+void string_writer_delete(struct string_writer *) PUBLIC;
+
+/// Queue @c str to be written after the strings submitted before it.
+/// @return Zero on success, negative errno otherwise.
+///   - EFAULT: NULL pointer argument.
+///   - ENOMEM: Insufficient memory.
+/// @note Memory ownership: Writer takes ownership of @c str on success only, until passed to the callback.
+int string_writer_submit(struct string_writer *, struct string *str) PUBLIC;
+
+/// Get number of strings submitted but not yet completed, to poll for completion.
+/// @return The number of strings in flight, or zero if NULL.
+size_t string_writer_pending(const struct string_writer *) PUBLIC;
+
+/// Wait until all submitted strings have been written.
+/// @return Zero on success, negative errno otherwise.
+///   - EFAULT: NULL pointer argument.
+///   - ENOMEM: Compressed content of a string could not be expanded, if first since the last flush.
+///   - Any error of writev() or poll(), for the first write that failed since the last flush.
+int string_writer_flush(struct string_writer *) PUBLIC;
+
+#endif // LIBCSTRING_STRING_WRITER_H_
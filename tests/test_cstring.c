@@ -1,11 +1,15 @@
 #include "cstring.h"
+#include "cstring_inline.h"
+#include "string_trace.h"
 
 #include "memory_shim.h"
 
 #include <assert.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 /// @return True if string contains expected content, false otherwise.
 static bool verify_string_content(const struct string *s, const char *expected)
@@ -18,6 +22,15 @@ static bool verify_string_content(const struct string *s, const char *expected)
     return actual && strcmp(actual, expected) == 0;
 }
 
+// Gain access to string internals for test purposes.
+struct test_string {
+    size_t cap;
+    size_t len;
+    char *buf;
+    char sso[8];
+    unsigned flags;
+};
+
 static void test_string_new(void)
 {
     struct string *s = NULL;
@@ -39,6 +52,128 @@ static void test_string_delete(void)
     string_delete(s);
 }
 
+static void test_string_new_adopt(void)
+{
+    struct string *s = NULL;
+    char *buf = NULL;
+
+    errno = 0;
+    assert(NULL == string_new_adopt(NULL, 0, 0));
+    assert(EFAULT == errno);
+
+    buf = malloc(16);
+    memcpy(buf, "adopted", 7);
+
+    errno = 0;
+    assert(NULL == string_new_adopt(buf, 8, 7));
+    assert(ERANGE == errno);
+
+    errno = 0;
+    assert(NULL == string_new_adopt(buf, 7, SIZE_MAX));
+    assert(ERANGE == errno);
+
+    // Caller retains ownership on failure.
+    memory_shim_fail_at(1);
+    errno = 0;
+    assert(NULL == string_new_adopt(buf, 7, 15));
+    assert(ENOMEM == errno);
+    memory_shim_reset();
+
+    s = string_new_adopt(buf, 7, 15);
+    assert(NULL != s);
+    assert(buf == string_c_str(s));
+    assert(verify_string_content(s, "adopted"));
+    assert(15 == string_capacity(s));
+
+    // Usable as any other string.
+    assert(0 == string_append_c_str(s, " buffer that grows"));
+    assert(verify_string_content(s, "adopted buffer that grows"));
+
+    string_delete(s);
+}
+
+static void test_string_move(void)
+{
+    struct string *dst = NULL;
+    struct string *src = NULL;
+    const char *buf = NULL;
+
+    dst = string_new();
+    src = string_new();
+
+    assert(-EFAULT == string_move(NULL, src));
+    assert(-EFAULT == string_move(dst, NULL));
+
+    assert(0 == string_append_c_str(src, "abc"));
+    assert(0 == string_move(src, src));
+    assert(verify_string_content(src, "abc"));
+
+    // Small string.
+    assert(0 == string_move(dst, src));
+    assert(verify_string_content(dst, "abc"));
+    assert(verify_string_content(src, ""));
+    assert(7 == string_capacity(src));
+
+    // Allocated buffer is stolen, and previous content of destination released.
+    assert(0 == string_append_c_str(src, "a string that is allocated"));
+    assert(string_utf8_validate(src));
+    buf = string_c_str(src);
+    assert(0 == string_append_c_str(dst, " and also allocated"));
+    assert(0 == string_move(dst, src));
+    assert(buf == string_c_str(dst));
+    assert(verify_string_content(dst, "a string that is allocated"));
+    assert(string_utf8_validate(dst));
+    assert(verify_string_content(src, ""));
+    assert(7 == string_capacity(src));
+
+    string_delete(dst);
+    string_delete(src);
+}
+
+static void test_string_swap(void)
+{
+    struct string *a = NULL;
+    struct string *b = NULL;
+    const char *buf = NULL;
+
+    string_swap(NULL, NULL);
+
+    a = string_new();
+    b = string_new();
+
+    string_swap(a, NULL);
+    string_swap(NULL, b);
+    string_swap(a, a);
+    assert(verify_string_content(a, ""));
+
+    // Both small.
+    assert(0 == string_append_c_str(a, "a"));
+    assert(0 == string_append_c_str(b, "b"));
+    string_swap(a, b);
+    assert(verify_string_content(a, "b"));
+    assert(verify_string_content(b, "a"));
+
+    // Small and allocated.
+    assert(0 == string_append_c_str(b, " string that is allocated"));
+    buf = string_c_str(b);
+    string_swap(a, b);
+    assert(buf == string_c_str(a));
+    assert(verify_string_content(a, "a string that is allocated"));
+    assert(verify_string_content(b, "b"));
+    string_swap(a, b);
+    assert(buf == string_c_str(b));
+    assert(verify_string_content(a, "b"));
+
+    // Both allocated.
+    assert(0 == string_append_c_str(a, " string that is also allocated"));
+    string_swap(a, b);
+    assert(verify_string_content(a, "a string that is allocated"));
+    assert(verify_string_content(b, "b string that is also allocated"));
+
+    string_delete(a);
+    string_delete(b);
+}
+
 static void test_string_empty(void)
 {
     struct string *s = NULL;
@@ -179,6 +314,25 @@ static void test_string_c_str(void)
     string_delete(s);
 }
 
+static void test_string_as_view(void)
+{
+    struct string *s = NULL;
+    struct string_view view;
+
+    view = string_as_view(NULL);
+    assert(NULL == view.buf);
+    assert(0 == view.len);
+
+    s = string_new();
+
+    assert(0 == string_append_buffer(s, 4, "ab\0c"));
+    view = string_as_view(s);
+    assert(string_c_str(s) == view.buf);
+    assert(4 == view.len);
+
+    string_delete(s);
+}
+
 static void test_string_c_str_move(void)
 {
     struct string *s = NULL;
@@ -241,14 +395,6 @@ static void test_string_clear(void)
 
 static void test_string_insert_buffer(void)
 {
-    // Gain access to string internals for test purposes.
-    struct test_string {
-        size_t cap;
-        size_t len;
-        char *buf;
-        char sso[8];
-    };
-
     struct string *s = NULL;
 
     assert(-EFAULT == string_insert_buffer(NULL, 1, 3, "foo"));
@@ -388,6 +534,86 @@ static void test_string_erase(void)
     string_delete(s);
 }
 
+static void test_string_apply_edits(void)
+{
+    struct string *s = NULL;
+    struct string_edit edits[4];
+    char *buf = NULL;
+
+    assert(-EFAULT == string_apply_edits(NULL, edits, 0));
+
+    s = string_new();
+
+    assert(-EFAULT == string_apply_edits(s, NULL, 1));
+    assert(0 == string_apply_edits(s, NULL, 0));
+    assert(string_empty(s));
+
+    assert(0 == string_append_c_str(s, "The quick brown fox jumps over the lazy dog"));
+
+    // Invalid edits leave the string unchanged.
+    edits[0] = (struct string_edit){ 4, 5, 4, "slow" };
+    edits[1] = (struct string_edit){ 10, 0, 1, NULL };
+    assert(-EFAULT == string_apply_edits(s, edits, 2));
+    edits[1] = (struct string_edit){ 44, 0, 0, NULL };
+    assert(-ERANGE == string_apply_edits(s, edits, 2));
+    edits[1] = (struct string_edit){ 40, 4, 0, NULL };
+    assert(-ERANGE == string_apply_edits(s, edits, 2));
+    edits[1] = (struct string_edit){ 8, 2, 0, NULL };
+    assert(-EINVAL == string_apply_edits(s, edits, 2));
+    edits[1] = (struct string_edit){ 0, 0, 0, NULL };
+    assert(-EINVAL == string_apply_edits(s, edits, 2));
+    assert(0 == strcmp(string_c_str(s), "The quick brown fox jumps over the lazy dog"));
+
+    // Replace, erase, and insert at the same position and at the end.
+    edits[0] = (struct string_edit){ 4, 5, 4, "slow" };
+    edits[1] = (struct string_edit){ 10, 6, 0, NULL };
+    edits[2] = (struct string_edit){ 40, 0, 7, "sleepy " };
+    edits[3] = (struct string_edit){ 43, 0, 1, "!" };
+    assert(0 == string_apply_edits(s, edits, 4));
+    assert(0 == strcmp(string_c_str(s), "The slow fox jumps over the lazy sleepy dog!"));
+    assert(string_capacity(s) == string_size(s));
+
+    edits[0] = (struct string_edit){ 0, 0, 2, "<<" };
+    edits[1] = (struct string_edit){ 0, 0, 1, "[" };
+    assert(0 == string_apply_edits(s, edits, 2));
+    assert(0 == strncmp(string_c_str(s), "<<[The slow", 11));
+
+    // Inserted characters may point into the string.
+    string_clear(s);
+    assert(0 == string_append_c_str(s, "abcdefghijklmnop"));
+    edits[0] = (struct string_edit){ 0, 0, 4, &string_c_str(s)[12] };
+    edits[1] = (struct string_edit){ 8, 8, 4, string_c_str(s) };
+    assert(0 == string_apply_edits(s, edits, 2));
+    assert(0 == strcmp(string_c_str(s), "mnopabcdefghabcd"));
+
+    // A short result moves to internal storage.
+    edits[0] = (struct string_edit){ 3, 13, 1, "!" };
+    assert(0 == string_apply_edits(s, edits, 1));
+    assert(0 == strcmp(string_c_str(s), "mno!"));
+    edits[0] = (struct string_edit){ 0, 4, 0, NULL };
+    assert(0 == string_apply_edits(s, edits, 1));
+    assert(string_empty(s));
+    assert(0 == *string_c_str(s));
+
+    // Allocation failure leaves the string unchanged.
+    assert(0 == string_append_c_str(s, "abc"));
+    edits[0] = (struct string_edit){ 1, 1, 16, "BBBBBBBBBBBBBBBB" };
+    memory_shim_fail_at(1);
+    assert(-ENOMEM == string_apply_edits(s, edits, 1));
+    memory_shim_reset();
+    assert(0 == strcmp(string_c_str(s), "abc"));
+
+    // Size overflow.
+    buf = ((struct test_string *)s)->buf;
+    ((struct test_string *)s)->len = SIZE_MAX / 2 + 1;
+    edits[0] = (struct string_edit){ 0, 0, SIZE_MAX / 2, "" };
+    assert(-ENOMEM == string_apply_edits(s, edits, 1));
+    ((struct test_string *)s)->len = 3;
+    assert(buf == string_c_str(s));
+
+    string_delete(s);
+}
+
 static void test_string_push_back(void)
 {
     struct string *s = NULL;
@@ -520,6 +746,946 @@ static void test_string_append_fill(void)
     string_delete(s);
 }
 
+static void test_string_assign_buffer(void)
+{
+    struct string *s = NULL;
+
+    assert(-EFAULT == string_assign_buffer(NULL, 3, "abc"));
+
+    s = string_new();
+
+    assert(-EFAULT == string_assign_buffer(s, 3, NULL));
+
+    assert(0 == string_assign_buffer(s, 3, "abcDEF"));
+    assert(verify_string_content(s, "abc"));
+
+    memory_shim_fail_at(1);
+    assert(-ENOMEM == string_assign_buffer(s, 20, "12345678901234567890"));
+    memory_shim_reset();
+    assert(verify_string_content(s, "abc"));
+
+    // Exact growth, then capacity is reused.
+    assert(0 == string_assign_buffer(s, 20, "12345678901234567890"));
+    assert(verify_string_content(s, "12345678901234567890"));
+    assert(20 == string_capacity(s));
+
+    assert(0 == string_assign_buffer(s, 5, "vwxyz"));
+    assert(verify_string_content(s, "vwxyz"));
+    assert(20 == string_capacity(s));
+
+    // From own storage.
+    assert(0 == string_assign_buffer(s, 3, string_c_str(s) + 2));
+    assert(verify_string_content(s, "xyz"));
+
+    string_delete(s);
+}
+
+static void test_string_resize_uninit(void)
+{
+    struct string *s = NULL;
+    char *p = NULL;
+
+    errno = 0;
+    assert(NULL == string_resize_uninit(NULL, 3));
+    assert(EFAULT == errno);
+
+    s = string_new();
+
+    // Within small string storage.
+    p = string_resize_uninit(s, 3);
+    assert(p == string_c_str(s));
+    memcpy(p, "abc", 3);
+    assert(verify_string_content(s, "abc"));
+
+    errno = 0;
+    assert(NULL == string_resize_uninit(s, SIZE_MAX));
+    assert(ENOMEM == errno);
+    assert(verify_string_content(s, "abc"));
+
+    // Growth is exact, and existing content is kept.
+    p = string_resize_uninit(s, 10);
+    assert(NULL != p);
+    assert(10 == string_size(s));
+    assert(10 == string_capacity(s));
+    assert(0 == memcmp(p, "abc", 3));
+    assert(0 == p[10]);
+    memcpy(&p[3], "defghij", 7);
+    assert(verify_string_content(s, "abcdefghij"));
+
+    // Truncate.
+    p = string_resize_uninit(s, 2);
+    assert(verify_string_content(s, "ab"));
+    assert(10 == string_capacity(s));
+
+    string_delete(s);
+}
+
+static void test_string_reserve_tail(void)
+{
+    struct string *s = NULL;
+    char *p = NULL;
+
+    errno = 0;
+    assert(NULL == string_reserve_tail(NULL, 3));
+    assert(EFAULT == errno);
+
+    s = string_new();
+
+    assert(0 == string_append_c_str(s, "abc"));
+
+    p = string_reserve_tail(s, 4);
+    assert(p == string_c_str(s) + 3);
+    assert(7 == string_capacity(s));
+    memcpy(p, "defg", 4);
+    assert(3 == string_size(s));
+    assert(0 == string_commit(s, 4));
+    assert(verify_string_content(s, "abcdefg"));
+
+    errno = 0;
+    assert(NULL == string_reserve_tail(s, SIZE_MAX));
+    assert(ENOMEM == errno);
+
+    memory_shim_fail_at(1);
+    errno = 0;
+    assert(NULL == string_reserve_tail(s, 1));
+    assert(ENOMEM == errno);
+    memory_shim_reset();
+
+    // Geometric growth.
+    p = string_reserve_tail(s, 1);
+    assert(14 == string_capacity(s));
+    *p = 'h';
+    assert(0 == string_commit(s, 1));
+    assert(verify_string_content(s, "abcdefgh"));
+
+    string_delete(s);
+}
+
+static void test_string_commit(void)
+{
+    struct string *s = NULL;
+    char *p = NULL;
+
+    assert(-EFAULT == string_commit(NULL, 0));
+
+    s = string_new();
+
+    assert(-ERANGE == string_commit(s, 8));
+    assert(0 == string_commit(s, 0));
+    assert(verify_string_content(s, ""));
+
+    p = string_reserve_tail(s, 7);
+    memcpy(p, "\xc3\xa9", 2);
+    assert(string_utf8_validate(s));
+    assert(0 == string_commit(s, 1));
+    assert(!string_utf8_validate(s));
+    p = string_reserve_tail(s, 1);
+    *p = '\xa9';
+    assert(0 == string_commit(s, 1));
+    assert(verify_string_content(s, "\xc3\xa9"));
+    assert(string_utf8_validate(s));
+
+    string_delete(s);
+}
+
+static void test_string_inline(void)
+{
+    struct string *s = NULL;
+    size_t i;
+
+    assert(0 == string_size_inline(NULL));
+    assert(0 == string_at_inline(NULL, 0));
+    assert(-EFAULT == string_push_back_inline(NULL, 'a'));
+    assert(-EFAULT == string_append_buffer_inline(NULL, 1, "a"));
+
+    s = string_new();
+
+    assert(-EFAULT == string_append_buffer_inline(s, 1, NULL));
+
+    // In capacity.
+    assert(0 == string_push_back_inline(s, 'a'));
+    assert(0 == string_append_buffer_inline(s, 6, "bcdefgXYZ"));
+    assert(7 == string_size_inline(s));
+    assert(7 == string_capacity(s));
+    assert('g' == string_at_inline(s, 6));
+    assert(0 == string_at_inline(s, 7));
+    assert(verify_string_content(s, "abcdefg"));
+
+    // Growth is handled out of line.
+    assert(0 == string_push_back_inline(s, 'h'));
+    assert(14 == string_capacity(s));
+    assert(0 == string_append_buffer_inline(s, 7, "ijklmno"));
+    assert(verify_string_content(s, "abcdefghijklmno"));
+
+    memory_shim_fail_at(1);
+    assert(-ENOMEM == string_append_buffer_inline(s, 20, "12345678901234567890"));
+    memory_shim_reset();
+
+    // Content may be appended from own storage.
+    assert(0 == string_append_buffer_inline(s, 3, string_c_str(s)));
+    assert(verify_string_content(s, "abcdefghijklmnoabc"));
+
+    // Unchecked, after validation by the caller.
+    string_clear(s);
+    assert(0 == string_reserve(s, 101));
+    for (i = 0; i < 100; ++i) {
+        string_push_back_unchecked(s, (char)('0' + i % 10));
+    }
+    assert(100 == string_size_unchecked(s));
+    assert('9' == string_at_unchecked(s, 99));
+    assert(0 == string_c_str(s)[100]);
+
+    // Cached properties are invalidated.
+    assert(string_utf8_validate(s));
+    string_push_back_unchecked(s, '\xff');
+    assert(!string_utf8_validate(s));
+    assert(0 == string_pop_back(s));
+    assert(string_utf8_validate(s));
+    string_append_buffer_unchecked(s, 1, "\xff");
+    assert(!string_utf8_validate(s));
+
+    string_delete(s);
+}
+
+static void test_string_join(void)
+{
+    struct string *s = NULL;
+    struct string *sep = NULL;
+    struct string *parts[3] = { NULL, NULL, NULL };
+    struct string *beta = NULL;
+
+    s = string_new();
+    sep = string_new();
+    parts[0] = string_new();
+    parts[1] = string_new();
+    parts[2] = string_new();
+
+    assert(-EFAULT == string_join(NULL, sep, parts, 3));
+    assert(-EFAULT == string_join(s, NULL, parts, 3));
+    assert(-EFAULT == string_join(s, sep, NULL, 3));
+    assert(0 == string_join(s, sep, NULL, 0));
+    assert(verify_string_content(s, ""));
+
+    assert(0 == string_append_c_str(sep, ", "));
+    assert(0 == string_append_c_str(parts[0], "alpha"));
+    assert(0 == string_append_c_str(parts[1], "beta"));
+    assert(0 == string_append_c_str(parts[2], "gamma"));
+
+    beta = parts[1];
+    parts[1] = NULL;
+    assert(-EFAULT == string_join(s, sep, parts, 3));
+    parts[1] = beta;
+    assert(verify_string_content(s, ""));
+
+    // Exact reservation: no growth slack.
+    assert(0 == string_join(s, sep, &parts[1], 2));
+    assert(verify_string_content(s, "beta, gamma"));
+    assert(11 == string_capacity(s));
+    string_clear(s);
+
+    assert(0 == string_join(s, sep, parts, 3));
+    assert(verify_string_content(s, "alpha, beta, gamma"));
+    assert(18 == string_capacity(s));
+    string_clear(s);
+
+    parts[1] = parts[2];
+    assert(0 == string_join(s, sep, parts, 2));
+    assert(verify_string_content(s, "alpha, gamma"));
+    assert(18 == string_capacity(s));
+
+    // Appends to existing content.
+    assert(0 == string_join(s, sep, parts, 1));
+    assert(verify_string_content(s, "alpha, gammaalpha"));
+
+    // Destination may be a part or the separator.
+    string_clear(s);
+    assert(0 == string_append_c_str(s, "x"));
+    parts[2] = s;
+    assert(0 == string_join(s, s, &parts[1], 2));
+    assert(verify_string_content(s, "xgammaxx"));
+
+    memory_shim_fail_at(1);
+    assert(-ENOMEM == string_join(s, sep, parts, 3));
+    memory_shim_reset();
+    assert(verify_string_content(s, "xgammaxx"));
+
+    // Overflow.
+    ((struct test_string *)sep)->len = SIZE_MAX;
+    assert(-ENOMEM == string_join(s, sep, parts, 2));
+    ((struct test_string *)sep)->len = 2;
+    ((struct test_string *)parts[0])->len = SIZE_MAX;
+    assert(-ENOMEM == string_join(s, sep, parts, 1));
+    ((struct test_string *)parts[0])->len = SIZE_MAX - 1;
+    assert(-ENOMEM == string_join(s, sep, parts, 1));
+    ((struct test_string *)parts[0])->len = 5;
+    assert(verify_string_content(s, "xgammaxx"));
+
+    string_delete(parts[0]);
+    string_delete(parts[1]);
+    string_delete(beta);
+    string_delete(sep);
+    string_delete(s);
+}
+
+static void test_string_join_buffer(void)
+{
+    struct string *s = NULL;
+    const char *parts[3] = { "one", "two", "three" };
+    size_t lens[3] = { 3, 3, 5 };
+
+    s = string_new();
+
+    assert(-EFAULT == string_join_buffer(NULL, 1, "/", parts, lens, 3));
+    assert(-EFAULT == string_join_buffer(s, 1, NULL, parts, lens, 3));
+    assert(-EFAULT == string_join_buffer(s, 1, "/", NULL, lens, 3));
+    assert(-EFAULT == string_join_buffer(s, 1, "/", parts, NULL, 3));
+
+    // Separator is only needed between parts.
+    assert(0 == string_join_buffer(s, 0, NULL, NULL, NULL, 0));
+    assert(0 == string_join_buffer(s, 0, NULL, parts, lens, 1));
+    assert(verify_string_content(s, "one"));
+    string_clear(s);
+
+    parts[1] = NULL;
+    assert(-EFAULT == string_join_buffer(s, 1, "/", parts, lens, 3));
+    parts[1] = "two";
+
+    assert(0 == string_join_buffer(s, 1, "/", parts, lens, 3));
+    assert(verify_string_content(s, "one/two/three"));
+    assert(13 == string_capacity(s));
+
+    lens[2] = 2;
+    assert(0 == string_join_buffer(s, 2, "::", parts, lens, 3));
+    assert(verify_string_content(s, "one/two/threeone::two::th"));
+
+    memory_shim_fail_at(1);
+    assert(-ENOMEM == string_join_buffer(s, 1, "/", parts, lens, 3));
+    memory_shim_reset();
+    assert(verify_string_content(s, "one/two/threeone::two::th"));
+
+    // Overflow.
+    assert(-ENOMEM == string_join_buffer(s, SIZE_MAX, "/", parts, lens, 3));
+    lens[1] = SIZE_MAX;
+    assert(-ENOMEM == string_join_buffer(s, 1, "/", parts, lens, 3));
+    lens[1] = SIZE_MAX - 1;
+    assert(-ENOMEM == string_join_buffer(s, 0, "", &parts[1], &lens[1], 1));
+    assert(verify_string_content(s, "one/two/threeone::two::th"));
+
+    string_delete(s);
+}
+
+static void test_string_equal(void)
+{
+    struct string *a = NULL;
+    struct string *b = NULL;
+
+    assert(string_equal(NULL, NULL));
+
+    a = string_new();
+    b = string_new();
+
+    assert(string_equal(a, NULL));
+    assert(string_equal(NULL, b));
+    assert(string_equal(a, b));
+
+    assert(0 == string_append_c_str(a, "abc"));
+    assert(!string_equal(a, b));
+    assert(!string_equal(a, NULL));
+
+    assert(0 == string_append_c_str(b, "abd"));
+    assert(!string_equal(a, b));
+
+    // Embedded NUL.
+    assert(0 == string_pop_back(b));
+    assert(0 == string_push_back(b, 0));
+    assert(!string_equal(a, b));
+
+    assert(0 == string_pop_back(b));
+    assert(0 == string_push_back(b, 'c'));
+    assert(string_equal(a, b));
+
+    string_delete(a);
+    string_delete(b);
+}
+
+static void test_string_compare(void)
+{
+    struct string *a = NULL;
+    struct string *b = NULL;
+
+    assert(0 == string_compare(NULL, NULL));
+
+    a = string_new();
+    b = string_new();
+
+    assert(0 == string_compare(a, NULL));
+    assert(0 == string_compare(a, b));
+
+    assert(0 == string_append_c_str(a, "abc"));
+    assert(0 < string_compare(a, b));
+    assert(0 > string_compare(NULL, a));
+
+    assert(0 == string_append_c_str(b, "abc"));
+    assert(0 == string_compare(a, b));
+
+    // Prefix orders first, even when the next character is NUL.
+    assert(0 == string_push_back(b, 0));
+    assert(0 > string_compare(a, b));
+    assert(0 < string_compare(b, a));
+
+    // Unsigned comparison.
+    assert(0 == string_push_back(a, '\x80'));
+    assert(0 < string_compare(a, b));
+
+    string_delete(a);
+    string_delete(b);
+}
+
+static void test_string_starts_with(void)
+{
+    struct string *s = NULL;
+
+    assert(string_starts_with(NULL, 0, ""));
+    assert(!string_starts_with(NULL, 1, "a"));
+
+    s = string_new();
+
+    assert(!string_starts_with(s, 0, NULL));
+    assert(string_starts_with(s, 0, "abc"));
+
+    assert(0 == string_append_c_str(s, "GET /index.html"));
+    assert(string_starts_with(s, 4, "GET "));
+    assert(string_starts_with(s, 15, "GET /index.html"));
+    assert(!string_starts_with(s, 16, "GET /index.html?"));
+    assert(!string_starts_with(s, 4, "PUT "));
+
+    string_delete(s);
+}
+
+static void test_string_ends_with(void)
+{
+    struct string *s = NULL;
+
+    assert(string_ends_with(NULL, 0, ""));
+    assert(!string_ends_with(NULL, 1, "a"));
+
+    s = string_new();
+
+    assert(!string_ends_with(s, 0, NULL));
+    assert(string_ends_with(s, 0, "abc"));
+
+    assert(0 == string_append_c_str(s, "GET /index.html"));
+    assert(string_ends_with(s, 5, ".html"));
+    assert(string_ends_with(s, 15, "GET /index.html"));
+    assert(!string_ends_with(s, 16, " GET /index.html"));
+    assert(!string_ends_with(s, 4, ".htm"));
+
+    string_delete(s);
+}
+
+static void test_string_common_prefix(void)
+{
+    struct string *a = NULL;
+    struct string *b = NULL;
+
+    assert(0 == string_common_prefix(NULL, NULL));
+
+    a = string_new();
+    b = string_new();
+
+    assert(0 == string_append_c_str(a, "/usr/local/include/libcstring"));
+    assert(0 == string_common_prefix(a, NULL));
+    assert(0 == string_common_prefix(a, b));
+
+    assert(0 == string_append_c_str(b, "/usr/local/lib"));
+    assert(11 == string_common_prefix(a, b));
+
+    string_clear(b);
+    assert(0 == string_append_c_str(b, "/usr/lib"));
+    assert(6 == string_common_prefix(a, b));
+
+    string_clear(b);
+    assert(0 == string_append_c_str(b, "/usr/local/include/libcstring"));
+    assert(29 == string_common_prefix(a, b));
+
+    assert(0 == string_append_c_str(b, "/cstring.h"));
+    assert(29 == string_common_prefix(b, a));
+
+    string_delete(a);
+    string_delete(b);
+}
+
+static void test_string_hash(void)
+{
+    struct string *a = NULL;
+    struct string *b = NULL;
+
+    assert(string_hash(NULL) == string_hash_buffer(0, NULL));
+    assert(string_hash(NULL) == string_hash_buffer(0, ""));
+
+    a = string_new();
+    b = string_new();
+
+    assert(string_hash(a) == string_hash(NULL));
+
+    // Lengths around the block size.
+    assert(0 == string_append_c_str(a, "abcdefg"));
+    assert(string_hash(a) == string_hash_buffer(7, "abcdefg"));
+    assert(0 == string_append_c_str(a, "h"));
+    assert(string_hash(a) == string_hash_buffer(8, "abcdefgh"));
+    assert(0 == string_append_c_str(a, "ijklmnopqrstuvwxyz"));
+    assert(string_hash(a) == string_hash_buffer(26, "abcdefghijklmnopqrstuvwxyz"));
+
+    assert(0 == string_append_c_str(b, "abcdefghijklmnopqrstuvwxyz"));
+    assert(string_hash(a) == string_hash(b));
+    assert(0 == string_push_back(b, '.'));
+    assert(string_hash(a) != string_hash(b));
+
+    // Embedded and trailing NUL characters are significant.
+    assert(string_hash_buffer(1, "a") != string_hash_buffer(2, "a\0"));
+    assert(string_hash_buffer(0, "") != string_hash_buffer(1, ""));
+    assert(string_hash_buffer(8, "abcdefgh") != string_hash_buffer(8, "abcdefgi"));
+    assert(string_hash_buffer(9, "abcdefgh1") != string_hash_buffer(9, "abcdefgh2"));
+
+    string_delete(a);
+    string_delete(b);
+}
+
+/// @return True if the hash of @c s equals that of its content, false otherwise.
+static bool verify_hash(const struct string *s)
+{
+    return string_hash(s) == string_hash_buffer(string_size(s), string_c_str(s));
+}
+
+static void test_string_hash_track(void)
+{
+    static const char text[] = "the quick brown fox jumps over the lazy dog";
+    struct string *a = NULL;
+    struct string *b = NULL;
+    struct string *c = NULL;
+    struct string *many[40];
+    size_t i;
+
+    string_hash_track(NULL, true);
+
+    a = string_new();
+
+    // Allocation errors of the record and of the first table leave the string untracked.
+    memory_shim_fail_at(1);
+    string_hash_track(a, true);
+    memory_shim_fail_at(2);
+    string_hash_track(a, true);
+    memory_shim_reset();
+    assert(sizeof(struct test_string) == string_memory_usage(a).object);
+
+    string_hash_track(a, true);
+    assert(verify_hash(a));
+    assert(sizeof(struct test_string) < string_memory_usage(a).object);
+
+    // Appends of every length update the state.
+    for (i = 0; i < sizeof(text) - 1; ++i) {
+        assert(0 == string_push_back(a, text[i]));
+        assert(verify_hash(a));
+    }
+    assert(0 == string_append_buffer_inline(a, 3, "..."));
+    assert(verify_hash(a));
+    assert(0 == string_join_buffer(a, 0, "", (const char *const[]){ "!" }, (const size_t[]){ 1 }, 1));
+    assert(verify_hash(a));
+    assert(0 == string_append_utf32(a, 1, (const uint32_t[]){ 0xe9 }));
+    assert(verify_hash(a));
+    assert(string_reserve_tail(a, 10));
+    assert(0 == string_commit(a, 0));
+    assert(verify_hash(a));
+    assert(0 == string_append_fill(a, 9, '.'));
+    assert(verify_hash(a));
+
+    // Changes at the end keep the state of the words before them, others restart it.
+    assert(0 == string_pop_back(a));
+    assert(verify_hash(a));
+    assert(0 == string_erase(a, 44, 10));
+    assert(verify_hash(a));
+    assert(0 == string_insert_c_str(a, 40, "big "));
+    assert(verify_hash(a));
+    assert(0 == string_insert_c_str(a, 4, "very "));
+    assert(verify_hash(a));
+    assert(0 == string_insert_fill(a, 0, 2, ' '));
+    assert(verify_hash(a));
+    assert(0 == string_apply_edits(a, &(struct string_edit){ 2, 3, 3, "THE" }, 1));
+    assert(verify_hash(a));
+    assert(0 == string_to_lower(a));
+    assert(verify_hash(a));
+    assert(0 == string_to_upper(a));
+    assert(verify_hash(a));
+    assert(string_resize_uninit(a, 20));
+    assert(verify_hash(a));
+
+    // Moved with the content, to a string that was tracked too, which leaves the source untracked.
+    b = string_new();
+    string_hash_track(b, true);
+    assert(0 == string_move(b, a));
+    assert(verify_hash(b));
+    assert(verify_hash(a));
+    assert(sizeof(struct test_string) == string_memory_usage(a).object);
+
+    // Swapped with the content, whether one or both strings are tracked.
+    c = string_new();
+    assert(0 == string_append_c_str(c, text));
+    string_swap(b, c);
+    assert(verify_hash(b));
+    assert(verify_hash(c));
+    assert(0 == string_append_c_str(c, text));
+    assert(verify_hash(c));
+    string_swap(b, c);
+    assert(verify_hash(b));
+    string_hash_track(c, true);
+    assert(verify_hash(c));
+    string_swap(b, c);
+    assert(0 == string_append_c_str(b, text));
+    assert(0 == string_append_c_str(c, text));
+    assert(verify_hash(b));
+    assert(verify_hash(c));
+
+    // Replaced content restarts the state.
+    assert(0 == string_assign_buffer(b, 10, text));
+    assert(verify_hash(b));
+    string_clear(b);
+    assert(verify_hash(b));
+
+    // Disabled, and enabled again over existing content.
+    assert(0 == string_append_c_str(b, text));
+    string_hash_track(b, false);
+    assert(sizeof(struct test_string) == string_memory_usage(b).object);
+    assert(0 == string_append_c_str(b, text));
+    assert(verify_hash(b));
+    string_hash_track(b, true);
+    string_hash_track(b, true);
+    assert(verify_hash(b));
+
+    // Many tracked strings, which grow the table.
+    for (i = 0; i < sizeof(many) / sizeof(many[0]); ++i) {
+        many[i] = string_new();
+        assert(0 == string_append_buffer(many[i], i, text));
+        string_hash_track(many[i], true);
+    }
+    for (i = 0; i < sizeof(many) / sizeof(many[0]); ++i) {
+        assert(verify_hash(many[i]));
+        string_delete(many[i]);
+    }
+
+    string_delete(a);
+    string_delete(b);
+    string_delete(c);
+}
+
+static void test_string_to_lower(void)
+{
+    struct string *s = NULL;
+
+    assert(-EFAULT == string_to_lower(NULL));
+
+    s = string_new();
+
+    assert(0 == string_to_lower(s));
+    assert(verify_string_content(s, ""));
+
+    // Word-sized blocks, then a tail; boundaries of the letter ranges and non-ASCII bytes are unchanged.
+    assert(0 == string_append_c_str(s, "@AZ[`az{ Hello, WORLD! \xc3\x89t\xc3\xa9 ZZ"));
+    assert(0 == string_to_lower(s));
+    assert(verify_string_content(s, "@az[`az{ hello, world! \xc3\x89t\xc3\xa9 zz"));
+
+    string_delete(s);
+}
+
+static void test_string_to_upper(void)
+{
+    struct string *s = NULL;
+
+    assert(-EFAULT == string_to_upper(NULL));
+
+    s = string_new();
+
+    assert(0 == string_append_c_str(s, "@AZ[`az{ Hello, WORLD! \xc3\xa9 zz"));
+    assert(0 == string_to_upper(s));
+    assert(verify_string_content(s, "@AZ[`AZ{ HELLO, WORLD! \xc3\xa9 ZZ"));
+
+    string_delete(s);
+}
+
+static void test_string_casecmp(void)
+{
+    struct string *a = NULL;
+    struct string *b = NULL;
+
+    assert(0 == string_casecmp(NULL, NULL));
+
+    a = string_new();
+    b = string_new();
+
+    assert(0 == string_casecmp(a, NULL));
+    assert(0 == string_casecmp(a, b));
+
+    assert(0 == string_append_c_str(a, "Content-Type: text"));
+    assert(0 == string_append_c_str(b, "content-type: TEXT"));
+    assert(0 == string_casecmp(a, b));
+    assert(0 < string_casecmp(a, NULL));
+    assert(0 > string_casecmp(NULL, b));
+
+    // Length decides when one is a prefix of the other.
+    assert(0 == string_push_back(a, 0));
+    assert(0 < string_casecmp(a, b));
+    assert(0 > string_casecmp(b, a));
+    assert(0 == string_pop_back(a));
+
+    // Mismatch within the first word.
+    assert(0 == string_insert_c_str(a, 0, "X"));
+    assert(0 < string_casecmp(a, b));
+    assert(0 > string_casecmp(b, a));
+    assert(0 == string_erase(a, 0, 1));
+
+    // Mismatch in the tail; 'Z' folds to 'z', which sorts after '['.
+    assert(0 == string_append_c_str(a, "["));
+    assert(0 == string_append_c_str(b, "Z"));
+    assert(0 > string_casecmp(a, b));
+
+    // Non-ASCII bytes compare as unsigned.
+    string_clear(a);
+    string_clear(b);
+    assert(0 == string_append_c_str(a, "\xc3\xa9"));
+    assert(0 == string_append_c_str(b, "E"));
+    assert(0 < string_casecmp(a, b));
+
+    string_delete(a);
+    string_delete(b);
+}
+
+static void test_string_case_find(void)
+{
+    struct string *s = NULL;
+
+    assert(STRING_NPOS == string_case_find(NULL, 0, 1, "a"));
+
+    s = string_new();
+
+    assert(STRING_NPOS == string_case_find(s, 0, 1, NULL));
+    assert(0 == string_case_find(s, 0, 0, ""));
+    assert(STRING_NPOS == string_case_find(s, 1, 0, ""));
+    assert(STRING_NPOS == string_case_find(s, 0, 1, "a"));
+
+    assert(0 == string_append_c_str(s, "Accept-Encoding: gzip; X-Forwarded-For: 1.2.3.4"));
+
+    assert(5 == string_case_find(s, 5, 0, ""));
+    assert(0 == string_case_find(s, 0, 6, "ACCEPT"));
+    assert(7 == string_case_find(s, 0, 8, "encoding"));
+    assert(23 == string_case_find(s, 0, 16, "x-forwarded-for:"));
+    assert(STRING_NPOS == string_case_find(s, 24, 16, "x-forwarded-for:"));
+    assert(STRING_NPOS == string_case_find(s, 0, 7, "accepT!"));
+    assert(STRING_NPOS == string_case_find(s, 0, 4, "zip!"));
+    assert(18 == string_case_find(s, 0, 3, "ZIP"));
+
+    // Needles that start with a non-letter.
+    assert(39 == string_case_find(s, 0, 3, " 1."));
+    assert(43 == string_case_find(s, 0, 3, ".3."));
+    assert(STRING_NPOS == string_case_find(s, 0, 3, ".4."));
+    assert(STRING_NPOS == string_case_find(s, 0, 2, "#a"));
+
+    string_delete(s);
+}
+
+static void test_string_utf8_validate(void)
+{
+    static const char *const valid[] = {
+        "",
+        "plain ASCII spanning several words",
+        "\x7f\xc2\x80\xdf\xbf",
+        "\xe0\xa0\x80\xed\x9f\xbf\xee\x80\x80\xef\xbf\xbf",
+        "\xf0\x90\x80\x80\xf4\x8f\xbf\xbf",
+        "caf\xc3\xa9 cr\xc3\xa8me br\xc3\xbbl\xc3\xa9" "e",
+    };
+    static const char *const invalid[] = {
+        "\x80",
+        "\xc1\xbf",
+        "\xc2",
+        "\xc2\x41",
+        "\xe0\x9f\xbf",
+        "\xed\xa0\x80",
+        "\xe1\x80\x41",
+        "\xf0\x8f\xbf\xbf",
+        "\xf4\x90\x80\x80",
+        "\xf5\x80\x80\x80",
+        "ASCII words then \xff",
+    };
+    struct string *s = NULL;
+    size_t i;
+
+    assert(!string_utf8_validate(NULL));
+
+    s = string_new();
+
+    for (i = 0; i < sizeof(valid) / sizeof(valid[0]); ++i) {
+        string_clear(s);
+        assert(0 == string_append_c_str(s, valid[i]));
+        assert(string_utf8_validate(s));
+        // Cached.
+        assert(string_utf8_validate(s));
+    }
+
+    for (i = 0; i < sizeof(invalid) / sizeof(invalid[0]); ++i) {
+        string_clear(s);
+        assert(0 == string_append_c_str(s, invalid[i]));
+        assert(!string_utf8_validate(s));
+    }
+
+    // Cache is invalidated by modification.
+    string_clear(s);
+    assert(0 == string_append_c_str(s, "\xc3\xa9t\xc3\xa9"));
+    assert(string_utf8_validate(s));
+    assert(0 == string_erase(s, 0, 1));
+    assert(!string_utf8_validate(s));
+    assert(0 == string_insert_c_str(s, 0, "\xc3"));
+    assert(string_utf8_validate(s));
+    assert(0 == string_pop_back(s));
+    assert(!string_utf8_validate(s));
+    assert(0 == string_push_back(s, '\xa9'));
+    assert(string_utf8_validate(s));
+    assert(0 == string_append_fill(s, 1, '\xc3'));
+    assert(!string_utf8_validate(s));
+
+    string_delete(s);
+}
+
+static void test_string_utf8_length(void)
+{
+    struct string *s = NULL;
+
+    assert(0 == string_utf8_length(NULL));
+
+    s = string_new();
+
+    assert(0 == string_utf8_length(s));
+
+    assert(0 == string_append_c_str(s, "caf\xc3\xa9 \xe2\x82\xac \xf0\x9f\x98\x80 ASCII tail"));
+    assert(19 == string_utf8_length(s));
+
+    string_delete(s);
+}
+
+static void test_string_utf8_to_utf16(void)
+{
+    struct string *s = NULL;
+    uint16_t buf[16];
+    size_t n;
+
+    n = 16;
+    assert(-EFAULT == string_utf8_to_utf16(NULL, buf, &n));
+
+    s = string_new();
+
+    assert(-EFAULT == string_utf8_to_utf16(s, buf, NULL));
+
+    assert(0 == string_append_c_str(s, "ASCII...\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80"));
+
+    assert(0 == string_utf8_to_utf16(s, NULL, &n));
+    assert(12 == n);
+
+    n = 11;
+    assert(-ERANGE == string_utf8_to_utf16(s, buf, &n));
+    assert(12 == n);
+
+    n = 16;
+    assert(0 == string_utf8_to_utf16(s, buf, &n));
+    assert(12 == n);
+    assert('A' == buf[0] && '.' == buf[7]);
+    assert(0xe9 == buf[8]);
+    assert(0x20ac == buf[9]);
+    assert(0xd83d == buf[10] && 0xde00 == buf[11]);
+
+    assert(0 == string_push_back(s, '\x80'));
+    assert(-EILSEQ == string_utf8_to_utf16(s, buf, &n));
+
+    string_delete(s);
+}
+
+static void test_string_utf8_to_utf32(void)
+{
+    struct string *s = NULL;
+    uint32_t buf[16];
+    size_t n;
+
+    s = string_new();
+
+    assert(0 == string_append_c_str(s, "ASCII...\xc3\xa9\xf0\x9f\x98\x80"));
+
+    n = 16;
+    assert(0 == string_utf8_to_utf32(s, buf, &n));
+    assert(10 == n);
+    assert('A' == buf[0] && '.' == buf[7]);
+    assert(0xe9 == buf[8]);
+    assert(0x1f600 == buf[9]);
+
+    string_delete(s);
+}
+
+static void test_string_append_utf16(void)
+{
+    static const uint16_t text[] = { 'a', 0xe9, 0x20ac, 0xd83d, 0xde00, 'z' };
+    static const uint16_t lone_high[] = { 'a', 0xd83d, 'z' };
+    static const uint16_t lone_low[] = { 0xde00 };
+    static const uint16_t trailing_high[] = { 0xd83d };
+    struct string *s = NULL;
+
+    assert(-EFAULT == string_append_utf16(NULL, 1, text));
+
+    s = string_new();
+
+    assert(-EFAULT == string_append_utf16(s, 1, NULL));
+
+    assert(-EILSEQ == string_append_utf16(s, 3, lone_high));
+    assert(-EILSEQ == string_append_utf16(s, 1, lone_low));
+    assert(-EILSEQ == string_append_utf16(s, 1, trailing_high));
+    assert(verify_string_content(s, ""));
+
+    // Valid content remains valid.
+    assert(string_utf8_validate(s));
+    assert(0 == string_append_utf16(s, 6, text));
+    assert(verify_string_content(s, "a\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80z"));
+    assert(11 == string_capacity(s));
+    assert(string_utf8_validate(s));
+
+    memory_shim_fail_at(1);
+    assert(-ENOMEM == string_append_utf16(s, 6, text));
+    memory_shim_reset();
+
+    // Invalid content is not known to become valid.
+    assert(0 == string_push_back(s, '\xff'));
+    assert(0 == string_append_utf16(s, 1, text));
+    assert(!string_utf8_validate(s));
+
+    string_delete(s);
+}
+
+static void test_string_append_utf32(void)
+{
+    static const uint32_t text[] = { 'a', 0x7ff, 0xffff, 0x10ffff };
+    static const uint32_t surrogate[] = { 0xd800 };
+    static const uint32_t too_big[] = { 0x110000 };
+    struct string *s = NULL;
+
+    assert(-EFAULT == string_append_utf32(NULL, 1, text));
+
+    s = string_new();
+
+    assert(-EFAULT == string_append_utf32(s, 1, NULL));
+
+    assert(-EILSEQ == string_append_utf32(s, 1, surrogate));
+    assert(-EILSEQ == string_append_utf32(s, 1, too_big));
+
+    assert(0 == string_append_utf32(s, 4, text));
+    assert(verify_string_content(s, "a\xdf\xbf\xef\xbf\xbf\xf4\x8f\xbf\xbf"));
+    assert(string_utf8_validate(s));
+
+    string_delete(s);
+}
+
 static void test_string_substr(void)
 {
     struct string *s = NULL;
@@ -592,27 +1758,548 @@ static void test_string_substr(void)
     string_delete(s);
 }
 
+/// Length of the document used in tests of compression.
+#define DOCUMENT_SIZE 20000
+
+/// Fill @c buf with @c n characters of a document: random letters, then repeated phrases and runs.
+static void make_document(char *buf, size_t n)
+{
+    static const char *const words[] = { "cached ", "document ", "rarely ", "touched ", "string ", "resident " };
+    unsigned seed = 1;
+    size_t i = 0;
+
+    // Literals, long enough to need extended lengths.
+    for (; i < 300 && i < n; ++i) {
+        seed = seed * 1103515245 + 12345;
+        buf[i] = (char)('a' + (seed >> 16) % 26);
+    }
+
+    while (i < n) {
+        const char *w = words[i % 6];
+        size_t k;
+
+        if (i % 7 == 0) {
+            // Run, matched with an overlapping copy.
+            for (k = 0; k < 500 && i < n; ++k) {
+                buf[i++] = 'z';
+            }
+        }
+        for (k = 0; w[k] && i < n; ++k) {
+            buf[i++] = w[k];
+        }
+    }
+}
+
+/// @return New string holding the document, compressed.
+static struct string *new_compressed(const char *doc)
+{
+    struct string *s = NULL;
+
+    s = string_new();
+    assert(0 == string_append_buffer(s, DOCUMENT_SIZE, doc));
+    assert(0 == string_compress(s, 0));
+    assert(string_compressed(s));
+    return s;
+}
+
+static void test_string_compress(void)
+{
+    static char doc[DOCUMENT_SIZE];
+    struct string *s = NULL;
+    char random[308];
+    unsigned seed = 7;
+    size_t allocations;
+    size_t total;
+    size_t i;
+
+    make_document(doc, sizeof(doc));
+
+    assert(-EFAULT == string_compress(NULL, 0));
+    assert(!string_compressed(NULL));
+
+    // Left unchanged: internal storage, small, shorter than the threshold, or incompressible.
+    s = string_new();
+    assert(0 == string_compress(s, 0));
+    assert(0 == string_append_c_str(s, "abcdefgh"));
+    assert(0 == string_compress(s, 0));
+    assert(!string_compressed(s));
+    assert(0 == string_assign_buffer(s, DOCUMENT_SIZE, doc));
+    assert(0 == string_compress(s, DOCUMENT_SIZE + 1));
+    assert(!string_compressed(s));
+
+    for (i = 0; i < sizeof(random); ++i) {
+        seed = seed * 1103515245 + 12345;
+        random[i] = (char)(seed >> 16);
+    }
+    assert(0 == string_assign_buffer(s, 300, random));
+    assert(0 == string_compress(s, 0));
+    assert(!string_compressed(s));
+
+    // A short match does not make up for the literals before it.
+    memcpy(&random[300], "abcdabcd", 8);
+    assert(0 == string_assign_buffer(s, sizeof(random), random));
+    assert(0 == string_compress(s, 0));
+    assert(!string_compressed(s));
+
+    // Compressed.
+    assert(0 == string_assign_buffer(s, DOCUMENT_SIZE, doc));
+    total = string_memory_total();
+    memory_shim_fail_at(1);
+    assert(-ENOMEM == string_compress(s, 0));
+    memory_shim_fail_at(2);
+    assert(-ENOMEM == string_compress(s, 0));
+    memory_shim_reset();
+    assert(!string_compressed(s));
+    assert(total == string_memory_total());
+
+    // Only the compressed size is held.
+    assert(string_utf8_validate(s));
+    total -= string_memory_usage(s).heap;
+    allocations = string_memory_allocations();
+    assert(0 == string_compress(s, DOCUMENT_SIZE));
+    assert(string_compressed(s));
+    assert(DOCUMENT_SIZE == string_size(s));
+    assert(string_capacity(s) < DOCUMENT_SIZE / 4);
+    assert(string_capacity(s) + 1 == string_memory_usage(s).heap);
+    assert(total + string_memory_usage(s).heap == string_memory_total());
+    assert(allocations + 2 == string_memory_allocations());
+    assert(0 == string_compress(s, 0));
+
+    // Cached properties are kept.
+    assert(string_utf8_validate(s));
+    assert(string_compressed(s));
+
+    // Decompressed on access.
+    assert(0 == memcmp(string_c_str(s), doc, DOCUMENT_SIZE));
+    assert(!string_compressed(s));
+    assert(DOCUMENT_SIZE == string_capacity(s));
+    assert(0 == string_c_str(s)[DOCUMENT_SIZE]);
+
+    // The compressed storage is reused when the content is replaced.
+    assert(0 == string_compress(s, 0));
+    assert(0 == string_assign_buffer(s, 3, "abc"));
+    assert(!string_compressed(s));
+    assert(verify_string_content(s, "abc"));
+
+    assert(0 == string_assign_buffer(s, DOCUMENT_SIZE, doc));
+    assert(0 == string_compress(s, 0));
+    string_clear(s);
+    assert(!string_compressed(s));
+    assert(verify_string_content(s, ""));
+
+    string_delete(s);
+
+    // Compressed strings move, and are deleted, without decompression.
+    s = new_compressed(doc);
+    {
+        struct string *t = string_new();
+
+        assert(0 == string_move(t, s));
+        assert(string_compressed(t));
+        assert(!string_compressed(s));
+        string_swap(s, t);
+        assert(string_compressed(s));
+        string_delete(t);
+    }
+    string_delete(s);
+}
+
+static void test_string_compressed_access(void)
+{
+    static char doc[DOCUMENT_SIZE];
+    struct string *s = NULL;
+    struct string *t = NULL;
+    struct string *parts[2];
+    struct string_view v;
+    uint32_t u32[1];
+    size_t n;
+
+    make_document(doc, sizeof(doc));
+    t = string_new();
+    assert(0 == string_append_buffer(t, DOCUMENT_SIZE, doc));
+
+    // Functions that fail to decompress behave as for a NULL argument, and leave the string compressed.
+    s = new_compressed(doc);
+    memory_shim_fail_at(1);
+    assert(0 == string_at(s, 0));
+    memory_shim_fail_at(1);
+    assert(0 == string_at_inline(s, 0));
+    memory_shim_fail_at(1);
+    errno = 0;
+    assert(NULL == string_c_str(s));
+    assert(ENOMEM == errno);
+    memory_shim_fail_at(1);
+    v = string_as_view(s);
+    assert(NULL == v.buf);
+    memory_shim_fail_at(1);
+    errno = 0;
+    assert(NULL == string_c_str_move(s));
+    assert(ENOMEM == errno);
+    memory_shim_fail_at(1);
+    assert(-ENOMEM == string_reserve(s, 0));
+    memory_shim_fail_at(1);
+    assert(-ENOMEM == string_push_back(s, 'a'));
+    memory_shim_fail_at(1);
+    assert(-ENOMEM == string_push_back_inline(s, 'a'));
+    memory_shim_fail_at(1);
+    assert(-ENOMEM == string_append_buffer_inline(s, 1, "a"));
+    memory_shim_fail_at(1);
+    assert(-ENOMEM == string_insert_c_str(s, 0, "a"));
+    memory_shim_fail_at(1);
+    assert(-ENOMEM == string_erase(s, 0, 1));
+    memory_shim_fail_at(1);
+    assert(-ENOMEM == string_apply_edits(s, &(struct string_edit){ 0, 1, 0, NULL }, 1));
+    memory_shim_fail_at(1);
+    assert(-ENOMEM == string_pop_back(s));
+    memory_shim_fail_at(1);
+    assert(-ENOMEM == string_to_lower(s));
+    memory_shim_fail_at(1);
+    assert(-ENOMEM == string_to_upper(s));
+    memory_shim_fail_at(1);
+    assert(string_casecmp(s, t) < 0);
+    memory_shim_fail_at(1);
+    assert(string_casecmp(t, s) > 0);
+    memory_shim_fail_at(1);
+    assert(STRING_NPOS == string_case_find(s, 0, 1, "a"));
+    memory_shim_fail_at(1);
+    assert(!string_equal(s, t));
+    memory_shim_fail_at(1);
+    assert(!string_equal(t, s));
+    memory_shim_fail_at(1);
+    assert(string_compare(s, t) < 0);
+    memory_shim_fail_at(1);
+    assert(string_compare(t, s) > 0);
+    memory_shim_fail_at(1);
+    assert(!string_starts_with(s, 1, doc));
+    memory_shim_fail_at(1);
+    assert(!string_ends_with(s, 1, &doc[DOCUMENT_SIZE - 1]));
+    memory_shim_fail_at(1);
+    assert(0 == string_common_prefix(s, t));
+    memory_shim_fail_at(1);
+    assert(0 == string_common_prefix(t, s));
+    memory_shim_fail_at(1);
+    assert(string_hash(NULL) == string_hash(s));
+    memory_shim_fail_at(1);
+    errno = 0;
+    assert(NULL == string_resize_uninit(s, 1));
+    assert(ENOMEM == errno);
+    memory_shim_fail_at(1);
+    assert(-ENOMEM == string_commit(s, 0));
+    memory_shim_fail_at(1);
+    assert(!string_utf8_validate(s));
+    memory_shim_fail_at(1);
+    assert(0 == string_utf8_length(s));
+    n = 1;
+    memory_shim_fail_at(1);
+    assert(-ENOMEM == string_utf8_to_utf32(s, u32, &n));
+    memory_shim_fail_at(1);
+    errno = 0;
+    assert(NULL == string_substr(s, 0, 1));
+    assert(ENOMEM == errno);
+    parts[0] = t;
+    parts[1] = s;
+    memory_shim_fail_at(1);
+    assert(-ENOMEM == string_join(t, s, parts, 2));
+    memory_shim_fail_at(1);
+    assert(-ENOMEM == string_join(t, t, parts, 2));
+    memory_shim_reset();
+    assert(string_compressed(s));
+    assert(DOCUMENT_SIZE == string_size(t));
+
+    // Functions that read the content decompress it.
+    assert(doc[1] == string_at(s, 1));
+    assert(!string_compressed(s));
+    assert(0 == string_compress(s, 0));
+    assert(doc[2] == string_at_inline(s, 2));
+    assert(0 == string_compress(s, 0));
+    v = string_as_view(s);
+    assert(DOCUMENT_SIZE == v.len && 0 == memcmp(v.buf, doc, DOCUMENT_SIZE));
+    assert(0 == string_compress(s, 0));
+    assert(0 == string_casecmp(s, t));
+    assert(0 == string_compress(s, 0));
+    assert(string_equal(t, s));
+    assert(0 == string_compress(s, 0));
+    assert(0 == string_compare(s, t));
+    assert(0 == string_compress(s, 0));
+    assert(DOCUMENT_SIZE == string_common_prefix(s, t));
+    assert(0 == string_compress(s, 0));
+    assert(string_starts_with(s, 10, doc));
+    assert(0 == string_compress(s, 0));
+    assert(string_ends_with(s, 10, &doc[DOCUMENT_SIZE - 10]));
+    assert(0 == string_compress(s, 0));
+    assert(string_hash(t) == string_hash(s));
+    assert(0 == string_compress(s, 0));
+    assert(0 == string_case_find(s, 0, 10, doc));
+    assert(0 == string_compress(s, 0));
+    assert(string_utf8_validate(s));
+    assert(0 == string_compress(s, 0));
+    assert(DOCUMENT_SIZE == string_utf8_length(s));
+    assert(0 == string_compress(s, 0));
+    n = 0;
+    assert(0 == string_utf8_to_utf32(s, NULL, &n));
+    assert(DOCUMENT_SIZE == n);
+    assert(0 == string_compress(s, 0));
+    string_delete(t);
+    t = string_substr(s, 5, 10);
+    assert(0 == memcmp(string_c_str(t), &doc[5], 10));
+    assert(0 == string_compress(s, 0));
+    parts[0] = s;
+    parts[1] = s;
+    assert(0 == string_join(t, s, parts, 2));
+    assert(3 * DOCUMENT_SIZE + 10 == string_size(t));
+    assert(0 == memcmp(&string_c_str(t)[10 + DOCUMENT_SIZE], doc, DOCUMENT_SIZE));
+    string_delete(t);
+
+    // Functions that modify the content decompress it first.
+    assert(0 == string_compress(s, 0));
+    assert(0 == string_push_back_inline(s, '!'));
+    assert(DOCUMENT_SIZE + 1 == string_size(s));
+    assert(0 == string_pop_back(s));
+    assert(0 == string_compress(s, 0));
+    assert(0 == string_append_buffer_inline(s, 1, "!"));
+    assert(0 == string_compress(s, 0));
+    assert(0 == string_pop_back(s));
+    assert(0 == string_compress(s, 0));
+    assert(0 == string_erase(s, 0, 300));
+    assert(0 == memcmp(string_c_str(s), &doc[300], DOCUMENT_SIZE - 300));
+    assert(0 == string_compress(s, 0));
+    assert(0 == string_apply_edits(s, &(struct string_edit){ 0, 0, 300, doc }, 1));
+    assert(0 == memcmp(string_c_str(s), doc, DOCUMENT_SIZE));
+    assert(0 == string_compress(s, 0));
+    assert(0 == string_to_upper(s));
+    assert('A' <= string_at(s, 0) && string_at(s, 0) <= 'Z');
+    assert(0 == string_compress(s, 0));
+    assert(0 == string_to_lower(s));
+    assert(0 == memcmp(string_c_str(s), doc, DOCUMENT_SIZE));
+    assert(0 == string_compress(s, 0));
+    assert(string_resize_uninit(s, 10));
+    assert(0 == memcmp(string_c_str(s), doc, 10));
+    assert(0 == string_append_buffer(s, DOCUMENT_SIZE - 10, &doc[10]));
+    assert(0 == string_compress(s, 0));
+    assert(0 == string_commit(s, 0));
+    assert(!string_compressed(s));
+    assert(0 == string_compress(s, 0));
+    assert(0 == string_append_utf32(s, 0, u32));
+    assert(0 == memcmp(string_c_str(s), doc, DOCUMENT_SIZE));
+    assert(0 == string_compress(s, 0));
+    assert(0 == string_reserve(s, 0));
+    assert(!string_compressed(s));
+    assert(0 == string_compress(s, 0));
+    free(string_c_str_move(s));
+    assert(string_empty(s));
+
+    string_delete(s);
+}
+
+static void test_string_memory(void)
+{
+    static char doc[DOCUMENT_SIZE];
+    struct string_memory usage;
+    struct string *s = NULL;
+    struct string *t = NULL;
+    size_t base = string_memory_total();
+    size_t allocations = string_memory_allocations();
+    char *buf;
+
+    make_document(doc, sizeof(doc));
+
+    usage = string_memory_usage(NULL);
+    assert(0 == usage.object && 0 == usage.heap);
+
+    // Short strings are held in the object.
+    s = string_new();
+    assert(0 == string_append_c_str(s, "short"));
+    usage = string_memory_usage(s);
+    assert(sizeof(struct test_string) == usage.object);
+    assert(0 == usage.heap);
+    assert(base == string_memory_total());
+    assert(allocations + 1 == string_memory_allocations());
+
+    // Growth, and peak.
+    assert(0 == string_reserve(s, 99));
+    assert(allocations + 2 == string_memory_allocations());
+    assert(100 == string_memory_usage(s).heap);
+    assert(base + 100 == string_memory_total());
+    string_memory_peak_reset();
+    assert(base + 100 == string_memory_peak());
+    assert(0 == string_reserve(s, 199));
+    assert(0 == string_reserve(s, 9));
+    assert(base + 10 == string_memory_total());
+    assert(base + 200 == string_memory_peak());
+    string_memory_peak_reset();
+    assert(base + 10 == string_memory_peak());
+
+    // Detached buffers are no longer held, adopted buffers are.
+    free(string_c_str_move(s));
+    assert(base == string_memory_total());
+    buf = malloc(50);
+    t = string_new_adopt(buf, 0, 49);
+    assert(base + 50 == string_memory_total());
+    assert(0 == string_move(s, t));
+    assert(0 == string_move(t, s));
+    assert(base + 50 == string_memory_total());
+    assert(0 == string_apply_edits(t, &(struct string_edit){ 0, 0, 20, doc }, 1));
+    assert(base + 21 == string_memory_total());
+
+    // Compressed strings hold their compressed size.
+    assert(0 == string_assign_buffer(s, DOCUMENT_SIZE, doc));
+    assert(0 == string_compress(s, 0));
+    assert(base + 21 + string_capacity(s) + 1 == string_memory_total());
+    assert(string_c_str(s));
+    assert(base + 21 + DOCUMENT_SIZE + 1 == string_memory_total());
+
+    // Budget.
+    string_memory_set_budget(string_memory_total() + 50);
+    assert(-ENOMEM == string_compress(s, 0));
+    assert(-ENOMEM == string_reserve(t, 100));
+    assert(-ENOMEM == string_append_fill(t, 100, 'x'));
+    assert(-ENOMEM == string_apply_edits(t, &(struct string_edit){ 0, 0, 100, doc }, 1));
+    assert(0 == string_append_fill(t, 20, 'x'));
+    buf = malloc(100);
+    errno = 0;
+    assert(NULL == string_new_adopt(buf, 0, 99));
+    assert(ENOMEM == errno);
+    free(buf);
+
+    // Lowering the budget below the total does not affect existing strings.
+    string_memory_set_budget(0);
+    assert(0 == string_reserve(s, 0));
+    assert(-ENOMEM == string_reserve(t, 1000));
+    string_memory_set_budget(SIZE_MAX);
+    assert(0 == string_compress(s, 0));
+    string_memory_set_budget(0);
+    errno = 0;
+    assert(NULL == string_c_str(s));
+    assert(ENOMEM == errno);
+    string_memory_set_budget(SIZE_MAX);
+
+    string_delete(s);
+    string_delete(t);
+    assert(base == string_memory_total());
+}
+
+/// @return New temporary file, removed from the file system.
+static int temp_file(void)
+{
+    char path[] = "/tmp/test_cstring.XXXXXX";
+    int fd = mkstemp(path);
+
+    assert(fd >= 0);
+    assert(0 == unlink(path));
+    return fd;
+}
+
+static void test_string_trace(void)
+{
+    static const char expected[] = STRING_TRACE_MAGIC "\x0b\x00";
+    const char *texts[] = { "a", "b" };
+    const size_t lens[] = { 1, 1 };
+    struct string *parts[2];
+    struct string *s = NULL;
+    char buf[64];
+    int fd = temp_file();
+    int ro;
+    size_t i;
+
+    assert(-EINVAL == string_trace_stop());
+    assert(-EBADF == string_trace_start(-1));
+
+    // The first record is relative to NULL, so a call on NULL takes two characters.
+    assert(!string_tracing());
+    assert(0 == string_trace_start(fd));
+    assert(string_tracing());
+    assert(-EBUSY == string_trace_start(fd));
+    string_clear(NULL);
+    assert(0 == string_trace_stop());
+    assert(-EINVAL == string_trace_stop());
+    assert(!string_tracing());
+    assert(sizeof(expected) - 1 == pread(fd, buf, sizeof(buf), 0));
+    assert(0 == memcmp(buf, expected, sizeof(expected) - 1));
+
+    // Operations with lists of arguments, and more records than are buffered.
+    assert(0 == string_trace_start(fd));
+    s = string_new();
+    parts[0] = s;
+    parts[1] = s;
+    assert(0 == string_apply_edits(s, &(struct string_edit){ 0, 0, 1, "a" }, 1));
+    assert(0 == string_join(s, s, parts, 2));
+    assert(0 == string_join_buffer(s, 1, ",", texts, lens, 2));
+    for (i = 0; i < 100000; ++i) {
+        string_at(s, 0);
+    }
+    assert(0 == string_trace_stop());
+    assert(lseek(fd, 0, SEEK_END) > 200000);
+    assert(0 == strcmp(string_c_str(s), "aaaaa,b"));
+    close(fd);
+
+    // Recording stops when writing fails, which is then reported.
+    ro = open("/dev/null", O_RDONLY);
+    assert(0 == string_trace_start(ro));
+    for (i = 0; i < 100000; ++i) {
+        string_at(s, 0);
+    }
+    assert(!string_tracing());
+    assert(-EBUSY == string_trace_start(ro));
+    assert(-EBADF == string_trace_stop());
+    close(ro);
+
+    string_delete(s);
+}
+
 int main(void)
 {
     test_string_new();
     test_string_delete();
+    test_string_new_adopt();
+    test_string_move();
+    test_string_swap();
     test_string_empty();
     test_string_size();
     test_string_reserve();
     test_string_capacity();
     test_string_at();
     test_string_c_str();
+    test_string_as_view();
     test_string_c_str_move();
     test_string_clear();
     test_string_insert_buffer();
     test_string_insert_c_str();
     test_string_insert_fill();
     test_string_erase();
+    test_string_apply_edits();
     test_string_push_back();
     test_string_pop_back();
     test_string_append_buffer();
     test_string_append_c_str();
     test_string_append_fill();
+    test_string_assign_buffer();
+    test_string_resize_uninit();
+    test_string_reserve_tail();
+    test_string_commit();
+    test_string_inline();
+    test_string_join();
+    test_string_join_buffer();
+    test_string_equal();
+    test_string_compare();
+    test_string_starts_with();
+    test_string_ends_with();
+    test_string_common_prefix();
+    test_string_hash();
+    test_string_hash_track();
+    test_string_to_lower();
+    test_string_to_upper();
+    test_string_casecmp();
+    test_string_case_find();
+    test_string_utf8_validate();
+    test_string_utf8_length();
+    test_string_utf8_to_utf16();
+    test_string_utf8_to_utf32();
+    test_string_append_utf16();
+    test_string_append_utf32();
     test_string_substr();
+    test_string_compress();
+    test_string_compressed_access();
+    test_string_memory();
+    test_string_trace();
     return 0;
 }
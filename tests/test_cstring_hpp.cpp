@@ -0,0 +1,207 @@
+#include "cstring.hpp"
+
+extern "C" {
+#include "memory_shim.h"
+}
+
+#include <cassert>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <unordered_set>
+
+/// @return True if calling @c fn throws @c E, false otherwise.
+template <typename E, typename F>
+static bool throws(F fn)
+{
+    try {
+        fn();
+    } catch (const E &) {
+        return true;
+    }
+    return false;
+}
+
+static void test_construct(void)
+{
+    static_assert(sizeof(cstring::string) == sizeof(struct string *));
+    static_assert(std::is_nothrow_move_constructible_v<cstring::string>);
+    static_assert(std::is_nothrow_move_assignable_v<cstring::string>);
+    static_assert(!std::is_convertible_v<std::string_view, cstring::string>);
+
+    cstring::string s;
+    assert(s.empty());
+    assert(s.size() == 0);
+    assert(0 == std::strcmp(s.c_str(), ""));
+
+    cstring::string t("abc");
+    assert(t.size() == 3);
+    assert(t == "abc");
+
+    memory_shim_fail_at(1);
+    assert(throws<std::bad_alloc>([] { cstring::string u; }));
+    memory_shim_reset();
+}
+
+static void test_move(void)
+{
+    cstring::string s("a string too long for the small buffer");
+    const char *buf = s.c_str();
+
+    // Moves steal the struct string, without allocating.
+    memory_shim_reset();
+    cstring::string t(std::move(s));
+    assert(t.c_str() == buf);
+    assert(s.empty());
+    assert(s.size() == 0);
+    assert(s.c_str() == nullptr);
+    assert(std::string_view(s).empty());
+
+    cstring::string u("u");
+    u = std::move(t);
+    assert(u.c_str() == buf);
+    assert(t == "u");
+    assert(memory_shim_count_get() == 1);
+
+    // Moved-from objects may be assigned to.
+    s = u;
+    assert(s == u);
+    assert(s.c_str() != u.c_str());
+    s = std::move(t);
+    assert(s == "u");
+
+    // Mutators of moved-from objects throw.
+    cstring::string v(std::move(s));
+    assert(throws<std::system_error>([&] { s.append("x"); }));
+    assert(throws<std::system_error>([&] { s.substr(); }));
+
+    s = "assigned";
+    assert(s == "assigned");
+
+    swap(s, v);
+    assert(s == "u");
+    assert(v == "assigned");
+}
+
+static void test_copy(void)
+{
+    cstring::string s("copy");
+    cstring::string t(s);
+    cstring::string &r = t;
+
+    assert(s == t);
+    assert(s.c_str() != t.c_str());
+
+    t = r;
+    assert(t == "copy");
+
+    t = std::string_view(t).substr(1);
+    assert(t == "opy");
+}
+
+static void test_view(void)
+{
+    cstring::string s("view");
+    std::string_view v = s;
+
+    assert(v.data() == s.c_str());
+    assert(v.data() == s.data());
+    assert(v.size() == 4);
+    assert(std::string(s) == "view");
+    assert(s[0] == 'v');
+    assert(s[4] == 0);
+    assert(s[5] == 0);
+}
+
+static void test_modify(void)
+{
+    cstring::string s;
+
+    s.reserve(100);
+    assert(s.capacity() >= 100);
+    memory_shim_fail_at(1);
+    assert(throws<std::bad_alloc>([&] { s.reserve(1000); }));
+    memory_shim_reset();
+
+    s.append("cd").append(std::string_view()).append(2, 'e');
+    s += "f";
+    s += 'g';
+    s.push_back('h');
+    s.insert(0, "ab").insert(s.size(), 1, 'i');
+    assert(s == "abcdeefghi");
+
+    s.pop_back();
+    s.erase(5, 1).erase(7);
+    assert(s == "abcdefg");
+
+    assert(throws<std::out_of_range>([&] { s.insert(100, "x"); }));
+    assert(throws<std::out_of_range>([&] { s.erase(100); }));
+
+    assert(s.substr(2, 3) == "cde");
+    assert(s.substr(2) == "cdefg");
+    assert(throws<std::out_of_range>([&] { s.substr(100); }));
+
+    assert(s.starts_with("abc"));
+    assert(s.starts_with(std::string_view()));
+    assert(!s.starts_with("b"));
+    assert(s.ends_with("efg"));
+    assert(!s.ends_with("f"));
+
+    s.clear();
+    assert(s.empty());
+    assert(throws<std::out_of_range>([&] { s.pop_back(); }));
+}
+
+static void test_compare(void)
+{
+    cstring::string a("apple");
+    cstring::string b("banana");
+    cstring::string c("apple");
+
+    assert(a == c);
+    assert(a != b);
+    assert(a == "apple");
+    assert("apple" == a);
+    assert(a != "banana");
+    assert("banana" != a);
+    assert(a < b);
+    assert(!(b < a));
+    assert(a.compare(b) < 0);
+    assert(a.compare(c) == 0);
+    assert(a.hash() == c.hash());
+
+    std::unordered_set<cstring::string> set;
+    set.insert(a);
+    set.insert(b);
+    set.insert(c);
+    assert(set.size() == 2);
+    assert(set.count(cstring::string("banana")) == 1);
+}
+
+static void test_c_api(void)
+{
+    cstring::string s("shared");
+    struct string *str;
+
+    assert(0 == string_append_c_str(s.get(), " with C"));
+    assert(s == "shared with C");
+
+    str = s.release();
+    assert(s.get() == nullptr);
+    assert(0 == std::strcmp(string_c_str(str), "shared with C"));
+
+    cstring::string t(str);
+    assert(t.get() == str);
+}
+
+int main(void)
+{
+    test_construct();
+    test_move();
+    test_copy();
+    test_view();
+    test_modify();
+    test_compare();
+    test_c_api();
+    return 0;
+}
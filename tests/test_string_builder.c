@@ -0,0 +1,360 @@
+#include "string_builder.h"
+
+#include "memory_shim.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/// Capacity of the largest chunks.
+#define MAX_CHUNK ((size_t)1 << 20)
+
+/// Number of chunks, more than are written by one writev() call.
+#define MANY_CHUNKS 70
+
+/// @return New temporary file, removed from the file system.
+static int temp_file(void)
+{
+    char path[] = "/tmp/test_string_builder.XXXXXX";
+    int fd = mkstemp(path);
+
+    assert(fd >= 0);
+    assert(0 == unlink(path));
+    return fd;
+}
+
+/// @return New string holding the content of file @c fd.
+static struct string *read_file(int fd)
+{
+    struct string *s = NULL;
+    char buf[4096];
+    ssize_t r;
+
+    s = string_new();
+    assert(0 == lseek(fd, 0, SEEK_SET));
+    while ((r = read(fd, buf, sizeof(buf))) > 0) {
+        assert(0 == string_append_buffer(s, (size_t)r, buf));
+    }
+    return s;
+}
+
+/// @return True if the chunks of @c b hold @c n characters of @c expected, false otherwise.
+static bool verify_chunks(const struct string_builder *b, size_t n, const char *expected)
+{
+    size_t off = 0;
+    size_t i;
+
+    for (i = 0; i < string_builder_chunks(b); ++i) {
+        struct string_view v = string_builder_chunk(b, i);
+
+        if (off + v.len > n || memcmp(v.buf, &expected[off], v.len) != 0) {
+            return false;
+        }
+        off += v.len;
+    }
+    return off == n && string_builder_size(b) == n;
+}
+
+static void test_string_builder_new(void)
+{
+    struct string_builder *b = NULL;
+    struct string_view v;
+
+    memory_shim_fail_at(1);
+    errno = 0;
+    assert(NULL == string_builder_new());
+    assert(ENOMEM == errno);
+    memory_shim_reset();
+
+    string_builder_delete(NULL);
+    string_builder_clear(NULL);
+    assert(0 == string_builder_size(NULL));
+    assert(0 == string_builder_chunks(NULL));
+    v = string_builder_chunk(NULL, 0);
+    assert(NULL == v.buf);
+    assert(0 == v.len);
+
+    b = string_builder_new();
+    assert(0 == string_builder_size(b));
+    assert(0 == string_builder_chunks(b));
+    v = string_builder_chunk(b, 0);
+    assert(NULL == v.buf);
+    string_builder_delete(b);
+}
+
+static void test_string_builder_append(void)
+{
+    struct string_builder *b = NULL;
+    char text[1000];
+    char twice[2 * sizeof(text)];
+    const char *first;
+    size_t i;
+
+    for (i = 0; i < sizeof(text); ++i) {
+        text[i] = (char)('a' + i % 26);
+    }
+    memcpy(twice, text, sizeof(text));
+    memcpy(&twice[sizeof(text)], text, sizeof(text));
+
+    assert(-EFAULT == string_builder_append_buffer(NULL, 1, "a"));
+    assert(-EFAULT == string_builder_append_c_str(NULL, "a"));
+    assert(-EFAULT == string_builder_push_back(NULL, 'a'));
+
+    b = string_builder_new();
+    assert(-EFAULT == string_builder_append_buffer(b, 1, NULL));
+    assert(-EFAULT == string_builder_append_c_str(b, NULL));
+    assert(-ENOMEM == string_builder_append_buffer(b, SIZE_MAX, "a"));
+
+    memory_shim_fail_at(1);
+    assert(-ENOMEM == string_builder_append_buffer(b, 1, "a"));
+    memory_shim_fail_at(2);
+    assert(-ENOMEM == string_builder_append_buffer(b, 1, "a"));
+    memory_shim_reset();
+    assert(0 == string_builder_size(b));
+
+    assert(0 == string_builder_append_buffer(b, 0, ""));
+    assert(0 == string_builder_append_c_str(b, "ab"));
+    assert(0 == string_builder_push_back(b, 'c'));
+    assert(1 == string_builder_chunks(b));
+    first = string_builder_chunk(b, 0).buf;
+
+    // Appends that overflow a chunk are split, and never move characters already written.
+    assert(0 == string_builder_append_buffer(b, sizeof(text) - 3, &text[3]));
+    assert(0 == string_builder_append_buffer(b, sizeof(text), text));
+    assert(3 == string_builder_chunks(b));
+    assert(first == string_builder_chunk(b, 0).buf);
+    assert(256 == string_builder_chunk(b, 0).len);
+    assert(verify_chunks(b, sizeof(twice), twice));
+
+    assert(-ENOMEM == string_builder_append_buffer(b, SIZE_MAX - 1999, "a"));
+
+    string_builder_clear(b);
+    assert(0 == string_builder_size(b));
+    assert(0 == string_builder_chunks(b));
+
+    assert(0 == string_builder_append_buffer(b, sizeof(text), text));
+    assert(verify_chunks(b, sizeof(text), text));
+
+    string_builder_delete(b);
+}
+
+static void test_string_builder_reserve_tail(void)
+{
+    struct string_builder *b = NULL;
+    char *p;
+
+    errno = 0;
+    assert(NULL == string_builder_reserve_tail(NULL, 1));
+    assert(EFAULT == errno);
+    assert(-EFAULT == string_builder_commit(NULL, 0));
+
+    b = string_builder_new();
+    assert(-ERANGE == string_builder_commit(b, 1));
+    assert(0 == string_builder_commit(b, 0));
+
+    errno = 0;
+    assert(NULL == string_builder_reserve_tail(b, SIZE_MAX));
+    assert(ENOMEM == errno);
+
+    p = string_builder_reserve_tail(b, 0);
+    assert(p);
+    assert(1 == string_builder_chunks(b));
+    memcpy(p, "abc", 3);
+    assert(0 == string_builder_commit(b, 3));
+
+    // Reserving within the last chunk does not start a new one.
+    p = string_builder_reserve_tail(b, 100);
+    assert(1 == string_builder_chunks(b));
+    memcpy(p, "def", 3);
+    assert(0 == string_builder_commit(b, 3));
+
+    // A request larger than the chunks starts a chunk of its size.
+    p = string_builder_reserve_tail(b, 5000);
+    assert(2 == string_builder_chunks(b));
+    memset(p, 'g', 5000);
+    assert(-ERANGE == string_builder_commit(b, 5001));
+    assert(0 == string_builder_commit(b, 5000));
+    assert(5006 == string_builder_size(b));
+    assert(5000 == string_builder_chunk(b, 1).len);
+
+    string_builder_delete(b);
+}
+
+static void test_string_builder_write(void)
+{
+    struct string_builder *b = NULL;
+    struct string *s = NULL;
+    int fd = temp_file();
+    size_t i;
+
+    assert(-EFAULT == string_builder_write(NULL, fd));
+
+    b = string_builder_new();
+    assert(0 == string_builder_write(b, fd));
+
+    // One character in each chunk.
+    for (i = 0; i < MANY_CHUNKS; ++i) {
+        char *p = string_builder_reserve_tail(b, MAX_CHUNK);
+
+        assert(p);
+        *p = (char)('a' + i % 26);
+        assert(0 == string_builder_commit(b, 1));
+    }
+    assert(MANY_CHUNKS == string_builder_chunks(b));
+
+    // Empty chunks are skipped.
+    assert(string_builder_reserve_tail(b, 2 * MAX_CHUNK));
+
+    assert(0 == string_builder_write(b, fd));
+    s = read_file(fd);
+    assert(MANY_CHUNKS == string_size(s));
+    for (i = 0; i < MANY_CHUNKS; ++i) {
+        assert(string_at(s, i) == (char)('a' + i % 26));
+    }
+    string_delete(s);
+    close(fd);
+
+    assert(-EBADF == string_builder_write(b, -1));
+
+    string_builder_delete(b);
+}
+
+/// Read end of pipe, and number of bytes read from it.
+struct reader {
+    int fd;
+    size_t n;
+};
+
+static void *drain(void *arg)
+{
+    struct reader *r = arg;
+    struct timespec delay = { 0, 10 * 1000 * 1000 };
+    char buf[4096];
+    ssize_t k;
+
+    // Let the builder fill the pipe first.
+    nanosleep(&delay, NULL);
+
+    while ((k = read(r->fd, buf, sizeof(buf))) > 0) {
+        r->n += (size_t)k;
+    }
+    return NULL;
+}
+
+static void test_string_builder_write_nonblocking(void)
+{
+    struct string_builder *b = NULL;
+    struct reader r = { 0, 0 };
+    pthread_t id;
+    int fds[2];
+    size_t i;
+
+    assert(0 == pipe(fds));
+    assert(0 == fcntl(fds[1], F_SETFL, O_NONBLOCK));
+    r.fd = fds[0];
+    assert(0 == pthread_create(&id, NULL, drain, &r));
+
+    // Writes that fill the pipe are resumed once it has room.
+    b = string_builder_new();
+    for (i = 0; i < 4; ++i) {
+        char *p = string_builder_reserve_tail(b, MAX_CHUNK);
+
+        assert(p);
+        memset(p, 'x', MAX_CHUNK);
+        assert(0 == string_builder_commit(b, MAX_CHUNK));
+    }
+    assert(0 == string_builder_write(b, fds[1]));
+    string_builder_delete(b);
+
+    close(fds[1]);
+    assert(0 == pthread_join(id, NULL));
+    assert(4 * MAX_CHUNK == r.n);
+    close(fds[0]);
+}
+
+static void test_string_builder_finish(void)
+{
+    struct string_builder *b = NULL;
+    struct string *s = NULL;
+    const char *buf;
+    char text[1000];
+    size_t i;
+
+    for (i = 0; i < sizeof(text); ++i) {
+        text[i] = (char)('a' + i % 26);
+    }
+
+    errno = 0;
+    assert(NULL == string_builder_finish(NULL));
+    assert(EFAULT == errno);
+
+    b = string_builder_new();
+
+    // Empty.
+    s = string_builder_finish(b);
+    assert(string_empty(s));
+    string_delete(s);
+
+    // A single chunk is adopted.
+    assert(0 == string_builder_append_buffer(b, 100, text));
+    buf = string_builder_chunk(b, 0).buf;
+    memory_shim_fail_at(1);
+    assert(NULL == string_builder_finish(b));
+    assert(ENOMEM == errno);
+    memory_shim_reset();
+    assert(100 == string_builder_size(b));
+
+    s = string_builder_finish(b);
+    assert(string_c_str(s) == buf);
+    assert(100 == string_size(s));
+    assert(0 == memcmp(string_c_str(s), text, 100));
+    assert(0 == string_builder_size(b));
+    assert(0 == string_builder_chunks(b));
+    string_delete(s);
+
+    // Several chunks are copied once.
+    assert(0 == string_builder_append_buffer(b, 100, text));
+    assert(0 == string_builder_append_buffer(b, sizeof(text) - 100, &text[100]));
+    assert(string_builder_chunks(b) > 1);
+
+    memory_shim_fail_at(1);
+    assert(NULL == string_builder_finish(b));
+    assert(ENOMEM == errno);
+    memory_shim_fail_at(2);
+    assert(NULL == string_builder_finish(b));
+    assert(ENOMEM == errno);
+    memory_shim_reset();
+
+    s = string_builder_finish(b);
+    assert(sizeof(text) == string_size(s));
+    assert(0 == memcmp(string_c_str(s), text, sizeof(text)));
+    assert(0 == string_c_str(s)[sizeof(text)]);
+    assert(0 == string_builder_size(b));
+    string_delete(s);
+
+    // The builder may be reused.
+    assert(0 == string_builder_append_c_str(b, "again"));
+    s = string_builder_finish(b);
+    assert(0 == strcmp(string_c_str(s), "again"));
+    string_delete(s);
+
+    string_builder_delete(b);
+}
+
+int main(void)
+{
+    test_string_builder_new();
+    test_string_builder_append();
+    test_string_builder_reserve_tail();
+    test_string_builder_write();
+    test_string_builder_write_nonblocking();
+    test_string_builder_finish();
+    return 0;
+}
@@ -0,0 +1,113 @@
+#include "string_chunk.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/// Size of the random data that is chunked.
+#define DATA_SIZE ((size_t)1 << 20)
+
+/// Fill @c buf with @c n random characters.
+static void make_random(char *buf, size_t n)
+{
+    uint32_t seed = 1;
+    size_t i;
+
+    for (i = 0; i < n; ++i) {
+        seed = seed * 1103515245 + 12345;
+        buf[i] = (char)(seed >> 16);
+    }
+}
+
+/// Split @c n characters of @c s into chunks, storing their hashes in @c hashes.
+/// @return Number of chunks.
+static size_t split(size_t n, const char *s, uint64_t *hashes)
+{
+    size_t count = 0;
+    size_t pos = 0;
+
+    while (pos < n) {
+        size_t len = string_chunk_boundary(n - pos, &s[pos], 256, 8192, 10);
+
+        assert(len >= 256 || pos + len == n);
+        assert(len <= 8192);
+        hashes[count++] = string_hash_buffer(len, &s[pos]);
+        pos += len;
+    }
+    return count;
+}
+
+static int compare_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+static void test_string_chunk_boundary(void)
+{
+    char *data = malloc(DATA_SIZE + 1);
+    uint64_t *before = malloc(DATA_SIZE / 256 * sizeof(uint64_t));
+    uint64_t *after = malloc(DATA_SIZE / 256 * sizeof(uint64_t));
+    size_t nbefore;
+    size_t nafter;
+    size_t common = 0;
+    size_t i;
+    size_t j;
+    size_t b;
+
+    assert(data && before && after);
+    make_random(&data[1], DATA_SIZE);
+    data[0] = 'x';
+
+    assert(0 == string_chunk_boundary(10, NULL, 0, 10, 8));
+
+    // Limited by the data, and by the maximum.
+    assert(100 == string_chunk_boundary(100, data, 200, 8192, 10));
+    assert(300 == string_chunk_boundary(DATA_SIZE, data, 1000, 300, 10));
+    assert(300 == string_chunk_boundary(DATA_SIZE, data, 0, 300, 100));
+
+    // Without bits tested, any position is a boundary.
+    assert(1 == string_chunk_boundary(DATA_SIZE, data, 0, 8192, 0));
+    assert(101 == string_chunk_boundary(DATA_SIZE, data, 100, 8192, 0));
+
+    // The boundary does not depend on the characters skipped before the minimum.
+    b = string_chunk_boundary(DATA_SIZE, data, 0, DATA_SIZE, 12);
+    assert(b > 1 && b < DATA_SIZE);
+    assert(b == string_chunk_boundary(DATA_SIZE, data, b / 2, DATA_SIZE, 12));
+    assert(b == string_chunk_boundary(DATA_SIZE, data, b - 1, DATA_SIZE, 12));
+
+    // Chunks average about 2^bits characters beyond the minimum.
+    nbefore = split(DATA_SIZE, &data[1], before);
+    assert(nbefore > DATA_SIZE / (256 + 2048));
+    assert(nbefore < DATA_SIZE / (256 + 512));
+
+    // Inserting a character at the start only changes the chunks near it.
+    nafter = split(DATA_SIZE + 1, data, after);
+    qsort(before, nbefore, sizeof(uint64_t), compare_u64);
+    qsort(after, nafter, sizeof(uint64_t), compare_u64);
+    for (i = 0, j = 0; i < nbefore && j < nafter;) {
+        if (before[i] == after[j]) {
+            ++common;
+            ++i;
+            ++j;
+        } else if (before[i] < after[j]) {
+            ++i;
+        } else {
+            ++j;
+        }
+    }
+    assert(common + 2 >= nbefore);
+
+    free(after);
+    free(before);
+    free(data);
+}
+
+int main(void)
+{
+    test_string_chunk_boundary();
+    return 0;
+}
@@ -0,0 +1,203 @@
+#include "string_codec.h"
+
+#include "memory_shim.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/// Encoding or decoding function.
+typedef int (*codec_fn)(struct string *, size_t n, const char *s);
+
+/// @return True if string content equals @c n characters of @c expected, false otherwise.
+static bool verify_content(const struct string *s, size_t n, const char *expected)
+{
+    return string_size(s) == n && memcmp(string_c_str(s), expected, n) == 0 && string_c_str(s)[n] == 0;
+}
+
+/// Test argument and allocation errors of @c fn.
+static void test_errors(codec_fn fn)
+{
+    struct string *s = NULL;
+
+    assert(-EFAULT == fn(NULL, 2, "AA"));
+
+    s = string_new();
+
+    assert(-EFAULT == fn(s, 2, NULL));
+
+    memory_shim_fail_at(1);
+    assert(-ENOMEM == fn(s, 32, "abcdefABCDEF0123456789abcdefABCD"));
+    memory_shim_reset();
+    assert(string_empty(s));
+
+    string_delete(s);
+}
+
+/// Test that decoding the encoding of every length of a buffer holding every byte restores it.
+static void test_round_trip(codec_fn encode, codec_fn decode)
+{
+    struct string *encoded = NULL;
+    struct string *decoded = NULL;
+    char all[256];
+    size_t i;
+
+    for (i = 0; i < sizeof(all); ++i) {
+        all[i] = (char)(255 - i);
+    }
+
+    encoded = string_new();
+    decoded = string_new();
+
+    for (i = 0; i <= sizeof(all); ++i) {
+        string_clear(encoded);
+        string_clear(decoded);
+        assert(0 == encode(encoded, i, all));
+        assert(0 == decode(decoded, string_size(encoded), string_c_str(encoded)));
+        assert(verify_content(decoded, i, all));
+    }
+
+    string_delete(encoded);
+    string_delete(decoded);
+}
+
+/// @return Result of applying @c fn to @c in on a string holding "x", and verify that is unchanged on error.
+static int decode(codec_fn fn, const char *in, size_t n, const char *expected)
+{
+    struct string *s = NULL;
+    int r;
+
+    s = string_new();
+    assert(0 == string_append_c_str(s, "x"));
+
+    r = fn(s, strlen(in), in);
+    if (r == 0) {
+        assert(0 == strncmp(string_c_str(s), "x", 1));
+        assert(string_size(s) == n + 1);
+        assert(0 == memcmp(string_c_str(s) + 1, expected, n));
+    } else {
+        assert(0 == strcmp(string_c_str(s), "x"));
+    }
+
+    string_delete(s);
+    return r;
+}
+
+static void test_string_append_hex(void)
+{
+    struct string *s = NULL;
+
+    test_errors(string_append_hex);
+
+    s = string_new();
+
+    assert(-ENOMEM == string_append_hex(s, SIZE_MAX, "a"));
+
+    assert(0 == string_append_hex(s, 0, ""));
+    assert(string_empty(s));
+
+    assert(0 == string_append_hex(s, 6, "\x00\x01\xab\xcd\xef\xff"));
+    assert(0 == strcmp(string_c_str(s), "0001abcdefff"));
+
+    string_delete(s);
+}
+
+static void test_string_append_hex_decoded(void)
+{
+    test_errors(string_append_hex_decoded);
+    test_round_trip(string_append_hex, string_append_hex_decoded);
+
+    assert(0 == decode(string_append_hex_decoded, "", 0, ""));
+    assert(0 == decode(string_append_hex_decoded, "0001abcdefff", 6, "\x00\x01\xab\xcd\xef\xff"));
+    assert(0 == decode(string_append_hex_decoded, "ABCDEF", 3, "\xab\xcd\xef"));
+
+    assert(-EILSEQ == decode(string_append_hex_decoded, "abc", 0, NULL));
+    assert(-EILSEQ == decode(string_append_hex_decoded, "0g", 0, NULL));
+    assert(-EILSEQ == decode(string_append_hex_decoded, "g0", 0, NULL));
+    assert(-EILSEQ == decode(string_append_hex_decoded, "00 1", 0, NULL));
+}
+
+static void test_string_append_base64(void)
+{
+    struct string *s = NULL;
+
+    test_errors(string_append_base64);
+
+    s = string_new();
+
+    assert(-ENOMEM == string_append_base64(s, SIZE_MAX, "a"));
+
+    assert(0 == string_append_base64(s, 27, "Many hands make light work."));
+    assert(0 == strcmp(string_c_str(s), "TWFueSBoYW5kcyBtYWtlIGxpZ2h0IHdvcmsu"));
+
+    string_clear(s);
+    assert(0 == string_append_base64(s, 1, "M"));
+    assert(0 == string_append_base64(s, 2, "Ma"));
+    assert(0 == string_append_base64(s, 3, "Man"));
+    assert(0 == string_append_base64(s, 4, "\xfb\xff\xbf\xfe"));
+    assert(0 == strcmp(string_c_str(s), "TQ==TWE=TWFu+/+//g=="));
+
+    string_delete(s);
+}
+
+static void test_string_append_base64_decoded(void)
+{
+    test_errors(string_append_base64_decoded);
+    test_round_trip(string_append_base64, string_append_base64_decoded);
+
+    assert(0 == decode(string_append_base64_decoded, "", 0, ""));
+    assert(0 == decode(string_append_base64_decoded, "TWFueSBoYW5kcyBtYWtlIGxpZ2h0IHdvcmsu", 27, "Many hands make light work."));
+    assert(0 == decode(string_append_base64_decoded, "TQ==", 1, "M"));
+    assert(0 == decode(string_append_base64_decoded, "TWE=", 2, "Ma"));
+    assert(0 == decode(string_append_base64_decoded, "TQ", 1, "M"));
+    assert(0 == decode(string_append_base64_decoded, "TWE", 2, "Ma"));
+    assert(0 == decode(string_append_base64_decoded, "+/+//g==", 4, "\xfb\xff\xbf\xfe"));
+
+    assert(-EILSEQ == decode(string_append_base64_decoded, "T", 0, NULL));
+    assert(-EILSEQ == decode(string_append_base64_decoded, "TWFuT===", 0, NULL));
+    assert(-EILSEQ == decode(string_append_base64_decoded, "TQ==TWFu", 0, NULL));
+    assert(-EILSEQ == decode(string_append_base64_decoded, "TWFu\nTWFu", 0, NULL));
+    assert(-EILSEQ == decode(string_append_base64_decoded, "-_-__g", 0, NULL));
+}
+
+static void test_string_append_base64url(void)
+{
+    struct string *s = NULL;
+
+    test_errors(string_append_base64url);
+
+    s = string_new();
+
+    assert(0 == string_append_base64url(s, 1, "M"));
+    assert(0 == string_append_base64url(s, 2, "Ma"));
+    assert(0 == string_append_base64url(s, 3, "Man"));
+    assert(0 == string_append_base64url(s, 4, "\xfb\xff\xbf\xfe"));
+    assert(0 == strcmp(string_c_str(s), "TQTWETWFu-_-__g"));
+
+    string_delete(s);
+}
+
+static void test_string_append_base64url_decoded(void)
+{
+    test_errors(string_append_base64url_decoded);
+    test_round_trip(string_append_base64url, string_append_base64url_decoded);
+
+    assert(0 == decode(string_append_base64url_decoded, "-_-__g", 4, "\xfb\xff\xbf\xfe"));
+    assert(0 == decode(string_append_base64url_decoded, "-_-__g==", 4, "\xfb\xff\xbf\xfe"));
+
+    assert(-EILSEQ == decode(string_append_base64url_decoded, "+/+//g==", 0, NULL));
+}
+
+int main(void)
+{
+    test_string_append_hex();
+    test_string_append_hex_decoded();
+    test_string_append_base64();
+    test_string_append_base64_decoded();
+    test_string_append_base64url();
+    test_string_append_base64url_decoded();
+    return 0;
+}
@@ -0,0 +1,231 @@
+#include "string_escape.h"
+
+#include "memory_shim.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/// Escaping or unescaping function.
+typedef int (*codec_fn)(struct string *, size_t n, const char *s);
+
+/// @return True if string content equals @c n characters of @c expected, false otherwise.
+static bool verify_content(const struct string *s, size_t n, const char *expected)
+{
+    return string_size(s) == n && memcmp(string_c_str(s), expected, n) == 0 && string_c_str(s)[n] == 0;
+}
+
+/// Test argument and allocation errors of @c fn.
+static void test_errors(codec_fn fn)
+{
+    struct string *s = NULL;
+
+    assert(-EFAULT == fn(NULL, 1, "a"));
+
+    s = string_new();
+
+    assert(-EFAULT == fn(s, 1, NULL));
+    assert(-ENOMEM == fn(s, SIZE_MAX, "a"));
+
+    memory_shim_fail_at(1);
+    assert(-ENOMEM == fn(s, 32, "abcdefghijklmnopqrstuvwxyz012345"));
+    memory_shim_reset();
+    assert(string_empty(s));
+
+    string_delete(s);
+}
+
+/// Test that decoding the encoding of every character restores it.
+static void test_round_trip(codec_fn encode, codec_fn decode)
+{
+    struct string *encoded = NULL;
+    struct string *decoded = NULL;
+    char all[256];
+    size_t i;
+
+    for (i = 0; i < sizeof(all); ++i) {
+        all[i] = (char)i;
+    }
+
+    encoded = string_new();
+    decoded = string_new();
+
+    assert(0 == encode(encoded, sizeof(all), all));
+    assert(0 == decode(decoded, string_size(encoded), string_c_str(encoded)));
+    assert(verify_content(decoded, sizeof(all), all));
+
+    string_delete(encoded);
+    string_delete(decoded);
+}
+
+/// @return Result of unescaping @c in with @c fn into a string holding "x", and verify that is unchanged on error.
+static int unescape(codec_fn fn, const char *in, const char *expected)
+{
+    struct string *s = NULL;
+    int r;
+
+    s = string_new();
+    assert(0 == string_append_c_str(s, "x"));
+
+    r = fn(s, strlen(in), in);
+    if (r == 0) {
+        assert(0 == strncmp(string_c_str(s), "x", 1));
+        assert(0 == strcmp(string_c_str(s) + 1, expected));
+    } else {
+        assert(0 == strcmp(string_c_str(s), "x"));
+    }
+
+    string_delete(s);
+    return r;
+}
+
+static void test_string_append_json_escaped(void)
+{
+    struct string *s = NULL;
+
+    test_errors(string_append_json_escaped);
+
+    s = string_new();
+
+    assert(0 == string_append_json_escaped(s, 0, ""));
+    assert(string_empty(s));
+
+    assert(0 == string_append_json_escaped(s, 43, "{\"path\": \"C:\\\\temp\", \"note\": \"tab\there\"}\n\x01\x7f"));
+    assert(0 == strcmp(string_c_str(s), "{\\\"path\\\": \\\"C:\\\\\\\\temp\\\", \\\"note\\\": \\\"tab\\there\\\"}\\n\\u0001\x7f"));
+
+    string_clear(s);
+    assert(0 == string_append_json_escaped(s, 23, "caf\xc3\xa9 a long clean run\0"));
+    assert(0 == strcmp(string_c_str(s), "caf\xc3\xa9 a long clean run\\u0000"));
+
+    string_delete(s);
+}
+
+static void test_string_append_json_unescaped(void)
+{
+    test_errors(string_append_json_unescaped);
+    test_round_trip(string_append_json_escaped, string_append_json_unescaped);
+
+    assert(0 == unescape(string_append_json_unescaped, "plain text", "plain text"));
+    assert(0 == unescape(string_append_json_unescaped, "\\\"\\\\\\/\\b\\f\\n\\r\\t", "\"\\/\b\f\n\r\t"));
+    assert(0 == unescape(string_append_json_unescaped, "\\u0041\\u00e9\\u20AC", "A\xc3\xa9\xe2\x82\xac"));
+    assert(0 == unescape(string_append_json_unescaped, "\\ud83d\\ude00!", "\xf0\x9f\x98\x80!"));
+
+    assert(-EILSEQ == unescape(string_append_json_unescaped, "trailing \\", NULL));
+    assert(-EILSEQ == unescape(string_append_json_unescaped, "\\a", NULL));
+    assert(-EILSEQ == unescape(string_append_json_unescaped, "\\u004", NULL));
+    assert(-EILSEQ == unescape(string_append_json_unescaped, "\\u004g", NULL));
+    assert(-EILSEQ == unescape(string_append_json_unescaped, "\\ude00", NULL));
+    assert(-EILSEQ == unescape(string_append_json_unescaped, "\\ud83d", NULL));
+    assert(-EILSEQ == unescape(string_append_json_unescaped, "\\ud83d\\u0041", NULL));
+    assert(-EILSEQ == unescape(string_append_json_unescaped, "\\ud83d\\n\\u0041", NULL));
+}
+
+static void test_string_append_url_encoded(void)
+{
+    struct string *s = NULL;
+
+    test_errors(string_append_url_encoded);
+
+    s = string_new();
+
+    assert(0 == string_append_url_encoded(s, 29, "AZaz09-._~ /?&=+%:@\xc3\xa9[]`{}\x7f\x01\x00"));
+    assert(0 == strcmp(string_c_str(s), "AZaz09-._~%20%2F%3F%26%3D%2B%25%3A%40%C3%A9%5B%5D%60%7B%7D%7F%01%00"));
+
+    string_delete(s);
+}
+
+static void test_string_append_url_decoded(void)
+{
+    test_errors(string_append_url_decoded);
+    test_round_trip(string_append_url_encoded, string_append_url_decoded);
+
+    assert(0 == unescape(string_append_url_decoded, "a%20b+c%2fd%2F", "a b+c/d/"));
+    assert(-EILSEQ == unescape(string_append_url_decoded, "a%2", NULL));
+    assert(-EILSEQ == unescape(string_append_url_decoded, "a%%20", NULL));
+    assert(-EILSEQ == unescape(string_append_url_decoded, "a%g0", NULL));
+}
+
+static void test_string_append_html_escaped(void)
+{
+    struct string *s = NULL;
+
+    test_errors(string_append_html_escaped);
+
+    s = string_new();
+
+    assert(0 == string_append_html_escaped(s, 49, "<a href=\"x?a=1&b='2'\">Tom & Jerry's clean run</a>"));
+    assert(0 == strcmp(string_c_str(s), "&lt;a href=&quot;x?a=1&amp;b=&#39;2&#39;&quot;&gt;Tom &amp; Jerry&#39;s clean run&lt;/a&gt;"));
+
+    string_delete(s);
+}
+
+static void test_string_append_html_unescaped(void)
+{
+    test_errors(string_append_html_unescaped);
+    test_round_trip(string_append_html_escaped, string_append_html_unescaped);
+
+    assert(0 == unescape(string_append_html_unescaped, "&amp;&lt;&gt;&quot;&apos;&#39;", "&<>\"''"));
+    assert(0 == unescape(string_append_html_unescaped, "&#65;&#x41;&#X41;&#233;&#x20ac;&#128512;", "AAA\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80"));
+    assert(0 == unescape(string_append_html_unescaped, "&#x10FFFF;", "\xf4\x8f\xbf\xbf"));
+
+    // A '&' that begins no reference is kept.
+    assert(0 == unescape(string_append_html_unescaped, "AT&T &amp; a & b", "AT&T & a & b"));
+    assert(0 == unescape(string_append_html_unescaped, "&&amp;&", "&&&"));
+    assert(0 == unescape(string_append_html_unescaped, "Tom & Jerry", "Tom & Jerry"));
+    assert(0 == unescape(string_append_html_unescaped, "&amp", "&amp"));
+    assert(0 == unescape(string_append_html_unescaped, "&nbsp;", "&nbsp;"));
+    assert(0 == unescape(string_append_html_unescaped, "&;", "&;"));
+    assert(0 == unescape(string_append_html_unescaped, "&#;", "&#;"));
+    assert(0 == unescape(string_append_html_unescaped, "&#x;", "&#x;"));
+    assert(0 == unescape(string_append_html_unescaped, "&#12a;", "&#12a;"));
+    assert(0 == unescape(string_append_html_unescaped, "&#0;", "&#0;"));
+    assert(0 == unescape(string_append_html_unescaped, "&#xd800;", "&#xd800;"));
+    assert(0 == unescape(string_append_html_unescaped, "&#x110000;", "&#x110000;"));
+    assert(0 == unescape(string_append_html_unescaped, "&#00000000065;", "&#00000000065;"));
+}
+
+static void test_string_append_c_escaped(void)
+{
+    struct string *s = NULL;
+
+    test_errors(string_append_c_escaped);
+
+    s = string_new();
+
+    assert(0 == string_append_c_escaped(s, 31, "printf(\"%s\\n\", 'x');\a\b\f\n\r\t\v\x7f\xff\x00" "1"));
+    assert(0 == strcmp(string_c_str(s), "printf(\\\"%s\\\\n\\\", \\'x\\');\\a\\b\\f\\n\\r\\t\\v\\177\\377\\0001"));
+
+    string_delete(s);
+}
+
+static void test_string_append_c_unescaped(void)
+{
+    test_errors(string_append_c_unescaped);
+    test_round_trip(string_append_c_escaped, string_append_c_unescaped);
+
+    assert(0 == unescape(string_append_c_unescaped, "\\\"\\\\\\'\\?\\a\\b\\f\\n\\r\\t\\v", "\"\\'?\a\b\f\n\r\t\v"));
+    assert(0 == unescape(string_append_c_unescaped, "\\101\\1011\\60\\x41\\x4a\\x4AB\\x9", "AA1" "0AJJB\t"));
+
+    assert(-EILSEQ == unescape(string_append_c_unescaped, "\\", NULL));
+    assert(-EILSEQ == unescape(string_append_c_unescaped, "\\q", NULL));
+    assert(-EILSEQ == unescape(string_append_c_unescaped, "\\x", NULL));
+    assert(-EILSEQ == unescape(string_append_c_unescaped, "\\xg", NULL));
+    assert(-EILSEQ == unescape(string_append_c_unescaped, "\\8", NULL));
+    assert(-EILSEQ == unescape(string_append_c_unescaped, "\\400", NULL));
+}
+
+int main(void)
+{
+    test_string_append_json_escaped();
+    test_string_append_json_unescaped();
+    test_string_append_url_encoded();
+    test_string_append_url_decoded();
+    test_string_append_html_escaped();
+    test_string_append_html_unescaped();
+    test_string_append_c_escaped();
+    test_string_append_c_unescaped();
+    return 0;
+}
@@ -0,0 +1,224 @@
+#include "string_frozen.h"
+
+#include "memory_shim.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/// Number of threads sharing a frozen string.
+#define THREADS 4
+
+/// Number of times each thread retains and releases a frozen string.
+#define ROUNDS 100000
+
+/// Content longer than the frozen inline storage.
+#define LONG_TEXT "a configuration value that is long enough to be kept in its own buffer"
+
+static void test_string_freeze(void)
+{
+    struct string_frozen *f = NULL;
+    struct string *s = NULL;
+    struct string_view v;
+    const char *buf;
+
+    errno = 0;
+    assert(NULL == string_freeze(NULL));
+    assert(EFAULT == errno);
+
+    s = string_new();
+
+    // Short strings are copied.
+    assert(0 == string_append_buffer(s, 5, "sh\0rt"));
+    memory_shim_fail_at(1);
+    assert(NULL == string_freeze(s));
+    assert(ENOMEM == errno);
+    memory_shim_reset();
+    assert(string_size(s) == 5);
+
+    f = string_freeze(s);
+    assert(f);
+    assert(string_empty(s));
+    assert(5 == string_frozen_size(f));
+    assert(0 == memcmp(string_frozen_c_str(f), "sh\0rt", 6));
+    string_frozen_release(f);
+
+    // Long strings hand over their buffer.
+    assert(0 == string_append_c_str(s, LONG_TEXT));
+    buf = string_c_str(s);
+    f = string_freeze(s);
+    assert(string_empty(s));
+    assert(string_frozen_c_str(f) == buf);
+    v = string_frozen_view(f);
+    assert(v.buf == buf);
+    assert(v.len == strlen(LONG_TEXT));
+    string_frozen_release(f);
+
+    string_delete(s);
+}
+
+static void test_string_freeze_compressed(void)
+{
+    struct string_frozen *f = NULL;
+    struct string *s = NULL;
+    size_t lens[] = { 40, 4000 };
+    size_t i;
+
+    for (i = 0; i < sizeof(lens) / sizeof(lens[0]); ++i) {
+        s = string_new();
+        assert(0 == string_reserve(s, 100));
+        assert(0 == string_append_fill(s, lens[i], 'a'));
+        assert(0 == string_compress(s, 0));
+        assert(string_compressed(s));
+
+        // Expanding the content fails under a budget.
+        string_memory_set_budget(string_memory_total());
+        errno = 0;
+        assert(NULL == string_freeze(s));
+        assert(ENOMEM == errno);
+        assert(string_compressed(s));
+        assert(lens[i] == string_size(s));
+        string_memory_set_budget(SIZE_MAX);
+
+        f = string_freeze(s);
+        assert(f);
+        assert(string_empty(s));
+        assert(lens[i] == string_frozen_size(f));
+        assert('a' == string_frozen_c_str(f)[lens[i] - 1]);
+        string_frozen_release(f);
+        string_delete(s);
+    }
+}
+
+static void test_string_frozen_null(void)
+{
+    struct string_view v;
+
+    errno = 0;
+    assert(NULL == string_frozen_retain(NULL));
+    assert(EFAULT == errno);
+
+    string_frozen_release(NULL);
+    assert(0 == string_frozen_size(NULL));
+
+    errno = 0;
+    assert(NULL == string_frozen_c_str(NULL));
+    assert(EFAULT == errno);
+
+    v = string_frozen_view(NULL);
+    assert(NULL == v.buf);
+    assert(0 == v.len);
+
+    errno = 0;
+    assert(NULL == string_thaw(NULL));
+    assert(EFAULT == errno);
+}
+
+static void test_string_thaw(void)
+{
+    struct string_frozen *f = NULL;
+    struct string *s = NULL;
+    struct string *t = NULL;
+    const char *buf;
+
+    // The last reference to a long string moves its buffer.
+    s = string_new();
+    assert(0 == string_append_c_str(s, LONG_TEXT));
+    buf = string_c_str(s);
+    f = string_freeze(s);
+
+    memory_shim_fail_at(1);
+    assert(NULL == string_thaw(f));
+    assert(ENOMEM == errno);
+    memory_shim_reset();
+
+    t = string_thaw(f);
+    assert(string_c_str(t) == buf);
+    assert(0 == strcmp(string_c_str(t), LONG_TEXT));
+    assert(0 == string_append_c_str(t, "!"));
+    string_delete(t);
+
+    // Shared strings are copied, leaving the other references intact.
+    assert(0 == string_append_c_str(s, LONG_TEXT));
+    f = string_freeze(s);
+    assert(f == string_frozen_retain(f));
+
+    memory_shim_fail_at(1);
+    assert(NULL == string_thaw(f));
+    assert(ENOMEM == errno);
+    memory_shim_fail_at(2);
+    assert(NULL == string_thaw(f));
+    assert(ENOMEM == errno);
+    memory_shim_reset();
+
+    t = string_thaw(f);
+    assert(string_c_str(t) != string_frozen_c_str(f));
+    assert(0 == strcmp(string_c_str(t), LONG_TEXT));
+    string_delete(t);
+
+    t = string_thaw(f);
+    assert(0 == strcmp(string_c_str(t), LONG_TEXT));
+    string_delete(t);
+
+    // Short strings are copied.
+    assert(0 == string_append_c_str(s, "short"));
+    f = string_freeze(s);
+    t = string_thaw(f);
+    assert(0 == strcmp(string_c_str(t), "short"));
+    string_delete(t);
+
+    string_delete(s);
+}
+
+static void *share(void *arg)
+{
+    struct string_frozen *f = arg;
+    size_t i;
+
+    for (i = 0; i < ROUNDS; ++i) {
+        struct string_frozen *g = string_frozen_retain(f);
+
+        assert(0 == strcmp(string_frozen_c_str(g), LONG_TEXT));
+        string_frozen_release(g);
+    }
+
+    string_frozen_release(f);
+    return NULL;
+}
+
+static void test_string_frozen_concurrent(void)
+{
+    struct string_frozen *f = NULL;
+    struct string *s = NULL;
+    pthread_t ids[THREADS];
+    size_t k;
+
+    s = string_new();
+    assert(0 == string_append_c_str(s, LONG_TEXT));
+    f = string_freeze(s);
+    string_delete(s);
+
+    // Each thread is handed its own reference, and releases it when done; the last one deletes the object.
+    for (k = 0; k < THREADS; ++k) {
+        assert(0 == pthread_create(&ids[k], NULL, share, string_frozen_retain(f)));
+    }
+    string_frozen_release(f);
+
+    for (k = 0; k < THREADS; ++k) {
+        assert(0 == pthread_join(ids[k], NULL));
+    }
+}
+
+int main(void)
+{
+    test_string_freeze();
+    test_string_freeze_compressed();
+    test_string_frozen_null();
+    test_string_thaw();
+    test_string_frozen_concurrent();
+    return 0;
+}
@@ -0,0 +1,316 @@
+#include "string_map.h"
+
+#include "memory_shim.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/// Number of keys for tests that grow the map through several resizes.
+#define MANY_KEYS 20000
+
+/// Format key @c i, which is short (stored inline) for odd @c i and long otherwise.
+/// @return Length of key.
+static size_t make_key(char *buf, size_t i)
+{
+    return (size_t)sprintf(buf, (i % 2) ? "k%zu" : "a-rather-long-key-%zu", i);
+}
+
+/// @return True if map contains @c key with @c expected value, false otherwise.
+static bool verify_entry(const struct string_map *map, const char *key, void *expected)
+{
+    void *value = NULL;
+
+    return string_map_find(map, strlen(key), key, &value) == 0 && value == expected;
+}
+
+static void test_string_map_new(void)
+{
+    struct string_map *map = NULL;
+
+    memory_shim_fail_at(1);
+    errno = 0;
+    map = string_map_new();
+    memory_shim_reset();
+    assert(NULL == map);
+    assert(ENOMEM == errno);
+}
+
+static void test_string_map_delete(void)
+{
+    struct string_map *map = NULL;
+
+    string_map_delete(NULL);
+
+    map = string_map_new();
+
+    string_map_delete(map);
+
+    map = string_map_new();
+    assert(0 == string_map_insert(map, 3, "abc", NULL));
+    assert(0 == string_map_insert(map, 20, "a key that is longer", NULL));
+    string_map_delete(map);
+}
+
+static void test_string_map_size(void)
+{
+    struct string_map *map = NULL;
+
+    assert(0 == string_map_size(NULL));
+
+    map = string_map_new();
+
+    assert(0 == string_map_size(map));
+    assert(0 == string_map_insert(map, 0, "", NULL));
+    assert(1 == string_map_size(map));
+    assert(0 == string_map_insert(map, 0, "", map));
+    assert(1 == string_map_size(map));
+    assert(0 == string_map_insert(map, 1, "", NULL));
+    assert(2 == string_map_size(map));
+
+    string_map_delete(map);
+}
+
+static void test_string_map_clear(void)
+{
+    struct string_map *map = NULL;
+
+    string_map_clear(NULL);
+
+    map = string_map_new();
+
+    string_map_clear(map);
+    assert(0 == string_map_size(map));
+
+    assert(0 == string_map_insert(map, 5, "short", NULL));
+    assert(0 == string_map_insert(map, 24, "a key that is not inline", NULL));
+    string_map_clear(map);
+    assert(0 == string_map_size(map));
+    assert(-ENOENT == string_map_find(map, 5, "short", NULL));
+    assert(-ENOENT == string_map_find(map, 24, "a key that is not inline", NULL));
+
+    // Storage is reused.
+    memory_shim_reset();
+    assert(0 == string_map_insert(map, 5, "short", NULL));
+    assert(0 == memory_shim_count_get());
+    assert(1 == string_map_size(map));
+
+    string_map_delete(map);
+}
+
+static void test_string_map_reserve(void)
+{
+    struct string_map *map = NULL;
+    char key[64];
+    size_t i;
+
+    assert(-EFAULT == string_map_reserve(NULL, 0));
+
+    map = string_map_new();
+
+    assert(-ENOMEM == string_map_reserve(map, SIZE_MAX));
+
+    memory_shim_fail_at(1);
+    assert(-ENOMEM == string_map_reserve(map, 1));
+    memory_shim_fail_at(2);
+    assert(-ENOMEM == string_map_reserve(map, 1));
+    memory_shim_reset();
+
+    assert(0 == string_map_reserve(map, 1000));
+    assert(0 == string_map_reserve(map, 10));
+
+    // No rehash while inserting reserved entries.
+    for (i = 0; i < 1000; ++i) {
+        assert(0 == string_map_insert(map, make_key(key, i), key, NULL));
+    }
+    memory_shim_reset();
+    for (i = 0; i < 1000; i += 2) {
+        assert(0 == string_map_insert(map, make_key(key, i + 1000000), key, NULL));
+    }
+    assert(1500 == string_map_size(map));
+    assert(500 == memory_shim_count_get());
+
+    string_map_delete(map);
+}
+
+static void test_string_map_insert(void)
+{
+    struct string_map *map = NULL;
+    char key[64];
+    size_t n;
+    size_t i;
+
+    assert(-EFAULT == string_map_insert(NULL, 0, "", NULL));
+
+    map = string_map_new();
+
+    assert(-EFAULT == string_map_insert(map, 0, NULL, NULL));
+
+    // Allocation failures leave map unchanged.
+    memory_shim_fail_at(1);
+    assert(-ENOMEM == string_map_insert(map, 3, "abc", NULL));
+    memory_shim_fail_at(3);
+    assert(-ENOMEM == string_map_insert(map, 17, "seventeen chars!!", NULL));
+    memory_shim_reset();
+    assert(0 == string_map_size(map));
+    assert(-ENOENT == string_map_find(map, 17, "seventeen chars!!", NULL));
+
+    // Keys at the inline size boundary, and with embedded NUL characters.
+    assert(0 == string_map_insert(map, 16, "sixteen chars!!!", &map));
+    assert(0 == string_map_insert(map, 17, "seventeen chars!!", &n));
+    assert(0 == string_map_insert(map, 4, "a\0bc", &i));
+    assert(0 == string_map_insert(map, 4, "a\0bd", key));
+    assert(verify_entry(map, "sixteen chars!!!", &map));
+    assert(verify_entry(map, "seventeen chars!!", &n));
+    assert(0 == string_map_find(map, 4, "a\0bc", NULL));
+
+    // Replace.
+    assert(0 == string_map_insert(map, 16, "sixteen chars!!!", NULL));
+    assert(0 == string_map_insert(map, 17, "seventeen chars!!", NULL));
+    assert(verify_entry(map, "sixteen chars!!!", NULL));
+    assert(verify_entry(map, "seventeen chars!!", NULL));
+    assert(4 == string_map_size(map));
+
+    // Grow through several resizes.
+    string_map_clear(map);
+    for (i = 0; i < MANY_KEYS; ++i) {
+        n = make_key(key, i);
+        assert(0 == string_map_insert(map, n, key, (void *)(uintptr_t)i));
+    }
+    assert(MANY_KEYS == string_map_size(map));
+    for (i = 0; i < MANY_KEYS; ++i) {
+        void *value = NULL;
+
+        n = make_key(key, i);
+        assert(0 == string_map_find(map, n, key, &value));
+        assert(i == (uintptr_t)value);
+    }
+
+    string_map_delete(map);
+}
+
+static void test_string_map_find(void)
+{
+    struct string_map *map = NULL;
+    void *value = NULL;
+
+    assert(-EFAULT == string_map_find(NULL, 0, "", NULL));
+
+    map = string_map_new();
+
+    assert(-EFAULT == string_map_find(map, 0, NULL, NULL));
+    assert(-ENOENT == string_map_find(map, 0, "", NULL));
+
+    assert(0 == string_map_insert(map, 5, "apple", &map));
+    assert(0 == string_map_find(map, 5, "apple", NULL));
+    assert(0 == string_map_find(map, 5, "apple", &value));
+    assert(&map == value);
+
+    // Lookup by prefix of buffer.
+    assert(0 == string_map_find(map, 5, "applesauce", NULL));
+    assert(-ENOENT == string_map_find(map, 4, "apple", NULL));
+    assert(-ENOENT == string_map_find(map, 6, "applesauce", NULL));
+    assert(-ENOENT == string_map_find(map, 5, "Apple", NULL));
+
+    string_map_delete(map);
+}
+
+static void test_string_map_erase(void)
+{
+    struct string_map *map = NULL;
+    char key[64];
+    size_t n;
+    size_t i;
+
+    assert(-EFAULT == string_map_erase(NULL, 0, ""));
+
+    map = string_map_new();
+
+    assert(-EFAULT == string_map_erase(map, 0, NULL));
+    assert(-ENOENT == string_map_erase(map, 0, ""));
+
+    assert(0 == string_map_insert(map, 5, "apple", NULL));
+    assert(0 == string_map_insert(map, 20, "a key that is longer", NULL));
+    assert(0 == string_map_erase(map, 5, "apple"));
+    assert(-ENOENT == string_map_erase(map, 5, "apple"));
+    assert(0 == string_map_erase(map, 20, "a key that is longer"));
+    assert(0 == string_map_size(map));
+
+    // Erase every other key from a map with full groups, leaving deleted slots.
+    for (i = 0; i < MANY_KEYS; ++i) {
+        n = make_key(key, i);
+        assert(0 == string_map_insert(map, n, key, NULL));
+    }
+    for (i = 0; i < MANY_KEYS; i += 2) {
+        n = make_key(key, i);
+        assert(0 == string_map_erase(map, n, key));
+    }
+    assert(MANY_KEYS / 2 == string_map_size(map));
+    for (i = 0; i < MANY_KEYS; ++i) {
+        n = make_key(key, i);
+        assert(((i % 2) ? 0 : -ENOENT) == string_map_find(map, n, key, NULL));
+    }
+
+    // Churn through many keys with few entries live, so that deleted slots are reclaimed without growing.
+    for (i = MANY_KEYS; i < 10 * MANY_KEYS; ++i) {
+        n = make_key(key, i);
+        assert(0 == string_map_insert(map, n, key, NULL));
+        n = make_key(key, i - 1);
+        assert(0 == string_map_erase(map, n, key));
+    }
+    assert(MANY_KEYS / 2 == string_map_size(map));
+    n = make_key(key, 10 * MANY_KEYS - 1);
+    assert(0 == string_map_find(map, n, key, NULL));
+
+    string_map_delete(map);
+}
+
+/// Sum values and lengths of keys.
+static void sum_entry(void *ctx, struct string_view key, void *value)
+{
+    size_t *sum = ctx;
+
+    assert(key.buf);
+    sum[0] += key.len;
+    sum[1] += (uintptr_t)value;
+}
+
+static void test_string_map_foreach(void)
+{
+    struct string_map *map = NULL;
+    size_t sum[2] = { 0, 0 };
+
+    assert(-EFAULT == string_map_foreach(NULL, sum_entry, sum));
+
+    map = string_map_new();
+
+    assert(-EFAULT == string_map_foreach(map, NULL, sum));
+    assert(0 == string_map_foreach(map, sum_entry, sum));
+    assert(0 == sum[0] && 0 == sum[1]);
+
+    assert(0 == string_map_insert(map, 3, "one", (void *)1));
+    assert(0 == string_map_insert(map, 3, "two", (void *)2));
+    assert(0 == string_map_insert(map, 19, "three hundred and 3", (void *)303));
+    assert(0 == string_map_foreach(map, sum_entry, sum));
+    assert(25 == sum[0]);
+    assert(306 == sum[1]);
+
+    string_map_delete(map);
+}
+
+int main(void)
+{
+    test_string_map_new();
+    test_string_map_delete();
+    test_string_map_size();
+    test_string_map_clear();
+    test_string_map_reserve();
+    test_string_map_insert();
+    test_string_map_find();
+    test_string_map_erase();
+    test_string_map_foreach();
+    return 0;
+}
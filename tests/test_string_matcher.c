@@ -0,0 +1,279 @@
+#include "string_matcher.h"
+
+#include "memory_shim.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/// Maximum number of matches recorded.
+#define MATCHES_MAX 16
+
+/// Matches recorded by a scan.
+struct matches {
+    size_t count;
+    size_t id[MATCHES_MAX];
+    size_t pos[MATCHES_MAX];
+    /// Stop after this many matches.
+    size_t limit;
+};
+
+static bool record(void *ctx, size_t id, size_t pos)
+{
+    struct matches *matches = ctx;
+
+    assert(matches->count < MATCHES_MAX);
+    matches->id[matches->count] = id;
+    matches->pos[matches->count] = pos;
+    matches->count++;
+    return matches->count < matches->limit;
+}
+
+/// Scan @c text, recording matches.
+static void scan(const struct string_matcher *m, const char *text, struct matches *matches)
+{
+    memset(matches, 0, sizeof(*matches));
+    matches->limit = MATCHES_MAX;
+    assert(0 == string_matcher_scan(m, strlen(text), text, record, matches));
+}
+
+/// @return True if match @c i is pattern @c id at position @c pos, false otherwise.
+static bool verify_match(const struct matches *matches, size_t i, size_t id, size_t pos)
+{
+    return i < matches->count && matches->id[i] == id && matches->pos[i] == pos;
+}
+
+static void test_string_matcher_new(void)
+{
+    struct string_view patterns[3] = { { "he", 2 }, { "she", 3 }, { "his", 3 } };
+    struct string_view invalid[2] = { { "he", 2 }, { NULL, 0 } };
+    struct string_matcher *m = NULL;
+    unsigned allocs;
+    unsigned i;
+
+    errno = 0;
+    assert(NULL == string_matcher_new(NULL, 1, 0));
+    assert(EFAULT == errno);
+
+    errno = 0;
+    assert(NULL == string_matcher_new(invalid, 2, 0));
+    assert(EFAULT == errno);
+
+    invalid[1].buf = "";
+    errno = 0;
+    assert(NULL == string_matcher_new(invalid, 2, 0));
+    assert(EINVAL == errno);
+
+    errno = 0;
+    assert(NULL == string_matcher_new(patterns, 3, 0x2));
+    assert(EINVAL == errno);
+
+    // Too many characters for 32-bit states (the buffer is not read).
+    invalid[1].len = UINT32_MAX;
+    errno = 0;
+    assert(NULL == string_matcher_new(invalid, 2, 0));
+    assert(ENOMEM == errno);
+
+    // No patterns.
+    m = string_matcher_new(NULL, 0, 0);
+    assert(m);
+    string_matcher_delete(m);
+
+    // Allocation failures.
+    memory_shim_reset();
+    m = string_matcher_new(patterns, 3, 0);
+    allocs = memory_shim_count_get();
+    assert(m);
+    string_matcher_delete(m);
+    for (i = 1; i <= allocs; ++i) {
+        memory_shim_fail_at(i);
+        errno = 0;
+        assert(NULL == string_matcher_new(patterns, 3, 0));
+        assert(ENOMEM == errno);
+    }
+    memory_shim_reset();
+}
+
+static void test_string_matcher_delete(void)
+{
+    struct string_view patterns[1] = { { "abc", 3 } };
+    struct string_matcher *m = NULL;
+
+    string_matcher_delete(NULL);
+
+    m = string_matcher_new(patterns, 1, 0);
+    string_matcher_delete(m);
+}
+
+static void test_string_matcher_scan(void)
+{
+    struct string_view patterns[4] = { { "he", 2 }, { "she", 3 }, { "his", 3 }, { "hers", 4 } };
+    struct string_view same[3] = { { "ab", 2 }, { "b", 1 }, { "ab", 2 } };
+    struct string_view nul[1] = { { "a\0b", 3 } };
+    struct string_matcher *m = NULL;
+    struct matches matches;
+    char all[256];
+    size_t i;
+
+    m = string_matcher_new(patterns, 4, 0);
+
+    assert(-EFAULT == string_matcher_scan(NULL, 0, "", record, &matches));
+    assert(-EFAULT == string_matcher_scan(m, 0, NULL, record, &matches));
+    assert(-EFAULT == string_matcher_scan(m, 0, "", NULL, &matches));
+
+    scan(m, "", &matches);
+    assert(0 == matches.count);
+
+    // At the same end, longer first.
+    scan(m, "ushers", &matches);
+    assert(3 == matches.count);
+    assert(verify_match(&matches, 0, 1, 1));
+    assert(verify_match(&matches, 1, 0, 2));
+    assert(verify_match(&matches, 2, 3, 2));
+
+    scan(m, "this is his, hers and hishe", &matches);
+    assert(7 == matches.count);
+    assert(verify_match(&matches, 0, 2, 1));
+    assert(verify_match(&matches, 1, 2, 8));
+    assert(verify_match(&matches, 2, 0, 13));
+    assert(verify_match(&matches, 3, 3, 13));
+    assert(verify_match(&matches, 4, 2, 22));
+    assert(verify_match(&matches, 5, 1, 24));
+    assert(verify_match(&matches, 6, 0, 25));
+
+    scan(m, "HE SHE", &matches);
+    assert(0 == matches.count);
+
+    // Runs of characters that begin no pattern are skipped a word at a time.
+    scan(m, "xxxxxxxxxxxxxxxxxxxxxxxxushersxxxxxxxxxxxxxxxxxxxhis", &matches);
+    assert(4 == matches.count);
+    assert(verify_match(&matches, 0, 1, 25));
+    assert(verify_match(&matches, 1, 0, 26));
+    assert(verify_match(&matches, 2, 3, 26));
+    assert(verify_match(&matches, 3, 2, 49));
+    scan(m, "xxxxxxxxxxxxxxxxxxxxx", &matches);
+    assert(0 == matches.count);
+
+    // Stop early.
+    memset(&matches, 0, sizeof(matches));
+    matches.limit = 2;
+    assert(0 == string_matcher_scan(m, 6, "ushers", record, &matches));
+    assert(2 == matches.count);
+
+    string_matcher_delete(m);
+
+    // Identical patterns in order of id.
+    m = string_matcher_new(same, 3, 0);
+
+    scan(m, "abba cab", &matches);
+    assert(7 == matches.count);
+    assert(verify_match(&matches, 0, 0, 0));
+    assert(verify_match(&matches, 1, 2, 0));
+    assert(verify_match(&matches, 2, 1, 1));
+    assert(verify_match(&matches, 3, 1, 2));
+    assert(verify_match(&matches, 4, 0, 6));
+    assert(verify_match(&matches, 5, 2, 6));
+    assert(verify_match(&matches, 6, 1, 7));
+    scan(m, "aaaa", &matches);
+    assert(0 == matches.count);
+
+    string_matcher_delete(m);
+
+    // Embedded NUL, and a single character that begins a pattern.
+    m = string_matcher_new(nul, 1, 0);
+
+    memset(&matches, 0, sizeof(matches));
+    matches.limit = MATCHES_MAX;
+    assert(0 == string_matcher_scan(m, 7, "a\0a\0b\0b", record, &matches));
+    assert(1 == matches.count);
+    assert(verify_match(&matches, 0, 0, 2));
+
+    string_matcher_delete(m);
+
+    // Every character in a pattern.
+    for (i = 0; i < 256; ++i) {
+        all[i] = (char)i;
+    }
+    patterns[0].buf = all;
+    patterns[0].len = sizeof(all);
+    patterns[1].buf = &all[255];
+    patterns[1].len = 1;
+    m = string_matcher_new(patterns, 2, 0);
+
+    memset(&matches, 0, sizeof(matches));
+    matches.limit = MATCHES_MAX;
+    assert(0 == string_matcher_scan(m, sizeof(all), all, record, &matches));
+    assert(2 == matches.count);
+    assert(verify_match(&matches, 0, 0, 0));
+    assert(verify_match(&matches, 1, 1, 255));
+
+    string_matcher_delete(m);
+}
+
+static void test_string_matcher_scan_icase(void)
+{
+    struct string_view patterns[3] = { { "Hello", 5 }, { "WORLD!", 6 }, { "o, w", 4 } };
+    struct string_matcher *m = NULL;
+    struct matches matches;
+
+    m = string_matcher_new(patterns, 3, STRING_MATCHER_ICASE);
+
+    scan(m, "hello, world! HELLO, WORLD! [\\]^_`@", &matches);
+    assert(6 == matches.count);
+    assert(verify_match(&matches, 0, 0, 0));
+    assert(verify_match(&matches, 1, 2, 4));
+    assert(verify_match(&matches, 2, 1, 7));
+    assert(verify_match(&matches, 3, 0, 14));
+    assert(verify_match(&matches, 4, 2, 18));
+    assert(verify_match(&matches, 5, 1, 21));
+
+    string_matcher_delete(m);
+
+    // Case is significant without the flag.
+    m = string_matcher_new(patterns, 3, 0);
+
+    scan(m, "hello, world! Hello, WORLD!", &matches);
+    assert(3 == matches.count);
+    assert(verify_match(&matches, 0, 2, 4));
+    assert(verify_match(&matches, 1, 0, 14));
+    assert(verify_match(&matches, 2, 1, 21));
+
+    string_matcher_delete(m);
+}
+
+static void test_string_matcher_scan_string(void)
+{
+    struct string_view patterns[1] = { { "needle", 6 } };
+    struct string_matcher *m = NULL;
+    struct string *s = NULL;
+    struct matches matches;
+
+    m = string_matcher_new(patterns, 1, 0);
+    memset(&matches, 0, sizeof(matches));
+    matches.limit = MATCHES_MAX;
+
+    assert(-EFAULT == string_matcher_scan_string(m, NULL, record, &matches));
+
+    s = string_new();
+    assert(0 == string_append_c_str(s, "haystack with a needle, and another needle"));
+    assert(0 == string_matcher_scan_string(m, s, record, &matches));
+    assert(2 == matches.count);
+    assert(verify_match(&matches, 0, 0, 16));
+    assert(verify_match(&matches, 1, 0, 36));
+
+    string_delete(s);
+    string_matcher_delete(m);
+}
+
+int main(void)
+{
+    test_string_matcher_new();
+    test_string_matcher_delete();
+    test_string_matcher_scan();
+    test_string_matcher_scan_icase();
+    test_string_matcher_scan_string();
+    return 0;
+}
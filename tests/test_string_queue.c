@@ -0,0 +1,327 @@
+#include "string_queue.h"
+
+#include "memory_shim.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/// Number of producer threads in concurrent tests.
+#define PRODUCERS 4
+
+/// Number of strings sent by each producer.
+#define MESSAGES 20000
+
+/// @return New string holding the decimal representation of @c n.
+static struct string *new_number(size_t n)
+{
+    struct string *s = NULL;
+    char buf[32];
+
+    s = string_new();
+    assert(s);
+    assert(0 == string_append_buffer(s, (size_t)snprintf(buf, sizeof(buf), "%zu", n), buf));
+    return s;
+}
+
+/// @return Number held by string @c s, which is deleted.
+static size_t take_number(struct string *s)
+{
+    size_t n = strtoul(string_c_str(s), NULL, 10);
+
+    string_delete(s);
+    return n;
+}
+
+static void test_string_queue_new(void)
+{
+    struct string_queue *q = NULL;
+
+    errno = 0;
+    assert(NULL == string_queue_new(0));
+    assert(EINVAL == errno);
+
+    errno = 0;
+    assert(NULL == string_queue_new(SIZE_MAX));
+    assert(ENOMEM == errno);
+
+    memory_shim_fail_at(1);
+    assert(NULL == string_queue_new(1));
+    assert(ENOMEM == errno);
+
+    memory_shim_fail_at(2);
+    assert(NULL == string_queue_new(1));
+    assert(ENOMEM == errno);
+    memory_shim_reset();
+
+    assert(0 == string_queue_capacity(NULL));
+
+    q = string_queue_new(1);
+    assert(2 == string_queue_capacity(q));
+    string_queue_delete(q);
+
+    q = string_queue_new(100);
+    assert(128 == string_queue_capacity(q));
+    string_queue_delete(q);
+
+    string_queue_delete(NULL);
+}
+
+static void test_string_queue_push_pop(void)
+{
+    struct string_queue *q = NULL;
+    struct string *s = NULL;
+    size_t i;
+
+    q = string_queue_new(4);
+    s = new_number(0);
+
+    assert(-EFAULT == string_queue_push(NULL, s));
+    assert(-EFAULT == string_queue_push(q, NULL));
+    errno = 0;
+    assert(NULL == string_queue_pop(NULL));
+    assert(EFAULT == errno);
+
+    errno = 0;
+    assert(NULL == string_queue_pop(q));
+    assert(EAGAIN == errno);
+
+    // Strings come out in order, over several laps.
+    for (i = 0; i < 3; ++i) {
+        size_t k;
+
+        for (k = 0; k < 4; ++k) {
+            assert(0 == string_queue_push(q, new_number(4 * i + k)));
+        }
+        assert(-EAGAIN == string_queue_push(q, s));
+
+        for (k = 0; k < 4; ++k) {
+            assert(4 * i + k == take_number(string_queue_pop(q)));
+        }
+        assert(NULL == string_queue_pop(q));
+    }
+
+    // Strings still queued are deleted with the queue.
+    assert(0 == string_queue_push(q, s));
+    assert(0 == string_queue_push(q, new_number(1)));
+    string_queue_delete(q);
+}
+
+struct producer {
+    struct string_queue *q;
+    size_t id;
+};
+
+static void *produce(void *arg)
+{
+    struct producer *p = arg;
+    size_t i;
+
+    for (i = 0; i < MESSAGES; ++i) {
+        struct string *s = new_number(p->id * MESSAGES + i);
+
+        while (string_queue_push(p->q, s) != 0) {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static void test_string_queue_concurrent(void)
+{
+    struct producer producers[PRODUCERS];
+    pthread_t ids[PRODUCERS];
+    size_t next[PRODUCERS] = { 0 };
+    struct string_queue *q = NULL;
+    size_t received = 0;
+    size_t k;
+
+    q = string_queue_new(64);
+
+    for (k = 0; k < PRODUCERS; ++k) {
+        producers[k].q = q;
+        producers[k].id = k;
+        assert(0 == pthread_create(&ids[k], NULL, produce, &producers[k]));
+    }
+
+    // Each producer's strings arrive complete and in order.
+    while (received < PRODUCERS * MESSAGES) {
+        struct string *s = string_queue_pop(q);
+        size_t n;
+
+        if (!s) {
+            sched_yield();
+            continue;
+        }
+
+        n = take_number(s);
+        assert(n % MESSAGES == next[n / MESSAGES]);
+        ++next[n / MESSAGES];
+        ++received;
+    }
+
+    for (k = 0; k < PRODUCERS; ++k) {
+        assert(0 == pthread_join(ids[k], NULL));
+    }
+    assert(NULL == string_queue_pop(q));
+
+    string_queue_delete(q);
+}
+
+static void test_string_channel_new(void)
+{
+    errno = 0;
+    assert(NULL == string_channel_new(0));
+    assert(EINVAL == errno);
+
+    memory_shim_fail_at(1);
+    assert(NULL == string_channel_new(1));
+    assert(ENOMEM == errno);
+
+    memory_shim_fail_at(4);
+    assert(NULL == string_channel_new(1));
+    assert(ENOMEM == errno);
+    memory_shim_reset();
+
+    string_channel_delete(NULL);
+}
+
+static void test_string_channel(void)
+{
+    struct string_channel *ch = NULL;
+    struct string *s = NULL;
+    struct string *t = NULL;
+    const char *buf;
+
+    errno = 0;
+    assert(NULL == string_channel_acquire(NULL));
+    assert(EFAULT == errno);
+    assert(-EFAULT == string_channel_send(NULL, NULL));
+    errno = 0;
+    assert(NULL == string_channel_receive(NULL));
+    assert(EFAULT == errno);
+    string_channel_recycle(NULL, NULL);
+    string_channel_recycle(NULL, string_new());
+
+    ch = string_channel_new(2);
+
+    s = string_channel_acquire(ch);
+    assert(s);
+    assert(0 == string_append_c_str(s, "a message that does not fit in the small buffer"));
+    buf = string_c_str(s);
+    assert(-EFAULT == string_channel_send(ch, NULL));
+    assert(0 == string_channel_send(ch, s));
+
+    t = string_channel_receive(ch);
+    assert(t == s);
+    assert(0 == strcmp(string_c_str(t), "a message that does not fit in the small buffer"));
+    assert(NULL == string_channel_receive(ch));
+
+    // Recycled strings come back empty, with their storage.
+    string_channel_recycle(ch, t);
+    s = string_channel_acquire(ch);
+    assert(s == t);
+    assert(string_empty(s));
+    assert(string_c_str(s) == buf);
+
+    // Strings beyond the recycling capacity are deleted.
+    string_channel_recycle(ch, s);
+    string_channel_recycle(ch, string_new());
+    string_channel_recycle(ch, string_new());
+
+    s = string_channel_acquire(ch);
+    t = string_channel_acquire(ch);
+    assert(s && t);
+
+    memory_shim_fail_at(1);
+    assert(NULL == string_channel_acquire(ch));
+    assert(ENOMEM == errno);
+    memory_shim_reset();
+
+    // Strings still sent or recycled are deleted with the channel.
+    assert(0 == string_channel_send(ch, s));
+    string_channel_recycle(ch, t);
+    string_channel_delete(ch);
+}
+
+static void *echo(void *arg)
+{
+    struct string_channel **chs = arg;
+    size_t i;
+
+    // Receive from the first channel, and send back through the second, recycling the received strings.
+    for (i = 0; i < MESSAGES; ++i) {
+        struct string *in;
+        struct string *out;
+
+        while ((in = string_channel_receive(chs[0])) == NULL) {
+            sched_yield();
+        }
+
+        out = string_channel_acquire(chs[1]);
+        assert(out);
+        assert(0 == string_append_buffer(out, string_size(in), string_c_str(in)));
+        string_channel_recycle(chs[0], in);
+
+        while (string_channel_send(chs[1], out) != 0) {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static void test_string_channel_concurrent(void)
+{
+    struct string_channel *chs[2];
+    pthread_t id;
+    size_t sent = 0;
+    size_t received = 0;
+
+    chs[0] = string_channel_new(16);
+    chs[1] = string_channel_new(16);
+
+    assert(0 == pthread_create(&id, NULL, echo, chs));
+
+    while (received < MESSAGES) {
+        struct string *s;
+
+        if (sent < MESSAGES) {
+            s = string_channel_acquire(chs[0]);
+            assert(s);
+            assert(0 == string_append_c_str(s, "echo"));
+            if (string_channel_send(chs[0], s) == 0) {
+                ++sent;
+            } else {
+                string_channel_recycle(chs[0], s);
+            }
+        }
+
+        s = string_channel_receive(chs[1]);
+        if (s) {
+            assert(0 == strcmp(string_c_str(s), "echo"));
+            string_channel_recycle(chs[1], s);
+            ++received;
+        }
+    }
+
+    assert(0 == pthread_join(id, NULL));
+
+    string_channel_delete(chs[0]);
+    string_channel_delete(chs[1]);
+}
+
+int main(void)
+{
+    test_string_queue_new();
+    test_string_queue_push_pop();
+    test_string_queue_concurrent();
+    test_string_channel_new();
+    test_string_channel();
+    test_string_channel_concurrent();
+    return 0;
+}
@@ -0,0 +1,208 @@
+#include "string_search.h"
+
+#include "memory_shim.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/// Start positions searched as one unit of work.
+#define CHUNK_SIZE ((size_t)1 << 20)
+
+/// Size of string searched in several chunks.
+#define LARGE_SIZE (3 * CHUNK_SIZE + 100)
+
+/// Positions of pattern in large string, including at and across chunk boundaries.
+static const size_t large_offsets[] = { 0, 7, CHUNK_SIZE - 1, 2 * CHUNK_SIZE, 3 * CHUNK_SIZE - 2, LARGE_SIZE - 3 };
+
+#define LARGE_COUNT (sizeof(large_offsets) / sizeof(large_offsets[0]))
+
+/// Create string of LARGE_SIZE characters, with "<|>" at large_offsets and a newline every 100 characters.
+static struct string *new_large_string(void)
+{
+    struct string *s = NULL;
+    char *buf;
+    size_t i;
+
+    s = string_new();
+    assert(s);
+    buf = string_resize_uninit(s, LARGE_SIZE);
+    assert(buf);
+
+    for (i = 0; i < LARGE_SIZE; ++i) {
+        buf[i] = (i % 100 == 99) ? '\n' : '|';
+    }
+    for (i = 0; i < LARGE_COUNT; ++i) {
+        memcpy(&buf[large_offsets[i]], "<|>", 3);
+    }
+    return s;
+}
+
+static void test_string_find_all(void)
+{
+    struct string *s = NULL;
+    size_t *offsets = NULL;
+    size_t count = 0;
+
+    s = string_new();
+
+    assert(-EFAULT == string_find_all(NULL, 1, "a", &offsets, &count));
+    assert(-EFAULT == string_find_all(s, 1, NULL, &offsets, &count));
+    assert(-EFAULT == string_find_all(s, 1, "a", NULL, &count));
+    assert(-EFAULT == string_find_all(s, 1, "a", &offsets, NULL));
+    assert(-EINVAL == string_find_all(s, 0, "", &offsets, &count));
+
+    count = 1;
+    assert(0 == string_find_all(s, 1, "a", &offsets, &count));
+    assert(NULL == offsets);
+    assert(0 == count);
+
+    assert(0 == string_append_c_str(s, "abababa"));
+
+    assert(0 == string_find_all(s, 8, "abababab", &offsets, &count));
+    assert(NULL == offsets);
+    assert(0 == count);
+
+    assert(0 == string_find_all(s, 1, "c", &offsets, &count));
+    assert(NULL == offsets);
+    assert(0 == count);
+
+    // Occurrences overlap.
+    assert(0 == string_find_all(s, 3, "aba", &offsets, &count));
+    assert(3 == count);
+    assert(0 == offsets[0] && 2 == offsets[1] && 4 == offsets[2]);
+    free(offsets);
+
+    assert(0 == string_find_all(s, 7, "abababa", &offsets, &count));
+    assert(1 == count);
+    assert(0 == offsets[0]);
+    free(offsets);
+
+    // Allocation failures.
+    memory_shim_fail_at(1);
+    assert(-ENOMEM == string_find_all(s, 1, "a", &offsets, &count));
+    memory_shim_fail_at(2);
+    assert(-ENOMEM == string_find_all(s, 1, "a", &offsets, &count));
+    memory_shim_reset();
+
+    string_delete(s);
+}
+
+static void test_string_find_all_parallel(void)
+{
+    struct string *s = NULL;
+    size_t *offsets = NULL;
+    size_t count = 0;
+    unsigned allocs;
+    unsigned threads;
+    size_t i;
+
+    s = new_large_string();
+
+    for (threads = 0; threads <= 8; ++threads) {
+        assert(0 == string_find_all_parallel(s, 3, "<|>", &offsets, &count, threads));
+        assert(LARGE_COUNT == count);
+        for (i = 0; i < LARGE_COUNT; ++i) {
+            assert(large_offsets[i] == offsets[i]);
+        }
+        free(offsets);
+    }
+
+    assert(0 == string_find_all_parallel(s, 1, "\n", &offsets, &count, 4));
+    assert(LARGE_SIZE / 100 == count);
+    for (i = 0; i < count; ++i) {
+        assert(100 * i + 99 == offsets[i]);
+    }
+    free(offsets);
+
+    // Memory for threads unavailable: search in caller.
+    memory_shim_fail_at(2);
+    assert(0 == string_find_all_parallel(s, 3, "<|>", &offsets, &count, 4));
+    memory_shim_reset();
+    assert(LARGE_COUNT == count);
+    free(offsets);
+
+    // Gathering offsets of several chunks fails.
+    memory_shim_reset();
+    assert(0 == string_find_all_parallel(s, 3, "<|>", &offsets, &count, 1));
+    allocs = memory_shim_count_get();
+    free(offsets);
+    memory_shim_fail_at(allocs);
+    assert(-ENOMEM == string_find_all_parallel(s, 3, "<|>", &offsets, &count, 1));
+    memory_shim_reset();
+
+    string_delete(s);
+}
+
+static void test_string_count(void)
+{
+    struct string *s = NULL;
+    size_t count = 0;
+
+    s = string_new();
+
+    assert(-EFAULT == string_count(NULL, 1, "a", &count));
+    assert(-EFAULT == string_count(s, 1, NULL, &count));
+    assert(-EFAULT == string_count(s, 1, "a", NULL));
+    assert(-EINVAL == string_count(s, 0, "", &count));
+
+    assert(0 == string_append_c_str(s, "one\ntwo\nthree\n\n"));
+    assert(0 == string_count(s, 1, "\n", &count));
+    assert(4 == count);
+    assert(0 == string_count(s, 2, "\n\n", &count));
+    assert(1 == count);
+    assert(0 == string_count(s, 2, "e\n", &count));
+    assert(2 == count);
+    assert(0 == string_count(s, 3, "TWO", &count));
+    assert(0 == count);
+
+    // Counting does not allocate offsets.
+    memory_shim_fail_at(2);
+    assert(0 == string_count(s, 1, "\n", &count));
+    memory_shim_reset();
+    assert(4 == count);
+
+    // A compressed string is expanded, which may fail.
+    assert(0 == string_append_fill(s, 4000, '\n'));
+    assert(0 == string_compress(s, 0));
+    string_memory_set_budget(string_memory_total());
+    assert(-ENOMEM == string_count(s, 1, "\n", &count));
+    assert(string_compressed(s));
+    string_memory_set_budget(SIZE_MAX);
+    assert(0 == string_count(s, 1, "\n", &count));
+    assert(4004 == count);
+    assert(!string_compressed(s));
+
+    string_delete(s);
+}
+
+static void test_string_count_parallel(void)
+{
+    struct string *s = NULL;
+    size_t count = 0;
+    unsigned threads;
+
+    s = new_large_string();
+
+    for (threads = 0; threads <= 8; ++threads) {
+        assert(0 == string_count_parallel(s, 3, "<|>", &count, threads));
+        assert(LARGE_COUNT == count);
+        assert(0 == string_count_parallel(s, 1, "\n", &count, threads));
+        assert(LARGE_SIZE / 100 == count);
+        assert(0 == string_count_parallel(s, 2, "||", &count, threads));
+    }
+
+    string_delete(s);
+}
+
+int main(void)
+{
+    test_string_find_all();
+    test_string_find_all_parallel();
+    test_string_count();
+    test_string_count_parallel();
+    return 0;
+}
@@ -0,0 +1,391 @@
+#include "string_serial.h"
+
+#include "cstring_private.h"
+#include "memory_shim.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+/// Size of the buffer of a reader.
+#define READ_BUFFER ((size_t)1 << 16)
+
+/// @return New temporary file holding the @c n characters of @c buf, removed from the file system.
+static int temp_file(size_t n, const char *buf)
+{
+    char path[] = "/tmp/test_string_serial.XXXXXX";
+    int fd = mkstemp(path);
+
+    assert(fd >= 0);
+    assert(0 == unlink(path));
+    assert((ssize_t)n == write(fd, buf, n));
+    assert(0 == lseek(fd, 0, SEEK_SET));
+    return fd;
+}
+
+/// @return New string holding @c n copies of character @c c.
+static struct string *new_fill(size_t n, char c)
+{
+    struct string *s = NULL;
+
+    s = string_new();
+    assert(0 == string_append_fill(s, n, c));
+    return s;
+}
+
+static void test_string_serialize(void)
+{
+    struct string *dest = NULL;
+    struct string *src = NULL;
+    const char *p;
+
+    assert(-EFAULT == string_serialize(NULL, NULL));
+
+    dest = string_new();
+    src = new_fill(300, 'a');
+    assert(-EFAULT == string_serialize(dest, NULL));
+
+    memory_shim_fail_at(1);
+    assert(-ENOMEM == string_serialize(dest, src));
+    memory_shim_reset();
+    assert(string_empty(dest));
+
+    // The length takes two characters.
+    assert(0 == string_serialize(dest, src));
+    p = string_c_str(dest);
+    assert(302 == string_size(dest));
+    assert((char)0xac == p[0]);
+    assert(0x02 == p[1]);
+    assert('a' == p[2] && 'a' == p[301]);
+
+    // A compressed string is decompressed first.
+    assert(0 == string_compress(src, 0));
+    memory_shim_fail_at(1);
+    assert(-ENOMEM == string_serialize(dest, src));
+    memory_shim_reset();
+    assert(302 == string_size(dest));
+
+    // Into itself.
+    assert(0 == string_serialize(dest, dest));
+    assert(606 == string_size(dest));
+    assert(0 == memcmp(&string_c_str(dest)[304], string_c_str(dest), 302));
+
+    string_delete(src);
+    string_delete(dest);
+}
+
+static void test_get_varint(void)
+{
+    size_t v = 1;
+
+    assert(0 == get_varint("", 0, &v));
+    assert(0 == get_varint("\x80\x80", 2, &v));
+    assert(1 == v);
+
+    assert(1 == get_varint("\x00", 1, &v));
+    assert(0 == v);
+    assert(2 == get_varint("\xac\x02\x01", 3, &v));
+    assert(300 == v);
+    assert(10 == get_varint("\xff\xff\xff\xff\xff\xff\xff\xff\xff\x01", 10, &v));
+    assert(SIZE_MAX == v);
+
+    // Overlong forms, and values beyond the width of size_t.
+    assert(STRING_NPOS == get_varint("\x80\x00", 2, &v));
+    assert(STRING_NPOS == get_varint("\xac\x82\x00", 3, &v));
+    assert(STRING_NPOS == get_varint("\xff\xff\xff\xff\xff\xff\xff\xff\xff\x02", 10, &v));
+    assert(SIZE_MAX == v);
+}
+
+static void test_string_deserialize(void)
+{
+    struct string *dest = NULL;
+    struct string *src = NULL;
+    struct string_view v;
+    size_t pos = 0;
+
+    dest = string_new();
+    src = string_new();
+    assert(0 == string_append_buffer(src, 7, "\x03" "abc" "\x00" "\x81\x02"));
+    assert(-EFAULT == string_deserialize(NULL, 1, "", &pos));
+    assert(-EFAULT == string_deserialize(dest, 1, NULL, &pos));
+    assert(-EFAULT == string_deserialize(dest, 1, "", NULL));
+    assert(-EFAULT == string_deserialize_view(NULL, 1, "", &pos));
+    assert(-EFAULT == string_deserialize_view(&v, 1, NULL, &pos));
+    assert(-EFAULT == string_deserialize_view(&v, 1, "", NULL));
+
+    // In sequence, the second string being empty.
+    assert(0 == string_deserialize(dest, 7, string_c_str(src), &pos));
+    assert(0 == strcmp(string_c_str(dest), "abc"));
+    assert(4 == pos);
+    assert(0 == string_deserialize(dest, 7, string_c_str(src), &pos));
+    assert(string_empty(dest));
+    assert(5 == pos);
+
+    // Truncated: the length claims 257 characters.
+    assert(-EILSEQ == string_deserialize(dest, 7, string_c_str(src), &pos));
+    assert(-EILSEQ == string_deserialize_view(&v, 7, string_c_str(src), &pos));
+    assert(5 == pos);
+    pos = 8;
+    assert(-EILSEQ == string_deserialize(dest, 7, string_c_str(src), &pos));
+
+    // Truncated length.
+    pos = 0;
+    assert(-EILSEQ == string_deserialize(dest, 1, "\x80", &pos));
+
+    // Overlong lengths, and length beyond the width of size_t.
+    assert(-EILSEQ == string_deserialize(dest, 2, "\x80\x00", &pos));
+    assert(-EILSEQ == string_deserialize(dest, 12, "\x80\x80\x80\x80\x80\x80\x80\x80\x80\x80\x80\x00", &pos));
+    assert(-EILSEQ == string_deserialize(dest, 10, "\xff\xff\xff\xff\xff\xff\xff\xff\xff\x02", &pos));
+    assert(0 == pos);
+
+    // A view points into the buffer.
+    assert(0 == string_deserialize_view(&v, 7, string_c_str(src), &pos));
+    assert(3 == v.len);
+    assert(&string_c_str(src)[1] == v.buf);
+    assert(4 == pos);
+
+    // Insufficient memory.
+    string_delete(src);
+    src = new_fill(300, 'a');
+    assert(0 == string_serialize(src, src));
+    pos = 300;
+    memory_shim_fail_at(1);
+    assert(-ENOMEM == string_deserialize(dest, string_size(src), string_c_str(src), &pos));
+    memory_shim_reset();
+    assert(300 == pos);
+    assert(string_empty(dest));
+
+    assert(0 == string_deserialize(dest, string_size(src), string_c_str(src), &pos));
+    assert(300 == string_size(dest));
+    assert(string_size(src) == pos);
+
+    string_delete(src);
+    string_delete(dest);
+}
+
+static void test_string_serialize_vec(void)
+{
+    struct string_vec *vec = NULL;
+    struct string_vec *out = NULL;
+    struct string *dest = NULL;
+    size_t pos = 0;
+    size_t i;
+
+    vec = string_vec_new();
+    out = string_vec_new();
+    dest = string_new();
+    assert(-EFAULT == string_serialize_vec(NULL, vec));
+    assert(-EFAULT == string_serialize_vec(dest, NULL));
+    assert(-EFAULT == string_deserialize_vec(NULL, 1, "", &pos));
+    assert(-EFAULT == string_deserialize_vec(out, 1, NULL, &pos));
+    assert(-EFAULT == string_deserialize_vec(out, 1, "", NULL));
+
+    // Empty.
+    assert(0 == string_serialize_vec(dest, vec));
+    assert(0 == string_deserialize_vec(out, string_size(dest), string_c_str(dest), &pos));
+    assert(0 == string_vec_size(out));
+    assert(1 == pos);
+
+    for (i = 0; i < 100; ++i) {
+        char buf[8] = "element";
+
+        assert(0 == string_vec_push_back(vec, i % 8, buf));
+    }
+
+    // Nothing is appended on failure.
+    string_clear(dest);
+    memory_shim_fail_at(2);
+    assert(-ENOMEM == string_serialize_vec(dest, vec));
+    memory_shim_reset();
+    assert(string_empty(dest));
+
+    assert(0 == string_serialize_vec(dest, vec));
+    pos = 0;
+    memory_shim_fail_at(1);
+    assert(-ENOMEM == string_deserialize_vec(out, string_size(dest), string_c_str(dest), &pos));
+    memory_shim_reset();
+    assert(0 == pos);
+    assert(0 == string_vec_size(out));
+
+    // Appended after the existing elements.
+    assert(0 == string_vec_push_back(out, 5, "first"));
+    assert(0 == string_deserialize_vec(out, string_size(dest), string_c_str(dest), &pos));
+    assert(string_size(dest) == pos);
+    assert(101 == string_vec_size(out));
+    assert(0 == strcmp(string_vec_at(out, 0).buf, "first"));
+    for (i = 0; i < 100; ++i) {
+        struct string_view v = string_vec_at(out, i + 1);
+
+        assert(i % 8 == v.len);
+        assert(0 == memcmp(v.buf, "element", v.len));
+    }
+
+    // Invalid: count beyond the buffer, truncated element, position beyond the buffer.
+    pos = 0;
+    assert(-EILSEQ == string_deserialize_vec(out, 2, "\x02\x00", &pos));
+    assert(-EILSEQ == string_deserialize_vec(out, 3, "\x02\x00\x01", &pos));
+    assert(-EILSEQ == string_deserialize_vec(out, 0, "", &pos));
+    pos = 2;
+    assert(-EILSEQ == string_deserialize_vec(out, 1, "\x00", &pos));
+    assert(101 == string_vec_size(out));
+
+    string_delete(dest);
+    string_vec_delete(out);
+    string_vec_delete(vec);
+}
+
+static void test_string_deserialize_mmap(void)
+{
+    struct string *dest = NULL;
+    struct string *src = NULL;
+    struct string_view v;
+    const char *map;
+    size_t pos = 0;
+    int fd;
+
+    dest = string_new();
+    src = new_fill(1000, 'm');
+    assert(0 == string_serialize(dest, src));
+    assert(0 == string_serialize(dest, dest));
+    fd = temp_file(string_size(dest), string_c_str(dest));
+
+    map = mmap(NULL, string_size(dest), PROT_READ, MAP_PRIVATE, fd, 0);
+    assert(MAP_FAILED != map);
+
+    // Views into the mapping, without copying.
+    assert(0 == string_deserialize_view(&v, string_size(dest), map, &pos));
+    assert(map + 2 == v.buf);
+    assert(1000 == v.len && 'm' == v.buf[999]);
+    assert(0 == string_deserialize_view(&v, string_size(dest), map, &pos));
+    assert(1002 == v.len);
+    assert(string_size(dest) == pos);
+
+    assert(0 == munmap((void *)map, string_size(dest)));
+    close(fd);
+    string_delete(src);
+    string_delete(dest);
+}
+
+static void test_string_reader(void)
+{
+    struct string_reader *reader = NULL;
+    struct string *file = NULL;
+    struct string *s = NULL;
+    int fd;
+
+    memory_shim_fail_at(1);
+    errno = 0;
+    assert(NULL == string_reader_new(0));
+    assert(ENOMEM == errno);
+    memory_shim_reset();
+
+    string_reader_delete(NULL);
+    s = string_new();
+    assert(-EFAULT == string_reader_next(NULL, s));
+
+    // The length of the second string straddles the buffer, and the third string is larger than it.
+    file = string_new();
+    string_delete(s);
+    s = new_fill(READ_BUFFER - 4, 'a');
+    assert(0 == string_serialize(file, s));
+    string_delete(s);
+    s = new_fill(300, 'b');
+    assert(0 == string_serialize(file, s));
+    string_delete(s);
+    s = new_fill(3 * READ_BUFFER, 'c');
+    assert(0 == string_serialize(file, s));
+    assert(0 == string_append_buffer(file, 2, "\x01" "d"));
+    fd = temp_file(string_size(file), string_c_str(file));
+
+    reader = string_reader_new(fd);
+    assert(-EFAULT == string_reader_next(reader, NULL));
+    assert(0 == string_reader_next(reader, s));
+    assert(READ_BUFFER - 4 == string_size(s));
+    assert(0 == string_reader_next(reader, s));
+    assert(300 == string_size(s));
+    assert('b' == string_at(s, 299));
+    assert(0 == string_reader_next(reader, s));
+    assert(3 * READ_BUFFER == string_size(s));
+    assert('c' == string_at(s, 0) && 'c' == string_at(s, 3 * READ_BUFFER - 1));
+    assert(0 == string_reader_next(reader, s));
+    assert(0 == strcmp(string_c_str(s), "d"));
+    assert(-ENODATA == string_reader_next(reader, s));
+    assert(string_empty(s));
+    string_reader_delete(reader);
+    close(fd);
+
+    // Insufficient memory for the string.
+    string_delete(s);
+    s = string_new();
+    fd = temp_file(string_size(file), string_c_str(file));
+    reader = string_reader_new(fd);
+    memory_shim_fail_at(1);
+    assert(-ENOMEM == string_reader_next(reader, s));
+    memory_shim_reset();
+    string_reader_delete(reader);
+    close(fd);
+
+    // Truncated: length, short string, and long string.
+    fd = temp_file(1, "\x80");
+    reader = string_reader_new(fd);
+    assert(-EILSEQ == string_reader_next(reader, s));
+    string_reader_delete(reader);
+    close(fd);
+
+    fd = temp_file(3, "\x03" "ab");
+    reader = string_reader_new(fd);
+    assert(-EILSEQ == string_reader_next(reader, s));
+    assert(string_empty(s));
+    string_reader_delete(reader);
+    close(fd);
+
+    fd = temp_file(5, "\x80\x80\x10" "ab");
+    reader = string_reader_new(fd);
+    assert(-EILSEQ == string_reader_next(reader, s));
+    string_reader_delete(reader);
+    close(fd);
+
+    // Invalid length.
+    fd = temp_file(12, "\x80\x80\x80\x80\x80\x80\x80\x80\x80\x80\x80\x00");
+    reader = string_reader_new(fd);
+    assert(-EILSEQ == string_reader_next(reader, s));
+    string_reader_delete(reader);
+    close(fd);
+
+    // Read errors.
+    reader = string_reader_new(-1);
+    assert(-EBADF == string_reader_next(reader, s));
+    string_reader_delete(reader);
+
+    {
+        int fds[2];
+
+        assert(0 == pipe(fds));
+        assert(0 == fcntl(fds[0], F_SETFL, O_NONBLOCK));
+        assert(3 == write(fds[1], "\x03" "ab", 3));
+        reader = string_reader_new(fds[0]);
+        assert(-EAGAIN == string_reader_next(reader, s));
+        string_reader_delete(reader);
+        close(fds[0]);
+        close(fds[1]);
+    }
+
+    string_delete(file);
+    string_delete(s);
+}
+
+int main(void)
+{
+    test_string_serialize();
+    test_get_varint();
+    test_string_deserialize();
+    test_string_serialize_vec();
+    test_string_deserialize_mmap();
+    test_string_reader();
+    return 0;
+}
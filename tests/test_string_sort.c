@@ -0,0 +1,256 @@
+#include "string_sort.h"
+
+#include "memory_shim.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/// @return True if views are in non-decreasing order, false otherwise.
+static bool is_sorted(const struct string_view *views, size_t n)
+{
+    size_t i;
+
+    for (i = 1; i < n; ++i) {
+        size_t la = views[i - 1].len;
+        size_t lb = views[i].len;
+        int r = memcmp(views[i - 1].buf, views[i].buf, (la < lb) ? la : lb);
+
+        if (r > 0 || (r == 0 && la > lb)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/// Deterministic pseudo-random numbers.
+static unsigned long next_random(unsigned long *state)
+{
+    *state = *state * 6364136223846793005UL + 1442695040888963407UL;
+    return *state >> 33;
+}
+
+/// Fill @c buf with a key typical of @c kind, and @return its length.
+static size_t make_key(char *buf, size_t size, unsigned kind, unsigned long *state)
+{
+    switch (kind % 3) {
+    case 0:
+        // URLs: long shared prefixes.
+        return (size_t)snprintf(buf, size, "https://example.com/api/v1/items/%lu?page=%lu", next_random(state) % 1000, next_random(state) % 10);
+    case 1:
+        // Paths: shared prefixes of differing length.
+        return (size_t)snprintf(buf, size, "/usr/%s/%lu", (next_random(state) & 1) ? "lib" : "local/lib", next_random(state) % 100000);
+    default:
+        // UUIDs: random from the first character.
+        return (size_t)snprintf(buf, size, "%08lx-%04lx-%04lx", next_random(state), next_random(state) & 0xffff, next_random(state) & 0xffff);
+    }
+}
+
+static void test_string_sort(void)
+{
+    static const char *const words[] = {
+        "pear", "apple", "", "fig", "apples", "Zebra", "\x80", "apple",
+        "abcdefgh", "abcdefghi", "abcdefgh\x01", "abcdefg", "abcdefghabcdefgh", "abcdefghabcdefgg",
+        "a\0b", "a", "a\0", "a\0a", "abcdefghij",
+    };
+    static const size_t lens[] = {
+        4, 5, 0, 3, 6, 5, 1, 5,
+        8, 9, 9, 7, 16, 16,
+        3, 1, 2, 3, 10,
+    };
+    static const char *const sorted[] = {
+        "", "Zebra", "a", "a\0", "a\0a", "a\0b",
+        "abcdefg", "abcdefgh", "abcdefgh\x01", "abcdefghabcdefgg", "abcdefghabcdefgh", "abcdefghi", "abcdefghij",
+        "apple", "apple", "apples", "fig", "pear", "\x80",
+    };
+    static const size_t sorted_lens[] = {
+        0, 5, 1, 2, 3, 3,
+        7, 8, 9, 16, 16, 9, 10,
+        5, 5, 6, 3, 4, 1,
+    };
+    const size_t n = sizeof(words) / sizeof(words[0]);
+    struct string *arr[sizeof(words) / sizeof(words[0])];
+    struct string *saved;
+    size_t i;
+
+    assert(-EFAULT == string_sort(NULL, 0));
+
+    assert(0 == string_sort(arr, 0));
+
+    for (i = 0; i < n; ++i) {
+        arr[i] = string_new();
+        assert(0 == string_append_buffer(arr[i], lens[i], words[i]));
+    }
+
+    assert(-ENOMEM == string_sort(arr, SIZE_MAX));
+
+    memory_shim_fail_at(1);
+    assert(-ENOMEM == string_sort(arr, n));
+    memory_shim_reset();
+
+    saved = arr[1];
+    arr[1] = NULL;
+    assert(-EFAULT == string_sort(arr, n));
+
+    // Compressed content that cannot be expanded.
+    arr[1] = string_new();
+    assert(0 == string_append_fill(arr[1], 4000, 'x'));
+    assert(0 == string_compress(arr[1], 0));
+    string_memory_set_budget(string_memory_total());
+    assert(-ENOMEM == string_sort(arr, n));
+    string_memory_set_budget(SIZE_MAX);
+    string_delete(arr[1]);
+    arr[1] = saved;
+
+    assert(0 == string_sort(arr, n));
+    for (i = 0; i < n; ++i) {
+        assert(sorted_lens[i] == string_size(arr[i]));
+        assert(0 == memcmp(string_c_str(arr[i]), sorted[i], sorted_lens[i]));
+    }
+
+    for (i = 0; i < n; ++i) {
+        string_delete(arr[i]);
+    }
+}
+
+static void test_string_sort_parallel(void)
+{
+    const size_t n = 100000;
+    struct string **arr;
+    struct string_view *views;
+    unsigned long state = 1;
+    char buf[64];
+    size_t i;
+
+    assert(-EFAULT == string_sort_parallel(NULL, 0, 4));
+
+    arr = calloc(n, sizeof(*arr));
+    views = calloc(n, sizeof(*views));
+
+    for (i = 0; i < n; ++i) {
+        arr[i] = string_new();
+        assert(0 == string_append_buffer(arr[i], make_key(buf, sizeof(buf), (unsigned)i, &state), buf));
+    }
+
+    assert(0 == string_sort_parallel(arr, n, 4));
+    for (i = 0; i < n; ++i) {
+        views[i] = string_as_view(arr[i]);
+    }
+    assert(is_sorted(views, n));
+
+    // Already sorted.
+    assert(0 == string_sort_parallel(arr, n, 4));
+    for (i = 0; i < n; ++i) {
+        views[i] = string_as_view(arr[i]);
+    }
+    assert(is_sorted(views, n));
+
+    for (i = 0; i < n; ++i) {
+        string_delete(arr[i]);
+    }
+    free(views);
+    free(arr);
+}
+
+static void test_string_view_sort_prefixes(void)
+{
+    const size_t n = 3000;
+    struct string_view *views;
+    char *chars;
+    unsigned long state = 3;
+    size_t i;
+
+    chars = malloc(n);
+    memset(chars, 'x', n);
+    views = calloc(n, sizeof(*views));
+
+    // Each string is a prefix of the longer ones, in random order.
+    for (i = 0; i < n; ++i) {
+        views[i].buf = chars;
+        views[i].len = i;
+    }
+    for (i = n - 1; i > 0; --i) {
+        size_t j = next_random(&state) % (i + 1);
+        struct string_view tmp = views[i];
+
+        views[i] = views[j];
+        views[j] = tmp;
+    }
+
+    assert(0 == string_view_sort(views, n));
+    for (i = 0; i < n; ++i) {
+        assert(i == views[i].len);
+    }
+
+    free(views);
+    free(chars);
+}
+
+static void test_string_view_sort(void)
+{
+    struct string_view views[6] = {
+        { "cherry", 6 }, { "apple", 5 }, { "banana", 6 }, { "apple pie", 5 }, { "blueberry pie", 13 }, { "blueberry", 9 },
+    };
+
+    assert(-EFAULT == string_view_sort(NULL, 0));
+
+    assert(0 == string_view_sort(views, 0));
+
+    assert(-ENOMEM == string_view_sort(views, SIZE_MAX));
+
+    memory_shim_fail_at(1);
+    assert(-ENOMEM == string_view_sort(views, 6));
+    memory_shim_reset();
+
+    views[2].buf = NULL;
+    assert(-EFAULT == string_view_sort(views, 6));
+    views[2].buf = "banana";
+
+    assert(0 == string_view_sort(views, 6));
+    assert(0 == memcmp(views[0].buf, "apple", 5));
+    assert(0 == memcmp(views[1].buf, "apple", 5));
+    assert(0 == memcmp(views[2].buf, "banana", 6));
+    assert(9 == views[3].len);
+    assert(13 == views[4].len);
+    assert(0 == memcmp(views[5].buf, "cherry", 6));
+}
+
+static void test_string_view_sort_parallel(void)
+{
+    const size_t n = 100000;
+    char *chars;
+    struct string_view *views;
+    unsigned long state = 2;
+    size_t i;
+
+    assert(-EFAULT == string_view_sort_parallel(NULL, 0, 4));
+
+    chars = malloc(n * 64);
+    views = calloc(n, sizeof(*views));
+
+    // Many duplicates.
+    for (i = 0; i < n; ++i) {
+        views[i].buf = &chars[i * 64];
+        views[i].len = make_key(&chars[i * 64], 64, (unsigned)(next_random(&state) % 2), &state) / 2;
+    }
+
+    assert(0 == string_view_sort_parallel(views, n, 3));
+    assert(is_sorted(views, n));
+
+    free(views);
+    free(chars);
+}
+
+int main(void)
+{
+    test_string_sort();
+    test_string_sort_parallel();
+    test_string_view_sort();
+    test_string_view_sort_prefixes();
+    test_string_view_sort_parallel();
+    return 0;
+}
@@ -0,0 +1,286 @@
+#include "string_trace.h"
+
+#include "cstring_inline.h"
+#include "memory_shim.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/// Number of objects created by the workload, more than fit in the initial table of a replay.
+#define MANY_OBJECTS 100
+
+/// Number of calls appending to them, more than fit in the buffer of a replay.
+#define MANY_CALLS 30000
+
+/// @return New temporary file, removed from the file system.
+static int temp_file(void)
+{
+    char path[] = "/tmp/test_string_trace.XXXXXX";
+    int fd = mkstemp(path);
+
+    assert(fd >= 0);
+    assert(0 == unlink(path));
+    return fd;
+}
+
+/// Replay a trace of STRING_TRACE_MAGIC followed by the @c n characters of @c s.
+static int replay_bytes(size_t n, const char *s, struct string_trace_stats *stats)
+{
+    int fd = temp_file();
+    int r;
+
+    assert(8 == write(fd, STRING_TRACE_MAGIC, 8));
+    assert((ssize_t)n == write(fd, s, n));
+    assert(0 == lseek(fd, 0, SEEK_SET));
+    r = string_trace_replay(fd, stats);
+    close(fd);
+    return r;
+}
+
+/// Replay a trace of the @c n fields @c v.
+static int replay_fields(size_t n, const size_t *v, struct string_trace_stats *stats)
+{
+    static char buf[4096];
+    size_t len = 0;
+    size_t i;
+
+    for (i = 0; i < n; ++i) {
+        size_t f = v[i];
+
+        for (; f >= 0x80; f >>= 7) {
+            buf[len++] = (char)(f | 0x80);
+        }
+        buf[len++] = (char)f;
+    }
+    return replay_bytes(len, buf, stats);
+}
+
+/// Call every recorded function, and the inline fast paths within capacity, including on @c pre, which
+/// exists before recording starts.
+/// @return Number of calls.
+static size_t workload(struct string *pre)
+{
+    static const uint16_t u16[] = { 'a', 0xe9 };
+    static const uint32_t u32[] = { 'a', 0x1f600 };
+    const char *texts[] = { "a", "b" };
+    const size_t lens[] = { 1, 1 };
+    struct string *many[MANY_OBJECTS];
+    struct string *parts[2];
+    struct string *s = NULL;
+    struct string *t = NULL;
+    struct string *sub = NULL;
+    uint16_t b16[4];
+    uint32_t b32[4];
+    size_t n;
+    char *p;
+    size_t i;
+
+    s = string_new();
+    t = string_new_adopt(malloc(16), 0, 15);
+    assert(0 == string_reserve(s, 100000));
+    assert(0 == string_append_buffer(s, 3, "abc"));
+    assert(0 == string_append_c_str(s, "def"));
+    assert(0 == string_append_fill(s, 2, 'g'));
+    assert(0 == string_insert_buffer(s, 0, 2, "xy"));
+    assert(0 == string_insert_c_str(s, 1, "z"));
+    assert(0 == string_insert_fill(s, 2, 3, 'w'));
+    assert(0 == string_erase(s, 0, 2));
+    assert(0 == string_apply_edits(s, &(struct string_edit){ 0, 1, 2, "ab" }, 1));
+    assert(0 == string_push_back(s, 'h'));
+    assert(0 == string_pop_back(s));
+    assert(0 == string_push_back_inline(s, 'i'));
+    assert(0 == string_append_buffer_inline(s, 2, "jk"));
+    string_at_inline(s, 1);
+    assert(0 == string_to_lower(s));
+    assert(0 == string_to_upper(s));
+    string_at(s, 1);
+    string_c_str(s);
+    string_as_view(s);
+    string_casecmp(s, t);
+    string_case_find(s, 0, 2, "AB");
+    string_equal(s, t);
+    string_compare(s, t);
+    string_starts_with(s, 1, "A");
+    string_ends_with(s, 1, "G");
+    string_common_prefix(s, t);
+    string_hash_track(s, true);
+    string_hash(s);
+    assert(0 == string_assign_buffer(t, 4, "text"));
+    p = string_resize_uninit(t, 6);
+    memcpy(p, "texted", 6);
+    p = string_reserve_tail(t, 2);
+    memcpy(p, "!!", 2);
+    assert(0 == string_commit(t, 2));
+    parts[0] = t;
+    parts[1] = pre;
+    assert(0 == string_join(s, t, parts, 2));
+    assert(0 == string_join_buffer(s, 1, ",", texts, lens, 2));
+    string_utf8_validate(s);
+    string_utf8_length(s);
+    n = 4;
+    string_utf8_to_utf16(s, NULL, &n);
+    n = 4;
+    string_utf8_to_utf16(s, b16, &n);
+    n = 4;
+    string_utf8_to_utf32(s, b32, &n);
+    assert(0 == string_append_utf16(s, 2, u16));
+    assert(0 == string_append_utf32(s, 2, u32));
+    assert(0 == string_append_fill(s, 1000, 'q'));
+    sub = string_substr(s, 1, 5);
+    assert(0 == string_move(t, sub));
+    string_swap(s, t);
+    assert(0 == string_compress(t, 0));
+    free(string_c_str_move(t));
+    string_clear(s);
+    string_delete(NULL);
+
+    for (i = 0; i < MANY_OBJECTS; ++i) {
+        many[i] = string_new();
+    }
+    for (i = 0; i < MANY_CALLS; ++i) {
+        string_push_back(many[i % MANY_OBJECTS], 'x');
+    }
+    for (i = 0; i < MANY_OBJECTS; ++i) {
+        string_delete(many[i]);
+    }
+
+    string_delete(sub);
+    string_delete(t);
+    string_delete(s);
+    return 54 + 2 * MANY_OBJECTS + MANY_CALLS;
+}
+
+static void test_string_trace_replay(void)
+{
+    struct string_trace_stats stats;
+    struct string *pre = NULL;
+    size_t calls;
+    int fd = temp_file();
+
+    pre = string_new();
+    assert(0 == string_trace_start(fd));
+    calls = workload(pre);
+    assert(0 == string_trace_stop());
+    string_delete(pre);
+
+    assert(0 == lseek(fd, 0, SEEK_SET));
+    assert(0 == string_trace_replay(fd, &stats));
+    assert(calls == stats.calls);
+    assert(MANY_OBJECTS + 1 <= stats.objects);
+    assert(MANY_OBJECTS <= stats.allocations);
+    assert(100001 <= stats.peak);
+    assert(0 < stats.nanoseconds);
+    close(fd);
+}
+
+static void test_string_trace_replay_errors(void)
+{
+    static const char too_large[] = "\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\x01";
+    static const size_t truncated[] = {
+        STRING_TRACE_NEW_ADOPT, STRING_TRACE_MOVE, STRING_TRACE_SUBSTR, STRING_TRACE_ERASE, STRING_TRACE_RESERVE,
+        STRING_TRACE_APPLY_EDITS, STRING_TRACE_JOIN, STRING_TRACE_JOIN_BUFFER,
+    };
+    struct string_trace_stats stats;
+    size_t v[2 * 33];
+    int fds[2];
+    int fd;
+    size_t i;
+
+    fd = temp_file();
+    assert(-EFAULT == string_trace_replay(fd, NULL));
+    assert(-EILSEQ == string_trace_replay(fd, &stats));
+    assert(8 == write(fd, "CSTRACE0", 8));
+    assert(0 == lseek(fd, 0, SEEK_SET));
+    assert(-EILSEQ == string_trace_replay(fd, &stats));
+    close(fd);
+    assert(-EBADF == string_trace_replay(-1, &stats));
+
+    // Empty trace.
+    assert(0 == replay_bytes(0, "", &stats));
+    assert(0 == stats.calls);
+    assert(0 == stats.objects);
+
+    memory_shim_fail_at(1);
+    assert(-ENOMEM == replay_bytes(0, "", &stats));
+    memory_shim_fail_at(2);
+    assert(-ENOMEM == replay_bytes(0, "", &stats));
+    memory_shim_reset();
+
+    // Invalid encodings and operations, and truncated records.
+    assert(-EILSEQ == replay_bytes(1, "\x80", &stats));
+    assert(-EILSEQ == replay_bytes(2, "\x80\x00", &stats));
+    assert(-EILSEQ == replay_bytes(sizeof(too_large) - 1, too_large, &stats));
+    assert(-EILSEQ == replay_fields(2, (const size_t[]){ 99, 16 }, &stats));
+    assert(-EILSEQ == replay_fields(1, (const size_t[]){ STRING_TRACE_CLEAR }, &stats));
+    for (i = 0; i < sizeof(truncated) / sizeof(truncated[0]); ++i) {
+        v[0] = truncated[i];
+        v[1] = 16;
+        assert(-EILSEQ == replay_fields(2, v, &stats));
+    }
+    assert(-EILSEQ == replay_fields(3, (const size_t[]){ STRING_TRACE_SUBSTR, 16, 0 }, &stats));
+    assert(-EILSEQ == replay_fields(3, (const size_t[]){ STRING_TRACE_JOIN_BUFFER, 16, 0 }, &stats));
+
+    // Calls that failed when recorded fail again.
+    assert(0 == replay_fields(4, (const size_t[]){ STRING_TRACE_NEW_ADOPT, 16, 2, 1 }, &stats));
+    assert(1 == stats.calls);
+    assert(0 == stats.objects);
+
+    // An address reused without a recorded deletion replaces the object.
+    assert(0 == replay_fields(4, (const size_t[]){ STRING_TRACE_NEW, 16, STRING_TRACE_NEW, 0 }, &stats));
+    assert(2 == stats.calls);
+    assert(1 == stats.objects);
+
+    // Lengths too large for the content used in place of characters.
+    assert(-ENOMEM == replay_fields(3, (const size_t[]){ STRING_TRACE_APPEND_BUFFER, 16, SIZE_MAX }, &stats));
+    assert(-ENOMEM == replay_fields(3, (const size_t[]){ STRING_TRACE_APPLY_EDITS, 16, SIZE_MAX }, &stats));
+    assert(-ENOMEM == replay_fields(6, (const size_t[]){ STRING_TRACE_APPLY_EDITS, 16, 1, 0, 0, SIZE_MAX }, &stats));
+    assert(-ENOMEM == replay_fields(4, (const size_t[]){ STRING_TRACE_JOIN, 16, 0, SIZE_MAX }, &stats));
+    assert(-ENOMEM == replay_fields(4, (const size_t[]){ STRING_TRACE_JOIN_BUFFER, 16, SIZE_MAX, 0 }, &stats));
+    assert(-ENOMEM == replay_fields(4, (const size_t[]){ STRING_TRACE_JOIN_BUFFER, 16, 0, SIZE_MAX }, &stats));
+    assert(-ENOMEM == replay_fields(5, (const size_t[]){ STRING_TRACE_JOIN_BUFFER, 16, 0, 1, SIZE_MAX }, &stats));
+
+    // Allocation failures: objects created on demand, content, lengths.
+    memory_shim_fail_at(3);
+    assert(-ENOMEM == replay_fields(2, (const size_t[]){ STRING_TRACE_CLEAR, 16 }, &stats));
+    memory_shim_fail_at(4);
+    assert(-ENOMEM == replay_fields(3, (const size_t[]){ STRING_TRACE_APPEND_BUFFER, 16, 1 }, &stats));
+    memory_shim_fail_at(5);
+    assert(-ENOMEM == replay_fields(5, (const size_t[]){ STRING_TRACE_JOIN_BUFFER, 16, 0, 1, 1 }, &stats));
+    memory_shim_reset();
+
+    // Objects beyond the initial table, each 8 bytes after the previous one.
+    for (i = 0; i < 33; ++i) {
+        v[2 * i] = STRING_TRACE_NEW;
+        v[2 * i + 1] = 16;
+    }
+    assert(0 == replay_fields(2 * 33, v, &stats));
+    assert(33 == stats.objects);
+    memory_shim_fail_at(36);
+    assert(-ENOMEM == replay_fields(2 * 33, v, &stats));
+
+    // The last object is used without being created.
+    v[2 * 32] = STRING_TRACE_CLEAR;
+    memory_shim_fail_at(35);
+    assert(-ENOMEM == replay_fields(2 * 33, v, &stats));
+    memory_shim_reset();
+
+    // Read errors after the header.
+    assert(0 == pipe(fds));
+    assert(0 == fcntl(fds[0], F_SETFL, O_NONBLOCK));
+    assert(10 == write(fds[1], STRING_TRACE_MAGIC "\x01\x10", 10));
+    assert(-EAGAIN == string_trace_replay(fds[0], &stats));
+    close(fds[0]);
+    close(fds[1]);
+}
+
+int main(void)
+{
+    test_string_trace_replay();
+    test_string_trace_replay_errors();
+    return 0;
+}
@@ -0,0 +1,253 @@
+#include "string_vec.h"
+
+#include "memory_shim.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/// @return True if element @c i of @c vec contains expected content, false otherwise.
+static bool verify_element(const struct string_vec *vec, size_t i, const char *expected)
+{
+    struct string_view view;
+
+    assert(expected);
+    view = string_vec_at(vec, i);
+    return view.buf && view.len == strlen(expected) && memcmp(view.buf, expected, view.len) == 0;
+}
+
+static void test_string_vec_new(void)
+{
+    struct string_vec *vec = NULL;
+
+    memory_shim_fail_at(1);
+    errno = 0;
+    vec = string_vec_new();
+    memory_shim_reset();
+    assert(NULL == vec);
+    assert(ENOMEM == errno);
+}
+
+static void test_string_vec_delete(void)
+{
+    struct string_vec *vec = NULL;
+
+    string_vec_delete(NULL);
+
+    vec = string_vec_new();
+
+    string_vec_delete(vec);
+
+    vec = string_vec_new();
+    assert(0 == string_vec_push_back(vec, 3, "abc"));
+    string_vec_delete(vec);
+}
+
+static void test_string_vec_size(void)
+{
+    struct string_vec *vec = NULL;
+
+    assert(0 == string_vec_size(NULL));
+
+    vec = string_vec_new();
+
+    assert(0 == string_vec_size(vec));
+    assert(0 == string_vec_push_back(vec, 0, ""));
+    assert(1 == string_vec_size(vec));
+
+    string_vec_delete(vec);
+}
+
+static void test_string_vec_clear(void)
+{
+    struct string_vec *vec = NULL;
+
+    string_vec_clear(NULL);
+
+    vec = string_vec_new();
+
+    assert(0 == string_vec_push_back(vec, 3, "abc"));
+    assert(0 == string_vec_push_back(vec, 3, "def"));
+    string_vec_clear(vec);
+    assert(0 == string_vec_size(vec));
+
+    // Storage is reused.
+    memory_shim_fail_at(1);
+    assert(0 == string_vec_push_back(vec, 3, "ghi"));
+    memory_shim_reset();
+    assert(verify_element(vec, 0, "ghi"));
+
+    string_vec_delete(vec);
+}
+
+static void test_string_vec_reserve(void)
+{
+    struct string_vec *vec = NULL;
+
+    assert(-EFAULT == string_vec_reserve(NULL, 1, 1));
+
+    vec = string_vec_new();
+
+    assert(-ENOMEM == string_vec_reserve(vec, 1, SIZE_MAX));
+    assert(-ENOMEM == string_vec_reserve(vec, SIZE_MAX / 2, 0));
+
+    memory_shim_fail_at(1);
+    assert(-ENOMEM == string_vec_reserve(vec, 2, 10));
+    memory_shim_reset();
+
+    memory_shim_fail_at(2);
+    assert(-ENOMEM == string_vec_reserve(vec, 2, 10));
+    memory_shim_reset();
+
+    assert(0 == string_vec_reserve(vec, 2, 10));
+    assert(0 == string_vec_reserve(vec, 0, 0));
+
+    // No allocation needed within reserved storage.
+    memory_shim_fail_at(1);
+    assert(0 == string_vec_push_back(vec, 5, "01234"));
+    assert(0 == string_vec_push_back(vec, 5, "56789"));
+    memory_shim_reset();
+
+    assert(verify_element(vec, 0, "01234"));
+    assert(verify_element(vec, 1, "56789"));
+
+    string_vec_delete(vec);
+}
+
+static void test_string_vec_push_back(void)
+{
+    struct string_vec *vec = NULL;
+    char buf[16];
+    size_t i;
+
+    assert(-EFAULT == string_vec_push_back(NULL, 3, "abc"));
+
+    vec = string_vec_new();
+
+    assert(-EFAULT == string_vec_push_back(vec, 3, NULL));
+    assert(-ENOMEM == string_vec_push_back(vec, SIZE_MAX, "abc"));
+
+    memory_shim_fail_at(1);
+    assert(-ENOMEM == string_vec_push_back(vec, 3, "abc"));
+    memory_shim_reset();
+
+    memory_shim_fail_at(2);
+    assert(-ENOMEM == string_vec_push_back(vec, 3, "abc"));
+    memory_shim_reset();
+    assert(0 == string_vec_size(vec));
+
+    // Embedded NUL.
+    assert(0 == string_vec_push_back(vec, 3, "a\0c"));
+    assert(3 == string_vec_at(vec, 0).len);
+
+    for (i = 0; i < 1000; ++i) {
+        snprintf(buf, sizeof(buf), "%zu", i);
+        assert(0 == string_vec_push_back(vec, strlen(buf), buf));
+    }
+
+    assert(1001 == string_vec_size(vec));
+    for (i = 0; i < 1000; ++i) {
+        snprintf(buf, sizeof(buf), "%zu", i);
+        assert(verify_element(vec, i + 1, buf));
+        // NUL terminated.
+        assert(0 == strcmp(string_vec_at(vec, i + 1).buf, buf));
+    }
+
+    string_vec_delete(vec);
+}
+
+static void test_string_vec_push_back_string(void)
+{
+    struct string_vec *vec = NULL;
+    struct string *s = NULL;
+
+    assert(-EFAULT == string_vec_push_back_string(NULL, NULL));
+
+    vec = string_vec_new();
+    s = string_new();
+
+    assert(-EFAULT == string_vec_push_back_string(vec, NULL));
+
+    assert(0 == string_append_c_str(s, "from string"));
+    assert(0 == string_vec_push_back_string(vec, s));
+    assert(verify_element(vec, 0, "from string"));
+
+    string_delete(s);
+    string_vec_delete(vec);
+}
+
+static void test_string_vec_at(void)
+{
+    struct string_vec *vec = NULL;
+    struct string_view view;
+
+    view = string_vec_at(NULL, 0);
+    assert(NULL == view.buf);
+    assert(0 == view.len);
+
+    vec = string_vec_new();
+
+    view = string_vec_at(vec, 0);
+    assert(NULL == view.buf);
+
+    assert(0 == string_vec_push_back(vec, 0, ""));
+    view = string_vec_at(vec, 0);
+    assert(NULL != view.buf);
+    assert(0 == view.len);
+
+    view = string_vec_at(vec, 1);
+    assert(NULL == view.buf);
+
+    string_vec_delete(vec);
+}
+
+static void test_string_vec_sort(void)
+{
+    static const char *const words[] = { "pear", "apple", "", "fig", "apples", "Zebra", "\x80", "apple" };
+    static const char *const sorted[] = { "", "Zebra", "apple", "apple", "apples", "fig", "pear", "\x80" };
+    struct string_vec *vec = NULL;
+    size_t i;
+
+    assert(-EFAULT == string_vec_sort(NULL));
+
+    vec = string_vec_new();
+
+    assert(0 == string_vec_sort(vec));
+
+    for (i = 0; i < sizeof(words) / sizeof(words[0]); ++i) {
+        assert(0 == string_vec_push_back(vec, strlen(words[i]), words[i]));
+    }
+
+    memory_shim_fail_at(1);
+    assert(-ENOMEM == string_vec_sort(vec));
+    memory_shim_reset();
+    assert(verify_element(vec, 0, "pear"));
+
+    assert(0 == string_vec_sort(vec));
+    for (i = 0; i < sizeof(sorted) / sizeof(sorted[0]); ++i) {
+        assert(verify_element(vec, i, sorted[i]));
+    }
+
+    // Elements may still be appended.
+    assert(0 == string_vec_push_back(vec, 1, "b"));
+    assert(verify_element(vec, 8, "b"));
+
+    string_vec_delete(vec);
+}
+
+int main(void)
+{
+    test_string_vec_new();
+    test_string_vec_delete();
+    test_string_vec_size();
+    test_string_vec_clear();
+    test_string_vec_reserve();
+    test_string_vec_push_back();
+    test_string_vec_push_back_string();
+    test_string_vec_at();
+    test_string_vec_sort();
+    return 0;
+}
@@ -0,0 +1,310 @@
+#include "string_writer.h"
+
+#include "memory_shim.h"
+
+#include <assert.h>
+#include <dlfcn.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/// Number of strings written in tests of ordering.
+#define MANY_STRINGS 1000
+
+/// Size of string written to a pipe, larger than the pipe buffer.
+#define LARGE_SIZE ((size_t)1 << 20)
+
+/// Error returned by the next call to pthread_create(), or zero to create the thread.
+static int g_pthread_create_error;
+
+int pthread_create(pthread_t *id, const pthread_attr_t *attr, void *(*start)(void *), void *arg)
+{
+    static int (*libc_pthread_create)(pthread_t *, const pthread_attr_t *, void *(*)(void *), void *);
+    int r = g_pthread_create_error;
+
+    if (r != 0) {
+        g_pthread_create_error = 0;
+        return r;
+    }
+    if (!libc_pthread_create) {
+        *(void **)&libc_pthread_create = dlsym(RTLD_NEXT, "pthread_create");
+    }
+    return libc_pthread_create(id, attr, start, arg);
+}
+
+/// Completions seen by the callback.
+struct completions {
+    size_t count;
+    int err;
+    struct string *last;
+};
+
+static void complete(void *ctx, struct string *str, int err)
+{
+    struct completions *c = ctx;
+
+    ++c->count;
+    c->err = err;
+    string_delete(c->last);
+    c->last = str;
+}
+
+/// @return New string holding the line "line <n>\n".
+static struct string *new_line(size_t n)
+{
+    struct string *s = NULL;
+    char buf[32];
+
+    s = string_new();
+    assert(s);
+    assert(0 == string_append_buffer(s, (size_t)snprintf(buf, sizeof(buf), "line %zu\n", n), buf));
+    return s;
+}
+
+/// @return New temporary file, removed from the file system.
+static int temp_file(void)
+{
+    char path[] = "/tmp/test_string_writer.XXXXXX";
+    int fd = mkstemp(path);
+
+    assert(fd >= 0);
+    assert(0 == unlink(path));
+    return fd;
+}
+
+/// @return True if file @c fd holds the lines of new_line() from 0 to @c n - 1, false otherwise.
+static bool verify_lines(int fd, size_t n)
+{
+    struct string *expected = NULL;
+    struct string *actual = NULL;
+    char buf[4096];
+    ssize_t r;
+    bool equal;
+    size_t i;
+
+    expected = string_new();
+    actual = string_new();
+    for (i = 0; i < n; ++i) {
+        struct string *line = new_line(i);
+
+        assert(0 == string_append_buffer(expected, string_size(line), string_c_str(line)));
+        string_delete(line);
+    }
+
+    assert(0 == lseek(fd, 0, SEEK_SET));
+    while ((r = read(fd, buf, sizeof(buf))) > 0) {
+        assert(0 == string_append_buffer(actual, (size_t)r, buf));
+    }
+
+    equal = string_equal(expected, actual);
+    string_delete(expected);
+    string_delete(actual);
+    return equal;
+}
+
+static void test_string_writer_new(void)
+{
+    struct string_writer *w = NULL;
+
+    memory_shim_fail_at(1);
+    errno = 0;
+    assert(NULL == string_writer_new(1, NULL, NULL));
+    assert(ENOMEM == errno);
+    memory_shim_reset();
+
+    g_pthread_create_error = EAGAIN;
+    errno = 0;
+    assert(NULL == string_writer_new(1, NULL, NULL));
+    assert(EAGAIN == errno);
+
+    assert(-EFAULT == string_writer_submit(NULL, NULL));
+    assert(0 == string_writer_pending(NULL));
+    assert(-EFAULT == string_writer_flush(NULL));
+    string_writer_delete(NULL);
+
+    // Nothing submitted.
+    w = string_writer_new(1, NULL, NULL);
+    assert(w);
+    assert(-EFAULT == string_writer_submit(w, NULL));
+    assert(0 == string_writer_flush(w));
+    string_writer_delete(w);
+}
+
+static void test_string_writer_submit(void)
+{
+    struct completions c = { 0, 0, NULL };
+    struct string_writer *w = NULL;
+    struct string *s = NULL;
+    int fd = temp_file();
+    size_t i;
+
+    w = string_writer_new(fd, complete, &c);
+
+    s = new_line(0);
+    memory_shim_fail_at(1);
+    assert(-ENOMEM == string_writer_submit(w, s));
+    memory_shim_reset();
+
+    // Strings are written in order, whether submitted while the thread is busy or idle.
+    assert(0 == string_writer_submit(w, s));
+    for (i = 1; i < MANY_STRINGS; ++i) {
+        assert(0 == string_writer_submit(w, new_line(i)));
+    }
+    assert(0 == string_writer_flush(w));
+    assert(0 == string_writer_pending(w));
+    assert(MANY_STRINGS == c.count);
+    assert(0 == c.err);
+    assert(0 == strcmp(string_c_str(c.last), "line 999\n"));
+
+    assert(0 == string_writer_submit(w, new_line(MANY_STRINGS)));
+    assert(0 == string_writer_flush(w));
+    assert(verify_lines(fd, MANY_STRINGS + 1));
+
+    string_writer_delete(w);
+    string_delete(c.last);
+    close(fd);
+}
+
+static void test_string_writer_delete(void)
+{
+    struct string_writer *w = NULL;
+    int fd = temp_file();
+    size_t i;
+
+    // Without a callback, strings are deleted once written; deleting the writer waits for them.
+    w = string_writer_new(fd, NULL, NULL);
+    for (i = 0; i < MANY_STRINGS; ++i) {
+        assert(0 == string_writer_submit(w, new_line(i)));
+    }
+    string_writer_delete(w);
+
+    assert(verify_lines(fd, MANY_STRINGS));
+    close(fd);
+}
+
+static void test_string_writer_error(void)
+{
+    struct completions c = { 0, 0, NULL };
+    struct string_writer *w = NULL;
+    int fd = open("/dev/null", O_RDONLY);
+
+    assert(fd >= 0);
+    w = string_writer_new(fd, complete, &c);
+
+    assert(0 == string_writer_submit(w, new_line(0)));
+    assert(0 == string_writer_submit(w, new_line(1)));
+    assert(-EBADF == string_writer_flush(w));
+    assert(2 == c.count);
+    assert(-EBADF == c.err);
+
+    // The error is reported once.
+    assert(0 == string_writer_flush(w));
+
+    string_writer_delete(w);
+    string_delete(c.last);
+    close(fd);
+}
+
+static void test_string_writer_compressed(void)
+{
+    struct completions c = { 0, 0, NULL };
+    struct string_writer *w = NULL;
+    struct string *s = NULL;
+    int fd = temp_file();
+
+    w = string_writer_new(fd, complete, &c);
+
+    // A string whose content cannot be expanded is not written, and completed with an error; so are the strings
+    // after it, whether taken in the same batch or not, so that the output has no gap.
+    s = string_new();
+    assert(0 == string_append_fill(s, 4000, 'x'));
+    assert(0 == string_compress(s, 0));
+    assert(string_compressed(s));
+    string_memory_set_budget(string_memory_total());
+    assert(0 == string_writer_submit(w, new_line(0)));
+    assert(0 == string_writer_submit(w, s));
+    assert(0 == string_writer_submit(w, new_line(1)));
+    assert(-ENOMEM == string_writer_flush(w));
+    assert(3 == c.count);
+    assert(-ENOMEM == c.err);
+    assert(string_compressed(s));
+    string_memory_set_budget(SIZE_MAX);
+    assert(verify_lines(fd, 1));
+
+    // Once reported, later strings are written, and the error is reported once.
+    assert(0 == string_writer_submit(w, new_line(1)));
+    assert(0 == string_writer_flush(w));
+    assert(0 == c.err);
+    assert(verify_lines(fd, 2));
+
+    string_writer_delete(w);
+    string_delete(c.last);
+    close(fd);
+}
+
+/// Read end of pipe, and number of bytes read from it.
+struct reader {
+    int fd;
+    size_t n;
+};
+
+static void *drain(void *arg)
+{
+    struct reader *r = arg;
+    struct timespec delay = { 0, 10 * 1000 * 1000 };
+    char buf[4096];
+    ssize_t k;
+
+    // Let the writer fill the pipe first.
+    nanosleep(&delay, NULL);
+
+    while ((k = read(r->fd, buf, sizeof(buf))) > 0) {
+        r->n += (size_t)k;
+    }
+    return NULL;
+}
+
+static void test_string_writer_nonblocking(void)
+{
+    struct string_writer *w = NULL;
+    struct string *s = NULL;
+    struct reader r = { 0, 0 };
+    pthread_t id;
+    int fds[2];
+
+    assert(0 == pipe(fds));
+    assert(0 == fcntl(fds[1], F_SETFL, O_NONBLOCK));
+    r.fd = fds[0];
+    assert(0 == pthread_create(&id, NULL, drain, &r));
+
+    // Partial writes are resumed once the pipe has room.
+    s = string_new();
+    assert(0 == string_append_fill(s, LARGE_SIZE, 'x'));
+    w = string_writer_new(fds[1], NULL, NULL);
+    assert(0 == string_writer_submit(w, s));
+    assert(0 == string_writer_submit(w, new_line(0)));
+    assert(0 == string_writer_flush(w));
+    string_writer_delete(w);
+
+    close(fds[1]);
+    assert(0 == pthread_join(id, NULL));
+    assert(LARGE_SIZE + strlen("line 0\n") == r.n);
+    close(fds[0]);
+}
+
+int main(void)
+{
+    test_string_writer_new();
+    test_string_writer_submit();
+    test_string_writer_delete();
+    test_string_writer_error();
+    test_string_writer_compressed();
+    test_string_writer_nonblocking();
+    return 0;
+}
@@ -0,0 +1,57 @@
+// Replay traces recorded with string_trace_start(), and print their measurements.
+//
+// Usage: string_replay TRACE...
+//
+// Comparing the output of builds of this library (for example with another growth
+// factor, or size of internal storage) measures the change against real traffic.
+
+#include "string_trace.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+int main(int argc, char **argv)
+{
+    struct string_trace_stats stats;
+    int status = 0;
+    int fd;
+    int i;
+    int r;
+
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s TRACE...\n", argv[0]);
+        return 2;
+    }
+
+    printf("%-32s %12s %12s %10s %12s %14s\n", "trace", "calls", "calls/s", "objects", "allocations", "peak bytes");
+
+    for (i = 1; i < argc; ++i) {
+        fd = open(argv[i], O_RDONLY);
+        if (fd < 0) {
+            perror(argv[i]);
+            status = 1;
+            continue;
+        }
+
+        r = string_trace_replay(fd, &stats);
+        close(fd);
+
+        if (r < 0) {
+            fprintf(stderr, "%s: %s\n", argv[i], strerror(-r));
+            status = 1;
+            continue;
+        }
+
+        printf("%-32s %12zu %12.0f %10zu %12zu %14zu\n",
+               argv[i],
+               stats.calls,
+               (stats.nanoseconds > 0) ? stats.calls * 1e9 / (double)stats.nanoseconds : 0.0,
+               stats.objects,
+               stats.allocations,
+               stats.peak);
+    }
+
+    return status;
+}